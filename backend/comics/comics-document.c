@@ -35,9 +35,39 @@
 #include "ev-document-misc.h"
 #include "ev-file-helpers.h"
 #include "ev-archive.h"
+#include "ev-image-size.h"
 
 #define BLOCK_SIZE 10240
 
+/* How much of an image is read looking for its size in the
+ * header, before decoding it to get the size instead */
+#define HEADER_MAX_SIZE (256 * 1024)
+
+/* Decompressed entries of solid archives kept around, since
+ * reaching them again means decompressing all the ones before */
+#define ENTRY_CACHE_MAX_SIZE (64 * 1024 * 1024)
+#define ENTRY_CACHE_READAHEAD 16
+
+/* Decompression states saved in solid RAR archives, so that reaching
+ * an entry means decompressing at most CHECKPOINT_INTERVAL bytes. Each
+ * one holds a 4 MiB window; when there are too many the interval is
+ * doubled, dropping every other one */
+#define CHECKPOINT_INTERVAL (16 * 1024 * 1024)
+#define CHECKPOINTS_MAX 8
+
+typedef struct {
+	gint64   offset;
+	gboolean solid;
+} PageEntry;
+
+/* The data of an entry in the entry cache, with its link in the LRU
+ * queue. The page name is owned by page_names */
+typedef struct {
+	const gchar *page_path;
+	GBytes      *bytes;
+	GList       *link;
+} CachedEntry;
+
 typedef struct _ComicsDocumentClass ComicsDocumentClass;
 
 struct _ComicsDocumentClass
@@ -52,6 +82,21 @@ struct _ComicsDocument
 	gchar         *archive_path;
 	gchar         *archive_uri;
 	GPtrArray     *page_names;
+
+	/* Page name to the PageEntry with the offset of its entry,
+	 * or -1 if it can only be found by reading the archive */
+	GHashTable    *page_entries;
+
+	GMutex         entry_cache_lock;
+	GHashTable    *entry_cache;
+	GQueue         entry_cache_lru;
+	gsize          entry_cache_size;
+
+	/* EvArchiveCheckpoints sorted by offset */
+	GMutex         checkpoints_lock;
+	GList         *checkpoints;
+	guint          n_checkpoints;
+	gint64         checkpoint_interval;
 };
 
 static GSList* get_supported_image_extensions (void);
@@ -107,12 +152,15 @@ comics_document_list (ComicsDocument  *comics_document,
 
 	while (1) {
 		const char *name;
+		gchar *name_copy;
+		PageEntry *entry;
 
 		if (!ev_archive_read_next_header (comics_document->archive, error)) {
 			if (*error != NULL) {
 				g_debug ("Fatal error handling archive: %s", (*error)->message);
 				g_clear_error (error);
 
+				g_hash_table_remove_all (comics_document->page_entries);
 				g_ptr_array_free (array, TRUE);
 
 				g_set_error_literal (error,
@@ -137,10 +185,17 @@ comics_document_list (ComicsDocument  *comics_document,
 		}
 
 		g_debug ("Adding '%s' to the list of files in the comics", name);
-		g_ptr_array_add (array, g_strdup (name));
+		name_copy = g_strdup (name);
+		g_ptr_array_add (array, name_copy);
+
+		entry = g_new (PageEntry, 1);
+		entry->offset = ev_archive_get_entry_offset (comics_document->archive);
+		entry->solid = ev_archive_get_entry_is_solid (comics_document->archive);
+		g_hash_table_insert (comics_document->page_entries, name_copy, entry);
 	}
 
 	if (array->len == 0) {
+		g_hash_table_remove_all (comics_document->page_entries);
 		g_ptr_array_free (array, TRUE);
 		array = NULL;
 
@@ -301,6 +356,351 @@ get_page_size_prepared_cb (GdkPixbufLoader *loader,
 	info->width = width;
 }
 
+static void
+get_page_size_from_data (GdkPixbufLoader *loader,
+			 GBytes          *bytes,
+			 PixbufInfo      *info)
+{
+	const guchar *data;
+	gsize         length;
+
+	data = g_bytes_get_data (bytes, &length);
+	if (ev_image_size_from_header (data, length, &info->width, &info->height) == EV_IMAGE_SIZE_FOUND) {
+		info->got_info = TRUE;
+		return;
+	}
+
+	gdk_pixbuf_loader_write (loader, data, length, NULL);
+}
+
+static void
+cached_entry_free (CachedEntry *cached)
+{
+	g_bytes_unref (cached->bytes);
+	g_slice_free (CachedEntry, cached);
+}
+
+static GBytes *
+comics_document_lookup_entry (ComicsDocument *comics_document,
+			      const char     *page_path)
+{
+	CachedEntry *cached;
+	GBytes      *bytes = NULL;
+
+	g_mutex_lock (&comics_document->entry_cache_lock);
+	cached = g_hash_table_lookup (comics_document->entry_cache, page_path);
+	if (cached) {
+		g_queue_unlink (&comics_document->entry_cache_lru, cached->link);
+		g_queue_push_head_link (&comics_document->entry_cache_lru, cached->link);
+		bytes = g_bytes_ref (cached->bytes);
+	}
+	g_mutex_unlock (&comics_document->entry_cache_lock);
+
+	return bytes;
+}
+
+static void
+comics_document_cache_entry (ComicsDocument *comics_document,
+			     const char     *page_path,
+			     GBytes         *bytes)
+{
+	gpointer key;
+	gsize    size = g_bytes_get_size (bytes);
+
+	/* Keys are owned by page_names */
+	if (size > ENTRY_CACHE_MAX_SIZE / 4 ||
+	    !g_hash_table_lookup_extended (comics_document->page_entries,
+					   page_path, &key, NULL))
+		return;
+
+	g_mutex_lock (&comics_document->entry_cache_lock);
+	if (!g_hash_table_contains (comics_document->entry_cache, key)) {
+		CachedEntry *cached = g_slice_new (CachedEntry);
+
+		cached->page_path = key;
+		cached->bytes = g_bytes_ref (bytes);
+		g_queue_push_head (&comics_document->entry_cache_lru, cached);
+		cached->link = comics_document->entry_cache_lru.head;
+		g_hash_table_insert (comics_document->entry_cache, key, cached);
+		comics_document->entry_cache_size += size;
+
+		while (comics_document->entry_cache_size > ENTRY_CACHE_MAX_SIZE) {
+			CachedEntry *old = g_queue_pop_tail (&comics_document->entry_cache_lru);
+
+			comics_document->entry_cache_size -= g_bytes_get_size (old->bytes);
+			g_hash_table_remove (comics_document->entry_cache, old->page_path);
+		}
+	}
+	g_mutex_unlock (&comics_document->entry_cache_lock);
+}
+
+static GBytes *
+comics_read_entry (EvArchive *archive,
+		   GError   **error)
+{
+	GByteArray *data;
+	GBytes *bytes;
+	gint64 size;
+	gssize read;
+
+	bytes = ev_archive_get_entry_bytes (archive);
+	if (bytes)
+		return bytes;
+
+	size = ev_archive_get_entry_size (archive);
+	data = g_byte_array_sized_new (size > 0 ? size : BLOCK_SIZE);
+
+	while (size < 0 || data->len < size) {
+		gsize count = size < 0 ? BLOCK_SIZE : size - data->len;
+
+		g_byte_array_set_size (data, data->len + count);
+		read = ev_archive_read_data (archive, data->data + data->len - count,
+					     count, error);
+		if (read < 0) {
+			g_byte_array_free (data, TRUE);
+			return NULL;
+		}
+
+		g_byte_array_set_size (data, data->len - count + read);
+		if (read == 0)
+			break;
+	}
+
+	return g_byte_array_free_to_bytes (data);
+}
+
+/* Returns whether a checkpoint at @offset and @position would be far
+ * enough from the one before it, and where to insert it */
+static gboolean
+comics_document_checkpoint_is_due (ComicsDocument *comics_document,
+				   gint64          offset,
+				   gint64          position,
+				   GList         **sibling)
+{
+	gint64 last_position = 0;
+	GList *l;
+
+	for (l = comics_document->checkpoints; l; l = l->next) {
+		EvArchiveCheckpoint *checkpoint = l->data;
+
+		if (ev_archive_checkpoint_get_offset (checkpoint) >= offset)
+			break;
+		last_position = ev_archive_checkpoint_get_position (checkpoint);
+	}
+
+	*sibling = l;
+	if (l && ev_archive_checkpoint_get_offset (l->data) == offset)
+		return FALSE;
+
+	/* A lower position starts another solid block */
+	return position < last_position ||
+		position - last_position >= comics_document->checkpoint_interval;
+}
+
+/* Saves a checkpoint at the entry @archive is positioned at, if
+ * none is close to it already */
+static void
+comics_document_add_checkpoint (ComicsDocument *comics_document,
+				EvArchive      *archive)
+{
+	EvArchiveCheckpoint *checkpoint;
+	GList   *sibling;
+	gint64   offset, position;
+	gboolean is_due;
+
+	position = ev_archive_get_entry_solid_position (archive);
+	if (position < 0)
+		return;
+	offset = ev_archive_get_entry_offset (archive);
+
+	g_mutex_lock (&comics_document->checkpoints_lock);
+	is_due = comics_document_checkpoint_is_due (comics_document, offset, position, &sibling);
+	g_mutex_unlock (&comics_document->checkpoints_lock);
+	if (!is_due)
+		return;
+
+	/* Copying the state takes a while, so do it unlocked */
+	checkpoint = ev_archive_save_checkpoint (archive);
+	if (!checkpoint)
+		return;
+
+	g_mutex_lock (&comics_document->checkpoints_lock);
+	if (!comics_document_checkpoint_is_due (comics_document, offset, position, &sibling)) {
+		g_mutex_unlock (&comics_document->checkpoints_lock);
+		ev_archive_checkpoint_free (checkpoint);
+		return;
+	}
+
+	comics_document->checkpoints = g_list_insert_before (comics_document->checkpoints,
+							     sibling, checkpoint);
+	comics_document->n_checkpoints++;
+
+	while (comics_document->n_checkpoints > CHECKPOINTS_MAX) {
+		gint64 last_position = 0;
+		GList *l, *next;
+
+		comics_document->checkpoint_interval *= 2;
+		for (l = comics_document->checkpoints; l; l = next) {
+			next = l->next;
+			position = ev_archive_checkpoint_get_position (l->data);
+			if (position < last_position ||
+			    position - last_position >= comics_document->checkpoint_interval) {
+				last_position = position;
+				continue;
+			}
+
+			ev_archive_checkpoint_free (l->data);
+			comics_document->checkpoints = g_list_delete_link (comics_document->checkpoints, l);
+			comics_document->n_checkpoints--;
+		}
+	}
+	g_mutex_unlock (&comics_document->checkpoints_lock);
+}
+
+/* Positions @archive at the last checkpoint before the entry at
+ * @offset, if there's one. Returns whether @archive was positioned.
+ */
+static gboolean
+comics_document_restore_checkpoint (ComicsDocument *comics_document,
+				    EvArchive      *archive,
+				    gint64          offset,
+				    GError        **error)
+{
+	EvArchiveCheckpoint *checkpoint = NULL;
+	gboolean retval = FALSE;
+	GList *l;
+
+	g_mutex_lock (&comics_document->checkpoints_lock);
+	for (l = comics_document->checkpoints; l; l = l->next) {
+		if (ev_archive_checkpoint_get_offset (l->data) > offset)
+			break;
+		checkpoint = l->data;
+	}
+
+	if (checkpoint)
+		retval = ev_archive_restore_checkpoint (archive, checkpoint, error);
+	g_mutex_unlock (&comics_document->checkpoints_lock);
+
+	return retval;
+}
+
+/* Positions @archive, just opened, at the entry of @page_path:
+ * directly if the offset of the entry is known, otherwise by reading
+ * the entries before it, from the closest checkpoint in solid RAR
+ * archives. Pages on the way in a solid archive are cached, since they
+ * have to be decompressed anyway.
+ */
+static gboolean
+comics_document_seek_page (ComicsDocument *comics_document,
+			   EvArchive      *archive,
+			   const char     *page_path,
+			   GError        **error)
+{
+	PageEntry *entry;
+	gboolean   positioned = FALSE;
+	GError    *seek_error = NULL;
+
+	entry = g_hash_table_lookup (comics_document->page_entries, page_path);
+	if (entry && entry->offset >= 0 && !entry->solid) {
+		if (ev_archive_seek_entry (archive, entry->offset, &seek_error) &&
+		    g_strcmp0 (ev_archive_get_entry_pathname (archive), page_path) == 0)
+			return TRUE;
+	} else if (entry && entry->offset >= 0) {
+		positioned = comics_document_restore_checkpoint (comics_document, archive,
+								 entry->offset, &seek_error);
+	}
+
+	/* The offset index is only a shortcut: when it fails,
+	 * read the archive from the start as before it existed */
+	if (seek_error || (entry && entry->offset >= 0 && !entry->solid)) {
+		g_debug ("Could not reach '%s' from its offset: %s", page_path,
+			 seek_error ? seek_error->message : "unexpected entry");
+		g_clear_error (&seek_error);
+
+		ev_archive_reset (archive);
+		if (!ev_archive_open_filename (archive, comics_document->archive_path, error))
+			return FALSE;
+		positioned = FALSE;
+	}
+
+	while (1) {
+		const char *name;
+
+		if (!positioned && !ev_archive_read_next_header (archive, error)) {
+			if (*error == NULL) {
+				g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+					     "No entry '%s' in archive", page_path);
+			}
+			return FALSE;
+		}
+		positioned = FALSE;
+
+		comics_document_add_checkpoint (comics_document, archive);
+
+		name = ev_archive_get_entry_pathname (archive);
+		if (g_strcmp0 (name, page_path) == 0)
+			return TRUE;
+
+		/* Other files are decompressed too, since skipping
+		 * them would restart the solid block from its start */
+		if (ev_archive_get_entry_is_solid (archive)) {
+			GBytes *bytes;
+
+			bytes = comics_read_entry (archive, error);
+			if (!bytes)
+				return FALSE;
+			if (g_hash_table_contains (comics_document->page_entries, name))
+				comics_document_cache_entry (comics_document, name, bytes);
+			g_bytes_unref (bytes);
+		}
+	}
+
+	return FALSE;
+}
+
+/* Returns the data of the page @archive is positioned at. In solid
+ * archives, the data is cached along with the pages following it,
+ * which are likely to be needed next.
+ */
+static GBytes *
+comics_document_read_page (ComicsDocument *comics_document,
+			   EvArchive      *archive,
+			   const char     *page_path,
+			   GError        **error)
+{
+	GBytes *bytes;
+	gint    i;
+
+	bytes = comics_read_entry (archive, error);
+	if (!bytes || !ev_archive_get_entry_is_solid (archive))
+		return bytes;
+
+	comics_document_cache_entry (comics_document, page_path, bytes);
+
+	for (i = 0; i < ENTRY_CACHE_READAHEAD; i++) {
+		const char *name;
+		GBytes *next;
+
+		if (!ev_archive_read_next_header (archive, NULL))
+			break;
+
+		comics_document_add_checkpoint (comics_document, archive);
+
+		name = ev_archive_get_entry_pathname (archive);
+		if (!ev_archive_get_entry_is_solid (archive))
+			continue;
+
+		next = comics_read_entry (archive, NULL);
+		if (!next)
+			break;
+		if (g_hash_table_contains (comics_document->page_entries, name))
+			comics_document_cache_entry (comics_document, name, next);
+		g_bytes_unref (next);
+	}
+
+	return bytes;
+}
+
 static void
 comics_document_get_page_size (EvDocument *document,
 			       EvPage     *page,
@@ -311,14 +711,9 @@ comics_document_get_page_size (EvDocument *document,
 	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	const char *page_path;
 	PixbufInfo info;
+	GBytes *bytes;
 	GError *error = NULL;
 
-	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, &error)) {
-		g_warning ("Fatal error opening archive: %s", error->message);
-		g_error_free (error);
-		goto out;
-	}
-
 	loader = gdk_pixbuf_loader_new ();
 	info.got_info = FALSE;
 	g_signal_connect (loader, "size-prepared",
@@ -327,46 +722,94 @@ comics_document_get_page_size (EvDocument *document,
 
 	page_path = g_ptr_array_index (comics_document->page_names, page->index);
 
-	while (1) {
-		const char *name;
-		GError *error = NULL;
+	bytes = comics_document_lookup_entry (comics_document, page_path);
+	if (bytes) {
+		get_page_size_from_data (loader, bytes, &info);
+		g_bytes_unref (bytes);
+		goto close;
+	}
 
-		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
-			if (error != NULL) {
-				g_warning ("Fatal error handling archive: %s", error->message);
-				g_error_free (error);
-			}
-			break;
-		}
+	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, &error)) {
+		g_warning ("Fatal error opening archive: %s", error->message);
+		g_error_free (error);
+		goto out;
+	}
 
-		name = ev_archive_get_entry_pathname (comics_document->archive);
-		if (g_strcmp0 (name, page_path) == 0) {
-			char buf[BLOCK_SIZE];
-			gssize read;
-			gint64 left;
+	if (!comics_document_seek_page (comics_document, comics_document->archive,
+					page_path, &error)) {
+		g_warning ("Fatal error handling archive: %s", error->message);
+		g_error_free (error);
+		goto out;
+	}
 
-			left = ev_archive_get_entry_size (comics_document->archive);
-			read = ev_archive_read_data (comics_document->archive, buf,
-						     MIN(BLOCK_SIZE, left), &error);
-			while (read > 0 && !info.got_info) {
-				if (!gdk_pixbuf_loader_write (loader, (guchar *) buf, read, &error)) {
-					read = -1;
+	bytes = ev_archive_get_entry_bytes (comics_document->archive);
+	if (bytes) {
+		get_page_size_from_data (loader, bytes, &info);
+		g_bytes_unref (bytes);
+	} else if (ev_archive_get_entry_is_solid (comics_document->archive)) {
+		bytes = comics_document_read_page (comics_document, comics_document->archive,
+						   page_path, &error);
+		if (bytes) {
+			get_page_size_from_data (loader, bytes, &info);
+			g_bytes_unref (bytes);
+		} else {
+			g_warning ("Fatal error reading '%s' in archive: %s", page_path, error->message);
+			g_error_free (error);
+		}
+	} else {
+		char buf[BLOCK_SIZE];
+		GByteArray *header;
+		EvImageSizeResult result = EV_IMAGE_SIZE_NEED_MORE_DATA;
+		gssize read;
+		gint64 left;
+
+		/* Only read until the size is known: from the image
+		 * header when possible, otherwise by decoding it */
+		header = g_byte_array_new ();
+		left = ev_archive_get_entry_size (comics_document->archive);
+		if (left < 0)
+			left = G_MAXINT64;
+		read = ev_archive_read_data (comics_document->archive, buf,
+					     MIN(BLOCK_SIZE, left), &error);
+		while (read > 0 && !info.got_info) {
+			left -= read;
+
+			if (result == EV_IMAGE_SIZE_NEED_MORE_DATA) {
+				g_byte_array_append (header, (guint8 *) buf, read);
+				result = ev_image_size_from_header (header->data, header->len,
+								    &info.width, &info.height);
+				if (result == EV_IMAGE_SIZE_FOUND) {
+					info.got_info = TRUE;
 					break;
 				}
-				left -= read;
-				read = ev_archive_read_data (comics_document->archive, buf,
-							     MIN(BLOCK_SIZE, left), &error);
-			}
-			if (read < 0) {
-				g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
-				g_error_free (error);
+
+				if (result == EV_IMAGE_SIZE_UNKNOWN || header->len >= HEADER_MAX_SIZE) {
+					result = EV_IMAGE_SIZE_UNKNOWN;
+					if (!gdk_pixbuf_loader_write (loader, header->data, header->len, &error)) {
+						read = -1;
+						break;
+					}
+				}
+			} else if (!gdk_pixbuf_loader_write (loader, (guchar *) buf, read, &error)) {
+				read = -1;
+				break;
 			}
-			break;
+
+			read = ev_archive_read_data (comics_document->archive, buf,
+						     MIN(BLOCK_SIZE, left), &error);
+		}
+		if (read < 0) {
+			g_warning ("Fatal error reading '%s' in archive: %s", page_path, error->message);
+			g_error_free (error);
+		} else if (!info.got_info && result == EV_IMAGE_SIZE_NEED_MORE_DATA) {
+			/* The whole image is shorter than its header should be */
+			gdk_pixbuf_loader_write (loader, header->data, header->len, NULL);
 		}
+		g_byte_array_free (header, TRUE);
 	}
 
+close:
 	gdk_pixbuf_loader_close (loader, NULL);
-	g_object_unref (loader);
 
 	if (info.got_info) {
 		if (width)
@@ -376,6 +819,7 @@ comics_document_get_page_size (EvDocument *document,
 	}
 
 out:
+	g_object_unref (loader);
 	ev_archive_reset (comics_document->archive);
 }
 
@@ -399,57 +843,56 @@ comics_document_render_pixbuf (EvDocument      *document,
 	GdkPixbuf *tmp_pixbuf;
 	GdkPixbuf *rotated_pixbuf = NULL;
 	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
+	EvArchive *archive = NULL;
 	const char *page_path;
+	GBytes *bytes;
 	GError *error = NULL;
 
-	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, &error)) {
-		g_warning ("Fatal error opening archive: %s", error->message);
-		g_error_free (error);
-		goto out;
-	}
-
-	loader = gdk_pixbuf_loader_new ();
-	g_signal_connect (loader, "size-prepared",
-			  G_CALLBACK (render_pixbuf_size_prepared_cb),
-			  rc);
-
 	page_path = g_ptr_array_index (comics_document->page_names, rc->page->index);
 
-	while (1) {
-		const char *name;
+	bytes = comics_document_lookup_entry (comics_document, page_path);
+	if (!bytes) {
+		/* Use a private archive reader, so that several
+		 * pages can be rendered at the same time.
+		 */
+		archive = ev_archive_new ();
+		ev_archive_set_archive_type (archive, ev_archive_get_archive_type (comics_document->archive));
+
+		if (!ev_archive_open_filename (archive, comics_document->archive_path, &error)) {
+			g_warning ("Fatal error opening archive: %s", error->message);
+			g_error_free (error);
+			goto out;
+		}
 
-		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
-			if (error != NULL) {
-				g_warning ("Fatal error handling archive: %s", error->message);
-				g_error_free (error);
-			}
-			break;
+		if (!comics_document_seek_page (comics_document, archive, page_path, &error)) {
+			g_warning ("Fatal error handling archive: %s", error->message);
+			g_error_free (error);
+			goto out;
 		}
 
-		name = ev_archive_get_entry_pathname (comics_document->archive);
-		if (g_strcmp0 (name, page_path) == 0) {
-			size_t size = ev_archive_get_entry_size (comics_document->archive);
-			char *buf;
-			ssize_t read;
-
-			buf = g_malloc (size);
-			read = ev_archive_read_data (comics_document->archive, buf, size, &error);
-			if (read <= 0) {
-				if (read < 0) {
-					g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
-					g_error_free (error);
-				} else {
-					g_warning ("Read an empty file from the archive");
-				}
-			} else {
-				gdk_pixbuf_loader_write (loader, (guchar *) buf, size, NULL);
-			}
-			g_free (buf);
-			gdk_pixbuf_loader_close (loader, NULL);
-			break;
+		bytes = comics_document_read_page (comics_document, archive, page_path, &error);
+		if (!bytes) {
+			g_warning ("Fatal error reading '%s' in archive: %s", page_path, error->message);
+			g_error_free (error);
+			goto out;
 		}
 	}
 
+	if (g_bytes_get_size (bytes) == 0) {
+		g_warning ("Read an empty file from the archive");
+		g_bytes_unref (bytes);
+		goto out;
+	}
+
+	loader = gdk_pixbuf_loader_new ();
+	g_signal_connect (loader, "size-prepared",
+			  G_CALLBACK (render_pixbuf_size_prepared_cb),
+			  rc);
+	gdk_pixbuf_loader_write (loader, g_bytes_get_data (bytes, NULL),
+				 g_bytes_get_size (bytes), NULL);
+	gdk_pixbuf_loader_close (loader, NULL);
+	g_bytes_unref (bytes);
+
 	tmp_pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
 	if (tmp_pixbuf) {
 		if ((rc->rotation % 360) == 0)
@@ -461,7 +904,7 @@ comics_document_render_pixbuf (EvDocument      *document,
 	g_object_unref (loader);
 
 out:
-	ev_archive_reset (comics_document->archive);
+	g_clear_object (&archive);
 	return rotated_pixbuf;
 }
 
@@ -489,6 +932,14 @@ comics_document_finalize (GObject *object)
                 g_ptr_array_free (comics_document->page_names, TRUE);
 	}
 
+	g_hash_table_destroy (comics_document->page_entries);
+	g_hash_table_destroy (comics_document->entry_cache);
+	g_queue_clear (&comics_document->entry_cache_lru);
+	g_mutex_clear (&comics_document->entry_cache_lock);
+	g_list_free_full (comics_document->checkpoints,
+			  (GDestroyNotify) ev_archive_checkpoint_free);
+	g_mutex_clear (&comics_document->checkpoints_lock);
+
 	g_clear_object (&comics_document->archive);
 	g_free (comics_document->archive_path);
 	g_free (comics_document->archive_uri);
@@ -509,12 +960,21 @@ comics_document_class_init (ComicsDocumentClass *klass)
 	ev_document_class->get_n_pages = comics_document_get_n_pages;
 	ev_document_class->get_page_size = comics_document_get_page_size;
 	ev_document_class->render = comics_document_render;
+	ev_document_class_set_render_flags (ev_document_class, EV_DOCUMENT_RENDER_FLAG_REENTRANT);
 }
 
 static void
 comics_document_init (ComicsDocument *comics_document)
 {
 	comics_document->archive = ev_archive_new ();
+	comics_document->page_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+							       NULL, g_free);
+	comics_document->entry_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      NULL, (GDestroyNotify) cached_entry_free);
+	g_queue_init (&comics_document->entry_cache_lru);
+	g_mutex_init (&comics_document->entry_cache_lock);
+	g_mutex_init (&comics_document->checkpoints_lock);
+	comics_document->checkpoint_interval = CHECKPOINT_INTERVAL;
 }
 
 /* Returns a list of file extensions supported by gdk-pixbuf */
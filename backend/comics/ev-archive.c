@@ -20,6 +20,7 @@
 #include "config.h"
 #include "ev-archive.h"
 
+#include <errno.h>
 #include <archive.h>
 #include <archive_entry.h>
 #include <unarr/unarr.h>
@@ -27,21 +28,236 @@
 
 #define BUFFER_SIZE (64 * 1024)
 
+#define ZIP_EOCD_SIGNATURE           0x06054b50
+#define ZIP_EOCD64_SIGNATURE         0x06064b50
+#define ZIP_EOCD64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP_CDIR_ENTRY_SIGNATURE     0x02014b50
+#define ZIP_EOCD_SIZE                22
+#define ZIP_EOCD64_SIZE              56
+#define ZIP_EOCD64_LOCATOR_SIZE      20
+#define ZIP_CDIR_ENTRY_SIZE          46
+#define ZIP_MAX_COMMENT_SIZE         0xffff
+#define ZIP_EXTRA_ZIP64              0x0001
+#define ZIP_EXTRA_UNICODE_PATH       0x7075
+
+typedef struct {
+	gint64 offset;
+	gint64 size;
+} ZipEntry;
+
+struct _EvArchiveCheckpoint {
+	gint64 position;
+	ar_rar_checkpoint *rar;
+};
+
 struct _EvArchive {
 	GObject parent_instance;
 	EvArchiveType type;
+	gchar *path;
 
 	/* libarchive */
 	struct archive *libar;
 	struct archive_entry *libar_entry;
 
-	/* unarr */
+	/* libarchive reading from an entry offset */
+	GInputStream *libar_stream;
+	guchar *libar_buffer;
+	gint64 libar_offset;
+
+	/* ZIP central directory, entry pathname to ZipEntry */
+	GHashTable *zip_entries;
+
+	/* unarr, reading from the mapped archive when possible */
+	GMappedFile *unarr_mapped;
 	ar_stream *unarr_stream;
 	ar_archive *unarr;
 };
 
 G_DEFINE_TYPE(EvArchive, ev_archive, G_TYPE_OBJECT);
 
+static guint16
+zip_read_u16 (const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static guint32
+zip_read_u32 (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static guint64
+zip_read_u64 (const guchar *p)
+{
+	return zip_read_u32 (p) | ((guint64) zip_read_u32 (p + 4) << 32);
+}
+
+/* Reads the local header offset and size of all the entries
+ * from the central directory at the end of the archive.
+ */
+static GHashTable *
+zip_read_central_directory (const char *path)
+{
+	GHashTable *entries;
+	GMappedFile *mapped;
+	const guchar *data;
+	gsize length;
+	gsize eocd, p, end;
+	guint64 n_entries, cdir_size, cdir_offset, i;
+	gboolean found = FALSE;
+
+	entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	mapped = g_mapped_file_new (path, FALSE, NULL);
+	if (!mapped)
+		return entries;
+
+	data = (const guchar *) g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+	if (length < ZIP_EOCD_SIZE)
+		goto out;
+
+	/* The end of central directory record is only followed by the comment */
+	for (eocd = length - ZIP_EOCD_SIZE; ; eocd--) {
+		if (zip_read_u32 (data + eocd) == ZIP_EOCD_SIGNATURE) {
+			found = TRUE;
+			break;
+		}
+		if (eocd == 0 || length - ZIP_EOCD_SIZE - eocd >= ZIP_MAX_COMMENT_SIZE)
+			break;
+	}
+	if (!found)
+		goto out;
+
+	n_entries = zip_read_u16 (data + eocd + 10);
+	cdir_size = zip_read_u32 (data + eocd + 12);
+	cdir_offset = zip_read_u32 (data + eocd + 16);
+
+	if (n_entries == 0xffff || cdir_size == 0xffffffff || cdir_offset == 0xffffffff) {
+		gsize   locator;
+		guint64 eocd64;
+
+		if (eocd < ZIP_EOCD64_LOCATOR_SIZE)
+			goto out;
+		locator = eocd - ZIP_EOCD64_LOCATOR_SIZE;
+		if (zip_read_u32 (data + locator) != ZIP_EOCD64_LOCATOR_SIGNATURE)
+			goto out;
+
+		eocd64 = zip_read_u64 (data + locator + 8);
+		if (length < ZIP_EOCD64_SIZE ||
+		    eocd64 > length - ZIP_EOCD64_SIZE ||
+		    zip_read_u32 (data + eocd64) != ZIP_EOCD64_SIGNATURE)
+			goto out;
+
+		n_entries = zip_read_u64 (data + eocd64 + 32);
+		cdir_size = zip_read_u64 (data + eocd64 + 40);
+		cdir_offset = zip_read_u64 (data + eocd64 + 48);
+	}
+
+	if (cdir_offset > length || cdir_size > length - cdir_offset)
+		goto out;
+
+	p = cdir_offset;
+	end = cdir_offset + cdir_size;
+	for (i = 0; i < n_entries; i++) {
+		const guchar *extra;
+		ZipEntry *entry;
+		gchar *unicode_name = NULL;
+		guint64 size, compressed_size, offset;
+		guint16 name_len, extra_len, comment_len;
+		gsize e;
+
+		if (end - p < ZIP_CDIR_ENTRY_SIZE ||
+		    zip_read_u32 (data + p) != ZIP_CDIR_ENTRY_SIGNATURE)
+			break;
+
+		name_len = zip_read_u16 (data + p + 28);
+		extra_len = zip_read_u16 (data + p + 30);
+		comment_len = zip_read_u16 (data + p + 32);
+		if (end - p < (gsize) ZIP_CDIR_ENTRY_SIZE + name_len + extra_len + comment_len)
+			break;
+
+		compressed_size = zip_read_u32 (data + p + 20);
+		size = zip_read_u32 (data + p + 24);
+		offset = zip_read_u32 (data + p + 42);
+
+		/* ZIP64 extended information, with only the fields
+		 * that overflow in the entry, in this order */
+		extra = data + p + ZIP_CDIR_ENTRY_SIZE + name_len;
+		for (e = 0; e + 4 <= extra_len; ) {
+			guint16 id = zip_read_u16 (extra + e);
+			guint16 field_len = zip_read_u16 (extra + e + 2);
+			const guchar *field = extra + e + 4;
+			gsize k = 0;
+
+			if (e + 4 + field_len > extra_len)
+				break;
+
+			if (id == ZIP_EXTRA_ZIP64) {
+				if (size == 0xffffffff && k + 8 <= field_len) {
+					size = zip_read_u64 (field + k);
+					k += 8;
+				}
+				if (compressed_size == 0xffffffff && k + 8 <= field_len)
+					k += 8;
+				if (offset == 0xffffffff && k + 8 <= field_len)
+					offset = zip_read_u64 (field + k);
+			} else if (id == ZIP_EXTRA_UNICODE_PATH && field_len > 5 && field[0] == 1) {
+				/* libarchive names the entry after the
+				 * UTF-8 name in this field, when there's one */
+				g_free (unicode_name);
+				unicode_name = g_strndup ((const gchar *) field + 5, field_len - 5);
+			}
+
+			e += 4 + field_len;
+		}
+
+		entry = g_new (ZipEntry, 1);
+		entry->offset = offset;
+		entry->size = size;
+		g_hash_table_replace (entries,
+				      g_strndup ((const gchar *) data + p + ZIP_CDIR_ENTRY_SIZE, name_len),
+				      entry);
+		if (unicode_name)
+			g_hash_table_replace (entries, unicode_name, g_memdup (entry, sizeof (ZipEntry)));
+
+		p += ZIP_CDIR_ENTRY_SIZE + name_len + extra_len + comment_len;
+	}
+
+out:
+	g_mapped_file_unref (mapped);
+
+	return entries;
+}
+
+/* Names that can't be converted to the locale encoding are only
+ * available in UTF-8 */
+static const char *
+libarchive_get_entry_pathname (EvArchive *archive)
+{
+	const char *name;
+
+	name = archive_entry_pathname (archive->libar_entry);
+	if (!name)
+		name = archive_entry_pathname_utf8 (archive->libar_entry);
+
+	return name;
+}
+
+static ZipEntry *
+zip_lookup_entry (EvArchive *archive)
+{
+	const char *name;
+
+	if (!archive->zip_entries)
+		archive->zip_entries = zip_read_central_directory (archive->path);
+
+	name = libarchive_get_entry_pathname (archive);
+
+	return name ? g_hash_table_lookup (archive->zip_entries, name) : NULL;
+}
+
 static void
 ev_archive_finalize (GObject *object)
 {
@@ -51,16 +267,22 @@ ev_archive_finalize (GObject *object)
 	case EV_ARCHIVE_TYPE_RAR:
 		g_clear_pointer (&archive->unarr, ar_close_archive);
 		g_clear_pointer (&archive->unarr_stream, ar_close);
+		g_clear_pointer (&archive->unarr_mapped, g_mapped_file_unref);
 		break;
 	case EV_ARCHIVE_TYPE_ZIP:
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
 		g_clear_pointer (&archive->libar, archive_free);
+		g_clear_object (&archive->libar_stream);
 		break;
 	default:
 		break;
 	}
 
+	g_clear_pointer (&archive->zip_entries, g_hash_table_destroy);
+	g_free (archive->libar_buffer);
+	g_free (archive->path);
+
 	G_OBJECT_CLASS (ev_archive_parent_class)->finalize (object);
 }
 
@@ -135,11 +357,23 @@ ev_archive_open_filename (EvArchive   *archive,
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
 	g_return_val_if_fail (path != NULL, FALSE);
 
+	g_free (archive->path);
+	archive->path = g_strdup (path);
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_NONE:
 		g_assert_not_reached ();
 	case EV_ARCHIVE_TYPE_RAR:
-		archive->unarr_stream = ar_open_file (path);
+		/* Reading the mapped file saves a read and a seek for
+		 * every block, and gives stored entries without a copy */
+		archive->unarr_mapped = g_mapped_file_new (path, FALSE, NULL);
+		if (archive->unarr_mapped && g_mapped_file_get_length (archive->unarr_mapped) > 0) {
+			archive->unarr_stream = ar_open_memory (g_mapped_file_get_contents (archive->unarr_mapped),
+								g_mapped_file_get_length (archive->unarr_mapped));
+		} else {
+			g_clear_pointer (&archive->unarr_mapped, g_mapped_file_unref);
+			archive->unarr_stream = ar_open_file (path);
+		}
 		if (archive->unarr_stream == NULL) {
 			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
 					     "Error opening archive");
@@ -233,7 +467,7 @@ ev_archive_get_entry_pathname (EvArchive *archive)
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
 		g_return_val_if_fail (archive->libar_entry != NULL, NULL);
-		return archive_entry_pathname (archive->libar_entry);
+		return libarchive_get_entry_pathname (archive);
 	}
 
 	return NULL;
@@ -255,6 +489,16 @@ ev_archive_get_entry_size (EvArchive *archive)
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
 		g_return_val_if_fail (archive->libar_entry != NULL, -1);
+		if (!archive_entry_size_is_set (archive->libar_entry)) {
+			ZipEntry *entry = NULL;
+
+			/* The local header of ZIP entries written in streaming
+			 * mode doesn't have the size, the central directory does */
+			if (archive->zip_entries)
+				entry = zip_lookup_entry (archive);
+
+			return entry ? entry->size : -1;
+		}
 		return archive_entry_size (archive->libar_entry);
 	}
 
@@ -284,6 +528,40 @@ ev_archive_get_entry_is_encrypted (EvArchive *archive)
 	return FALSE;
 }
 
+/**
+ * ev_archive_get_entry_bytes:
+ * @archive: an #EvArchive
+ *
+ * Gets the data of the current entry without copying it, which is only
+ * possible for entries stored uncompressed in a mapped RAR archive.
+ * The data stays valid after @archive is reset or finalized, but it is
+ * read from the archive file: accessing it after the file is truncated
+ * raises SIGBUS. Don't keep it longer than needed to decode the entry.
+ *
+ * Returns: (transfer full): the data of the entry, or %NULL if it
+ * has to be read with ev_archive_read_data()
+ */
+GBytes *
+ev_archive_get_entry_bytes (EvArchive *archive)
+{
+	const void *data;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), NULL);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, NULL);
+
+	if (archive->type != EV_ARCHIVE_TYPE_RAR || !archive->unarr_mapped)
+		return NULL;
+
+	g_return_val_if_fail (archive->unarr != NULL, NULL);
+	data = ar_rar_entry_get_stored_data (archive->unarr);
+	if (!data)
+		return NULL;
+
+	return g_bytes_new_with_free_func (data, ar_entry_get_size (archive->unarr),
+					   (GDestroyNotify) g_mapped_file_unref,
+					   g_mapped_file_ref (archive->unarr_mapped));
+}
+
 gssize
 ev_archive_read_data (EvArchive *archive,
 		      void      *buf,
@@ -332,11 +610,15 @@ ev_archive_reset (EvArchive *archive)
 	case EV_ARCHIVE_TYPE_RAR:
 		g_clear_pointer (&archive->unarr, ar_close_archive);
 		g_clear_pointer (&archive->unarr_stream, ar_close);
+		g_clear_pointer (&archive->unarr_mapped, g_mapped_file_unref);
 		break;
 	case EV_ARCHIVE_TYPE_ZIP:
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
 		g_clear_pointer (&archive->libar, archive_free);
+		g_clear_object (&archive->libar_stream);
+		archive->libar_entry = NULL;
+		archive->libar_offset = 0;
 		libarchive_set_archive_type (archive, archive->type);
 		break;
 	default:
@@ -344,6 +626,300 @@ ev_archive_reset (EvArchive *archive)
 	}
 }
 
+static la_ssize_t
+libarchive_stream_read (struct archive *libar,
+			void           *user_data,
+			const void    **buffer)
+{
+	EvArchive *archive = user_data;
+	GError *error = NULL;
+	gssize r;
+
+	*buffer = archive->libar_buffer;
+	r = g_input_stream_read (archive->libar_stream, archive->libar_buffer,
+				 BUFFER_SIZE, NULL, &error);
+	if (r < 0) {
+		archive_set_error (libar, EIO, "%s", error->message);
+		g_error_free (error);
+	}
+
+	return r;
+}
+
+static la_int64_t
+libarchive_stream_skip (struct archive *libar,
+			void           *user_data,
+			la_int64_t      request)
+{
+	EvArchive *archive = user_data;
+
+	if (!g_seekable_seek (G_SEEKABLE (archive->libar_stream), request,
+			      G_SEEK_CUR, NULL, NULL))
+		return 0;
+
+	return request;
+}
+
+/* Restarts reading the archive from the header at @offset. TAR
+ * archives can be read from any header, and so can ZIP archives
+ * when read in streaming mode, without the central directory.
+ */
+static gboolean
+libarchive_seek_entry (EvArchive *archive,
+		       gint64     offset,
+		       GError   **error)
+{
+	GFile *file;
+	GFileInputStream *stream;
+	int r;
+
+	file = g_file_new_for_path (archive->path);
+	stream = g_file_read (file, NULL, error);
+	g_object_unref (file);
+	if (!stream)
+		return FALSE;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, error)) {
+		g_object_unref (stream);
+		return FALSE;
+	}
+
+	g_clear_pointer (&archive->libar, archive_free);
+	g_clear_object (&archive->libar_stream);
+	archive->libar_entry = NULL;
+
+	archive->libar = archive_read_new ();
+	if (archive->type == EV_ARCHIVE_TYPE_ZIP)
+		archive_read_support_format_zip_streamable (archive->libar);
+	else
+		archive_read_support_format_tar (archive->libar);
+
+	archive->libar_stream = G_INPUT_STREAM (stream);
+	archive->libar_offset = offset;
+	if (!archive->libar_buffer)
+		archive->libar_buffer = g_malloc (BUFFER_SIZE);
+
+	r = archive_read_open2 (archive->libar, archive, NULL,
+				libarchive_stream_read,
+				libarchive_stream_skip,
+				NULL);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "Error opening archive: %s", archive_error_string (archive->libar));
+		return FALSE;
+	}
+
+	return libarchive_read_next_header (archive, error);
+}
+
+gint64
+ev_archive_get_entry_offset (EvArchive *archive)
+{
+	ZipEntry *entry;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), -1);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, -1);
+
+	switch (archive->type) {
+	case EV_ARCHIVE_TYPE_RAR:
+		g_return_val_if_fail (archive->unarr != NULL, -1);
+		return ar_entry_get_offset (archive->unarr);
+	case EV_ARCHIVE_TYPE_NONE:
+		g_assert_not_reached ();
+	case EV_ARCHIVE_TYPE_ZIP:
+		g_return_val_if_fail (archive->libar_entry != NULL, -1);
+		entry = zip_lookup_entry (archive);
+		return entry ? entry->offset : -1;
+	case EV_ARCHIVE_TYPE_TAR:
+		g_return_val_if_fail (archive->libar_entry != NULL, -1);
+		return archive->libar_offset + archive_read_header_position (archive->libar);
+	case EV_ARCHIVE_TYPE_7Z:
+		/* Entries can only be reached by decompressing
+		 * the ones before them in the same block */
+		return -1;
+	}
+
+	return -1;
+}
+
+gboolean
+ev_archive_seek_entry (EvArchive *archive,
+		       gint64     offset,
+		       GError   **error)
+{
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
+	g_return_val_if_fail (archive->path != NULL, FALSE);
+	g_return_val_if_fail (offset >= 0, FALSE);
+
+	switch (archive->type) {
+	case EV_ARCHIVE_TYPE_RAR:
+		g_return_val_if_fail (archive->unarr != NULL, FALSE);
+		if (!ar_parse_entry_at (archive->unarr, offset)) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "No RAR entry at offset %" G_GINT64_FORMAT, offset);
+			return FALSE;
+		}
+		return TRUE;
+	case EV_ARCHIVE_TYPE_NONE:
+		g_assert_not_reached ();
+	case EV_ARCHIVE_TYPE_ZIP:
+	case EV_ARCHIVE_TYPE_TAR:
+		if (!libarchive_seek_entry (archive, offset, error)) {
+			if (error && *error == NULL) {
+				g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+					     "No entry at offset %" G_GINT64_FORMAT, offset);
+			}
+			return FALSE;
+		}
+		return TRUE;
+	case EV_ARCHIVE_TYPE_7Z:
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Cannot seek in 7z archives");
+		return FALSE;
+	}
+
+	return FALSE;
+}
+
+gboolean
+ev_archive_get_entry_is_solid (EvArchive *archive)
+{
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
+
+	switch (archive->type) {
+	case EV_ARCHIVE_TYPE_RAR:
+		g_return_val_if_fail (archive->unarr != NULL, FALSE);
+		return ar_rar_entry_is_solid (archive->unarr);
+	case EV_ARCHIVE_TYPE_NONE:
+		g_assert_not_reached ();
+	case EV_ARCHIVE_TYPE_ZIP:
+	case EV_ARCHIVE_TYPE_TAR:
+		return FALSE;
+	case EV_ARCHIVE_TYPE_7Z:
+		/* libarchive doesn't tell about blocks,
+		 * and 7z archives are usually solid */
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * ev_archive_get_entry_solid_position:
+ * @archive: an #EvArchive
+ *
+ * Returns: the size of the uncompressed data before the current entry
+ * in its solid block, or -1 if the entry isn't in a solid RAR block
+ */
+gint64
+ev_archive_get_entry_solid_position (EvArchive *archive)
+{
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), -1);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, -1);
+
+	if (archive->type != EV_ARCHIVE_TYPE_RAR)
+		return -1;
+
+	g_return_val_if_fail (archive->unarr != NULL, -1);
+	return ar_rar_entry_get_solid_position (archive->unarr);
+}
+
+/**
+ * ev_archive_save_checkpoint:
+ * @archive: an #EvArchive
+ *
+ * Saves the decompression state needed for the current entry, which
+ * must not have been read yet, so that other readers of the same file
+ * can start at that entry instead of at the start of its solid block.
+ * Only solid RAR entries can be checkpointed, and a checkpoint takes
+ * a few megabytes.
+ *
+ * Returns: (transfer full): a new #EvArchiveCheckpoint, or %NULL
+ */
+EvArchiveCheckpoint *
+ev_archive_save_checkpoint (EvArchive *archive)
+{
+	EvArchiveCheckpoint *checkpoint;
+	ar_rar_checkpoint *rar;
+	gint64 position;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), NULL);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, NULL);
+
+	position = ev_archive_get_entry_solid_position (archive);
+	if (position < 0)
+		return NULL;
+
+	rar = ar_rar_save_checkpoint (archive->unarr);
+	if (!rar)
+		return NULL;
+
+	checkpoint = g_new (EvArchiveCheckpoint, 1);
+	checkpoint->position = position;
+	checkpoint->rar = rar;
+
+	return checkpoint;
+}
+
+/**
+ * ev_archive_restore_checkpoint:
+ * @archive: an #EvArchive, opened on the file @checkpoint was saved from
+ * @checkpoint: an #EvArchiveCheckpoint
+ * @error: a #GError
+ *
+ * Positions @archive at the entry @checkpoint was saved for, ready to
+ * read it without decompressing the entries before it.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+ev_archive_restore_checkpoint (EvArchive           *archive,
+			       EvArchiveCheckpoint *checkpoint,
+			       GError             **error)
+{
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (archive->type == EV_ARCHIVE_TYPE_RAR, FALSE);
+	g_return_val_if_fail (archive->unarr != NULL, FALSE);
+	g_return_val_if_fail (checkpoint != NULL, FALSE);
+
+	if (!ar_rar_restore_checkpoint (archive->unarr, checkpoint->rar)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "Error restoring RAR entry at offset %" G_GINT64_FORMAT,
+			     ev_archive_checkpoint_get_offset (checkpoint));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gint64
+ev_archive_checkpoint_get_offset (EvArchiveCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, -1);
+
+	return ar_rar_checkpoint_get_offset (checkpoint->rar);
+}
+
+gint64
+ev_archive_checkpoint_get_position (EvArchiveCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, -1);
+
+	return checkpoint->position;
+}
+
+void
+ev_archive_checkpoint_free (EvArchiveCheckpoint *checkpoint)
+{
+	if (!checkpoint)
+		return;
+
+	ar_rar_free_checkpoint (checkpoint->rar);
+	g_free (checkpoint);
+}
+
 static void
 ev_archive_init (EvArchive *archive)
 {
@@ -35,6 +35,8 @@ typedef enum {
 	EV_ARCHIVE_TYPE_TAR
 } EvArchiveType;
 
+typedef struct _EvArchiveCheckpoint EvArchiveCheckpoint;
+
 EvArchive     *ev_archive_new                (void);
 gboolean       ev_archive_set_archive_type   (EvArchive     *archive,
 					      EvArchiveType  archive_type);
@@ -47,11 +49,26 @@ gboolean       ev_archive_read_next_header   (EvArchive     *archive,
 const char    *ev_archive_get_entry_pathname (EvArchive     *archive);
 gint64         ev_archive_get_entry_size     (EvArchive     *archive);
 gboolean       ev_archive_get_entry_is_encrypted (EvArchive *archive);
+GBytes        *ev_archive_get_entry_bytes    (EvArchive     *archive);
 gssize         ev_archive_read_data          (EvArchive     *archive,
 					      void          *buf,
 					      gsize          count,
 					      GError       **error);
 void           ev_archive_reset              (EvArchive     *archive);
+gint64         ev_archive_get_entry_offset   (EvArchive     *archive);
+gboolean       ev_archive_seek_entry         (EvArchive     *archive,
+					      gint64         offset,
+					      GError       **error);
+gboolean       ev_archive_get_entry_is_solid (EvArchive     *archive);
+gint64         ev_archive_get_entry_solid_position (EvArchive *archive);
+
+EvArchiveCheckpoint *ev_archive_save_checkpoint         (EvArchive           *archive);
+gboolean             ev_archive_restore_checkpoint      (EvArchive           *archive,
+							 EvArchiveCheckpoint *checkpoint,
+							 GError             **error);
+gint64               ev_archive_checkpoint_get_offset   (EvArchiveCheckpoint *checkpoint);
+gint64               ev_archive_checkpoint_get_position (EvArchiveCheckpoint *checkpoint);
+void                 ev_archive_checkpoint_free         (EvArchiveCheckpoint *checkpoint);
 
 G_END_DECLS
 
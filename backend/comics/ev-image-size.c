@@ -0,0 +1,293 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include "ev-image-size.h"
+
+#include <string.h>
+
+/* Reads the size of images from their headers, without decoding
+ * them. The sizes are the ones GdkPixbufLoader::size-prepared
+ * reports for the same data.
+ */
+
+static guint16
+read_u16_be (const guchar *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static guint16
+read_u16_le (const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static guint32
+read_u24_le (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+static guint32
+read_u32_be (const guchar *p)
+{
+	return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static guint32
+read_u32_le (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static EvImageSizeResult
+set_size (guint32  w,
+	  guint32  h,
+	  gint    *width,
+	  gint    *height)
+{
+	if (w == 0 || h == 0 || w > G_MAXINT || h > G_MAXINT)
+		return EV_IMAGE_SIZE_UNKNOWN;
+
+	*width = w;
+	*height = h;
+
+	return EV_IMAGE_SIZE_FOUND;
+}
+
+static EvImageSizeResult
+png_get_size (const guchar *data,
+	      gsize         length,
+	      gint         *width,
+	      gint         *height)
+{
+	/* Signature, then the IHDR chunk, always first */
+	if (length < 24)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+	if (memcmp (data + 12, "IHDR", 4) != 0)
+		return EV_IMAGE_SIZE_UNKNOWN;
+
+	return set_size (read_u32_be (data + 16), read_u32_be (data + 20),
+			 width, height);
+}
+
+static EvImageSizeResult
+gif_get_size (const guchar *data,
+	      gsize         length,
+	      gint         *width,
+	      gint         *height)
+{
+	/* The logical screen descriptor follows the signature */
+	if (length < 10)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	return set_size (read_u16_le (data + 6), read_u16_le (data + 8),
+			 width, height);
+}
+
+static gboolean
+jpeg_marker_is_sof (guchar marker)
+{
+	/* C4, C8 and CC are DHT, JPG and DAC */
+	return marker >= 0xc0 && marker <= 0xcf &&
+		marker != 0xc4 && marker != 0xc8 && marker != 0xcc;
+}
+
+static EvImageSizeResult
+jpeg_get_size (const guchar *data,
+	       gsize         length,
+	       gint         *width,
+	       gint         *height)
+{
+	gsize p = 2;
+
+	while (1) {
+		guchar  marker;
+		guint16 segment_length;
+
+		if (p >= length)
+			return EV_IMAGE_SIZE_NEED_MORE_DATA;
+		if (data[p] != 0xff)
+			return EV_IMAGE_SIZE_UNKNOWN;
+
+		/* Markers can be preceded by fill bytes */
+		while (p < length && data[p] == 0xff)
+			p++;
+		if (p >= length)
+			return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+		marker = data[p++];
+		if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8))
+			continue;
+		/* Image data, or its end, before any frame header */
+		if (marker == 0xd9 || marker == 0xda)
+			return EV_IMAGE_SIZE_UNKNOWN;
+
+		if (length - p < 2)
+			return EV_IMAGE_SIZE_NEED_MORE_DATA;
+		segment_length = read_u16_be (data + p);
+		if (segment_length < 2)
+			return EV_IMAGE_SIZE_UNKNOWN;
+
+		if (jpeg_marker_is_sof (marker)) {
+			/* Length, precision, height and width */
+			if (length - p < 7)
+				return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+			return set_size (read_u16_be (data + p + 5),
+					 read_u16_be (data + p + 3),
+					 width, height);
+		}
+
+		p += segment_length;
+	}
+
+	return EV_IMAGE_SIZE_UNKNOWN;
+}
+
+static EvImageSizeResult
+webp_get_size (const guchar *data,
+	       gsize         length,
+	       gint         *width,
+	       gint         *height)
+{
+	guint32 bits;
+
+	/* RIFF header, then the first chunk */
+	if (length < 30)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	if (memcmp (data + 12, "VP8 ", 4) == 0) {
+		/* Frame tag, then the start code of key frames */
+		if (data[23] != 0x9d || data[24] != 0x01 || data[25] != 0x2a)
+			return EV_IMAGE_SIZE_UNKNOWN;
+
+		return set_size (read_u16_le (data + 26) & 0x3fff,
+				 read_u16_le (data + 28) & 0x3fff,
+				 width, height);
+	}
+
+	if (memcmp (data + 12, "VP8L", 4) == 0) {
+		if (data[20] != 0x2f)
+			return EV_IMAGE_SIZE_UNKNOWN;
+
+		bits = read_u32_le (data + 21);
+		return set_size ((bits & 0x3fff) + 1,
+				 ((bits >> 14) & 0x3fff) + 1,
+				 width, height);
+	}
+
+	if (memcmp (data + 12, "VP8X", 4) == 0) {
+		return set_size (read_u24_le (data + 24) + 1,
+				 read_u24_le (data + 27) + 1,
+				 width, height);
+	}
+
+	return EV_IMAGE_SIZE_UNKNOWN;
+}
+
+static EvImageSizeResult
+tiff_get_size (const guchar *data,
+	       gsize         length,
+	       gint         *width,
+	       gint         *height)
+{
+	gboolean little_endian = data[0] == 'I';
+	guint32  ifd, w = 0, h = 0;
+	guint16  n_entries, i;
+
+	if (length < 8)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	/* The first image file directory can be anywhere */
+	ifd = little_endian ? read_u32_le (data + 4) : read_u32_be (data + 4);
+	if (ifd < 8)
+		return EV_IMAGE_SIZE_UNKNOWN;
+	if (length < 2 || ifd > length - 2)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	n_entries = little_endian ? read_u16_le (data + ifd) : read_u16_be (data + ifd);
+	if ((length - ifd - 2) / 12 < n_entries)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	for (i = 0; i < n_entries; i++) {
+		const guchar *entry = data + ifd + 2 + i * 12;
+		guint16       tag, type;
+		guint32       value;
+
+		tag = little_endian ? read_u16_le (entry) : read_u16_be (entry);
+		if (tag != 256 && tag != 257)
+			continue;
+
+		type = little_endian ? read_u16_le (entry + 2) : read_u16_be (entry + 2);
+		if (type == 3)
+			value = little_endian ? read_u16_le (entry + 8) : read_u16_be (entry + 8);
+		else if (type == 4)
+			value = little_endian ? read_u32_le (entry + 8) : read_u32_be (entry + 8);
+		else
+			continue;
+
+		/* ImageWidth and ImageLength */
+		if (tag == 256)
+			w = value;
+		else
+			h = value;
+	}
+
+	return set_size (w, h, width, height);
+}
+
+/**
+ * ev_image_size_from_header:
+ * @data: the start of an image file
+ * @length: the length of @data
+ * @width: (out): return location for the width of the image
+ * @height: (out): return location for the height of the image
+ *
+ * Gets the size of JPEG, PNG, GIF, WebP and TIFF images from
+ * their header.
+ *
+ * Returns: %EV_IMAGE_SIZE_FOUND when @width and @height were set,
+ * %EV_IMAGE_SIZE_NEED_MORE_DATA when the header goes past @length,
+ * or %EV_IMAGE_SIZE_UNKNOWN for other formats and invalid headers
+ */
+EvImageSizeResult
+ev_image_size_from_header (const guchar *data,
+			   gsize         length,
+			   gint         *width,
+			   gint         *height)
+{
+	g_return_val_if_fail (data != NULL || length == 0, EV_IMAGE_SIZE_UNKNOWN);
+	g_return_val_if_fail (width != NULL && height != NULL, EV_IMAGE_SIZE_UNKNOWN);
+
+	if (length < 12)
+		return EV_IMAGE_SIZE_NEED_MORE_DATA;
+
+	if (memcmp (data, "\x89PNG\r\n\x1a\n", 8) == 0)
+		return png_get_size (data, length, width, height);
+	if (memcmp (data, "GIF87a", 6) == 0 || memcmp (data, "GIF89a", 6) == 0)
+		return gif_get_size (data, length, width, height);
+	if (data[0] == 0xff && data[1] == 0xd8)
+		return jpeg_get_size (data, length, width, height);
+	if (memcmp (data, "RIFF", 4) == 0 && memcmp (data + 8, "WEBP", 4) == 0)
+		return webp_get_size (data, length, width, height);
+	if (memcmp (data, "II*\0", 4) == 0 || memcmp (data, "MM\0*", 4) == 0)
+		return tiff_get_size (data, length, width, height);
+
+	return EV_IMAGE_SIZE_UNKNOWN;
+}
@@ -0,0 +1,38 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __EV_IMAGE_SIZE_H__
+#define __EV_IMAGE_SIZE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	EV_IMAGE_SIZE_FOUND,
+	EV_IMAGE_SIZE_NEED_MORE_DATA,
+	EV_IMAGE_SIZE_UNKNOWN
+} EvImageSizeResult;
+
+EvImageSizeResult ev_image_size_from_header (const guchar *data,
+					     gsize         length,
+					     gint         *width,
+					     gint         *height);
+
+G_END_DECLS
+
+#endif /* __EV_IMAGE_SIZE_H__ */
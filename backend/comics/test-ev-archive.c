@@ -24,7 +24,8 @@
 static void
 usage (const char *prog)
 {
-	g_print ("- Lists file in a supported archive format\n");
+	g_print ("- Lists file in a supported archive format, and checks\n"
+		 "  that entries can be reached from their offset\n");
 	g_print ("Usage: %s archive-type filename\n", prog);
 	g_print ("Where archive-type is one of rar, zip, 7z or tar\n");
 }
@@ -47,6 +48,54 @@ str_to_archive_type (const char *str)
 	return EV_ARCHIVE_TYPE_NONE;
 }
 
+typedef struct {
+	gchar *name;
+	gint64 offset;
+} Entry;
+
+static void
+entry_free (Entry *entry)
+{
+	g_free (entry->name);
+	g_free (entry);
+}
+
+static gboolean
+check_seek (EvArchive  *ar,
+	    const char *filename,
+	    GPtrArray  *entries)
+{
+	GError *error = NULL;
+	guint i, n_seeks = 0;
+
+	/* Backwards, so that each seek goes against the reading order */
+	for (i = entries->len; i > 0; i--) {
+		Entry *entry = g_ptr_array_index (entries, i - 1);
+
+		if (entry->offset < 0)
+			continue;
+
+		ev_archive_reset (ar);
+		if (!ev_archive_open_filename (ar, filename, &error) ||
+		    !ev_archive_seek_entry (ar, entry->offset, &error)) {
+			g_warning ("Failed to seek to '%s': %s", entry->name, error->message);
+			g_clear_error (&error);
+			return FALSE;
+		}
+
+		if (g_strcmp0 (ev_archive_get_entry_pathname (ar), entry->name) != 0) {
+			g_warning ("Found '%s' at the offset of '%s'",
+				   ev_archive_get_entry_pathname (ar), entry->name);
+			return FALSE;
+		}
+		n_seeks++;
+	}
+
+	g_print ("Reached %u of %u entries from their offset\n", n_seeks, entries->len);
+
+	return TRUE;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -54,6 +103,7 @@ main (int argc, char **argv)
 	EvArchiveType ar_type;
 	GError *error = NULL;
 	gboolean printed_header = FALSE;
+	GPtrArray *entries;
 
 	if (argc != 3) {
 		usage (argv[0]);
@@ -77,15 +127,19 @@ main (int argc, char **argv)
 		goto out;
 	}
 
+	entries = g_ptr_array_new_with_free_func ((GDestroyNotify) entry_free);
+
 	while (1) {
 		const char *name;
 		gboolean is_encrypted;
 		gint64 size;
+		Entry *entry;
 
 		if (!ev_archive_read_next_header (ar, &error)) {
 			if (error != NULL) {
 				g_warning ("Fatal error handling archive: %s", error->message);
 				g_clear_error (&error);
+				g_ptr_array_free (entries, TRUE);
 				goto out;
 			}
 			break;
@@ -95,16 +149,28 @@ main (int argc, char **argv)
 		is_encrypted = ev_archive_get_entry_is_encrypted (ar);
 		size = ev_archive_get_entry_size (ar);
 
+		entry = g_new (Entry, 1);
+		entry->name = g_strdup (name);
+		entry->offset = ev_archive_get_entry_offset (ar);
+		g_ptr_array_add (entries, entry);
+
 		if (!printed_header) {
-			g_print ("P\tSIZE\tNAME\n");
+			g_print ("P\tS\tSIZE\tOFFSET\tNAME\n");
 			printed_header = TRUE;
 		}
 
-		g_print ("%c\t%"G_GINT64_FORMAT"\t%s\n",
+		g_print ("%c\t%c\t%"G_GINT64_FORMAT"\t%"G_GINT64_FORMAT"\t%s\n",
 			 is_encrypted ? 'P' : ' ',
-			 size, name);
+			 ev_archive_get_entry_is_solid (ar) ? 'S' : ' ',
+			 size, entry->offset, name);
+	}
+
+	if (!check_seek (ar, argv[2], entries)) {
+		g_ptr_array_free (entries, TRUE);
+		goto out;
 	}
 
+	g_ptr_array_free (entries, TRUE);
 	ev_archive_reset (ar);
 	g_clear_object (&ar);
 
@@ -0,0 +1,231 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "ev-image-size.h"
+
+/* Checks the image headers parser against valid, truncated and
+ * malformed headers. Run it under valgrind to catch reads past
+ * the end of the data.
+ */
+
+typedef struct {
+	const gchar      *name;
+	const guchar     *data;
+	gsize             length;
+	EvImageSizeResult result;
+	gint              width;
+	gint              height;
+} TestCase;
+
+#define DATA(s) (const guchar *) (s), sizeof (s) - 1
+
+static const TestCase valid_cases[] = {
+	{ "png",
+	  DATA ("\x89PNG\r\n\x1a\n" "\0\0\0\x0d" "IHDR" "\0\0\x01\x2c" "\0\0\x00\xc8"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "gif",
+	  DATA ("GIF89a" "\x2c\x01" "\xc8\x00" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "jpeg",
+	  DATA ("\xff\xd8"
+		"\xff\xe0" "\0\x06" "JFIF"
+		"\xff\xff\xdb" "\0\x02"
+		"\xff\xc0" "\0\x0b" "\x08" "\0\xc8" "\x01\x2c" "\x01\x01\x11\x00"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "webp-vp8",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8 " "\0\0\0\0"
+		"\0\0\0" "\x9d\x01\x2a" "\x2c\x01" "\xc8\x00"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "webp-vp8l",
+	  /* 299 and 199, minus one, packed in 14 bits each */
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8L" "\0\0\0\0"
+		"\x2f" "\x2b\xc1\x31\x00" "\0\0\0\0\0"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "webp-vp8x",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8X" "\0\0\0\0"
+		"\0\0\0\0" "\x2b\x01\x00" "\xc7\x00\x00"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "tiff-le",
+	  DATA ("II*\0" "\x08\0\0\0" "\x02\0"
+		"\x00\x01" "\x03\0" "\x01\0\0\0" "\x2c\x01\0\0"
+		"\x01\x01" "\x04\0" "\x01\0\0\0" "\xc8\0\0\0"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+	{ "tiff-be",
+	  DATA ("MM\0*" "\0\0\0\x08" "\0\x02"
+		"\x01\x00" "\0\x04" "\0\0\0\x01" "\0\0\x01\x2c"
+		"\x01\x01" "\0\x03" "\0\0\0\x01" "\0\xc8\0\0"),
+	  EV_IMAGE_SIZE_FOUND, 300, 200 },
+};
+
+static const TestCase malformed_cases[] = {
+	{ "empty",
+	  DATA (""),
+	  EV_IMAGE_SIZE_NEED_MORE_DATA, 0, 0 },
+	{ "text",
+	  DATA ("This is not an image at all"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "png-no-ihdr",
+	  DATA ("\x89PNG\r\n\x1a\n" "\0\0\0\x0d" "IDAT" "\0\0\x01\x2c" "\0\0\x00\xc8"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "png-zero-width",
+	  DATA ("\x89PNG\r\n\x1a\n" "\0\0\0\x0d" "IHDR" "\0\0\0\0" "\0\0\x00\xc8"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "png-huge-height",
+	  DATA ("\x89PNG\r\n\x1a\n" "\0\0\0\x0d" "IHDR" "\0\0\x01\x2c" "\x80\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "gif-zero-height",
+	  DATA ("GIF87a" "\x2c\x01" "\0\0" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "jpeg-no-marker",
+	  DATA ("\xff\xd8" "\x00\xe0" "\0\x06" "JFIF" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "jpeg-short-segment",
+	  DATA ("\xff\xd8" "\xff\xe0" "\0\x01" "JFIF" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "jpeg-scan-before-frame",
+	  DATA ("\xff\xd8" "\xff\xda" "\0\x08" "\0\0\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "jpeg-segment-past-end",
+	  DATA ("\xff\xd8" "\xff\xe0" "\xff\xff" "JFIF" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_NEED_MORE_DATA, 0, 0 },
+	{ "jpeg-fill-bytes-only",
+	  DATA ("\xff\xd8" "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"),
+	  EV_IMAGE_SIZE_NEED_MORE_DATA, 0, 0 },
+	{ "webp-vp8-no-start-code",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8 " "\0\0\0\0"
+		"\0\0\0" "\x9d\x01\x00" "\x2c\x01" "\xc8\x00"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "webp-vp8-zero-width",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8 " "\0\0\0\0"
+		"\0\0\0" "\x9d\x01\x2a" "\0\xc0" "\xc8\x00"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "webp-vp8l-no-signature",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "VP8L" "\0\0\0\0"
+		"\x2e" "\x2b\xc1\x31\x00" "\0\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "webp-unknown-chunk",
+	  DATA ("RIFF" "\0\0\0\0" "WEBP" "ALPH" "\0\0\0\0"
+		"\0\0\0\0\0\0\0\0\0\0\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "tiff-ifd-in-header",
+	  DATA ("II*\0" "\x04\0\0\0" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "tiff-ifd-past-end",
+	  DATA ("II*\0" "\xff\xff\xff\xff" "\0\0\0\0"),
+	  EV_IMAGE_SIZE_NEED_MORE_DATA, 0, 0 },
+	{ "tiff-too-many-entries",
+	  DATA ("II*\0" "\x08\0\0\0" "\xff\xff" "\0\0"),
+	  EV_IMAGE_SIZE_NEED_MORE_DATA, 0, 0 },
+	{ "tiff-no-width",
+	  DATA ("II*\0" "\x08\0\0\0" "\x01\0"
+		"\x01\x01" "\x04\0" "\x01\0\0\0" "\xc8\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+	{ "tiff-bad-type",
+	  DATA ("II*\0" "\x08\0\0\0" "\x02\0"
+		"\x00\x01" "\x02\0" "\x01\0\0\0" "\x2c\x01\0\0"
+		"\x01\x01" "\x04\0" "\x01\0\0\0" "\xc8\0\0\0"),
+	  EV_IMAGE_SIZE_UNKNOWN, 0, 0 },
+};
+
+/* Copies the data, so that reads past @length hit the end of the block */
+static EvImageSizeResult
+get_size (const guchar *data,
+	  gsize         length,
+	  gint         *width,
+	  gint         *height)
+{
+	guchar           *copy = g_memdup (data, length);
+	EvImageSizeResult result;
+
+	*width = *height = -1;
+	result = ev_image_size_from_header (copy, length, width, height);
+	g_free (copy);
+
+	return result;
+}
+
+static gboolean
+check_case (const TestCase *test)
+{
+	EvImageSizeResult result;
+	gint              width, height;
+
+	result = get_size (test->data, test->length, &width, &height);
+	if (result != test->result) {
+		g_print ("FAIL %s: got result %d instead of %d\n",
+			 test->name, result, test->result);
+		return FALSE;
+	}
+
+	if (result == EV_IMAGE_SIZE_FOUND &&
+	    (width != test->width || height != test->height)) {
+		g_print ("FAIL %s: got %dx%d instead of %dx%d\n",
+			 test->name, width, height, test->width, test->height);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Every prefix of a valid header needs more data, or is enough */
+static gboolean
+check_truncated (const TestCase *test)
+{
+	gsize length;
+
+	for (length = 0; length < test->length; length++) {
+		EvImageSizeResult result;
+		gint              width, height;
+
+		result = get_size (test->data, length, &width, &height);
+		if (result == EV_IMAGE_SIZE_NEED_MORE_DATA)
+			continue;
+
+		if (result != EV_IMAGE_SIZE_FOUND ||
+		    width != test->width || height != test->height) {
+			g_print ("FAIL %s truncated to %" G_GSIZE_FORMAT " bytes: "
+				 "got result %d, %dx%d\n",
+				 test->name, length, result, width, height);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	guint i, n_failed = 0;
+
+	for (i = 0; i < G_N_ELEMENTS (valid_cases); i++) {
+		if (!check_case (&valid_cases[i]) || !check_truncated (&valid_cases[i]))
+			n_failed++;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (malformed_cases); i++) {
+		if (!check_case (&malformed_cases[i]))
+			n_failed++;
+	}
+
+	g_print ("%u of %u cases failed\n", n_failed,
+		 (guint) (G_N_ELEMENTS (valid_cases) + G_N_ELEMENTS (malformed_cases)));
+
+	return n_failed > 0 ? 1 : 0;
+}
@@ -41,6 +41,14 @@ struct _DjvuDocument {
 	ddjvu_fileinfo_t *fileinfo_pages;
 	gint		  n_pages;
 	GHashTable	 *file_ids;
+
+	/* Page number to the DjvuTextIndex of its text, for
+	 * the pages whose text was read most recently, with the
+	 * link of the page in text_indices_lru */
+	GMutex            text_indices_lock;
+	GHashTable       *text_indices;
+	GQueue            text_indices_lru;
+	gsize             text_indices_size;
 };
 
 int  djvu_document_get_n_pages (EvDocument   *document);
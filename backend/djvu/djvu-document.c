@@ -37,6 +37,16 @@
 #include <glib/gi18n-lib.h>
 #include <string.h>
 
+/* How much memory the text of the pages read last may take */
+#define TEXT_INDICES_MAX_SIZE (16 * 1024 * 1024)
+
+/* A cached text index, with its link in the LRU queue */
+typedef struct {
+	gint           page;
+	DjvuTextIndex *index;
+	GList         *link;
+} TextIndexEntry;
+
 enum {
 	PROP_0,
 	PROP_TITLE
@@ -542,6 +552,10 @@ djvu_document_finalize (GObject *object)
 	if (djvu_document->file_ids)
 	    g_hash_table_destroy (djvu_document->file_ids);
 
+	g_hash_table_destroy (djvu_document->text_indices);
+	g_queue_clear (&djvu_document->text_indices_lru);
+	g_mutex_clear (&djvu_document->text_indices_lock);
+
 	ddjvu_context_release (djvu_document->d_context);
 	ddjvu_format_release (djvu_document->d_format);
 	ddjvu_format_release (djvu_document->thumbs_format);
@@ -732,28 +746,89 @@ djvu_document_text_get_text_mapping (EvDocumentText *document_text,
 					  1.0, 1.0, &points);
 }
 
-static gchar *
-djvu_document_text_get_text (EvDocumentText  *selection,
-                             EvPage          *page)
+static void
+text_index_entry_free (TextIndexEntry *entry)
 {
-	DjvuDocument *djvu_document = DJVU_DOCUMENT (selection);
-	miniexp_t     page_text;
-	gchar        *text = NULL;
+	djvu_text_index_free (entry->index);
+	g_slice_free (TextIndexEntry, entry);
+}
+
+/* Returns the text index of @page with text_indices_lock held, reading
+ * the page text if it isn't cached. Reading the whole text to build
+ * the find index fills the cache for the searches that follow.
+ */
+static DjvuTextIndex *
+djvu_document_lock_text_index (DjvuDocument *djvu_document,
+			       gint          page)
+{
+	TextIndexEntry *entry;
+	DjvuTextIndex  *index;
+	miniexp_t       page_text;
+
+	g_mutex_lock (&djvu_document->text_indices_lock);
+	entry = g_hash_table_lookup (djvu_document->text_indices, GINT_TO_POINTER (page));
+	if (entry) {
+		g_queue_unlink (&djvu_document->text_indices_lru, entry->link);
+		g_queue_push_head_link (&djvu_document->text_indices_lru, entry->link);
+		return entry->index;
+	}
+	g_mutex_unlock (&djvu_document->text_indices_lock);
 
 	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
-							 page->index,
+							 page,
 							 "char")) == miniexp_dummy)
 		djvu_handle_events (djvu_document, TRUE, NULL);
 
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *tpage = djvu_text_page_new (page_text);
-
-		djvu_text_page_index_text (tpage, TRUE);
-		text = tpage->text;
-		tpage->text = NULL;
-		djvu_text_page_free (tpage);
+	index = djvu_text_index_new (page_text);
+	if (page_text != miniexp_nil)
 		ddjvu_miniexp_release (djvu_document->d_document, page_text);
+
+	g_mutex_lock (&djvu_document->text_indices_lock);
+	entry = g_hash_table_lookup (djvu_document->text_indices, GINT_TO_POINTER (page));
+	if (entry) {
+		/* Read by another thread meanwhile */
+		djvu_text_index_free (index);
+		return entry->index;
+	}
+
+	entry = g_slice_new (TextIndexEntry);
+	entry->page = page;
+	entry->index = index;
+	g_queue_push_head (&djvu_document->text_indices_lru, entry);
+	entry->link = djvu_document->text_indices_lru.head;
+	g_hash_table_insert (djvu_document->text_indices, GINT_TO_POINTER (page), entry);
+	djvu_document->text_indices_size += djvu_text_index_get_size (index);
+
+	/* Keep the page being returned */
+	while (djvu_document->text_indices_size > TEXT_INDICES_MAX_SIZE &&
+	       djvu_document->text_indices_lru.length > 1) {
+		TextIndexEntry *old_entry = g_queue_pop_tail (&djvu_document->text_indices_lru);
+
+		djvu_document->text_indices_size -= djvu_text_index_get_size (old_entry->index);
+		g_hash_table_remove (djvu_document->text_indices, GINT_TO_POINTER (old_entry->page));
 	}
+
+	return index;
+}
+
+static void
+djvu_document_unlock_text_index (DjvuDocument *djvu_document)
+{
+	g_mutex_unlock (&djvu_document->text_indices_lock);
+}
+
+static gchar *
+djvu_document_text_get_text (EvDocumentText  *selection,
+                             EvPage          *page)
+{
+	DjvuDocument  *djvu_document = DJVU_DOCUMENT (selection);
+	DjvuTextIndex *index;
+	gchar         *text;
+
+	index = djvu_document_lock_text_index (djvu_document, page->index);
+	text = g_strdup (djvu_text_index_get_text (index));
+	djvu_document_unlock_text_index (djvu_document);
+
 	return text;
 }
 
@@ -847,37 +922,31 @@ djvu_document_init (DjvuDocument *djvu_document)
 	djvu_document->opts = g_string_new ("");
 	
 	djvu_document->d_document = NULL;
+
+	djvu_document->text_indices = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							     NULL, (GDestroyNotify) text_index_entry_free);
+	g_queue_init (&djvu_document->text_indices_lru);
+	g_mutex_init (&djvu_document->text_indices_lock);
 }
 
 static GList *
-djvu_document_find_find_text (EvDocumentFind   *document,
-			      EvPage           *page,
-			      const char       *text,
-			      gboolean          case_sensitive)
+djvu_document_find_find_text_with_options (EvDocumentFind   *document,
+					   EvPage           *page,
+					   const char       *text,
+					   EvFindOptions     options)
 {
         DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
-	miniexp_t page_text;
+	DjvuTextIndex *index;
 	gdouble width, height, dpi;
-	GList *matches = NULL, *l;
+	GList *matches, *l;
 
 	g_return_val_if_fail (text != NULL, NULL);
 
-	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
-							 page->index,
-							 "char")) == miniexp_dummy)
-		djvu_handle_events (djvu_document, TRUE, NULL);
-
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *tpage = djvu_text_page_new (page_text);
-		
-		djvu_text_page_index_text (tpage, case_sensitive);
-		if (tpage->links->len > 0) {
-			djvu_text_page_search (tpage, text);
-			matches = tpage->results;
-		}
-		djvu_text_page_free (tpage);
-		ddjvu_miniexp_release (djvu_document->d_document, page_text);
-	}
+	index = djvu_document_lock_text_index (djvu_document, page->index);
+	matches = djvu_text_index_search (index, text,
+					  options & EV_FIND_CASE_SENSITIVE,
+					  options & EV_FIND_WHOLE_WORDS_ONLY);
+	djvu_document_unlock_text_index (djvu_document);
 	if (!matches)
 		return NULL;
 
@@ -897,16 +966,29 @@ djvu_document_find_find_text (EvDocumentFind   *document,
 	return matches;
 }
 
+static GList *
+djvu_document_find_find_text (EvDocumentFind   *document,
+			      EvPage           *page,
+			      const char       *text,
+			      gboolean          case_sensitive)
+{
+	return djvu_document_find_find_text_with_options (document, page, text,
+							  case_sensitive ?
+							  EV_FIND_CASE_SENSITIVE :
+							  EV_FIND_DEFAULT);
+}
+
 static EvFindOptions
 djvu_document_find_get_supported_options (EvDocumentFind *document)
 {
-	return EV_FIND_CASE_SENSITIVE;
+	return EV_FIND_CASE_SENSITIVE | EV_FIND_WHOLE_WORDS_ONLY;
 }
 
 static void
 djvu_document_find_iface_init (EvDocumentFindInterface *iface)
 {
         iface->find_text = djvu_document_find_find_text;
+	iface->find_text_with_options = djvu_document_find_find_text_with_options;
 	iface->get_supported_options = djvu_document_find_get_supported_options;
 }
 
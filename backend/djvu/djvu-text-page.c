@@ -250,271 +250,303 @@ djvu_text_page_copy (DjvuTextPage *page,
 }
 
 /**
- * djvu_text_page_position:
- * @page: #DjvuTextPage instance
- * @position: index in the page text
+ * djvu_text_page_new:
+ * @text: S-expression of the page text
  * 
- * Returns the closest s-expression that contains the given position in 
- * the page text.
+ * Creates a new page to select text in. 
  * 
- * Returns: closest s-expression
+ * Returns: new #DjvuTextPage instance
  */
-static miniexp_t
-djvu_text_page_position (DjvuTextPage *page, 
-			 int           position)
+DjvuTextPage *
+djvu_text_page_new (miniexp_t text)
 {
-	GArray *links = page->links;
-	int low = 0;
-	int hi = links->len - 1;
-	int mid = 0;
-
-	g_return_val_if_fail (hi >= 0, miniexp_nil);
-
-	/* Shamelessly copied from GNU classpath */
-	while (low <= hi) {
-                DjvuTextLink *link;
-
-		mid = (low + hi) >> 1;
-		link = &g_array_index (links, DjvuTextLink, mid);
-		if (link->position == position)
-			break;
-		else if (link->position > position)
-			hi = --mid;
-		else
-			low = mid + 1;
-	}
+	DjvuTextPage *page;
 
-	return g_array_index (page->links, DjvuTextLink, mid).pair;
+	page = g_new0 (DjvuTextPage, 1);
+	page->char_symbol = miniexp_symbol ("char");
+	page->word_symbol = miniexp_symbol ("word");
+	page->text_structure = text;
+	return page;
 }
 
 /**
- * djvu_text_page_sexpr_process:
+ * djvu_text_page_free:
  * @page: #DjvuTextPage instance
- * @p: s-expression to append
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
- * 
- * Appends the rectangle defined by @p to the internal bounding box rectangle.
  * 
- * Returns: whether the end was not reached in this s-expression
+ * Frees the given #DjvuTextPage instance.
  */
-static gboolean
-djvu_text_page_sexpr_process (DjvuTextPage *page, 
-                              miniexp_t     p,
-                              miniexp_t     start, 
-                              miniexp_t     end)
+void 
+djvu_text_page_free (DjvuTextPage *page)
 {
-	if (page->bounding_box || p == start) {
-		EvRectangle *new_rectangle = ev_rectangle_new ();
-		new_rectangle->x1 = miniexp_to_int (miniexp_nth (1, p));
-		new_rectangle->y1 = miniexp_to_int (miniexp_nth (2, p));
-		new_rectangle->x2 = miniexp_to_int (miniexp_nth (3, p));
-		new_rectangle->y2 = miniexp_to_int (miniexp_nth (4, p));
-		if (page->bounding_box) {
-			djvu_text_page_union (page->bounding_box,
-					      new_rectangle);
-			g_free (new_rectangle);
-		} else
-			page->bounding_box = new_rectangle;
-		if (p == end)
-			return FALSE;
-	}
-	return TRUE;
+	g_free (page->text);
+	g_free (page);
 }
 
-/**
- * djvu_text_page_sexpr:
- * @page: #DjvuTextPage instance
- * @p: tree to append
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
- * 
- * Walks the tree in @p and extends the rectangle with 
- * djvu_text_page_process() for all s-expressions between @start and @end.
- * 
- * Returns: whether the end was not reached in this subtree
- */
-static gboolean
-djvu_text_page_sexpr (DjvuTextPage *page, 
-		      miniexp_t p,
-		      miniexp_t start, 
-		      miniexp_t end)
+/* A string leaf of the page text: its bounding box, and where
+ * its text starts in the page text and in the casefolded one */
+typedef struct {
+	gint  x1, y1, x2, y2;
+	guint offset;
+	guint folded_offset;
+} DjvuTextToken;
+
+struct _DjvuTextIndex {
+	GString   *text;
+	GString   *folded;
+	GArray    *tokens;
+	miniexp_t  char_symbol;
+};
+
+static void
+djvu_text_index_append_text (DjvuTextIndex *index,
+			     miniexp_t      p,
+			     gboolean       delimit)
 {
-        miniexp_t deeper;
+	miniexp_t deeper;
 
-	g_return_val_if_fail (miniexp_consp (p) && miniexp_symbolp
-			      (miniexp_car (p)), FALSE);
+	g_return_if_fail (miniexp_consp (p) &&
+			  miniexp_symbolp (miniexp_car (p)));
+
+	delimit |= index->char_symbol != miniexp_car (p);
 
 	deeper = miniexp_cddr (miniexp_cdddr (p));
 	while (deeper != miniexp_nil) {
-		miniexp_t str = miniexp_car (deeper);
-		if (miniexp_stringp (str)) {
-			if (!djvu_text_page_sexpr_process
-			    (page, p, start, end))
-				return FALSE;
-		} else {
-			if (!djvu_text_page_sexpr
-			    (page, str, start, end))
-				return FALSE;
-		}
+		miniexp_t data = miniexp_car (deeper);
+		if (miniexp_stringp (data)) {
+			const char *token_text = miniexp_to_str (data);
+			char *folded_text;
+			DjvuTextToken token;
+
+			if (delimit && index->tokens->len > 0) {
+				g_string_append_c (index->text, ' ');
+				g_string_append_c (index->folded, ' ');
+			}
+
+			token.x1 = miniexp_to_int (miniexp_nth (1, p));
+			token.y1 = miniexp_to_int (miniexp_nth (2, p));
+			token.x2 = miniexp_to_int (miniexp_nth (3, p));
+			token.y2 = miniexp_to_int (miniexp_nth (4, p));
+			token.offset = index->text->len;
+			token.folded_offset = index->folded->len;
+			g_array_append_val (index->tokens, token);
+
+			folded_text = g_utf8_casefold (token_text, -1);
+			g_string_append (index->text, token_text);
+			g_string_append (index->folded, folded_text);
+			g_free (folded_text);
+		} else
+			djvu_text_index_append_text (index, data, delimit);
+		delimit = FALSE;
 		deeper = miniexp_cdr (deeper);
 	}
-	return TRUE;
 }
 
 /**
- * djvu_text_page_box:
- * @page: #DjvuTextPage instance
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
- * 
- * Builds a rectangle that contains all s-expressions in the given range.
+ * djvu_text_index_new:
+ * @text: S-expression of the page text, or miniexp_nil
+ *
+ * Flattens the page text once, along with its casefolded version and
+ * the position and box of every token, so that the page can be
+ * searched any number of times without @text, which may be released.
+ *
+ * Returns: new #DjvuTextIndex instance
  */
-static EvRectangle *
-djvu_text_page_box (DjvuTextPage *page,
-		    miniexp_t     start, 
-		    miniexp_t     end)
+DjvuTextIndex *
+djvu_text_index_new (miniexp_t text)
 {
-	page->bounding_box = NULL;
-	djvu_text_page_sexpr (page, page->text_structure, start, end);
-	return page->bounding_box;
+	DjvuTextIndex *index;
+
+	index = g_new0 (DjvuTextIndex, 1);
+	index->text = g_string_new (NULL);
+	index->folded = g_string_new (NULL);
+	index->tokens = g_array_new (FALSE, FALSE, sizeof (DjvuTextToken));
+	index->char_symbol = miniexp_symbol ("char");
+
+	if (text != miniexp_nil)
+		djvu_text_index_append_text (index, text, FALSE);
+
+	return index;
 }
 
 /**
- * djvu_text_page_append_search:
- * @page: #DjvuTextPage instance
- * @p: tree to append
- * @case_sensitive: do not ignore case
- * @delimit: insert spaces because of higher (sentence/paragraph/...) break
- * 
- * Appends the tree in @p to the internal text string. 
+ * djvu_text_index_get_text:
+ * @index: #DjvuTextIndex instance
+ *
+ * Returns: the page text, or %NULL if the page has none
  */
-static void
-djvu_text_page_append_text (DjvuTextPage *page,
-			    miniexp_t     p, 
-			    gboolean      case_sensitive, 
-			    gboolean      delimit)
+const char *
+djvu_text_index_get_text (DjvuTextIndex *index)
 {
-	char *token_text;
-	miniexp_t deeper;
-	
-	g_return_if_fail (miniexp_consp (p) && 
-			  miniexp_symbolp (miniexp_car (p)));
-
-	delimit |= page->char_symbol != miniexp_car (p);
-	
-	deeper = miniexp_cddr (miniexp_cdddr (p));
-	while (deeper != miniexp_nil) {
-		miniexp_t data = miniexp_car (deeper);
-		if (miniexp_stringp (data)) {
-			DjvuTextLink link;
-			link.position = page->text == NULL ? 0 :
-			    strlen (page->text);
-			link.pair = p;
-			g_array_append_val (page->links, link);
-
-			token_text = (char *) miniexp_to_str (data);
-			if (!case_sensitive)
-				token_text = g_utf8_casefold (token_text, -1);
-			if (page->text == NULL)
-				page->text = g_strdup (token_text);
-			else {
-				char *new_text =
-				    g_strjoin (delimit ? " " : NULL,
-					       page->text, token_text,
-					       NULL);
-				g_free (page->text);
-				page->text = new_text;
-			}
-			if (!case_sensitive)
-				g_free (token_text);
-		} else
-			djvu_text_page_append_text (page, data, 
-						    case_sensitive, delimit);
-		delimit = FALSE;
-		deeper = miniexp_cdr (deeper);
-	}
+	return index->tokens->len > 0 ? index->text->str : NULL;
 }
 
 /**
- * djvu_text_page_search:
- * @page: #DjvuTextPage instance
- * @text: text to search
- * 
- * Searches the page for the given text. The results list has to be 
- * externally freed afterwards.
+ * djvu_text_index_get_size:
+ * @index: #DjvuTextIndex instance
+ *
+ * Returns: about how much memory @index takes
  */
-void 
-djvu_text_page_search (DjvuTextPage *page, 
-		       const char   *text)
+gsize
+djvu_text_index_get_size (DjvuTextIndex *index)
 {
-	char *haystack = page->text;
-	int search_len;
-	EvRectangle *result;
-	if (page->links->len == 0)
-		return;
-
-	search_len = strlen (text);
-	while ((haystack = strstr (haystack, text)) != NULL) {
-		int start_p = haystack - page->text;
-		miniexp_t start = djvu_text_page_position (page, start_p);
-		int end_p = start_p + search_len - 1;
-		miniexp_t end = djvu_text_page_position (page, end_p);
-		result = djvu_text_page_box (page, start, end);
-		g_assert (result);
-		page->results = g_list_prepend (page->results, result);
-		haystack = haystack + search_len;
+	return sizeof (DjvuTextIndex) + index->text->allocated_len +
+		index->folded->allocated_len +
+		index->tokens->len * sizeof (DjvuTextToken);
+}
+
+/* Returns the token the byte at @offset of the text belongs to */
+static guint
+djvu_text_index_token_at (DjvuTextIndex *index,
+			  gsize          offset,
+			  gboolean       folded)
+{
+	guint low = 0;
+	guint high = index->tokens->len;
+
+	/* Last token starting at or before @offset */
+	while (high - low > 1) {
+		guint          mid = (low + high) / 2;
+		DjvuTextToken *token = &g_array_index (index->tokens, DjvuTextToken, mid);
+
+		if ((folded ? token->folded_offset : token->offset) <= offset)
+			low = mid;
+		else
+			high = mid;
 	}
-	page->results = g_list_reverse (page->results);
+
+	return low;
 }
 
+static void
+djvu_text_index_token_box (DjvuTextIndex *index,
+			   guint          i,
+			   EvRectangle   *box)
+{
+	DjvuTextToken *token = &g_array_index (index->tokens, DjvuTextToken, i);
 
-/**
- * djvu_text_page_index_text:
- * @page: #DjvuTextPage instance
- * @case_sensitive: do not ignore case
- * 
- * Indexes the page text and prepares the page for subsequent searches.
- */
-void
-djvu_text_page_index_text (DjvuTextPage *page,
-	       		       gboolean      case_sensitive)
+	box->x1 = token->x1;
+	box->y1 = token->y1;
+	box->x2 = token->x2;
+	box->y2 = token->y2;
+}
+
+static gboolean
+djvu_text_index_is_word_boundary (const char *text,
+				  gsize       length,
+				  gsize       offset)
+{
+	gunichar before, after;
+
+	if (offset == 0 || offset == length)
+		return TRUE;
+
+	before = g_utf8_get_char (g_utf8_find_prev_char (text, text + offset));
+	after = g_utf8_get_char (text + offset);
+
+	return !g_unichar_isalnum (before) || !g_unichar_isalnum (after);
+}
+
+/* Like memmem(): memchr() finds the candidates, and it and memcmp()
+ * are vectorized by the C library */
+static const char *
+djvu_text_index_find (const char *haystack,
+		      gsize       haystack_len,
+		      const char *needle,
+		      gsize       needle_len)
 {
-	djvu_text_page_append_text (page, page->text_structure, 
-				    case_sensitive, FALSE);	
+	const char *last;
+
+	if (needle_len > haystack_len)
+		return NULL;
+
+	last = haystack + haystack_len - needle_len;
+	while (haystack <= last) {
+		haystack = memchr (haystack, needle[0], last - haystack + 1);
+		if (!haystack)
+			return NULL;
+		if (memcmp (haystack + 1, needle + 1, needle_len - 1) == 0)
+			return haystack;
+		haystack++;
+	}
+
+	return NULL;
 }
 
 /**
- * djvu_text_page_new:
- * @text: S-expression of the page text
- * 
- * Creates a new page to search. 
- * 
- * Returns: new #DjvuTextPage instance
+ * djvu_text_index_search:
+ * @index: #DjvuTextIndex instance
+ * @text: text to search
+ * @case_sensitive: do not ignore case
+ * @whole_words: only match @text at word boundaries
+ *
+ * Searches the page for the given text.
+ *
+ * Returns: (transfer full): the #EvRectangles of the matches, in
+ * DjVu page coordinates
  */
-DjvuTextPage *
-djvu_text_page_new (miniexp_t text)
+GList *
+djvu_text_index_search (DjvuTextIndex *index,
+			const char    *text,
+			gboolean       case_sensitive,
+			gboolean       whole_words)
 {
-	DjvuTextPage *page;
+	GString    *haystack = case_sensitive ? index->text : index->folded;
+	const char *match;
+	char       *needle;
+	gsize       needle_len, offset = 0;
+	GList      *results = NULL;
+
+	if (index->tokens->len == 0 || *text == '\0')
+		return NULL;
+
+	needle = case_sensitive ? g_strdup (text) : g_utf8_casefold (text, -1);
+	needle_len = strlen (needle);
+
+	while ((match = djvu_text_index_find (haystack->str + offset, haystack->len - offset,
+					      needle, needle_len)) != NULL) {
+		gsize        start = match - haystack->str;
+		gsize        end = start + needle_len;
+		EvRectangle *result;
+		guint        i, last;
+
+		if (whole_words &&
+		    (!djvu_text_index_is_word_boundary (haystack->str, haystack->len, start) ||
+		     !djvu_text_index_is_word_boundary (haystack->str, haystack->len, end))) {
+			offset = start + 1;
+			continue;
+		}
 
-	page = g_new0 (DjvuTextPage, 1);
-	page->links = g_array_new (FALSE, FALSE, sizeof (DjvuTextLink));
-	page->char_symbol = miniexp_symbol ("char");
-	page->word_symbol = miniexp_symbol ("word");
-	page->text_structure = text;
-	return page;
+		i = djvu_text_index_token_at (index, start, !case_sensitive);
+		last = djvu_text_index_token_at (index, end - 1, !case_sensitive);
+
+		result = ev_rectangle_new ();
+		djvu_text_index_token_box (index, i, result);
+		for (i++; i <= last; i++) {
+			EvRectangle box;
+
+			djvu_text_index_token_box (index, i, &box);
+			djvu_text_page_union (result, &box);
+		}
+		results = g_list_prepend (results, result);
+
+		offset = end;
+	}
+	g_free (needle);
+
+	return g_list_reverse (results);
 }
 
 /**
- * djvu_text_page_free:
- * @page: #DjvuTextPage instance
- * 
- * Frees the given #DjvuTextPage instance.
+ * djvu_text_index_free:
+ * @index: #DjvuTextIndex instance
+ *
+ * Frees the given #DjvuTextIndex instance.
  */
-void 
-djvu_text_page_free (DjvuTextPage *page)
+void
+djvu_text_index_free (DjvuTextIndex *index)
 {
-	g_free (page->text);
-	g_array_free (page->links, TRUE);
-	g_free (page);
+	g_string_free (index->text, TRUE);
+	g_string_free (index->folded, TRUE);
+	g_array_free (index->tokens, TRUE);
+	g_free (index);
 }
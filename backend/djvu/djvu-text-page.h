@@ -27,25 +27,18 @@
 
 
 typedef struct _DjvuTextPage DjvuTextPage;
-typedef struct _DjvuTextLink DjvuTextLink;
+typedef struct _DjvuTextIndex DjvuTextIndex;
 
 struct _DjvuTextPage {
 	char *text;
-	GArray *links;
 	GList *results;
 	miniexp_t char_symbol;
 	miniexp_t word_symbol;
-	EvRectangle *bounding_box;
 	miniexp_t text_structure;
 	miniexp_t start;
 	miniexp_t end;
 };
 
-struct _DjvuTextLink {
-	int position;
-	miniexp_t pair;
-};
-
 typedef enum {
 	DJVU_SELECTION_TEXT,
 	DJVU_SELECTION_BOX,
@@ -55,12 +48,17 @@ GList        *djvu_text_page_get_selection_region (DjvuTextPage *page,
                                                    EvRectangle  *rectangle);
 char         *djvu_text_page_copy                 (DjvuTextPage *page,
                                                    EvRectangle  *rectangle);
-void          djvu_text_page_index_text           (DjvuTextPage *page,
-                                                   gboolean      case_sensitive);
-void          djvu_text_page_search               (DjvuTextPage *page,
-                                                   const char   *text);
 DjvuTextPage *djvu_text_page_new                  (miniexp_t     text);
 void          djvu_text_page_free                 (DjvuTextPage *page);
 
+DjvuTextIndex *djvu_text_index_new      (miniexp_t      text);
+const char    *djvu_text_index_get_text (DjvuTextIndex *index);
+gsize          djvu_text_index_get_size (DjvuTextIndex *index);
+GList         *djvu_text_index_search   (DjvuTextIndex *index,
+                                         const char    *text,
+                                         gboolean       case_sensitive,
+                                         gboolean       whole_words);
+void           djvu_text_index_free     (DjvuTextIndex *index);
+
 #endif /* __DJVU_TEXT_PAGE_H__ */
 
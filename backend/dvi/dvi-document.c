@@ -40,7 +40,8 @@
 #endif
 #include <stdlib.h>
 
-static GMutex dvi_context_mutex;
+/* Fonts and their glyphs are shared by all the DVI contexts */
+static GMutex dvi_fonts_mutex;
 
 enum {
 	PROP_0,
@@ -58,6 +59,13 @@ struct _DviDocument
 
 	DviContext *context;
 	DviPageSpec *spec;
+
+	/* Render contexts not in use. Every render uses its own
+	 * clone of context, so that pages can render in parallel. */
+	GMutex render_contexts_mutex;
+	GCond render_contexts_cond;
+	GSList *render_contexts;
+	guint n_busy_render_contexts;
 	DviParams *params;
 	
 	/* To let document scale we should remember width and height */
@@ -83,6 +91,85 @@ EV_BACKEND_REGISTER_WITH_CODE (DviDocument, dvi_document,
       EV_BACKEND_IMPLEMENT_INTERFACE (EV_TYPE_FILE_EXPORTER, dvi_document_file_exporter_iface_init);
      });
 
+static void
+dvi_font_lock (void)
+{
+	g_mutex_lock (&dvi_fonts_mutex);
+}
+
+static void
+dvi_font_unlock (void)
+{
+	g_mutex_unlock (&dvi_fonts_mutex);
+}
+
+static void
+dvi_document_free_render_contexts (DviDocument *dvi_document)
+{
+	GSList *l;
+
+	for (l = dvi_document->render_contexts; l; l = g_slist_next (l)) {
+		DviContext *context = (DviContext *)l->data;
+
+		mdvi_cairo_device_free (&context->device);
+		mdvi_destroy_context (context);
+	}
+	g_slist_free (dvi_document->render_contexts);
+	dvi_document->render_contexts = NULL;
+}
+
+static DviContext *
+dvi_document_get_render_context (DviDocument *dvi_document)
+{
+	DviContext *context = NULL;
+
+	g_mutex_lock (&dvi_document->render_contexts_mutex);
+
+	/* Only the loaded context can reload the file when it changes,
+	 * like mdvi does when rendering with it. The clones share its
+	 * fonts and page table, so they are made again from it, once
+	 * the renders using them are done.
+	 */
+	if (mdvi_file_changed (dvi_document->context)) {
+		while (dvi_document->n_busy_render_contexts > 0)
+			g_cond_wait (&dvi_document->render_contexts_cond,
+				     &dvi_document->render_contexts_mutex);
+
+		/* Unless another render reloaded it meanwhile */
+		if (mdvi_file_changed (dvi_document->context)) {
+			g_mutex_lock (&dvi_fonts_mutex);
+			dvi_document_free_render_contexts (dvi_document);
+			mdvi_reload (dvi_document->context, &dvi_document->context->params);
+			g_mutex_unlock (&dvi_fonts_mutex);
+		}
+	}
+
+	if (dvi_document->render_contexts) {
+		context = (DviContext *)dvi_document->render_contexts->data;
+		dvi_document->render_contexts = g_slist_delete_link (dvi_document->render_contexts,
+								     dvi_document->render_contexts);
+	} else {
+		context = mdvi_clone_context (dvi_document->context);
+		mdvi_cairo_device_init (&context->device);
+	}
+	dvi_document->n_busy_render_contexts++;
+
+	g_mutex_unlock (&dvi_document->render_contexts_mutex);
+
+	return context;
+}
+
+static void
+dvi_document_release_render_context (DviDocument *dvi_document,
+				     DviContext  *context)
+{
+	g_mutex_lock (&dvi_document->render_contexts_mutex);
+	dvi_document->render_contexts = g_slist_prepend (dvi_document->render_contexts, context);
+	if (--dvi_document->n_busy_render_contexts == 0)
+		g_cond_broadcast (&dvi_document->render_contexts_cond);
+	g_mutex_unlock (&dvi_document->render_contexts_mutex);
+}
+
 static gboolean
 dvi_document_load (EvDocument  *document,
 		   const char  *uri,
@@ -95,12 +182,13 @@ dvi_document_load (EvDocument  *document,
 	if (!filename)
         	return FALSE;
 	
-	g_mutex_lock (&dvi_context_mutex);
+	g_mutex_lock (&dvi_fonts_mutex);
+	dvi_document_free_render_contexts (dvi_document);
 	if (dvi_document->context)
 		mdvi_destroy_context (dvi_document->context);
 
 	dvi_document->context = mdvi_init_context(dvi_document->params, dvi_document->spec, filename);
-	g_mutex_unlock (&dvi_context_mutex);
+	g_mutex_unlock (&dvi_fonts_mutex);
 	g_free (filename);
 	
 	if (!dvi_document->context) {
@@ -164,41 +252,41 @@ dvi_document_render (EvDocument      *document,
 	cairo_surface_t *surface;
 	cairo_surface_t *rotated_surface;
 	DviDocument *dvi_document = DVI_DOCUMENT(document);
+	DviContext *context;
 	gdouble xscale, yscale;
 	gint required_width, required_height;
 	gint proposed_width, proposed_height;
 	gint xmargin = 0, ymargin = 0;
 
-	/* We should protect our context since it's not 
-	 * thread safe. The work to the future - 
-	 * let context render page independently
+	/* The shrink factor, margins and device belong to the render
+	 * context; only glyph loading and shrinking take the fonts lock.
 	 */
-	g_mutex_lock (&dvi_context_mutex);
-	
-	mdvi_setpage (dvi_document->context, rc->page->index);
+	context = dvi_document_get_render_context (dvi_document);
+
+	mdvi_setpage (context, rc->page->index);
 	
 	ev_render_context_compute_scales (rc, dvi_document->base_width, dvi_document->base_height,
 					  &xscale, &yscale);
-	mdvi_set_shrink (dvi_document->context, 
+	mdvi_set_shrink (context,
 			 (int)((dvi_document->params->hshrink - 1) / xscale) + 1,
 			 (int)((dvi_document->params->vshrink - 1) / yscale) + 1);
 
 	ev_render_context_compute_scaled_size (rc, dvi_document->base_width, dvi_document->base_height,
 					       &required_width, &required_height);
-	proposed_width = dvi_document->context->dvi_page_w * dvi_document->context->params.conv;
-	proposed_height = dvi_document->context->dvi_page_h * dvi_document->context->params.vconv;
+	proposed_width = context->dvi_page_w * context->params.conv;
+	proposed_height = context->dvi_page_h * context->params.vconv;
 	
 	if (required_width >= proposed_width)
 	    xmargin = (required_width - proposed_width) / 2;
 	if (required_height >= proposed_height)
 	    ymargin = (required_height - proposed_height) / 2;
 	    
-	mdvi_cairo_device_set_margins (&dvi_document->context->device, xmargin, ymargin);
-	mdvi_cairo_device_set_scale (&dvi_document->context->device, xscale, yscale);
-	mdvi_cairo_device_render (dvi_document->context);
-	surface = mdvi_cairo_device_get_surface (&dvi_document->context->device);
+	mdvi_cairo_device_set_margins (&context->device, xmargin, ymargin);
+	mdvi_cairo_device_set_scale (&context->device, xscale, yscale);
+	mdvi_cairo_device_render (context);
+	surface = mdvi_cairo_device_get_surface (&context->device);
 
-	g_mutex_unlock (&dvi_context_mutex);
+	dvi_document_release_render_context (dvi_document, context);
 
 	rotated_surface = ev_document_misc_surface_rotate_and_scale (surface,
 								     required_width,
@@ -214,12 +302,15 @@ dvi_document_finalize (GObject *object)
 {	
 	DviDocument *dvi_document = DVI_DOCUMENT(object);
 	
-	g_mutex_lock (&dvi_context_mutex);
+	g_mutex_lock (&dvi_fonts_mutex);
+	dvi_document_free_render_contexts (dvi_document);
 	if (dvi_document->context) {
 		mdvi_cairo_device_free (&dvi_document->context->device);
 		mdvi_destroy_context (dvi_document->context);
 	}
-	g_mutex_unlock (&dvi_context_mutex);
+	g_mutex_unlock (&dvi_fonts_mutex);
+	g_mutex_clear (&dvi_document->render_contexts_mutex);
+	g_cond_clear (&dvi_document->render_contexts_cond);
 
 	if (dvi_document->params)
 		g_free (dvi_document->params);
@@ -256,6 +347,7 @@ dvi_document_class_init (DviDocumentClass *klass)
 
 	mdvi_register_special ("Color", "color", NULL, dvi_document_do_color_special, 1);
 	mdvi_register_fonts ();
+	mdvi_set_font_lock_funcs (dvi_font_lock, dvi_font_unlock);
 
 	ev_document_class->load = dvi_document_load;
 	ev_document_class->save = dvi_document_save;
@@ -263,6 +355,7 @@ dvi_document_class_init (DviDocumentClass *klass)
 	ev_document_class->get_page_size = dvi_document_get_page_size;
 	ev_document_class->render = dvi_document_render;
 	ev_document_class->support_synctex = dvi_document_support_synctex;
+	ev_document_class_set_render_flags (ev_document_class, EV_DOCUMENT_RENDER_FLAG_REENTRANT);
 }
 
 /* EvFileExporterIface */
@@ -521,6 +614,10 @@ static void
 dvi_document_init (DviDocument *dvi_document)
 {
 	dvi_document->context = NULL;
+	g_mutex_init (&dvi_document->render_contexts_mutex);
+	g_cond_init (&dvi_document->render_contexts_cond);
+	dvi_document->render_contexts = NULL;
+	dvi_document->n_busy_render_contexts = 0;
 	dvi_document_init_params (dvi_document);
 
 	dvi_document->exporter_filename = NULL;
@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #include "mdvi.h"
 #include "private.h"
@@ -168,6 +169,20 @@ static void dummy_dev_set_color(void *a, Ulong b, Ulong c)
 {
 }
 
+static void init_dummy_device(DviDevice *dev)
+{
+	dev->draw_glyph   = dummy_draw_glyph;
+	dev->draw_rule    = dummy_draw_rule;
+	dev->alloc_colors = dummy_alloc_colors;
+	dev->create_image = dummy_create_image;
+	dev->free_image   = dummy_free_image;
+	dev->dev_destroy  = dummy_dev_destroy;
+	dev->put_pixel    = dummy_dev_putpixel;
+	dev->refresh      = dummy_dev_refresh;
+	dev->set_color    = dummy_dev_set_color;
+	dev->device_data  = NULL;
+}
+
 /* functions to report errors */
 static void dvierr(DviContext *dvi, const char *format, ...)
 {
@@ -564,15 +579,12 @@ int mdvi_configure(DviContext *dvi, DviParamCode option, ...)
 			break;
 		case MDVI_SET_SHRINK:
 			np.hshrink = np.vshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_XSHRINK:
 			np.hshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_YSHRINK:
 			np.vshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_ORIENTATION:
 			np.orientation = va_arg(ap, DviOrientation);
@@ -886,16 +898,7 @@ DviContext *mdvi_init_context(DviParams *par, DviPageSpec *spec, const char *fil
 	dvi->curr_layer = 0;
 	dvi->stack = xnalloc(DviState, dvi->stacksize + 8);
 
-	dvi->device.draw_glyph   = dummy_draw_glyph;
-	dvi->device.draw_rule    = dummy_draw_rule;
-	dvi->device.alloc_colors = dummy_alloc_colors;
-	dvi->device.create_image = dummy_create_image;
-	dvi->device.free_image   = dummy_free_image;
-	dvi->device.dev_destroy  = dummy_dev_destroy;
-	dvi->device.put_pixel    = dummy_dev_putpixel;
-	dvi->device.refresh      = dummy_dev_refresh;
-	dvi->device.set_color    = dummy_dev_set_color;
-	dvi->device.device_data  = NULL;
+	init_dummy_device(&dvi->device);
 
 	DEBUG((DBG_DVI, "%s read successfully\n", filename));
 	return dvi;
@@ -909,23 +912,69 @@ error:
 	return NULL;
 }
 
+/*
+ * Create a context that shares the fonts and the page table of `dvi', so
+ * that several pages can be rendered at the same time. The clone has its
+ * own file handle, stack, colors, parameters and a dummy device, and must
+ * be destroyed before `dvi'.
+ */
+DviContext *mdvi_clone_context(DviContext *dvi)
+{
+	DviContext *clone;
+
+	clone = xalloc(DviContext);
+	memcpy(clone, dvi, sizeof(DviContext));
+	clone->parent = dvi;
+	clone->in = NULL;
+	clone->filename = mdvi_strdup(dvi->filename);
+	clone->fileid = NULL;
+	memzero(&clone->buffer, sizeof(DviBuffer));
+	clone->currfont = NULL;
+	clone->stack = xnalloc(DviState, dvi->stacksize + 8);
+	clone->stacktop = 0;
+	clone->curr_fg = dvi->params.fg;
+	clone->curr_bg = dvi->params.bg;
+	clone->color_stack = NULL;
+	clone->color_top = 0;
+	clone->color_size = 0;
+	init_dummy_device(&clone->device);
+
+	return clone;
+}
+
+/*
+ * Check whether the file of `dvi' changed since it was loaded. Contexts
+ * that were cloned don't reload it when rendering: their owner has to
+ * call mdvi_reload() once no clone is in use, and clone them again.
+ */
+int	mdvi_file_changed(DviContext *dvi)
+{
+	struct stat st;
+
+	if(stat(dvi->filename, &st) < 0)
+		return 0;
+	return (Ulong)st.st_mtime > dvi->modtime;
+}
+
 void	mdvi_destroy_context(DviContext *dvi)
 {
 	if(dvi->device.dev_destroy)
 		dvi->device.dev_destroy(dvi->device.device_data);
-	/* release all fonts */
-	if(dvi->fonts) {
-		font_drop_chain(dvi->fonts);
-		font_free_unused(&dvi->device);
+	/* release all fonts, unless they belong to the context we cloned */
+	if(dvi->parent == NULL) {
+		if(dvi->fonts) {
+			font_drop_chain(dvi->fonts);
+			font_free_unused(&dvi->device);
+		}
+		if(dvi->fontmap)
+			mdvi_free(dvi->fontmap);
+		if(dvi->pagemap)
+			mdvi_free(dvi->pagemap);
 	}
-	if(dvi->fontmap)
-		mdvi_free(dvi->fontmap);
 	if(dvi->filename)
 		mdvi_free(dvi->filename);
 	if(dvi->stack)
 		mdvi_free(dvi->stack);
-	if(dvi->pagemap)
-		mdvi_free(dvi->pagemap);
 	if(dvi->fileid)
 		mdvi_free(dvi->fileid);
 	if(dvi->in)
@@ -1018,8 +1067,10 @@ again:
 		DEBUG((DBG_FILES, "reopen(%s) -> Ok\n", dvi->filename));
 	}
 	
-	/* check if we need to reload the file */
-	if(!reloaded && get_mtime(fileno(dvi->in)) > dvi->modtime) {
+	/* check if we need to reload the file; clones can't, since they
+	 * share the fonts and the page table (see mdvi_file_changed) */
+	if(!reloaded && dvi->parent == NULL &&
+	   get_mtime(fileno(dvi->in)) > dvi->modtime) {
 		mdvi_reload(dvi, &dvi->params);
 		/* we have to reopen the file, again */
 		reloaded = 1;
@@ -1246,6 +1297,7 @@ int	set_char(DviContext *dvi, int opcode)
 	int	num;
 	int	h;
 	int	hh;
+	Int32	tfmwidth;
 	DviFontChar *ch;
 	DviFont	*font;
 	
@@ -1258,35 +1310,48 @@ int	set_char(DviContext *dvi, int opcode)
 		return -1;
 	}
 	font = dvi->currfont->ref;
+	/* other contexts may be loading or shrinking glyphs of this font */
+	font_lock();
 	ch = font_get_glyph(dvi, font, num);
-	if(ch == NULL || ch->missing) {
+	if(ch == NULL) {
 		/* try to display something anyway */
 		ch = FONTCHAR(font, num);
 		if(!glyph_present(ch)) {
+			font_unlock();
 			dviwarn(dvi, 
 			_("requested character %d does not exist in `%s'\n"), 
 				num, font->fontname);
 			return 0;
 		}
 		draw_box(dvi, ch);
-	} else if(dvi->curr_layer <= dvi->params.layer) {
-		if(ISVIRTUAL(font))
-			mdvi_run_macro(dvi, (Uchar *)font->private + 
-				ch->offset, ch->width);
-		else if(ch->width && ch->height)
-			dvi->device.draw_glyph(dvi, ch, 
-				dvi->pos.hh, dvi->pos.vv);
+		tfmwidth = ch->tfmwidth;
+		font_unlock();
+	} else {
+		/* the glyph we got doesn't change anymore */
+		font_unlock();
+		tfmwidth = ch->tfmwidth;
+		if(ch->missing)
+			draw_box(dvi, ch);
+		else if(dvi->curr_layer <= dvi->params.layer) {
+			/* the macro locks the fonts it uses itself */
+			if(ISVIRTUAL(font))
+				mdvi_run_macro(dvi, (Uchar *)font->private + 
+					ch->offset, ch->width);
+			else if(ch->width && ch->height)
+				dvi->device.draw_glyph(dvi, ch, 
+					dvi->pos.hh, dvi->pos.vv);
+		}
 	}
 	if(opcode >= DVI_PUT1 && opcode <= DVI_PUT4) {
 		SHOWCMD((dvi, "putchar", opcode - DVI_PUT1 + 1,
 			"char %d (%s)\n",
 			num, dvi->currfont->ref->fontname));
 	} else {
-		h = dvi->pos.h + ch->tfmwidth;
-		hh = dvi->pos.hh + pixel_round(dvi, ch->tfmwidth);
+		h = dvi->pos.h + tfmwidth;
+		hh = dvi->pos.hh + pixel_round(dvi, tfmwidth);
 		SHOWCMD((dvi, "setchar", num, "(%d,%d) h:=%d%c%d=%d, hh:=%d (%s)\n",
 			dvi->pos.hh, dvi->pos.vv,
-			DBGSUM(dvi->pos.h, ch->tfmwidth, h), hh,
+			DBGSUM(dvi->pos.h, tfmwidth, h), hh,
 			font->fontname));
 		dvi->pos.h  = h;
 		dvi->pos.hh = hh;
@@ -24,6 +24,9 @@
 
 static ListHead fontlist;
 
+static void (*font_lock_func) __PROTO((void)) = NULL;
+static void (*font_unlock_func) __PROTO((void)) = NULL;
+
 extern char *_mdvi_fallback_font;
 
 extern void vf_free_macros(DviFont *);
@@ -32,6 +35,24 @@ extern void vf_free_macros(DviFont *);
 #define TYPENAME(font)	\
 	((font)->finfo ? (font)->finfo->name : "none")
 
+void	mdvi_set_font_lock_funcs(void (*lock)(void), void (*unlock)(void))
+{
+	font_lock_func = lock;
+	font_unlock_func = unlock;
+}
+
+void	font_lock(void)
+{
+	if(font_lock_func)
+		font_lock_func();
+}
+
+void	font_unlock(void)
+{
+	if(font_unlock_func)
+		font_unlock_func();
+}
+
 int	font_reopen(DviFont *font)
 {
 	if(font->in)
@@ -346,6 +367,7 @@ static int load_one_glyph(DviContext *dvi, DviFont *font, int code)
 DviFontChar *font_get_glyph(DviContext *dvi, DviFont *font, int code)
 {
 	DviFontChar *ch;
+	DviFontChar *var;
 
 again:
 	/* if we have not loaded the font yet, do so now */
@@ -371,35 +393,67 @@ again:
 	   font->finfo->getglyph == NULL ||
 	   (dvi->params.hshrink == 1 && dvi->params.vshrink == 1))
 		return ch;
-	
+
+	/* 
+	 * Contexts sharing this font may use different shrinking factors
+	 * and colors, so the shrunk bitmaps are kept in a copy of the glyph
+	 * for each of them. A copy is never changed, and only freed with
+	 * the bitmaps of the font, so it can be drawn without the font
+	 * lock. Bitmaps shrunk by larger factors are smaller: the copies for
+	 * every factor take less than twice the memory of the largest one.
+	 */
+	for(var = ch->variants; var; var = var->variants) {
+		if(var->hshrink == dvi->params.hshrink &&
+		   var->vshrink == dvi->params.vshrink &&
+		   var->fg == dvi->curr_fg &&
+		   var->bg == dvi->curr_bg)
+			return var;
+	}
+
+	var = xalloc(DviFontChar);
+	memcpy(var, ch, sizeof(DviFontChar));
+	var->hshrink = dvi->params.hshrink;
+	var->vshrink = dvi->params.vshrink;
+	var->fg = dvi->curr_fg;
+	var->bg = dvi->curr_bg;
+	var->shrunk.data = NULL;
+	var->grey.data = NULL;
+
 	/* If the glyph is empty, we just need to shrink the box */
-	if(ch->missing || MDVI_GLYPH_ISEMPTY(ch->glyph.data)) {
-		if(MDVI_GLYPH_UNSET(ch->shrunk.data))
-			mdvi_shrink_box(dvi, font, ch, &ch->shrunk);
-		return ch;
-	} else if(MDVI_ENABLED(dvi, MDVI_PARAM_ANTIALIASED)) {
-		if(ch->grey.data && 
-		   !MDVI_GLYPH_ISEMPTY(ch->grey.data) &&
-		   ch->fg == dvi->curr_fg && 
-		   ch->bg == dvi->curr_bg)
-		   	return ch;
-		if(ch->grey.data &&
-		   !MDVI_GLYPH_ISEMPTY(ch->grey.data)) {
-			if(dvi->device.free_image)
-				dvi->device.free_image(ch->grey.data);
-			ch->grey.data = NULL;
-		}
-		font->finfo->shrink1(dvi, font, ch, &ch->grey);
-	} else if(!ch->shrunk.data)
-		font->finfo->shrink0(dvi, font, ch, &ch->shrunk);
+	if(var->missing || MDVI_GLYPH_ISEMPTY(var->glyph.data))
+		mdvi_shrink_box(dvi, font, var, &var->shrunk);
+	else if(MDVI_ENABLED(dvi, MDVI_PARAM_ANTIALIASED))
+		font->finfo->shrink1(dvi, font, var, &var->grey);
+	else
+		font->finfo->shrink0(dvi, font, var, &var->shrunk);
 
-	return ch;
+	var->variants = ch->variants;
+	ch->variants = var;
+
+	return var;
+}
+
+/* the copies share the unshrunk glyph with `ch' */
+static void font_free_variants(DviDevice *dev, DviFontChar *ch)
+{
+	DviFontChar *var;
+
+	while((var = ch->variants) != NULL) {
+		ch->variants = var->variants;
+		if(MDVI_GLYPH_NONEMPTY(var->shrunk.data))
+			bitmap_destroy((BITMAP *)var->shrunk.data);
+		if(MDVI_GLYPH_NONEMPTY(var->grey.data) && dev->free_image)
+			dev->free_image(var->grey.data);
+		mdvi_free(var);
+	}
 }
 
 void	font_reset_one_glyph(DviDevice *dev, DviFontChar *ch, int what)
 {
 	if(!glyph_present(ch))
 		return;
+	if(what & (MDVI_FONTSEL_BITMAP|MDVI_FONTSEL_GREY|MDVI_FONTSEL_GLYPH))
+		font_free_variants(dev, ch);
 	if(what & MDVI_FONTSEL_BITMAP) {
 		if(MDVI_GLYPH_NONEMPTY(ch->shrunk.data))
 			bitmap_destroy((BITMAP *)ch->shrunk.data);
@@ -196,6 +196,14 @@ struct _DviFontChar {
 #endif
 	Ulong	fg;
 	Ulong	bg;
+	/* shrinking factors the shrunk bitmaps were made with */
+	int	hshrink;
+	int	vshrink;
+	/* 
+	 * in a glyph of the font, its first shrunk copy; in a shrunk copy,
+	 * the next one (see font_get_glyph)
+	 */
+	DviFontChar *variants;
 	BITMAP	*glyph_data;
 	/* data for shrunk bitimaps */
 	DviGlyph glyph;
@@ -398,6 +406,7 @@ struct _DviContext {
 
 	DviFontRef *(*findref) __PROTO((DviContext *, Int32));
 	void	*user_data;	/* client data attached to this context */
+	DviContext *parent;	/* owner of the fonts and page table, if cloned */
 };
 
 typedef enum {
@@ -496,6 +505,8 @@ extern void mdvi_init_kpathsea __PROTO((const char *, const char *, const char *
 
 extern DviContext* mdvi_init_context __PROTO((DviParams *, DviPageSpec *, const char *));
 extern void 	mdvi_destroy_context __PROTO((DviContext *));
+extern DviContext* mdvi_clone_context __PROTO((DviContext *));
+extern int	mdvi_file_changed __PROTO((DviContext *));
 
 /* helper macros that call mdvi_configure() */
 #define mdvi_config_one(d,x,y)	mdvi_configure((d), (x), (y), MDVI_PARAM_LAST)
@@ -588,6 +599,16 @@ extern int font_reopen __PROTO((DviFont *));
 /* reads a glyph from a font, and makes all necessary transformations */
 extern DviFontChar* font_get_glyph __PROTO((DviContext *, DviFont *, int));
 
+/* 
+ * Fonts are shared by all contexts, so contexts used from several threads
+ * must serialize glyph loading and shrinking with these. The glyphs that
+ * font_get_glyph() returns can be drawn without them. By default they do
+ * nothing.
+ */
+extern void mdvi_set_font_lock_funcs __PROTO((void (*)(void), void (*)(void)));
+extern void font_lock __PROTO((void));
+extern void font_unlock __PROTO((void));
+
 /* transform a glyph according to the given orientation */
 extern void font_transform_glyph __PROTO((DviOrientation, DviGlyph *));
 
@@ -135,6 +135,7 @@ int	get_tfm_chars(DviParams *params, DviFont *font, TFMInfo *info, int loaded)
 		ch->glyph.data  = NULL;
 		ch->grey.data   = NULL;
 		ch->shrunk.data = NULL;
+		ch->variants    = NULL;
 		ch->loaded      = loaded;
 	}
 
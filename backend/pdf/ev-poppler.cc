@@ -386,12 +386,20 @@ pdf_page_render (PopplerPage     *page,
 {
 	cairo_surface_t *surface;
 	cairo_t *cr;
+	cairo_rectangle_int_t area;
 	double page_width, page_height;
 	double xscale, yscale;
 
-	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-					      width, height);
-	cr = cairo_create (surface);
+	if (ev_render_context_get_area (rc, &area)) {
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      area.width, area.height);
+		cr = cairo_create (surface);
+		cairo_translate (cr, -area.x, -area.y);
+	} else {
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      width, height);
+		cr = cairo_create (surface);
+	}
 
 	switch (rc->rotation) {
 	        case 90:
@@ -989,14 +997,15 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	ev_document_class->get_info = pdf_document_get_info;
 	ev_document_class->get_backend_info = pdf_document_get_backend_info;
 	ev_document_class->support_synctex = pdf_document_support_synctex;
+	ev_document_class_set_render_flags (ev_document_class, EV_DOCUMENT_RENDER_FLAG_AREA);
 }
 
 /* EvDocumentSecurity */
 static gboolean
 pdf_document_has_document_security (EvDocumentSecurity *document_security)
 {
-	/* FIXME: do we really need to have this? */
-	return FALSE;
+	/* A password is only set for documents that can't be opened without it */
+	return PDF_DOCUMENT (document_security)->password != NULL;
 }
 
 static void
@@ -3064,9 +3073,27 @@ annot_set_unique_name (EvAnnotation *annot)
 static void
 annot_area_changed_cb (EvAnnotation *annot,
 		       GParamSpec   *spec,
-		       EvMapping    *mapping)
+		       PdfDocument  *pdf_document)
 {
-	ev_annotation_get_area (annot, &mapping->area);
+	EvMappingList *mapping_list;
+	EvMapping     *mapping;
+	EvRectangle    area;
+
+	if (!pdf_document->annots)
+		return;
+
+	mapping_list = (EvMappingList *)g_hash_table_lookup (pdf_document->annots,
+							     GINT_TO_POINTER (ev_annotation_get_page_index (annot)));
+	if (!mapping_list)
+		return;
+
+	mapping = ev_mapping_list_find (mapping_list, annot);
+	if (!mapping)
+		return;
+
+	/* Go through the mapping list, so that its index follows the area */
+	ev_annotation_get_area (annot, &area);
+	ev_mapping_list_update_area (mapping_list, mapping, &area);
 }
 
 static EvMappingList *
@@ -3127,9 +3154,9 @@ pdf_document_annotations_get_annotations (EvDocumentAnnotations *document_annota
 		}
 		annot_mapping->data = ev_annot;
 		ev_annotation_set_area (ev_annot, &annot_mapping->area);
-		g_signal_connect (ev_annot, "notify::area",
-				  G_CALLBACK (annot_area_changed_cb),
-				  annot_mapping);
+		g_signal_connect_object (ev_annot, "notify::area",
+					 G_CALLBACK (annot_area_changed_cb),
+					 pdf_document, (GConnectFlags)0);
 
 		g_object_set_data_full (G_OBJECT (ev_annot),
 					"poppler-annot",
@@ -3366,9 +3393,9 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	annot_mapping = g_new (EvMapping, 1);
 	annot_mapping->area = rect;
 	annot_mapping->data = annot;
-	g_signal_connect (annot, "notify::area",
-			  G_CALLBACK (annot_area_changed_cb),
-			  annot_mapping);
+	g_signal_connect_object (annot, "notify::area",
+				 G_CALLBACK (annot_area_changed_cb),
+				 pdf_document, (GConnectFlags)0);
 	g_object_set_data_full (G_OBJECT (annot),
 				"poppler-annot",
 				poppler_annot,
@@ -3388,8 +3415,7 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	annot_set_unique_name (annot);
 
 	if (mapping_list) {
-		list = ev_mapping_list_get_list (mapping_list);
-		list = g_list_append (list, annot_mapping);
+		ev_mapping_list_append (mapping_list, annot_mapping);
 	} else {
 		list = g_list_append (list, annot_mapping);
 		mapping_list = ev_mapping_list_new (page->index, list, (GDestroyNotify)g_object_unref);
@@ -0,0 +1,190 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <tiffio.h>
+
+#include "ev-render-context.h"
+#include "tiff-document.h"
+
+/* Taller than several bands, with a last band that isn't full */
+#define IMAGE_WIDTH  4
+#define IMAGE_HEIGHT 200
+
+/* A type module for the backend linked into this program */
+typedef GTypeModule      TestModule;
+typedef GTypeModuleClass TestModuleClass;
+
+G_DEFINE_TYPE (TestModule, test_module, G_TYPE_TYPE_MODULE)
+
+static gboolean
+test_module_load (GTypeModule *module)
+{
+	return TRUE;
+}
+
+static void
+test_module_init (TestModule *module)
+{
+}
+
+static void
+test_module_class_init (TestModuleClass *klass)
+{
+	klass->load = test_module_load;
+}
+
+/* Writes a gray image stored bottom row first, where the stored row
+ * r has the value r, so the visual row y has IMAGE_HEIGHT - 1 - y.
+ */
+static gboolean
+write_bottom_left_tiff (const gchar *filename)
+{
+	TIFF   *tiff;
+	guchar  row[IMAGE_WIDTH];
+	guint32 y;
+
+	tiff = TIFFOpen (filename, "w");
+	if (!tiff)
+		return FALSE;
+
+	TIFFSetField (tiff, TIFFTAG_IMAGEWIDTH, IMAGE_WIDTH);
+	TIFFSetField (tiff, TIFFTAG_IMAGELENGTH, IMAGE_HEIGHT);
+	TIFFSetField (tiff, TIFFTAG_BITSPERSAMPLE, 8);
+	TIFFSetField (tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+	TIFFSetField (tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+	TIFFSetField (tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField (tiff, TIFFTAG_ORIENTATION, ORIENTATION_BOTLEFT);
+	TIFFSetField (tiff, TIFFTAG_ROWSPERSTRIP, 16);
+	TIFFSetField (tiff, TIFFTAG_XRESOLUTION, 72.);
+	TIFFSetField (tiff, TIFFTAG_YRESOLUTION, 72.);
+
+	for (y = 0; y < IMAGE_HEIGHT; y++) {
+		memset (row, y, IMAGE_WIDTH);
+		if (TIFFWriteScanline (tiff, row, y, 0) < 0) {
+			TIFFClose (tiff);
+			return FALSE;
+		}
+	}
+	TIFFClose (tiff);
+
+	return TRUE;
+}
+
+/* Checks that the thumbnail is upright: every row is the average of
+ * the image rows it covers, from the top of the image. */
+static gboolean
+check_thumbnail (EvDocument *document,
+		 gdouble     scale)
+{
+	EvPage          *page;
+	EvRenderContext *rc;
+	GdkPixbuf       *pixbuf;
+	const guchar    *pixels;
+	gint             height, rowstride, n_channels;
+	gboolean         retval = TRUE;
+	gint             y;
+
+	page = ev_document_get_page (document, 0);
+	rc = ev_render_context_new (page, 0, scale);
+	pixbuf = ev_document_get_thumbnail (document, rc);
+	g_object_unref (rc);
+	g_object_unref (page);
+
+	if (!pixbuf) {
+		g_printerr ("No thumbnail at scale %.2f\n", scale);
+		return FALSE;
+	}
+
+	height = gdk_pixbuf_get_height (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	for (y = 0; y < height && retval; y++) {
+		gdouble first = (gdouble) y * IMAGE_HEIGHT / height;
+		gdouble last = (gdouble) (y + 1) * IMAGE_HEIGHT / height - 1;
+		gdouble expected = IMAGE_HEIGHT - 1 - (first + last) / 2;
+		gint    value = pixels[y * rowstride + (n_channels - 1) / 2];
+
+		if (ABS (value - expected) > 1 + IMAGE_HEIGHT / height) {
+			g_printerr ("Thumbnail at scale %.2f: row %d is %d, expected about %.0f\n",
+				    scale, y, value, expected);
+			retval = FALSE;
+		}
+	}
+	g_object_unref (pixbuf);
+
+	return retval;
+}
+
+int
+main (int argc, char **argv)
+{
+	GTypeModule *module;
+	EvDocument  *document;
+	GError      *error = NULL;
+	gchar       *filename;
+	gchar       *uri;
+	gint         fd;
+	gboolean     failed = FALSE;
+
+	fd = g_file_open_tmp ("test-tiff-document-XXXXXX.tiff", &filename, &error);
+	if (fd < 0) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+	close (fd);
+
+	if (!write_bottom_left_tiff (filename)) {
+		g_printerr ("Failed to write %s\n", filename);
+		g_unlink (filename);
+		g_free (filename);
+		return 1;
+	}
+
+	module = g_object_new (test_module_get_type (), NULL);
+	g_type_module_use (module);
+	register_evince_backend (module);
+
+	document = g_object_new (TIFF_TYPE_DOCUMENT, NULL);
+	uri = g_filename_to_uri (filename, NULL, NULL);
+	if (!ev_document_load (document, uri, &error)) {
+		g_printerr ("Failed to load %s: %s\n", filename, error->message);
+		g_error_free (error);
+		failed = TRUE;
+	} else {
+		failed |= !check_thumbnail (document, 1.);
+		failed |= !check_thumbnail (document, 0.25);
+		failed |= !check_thumbnail (document, 0.1);
+	}
+
+	g_object_unref (document);
+	g_unlink (filename);
+	g_free (filename);
+	g_free (uri);
+
+	if (!failed)
+		g_print ("Thumbnails of bottom-left TIFF images are upright\n");
+
+	return failed ? 1 : 0;
+}
@@ -24,6 +24,7 @@
 
 #include <config.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
@@ -221,25 +222,243 @@ tiff_document_get_page_size (EvDocument *document,
 	pop_handlers ();
 }
 
+/* Number of rows decoded at once when reading an image */
+#define BAND_HEIGHT 64
+
+/* Switches to the smallest reduced-resolution image of the current
+ * page that is still at least @dest_width x @dest_height, if the page
+ * has such images in sub-IFDs, and updates @width and @height.
+ */
+static void
+tiff_document_select_reduced_image (TiffDocument *tiff_document,
+				    int           page,
+				    int           dest_width,
+				    int           dest_height,
+				    int          *width,
+				    int          *height)
+{
+	TIFF    *tiff = tiff_document->tiff;
+	uint16   n_subifds = 0;
+	toff_t  *subifds = NULL;
+	toff_t   best = 0;
+	uint32   best_width = *width, best_height = *height;
+	int      i;
+
+	if (!TIFFGetField (tiff, TIFFTAG_SUBIFD, &n_subifds, &subifds) || n_subifds == 0)
+		return;
+
+	/* The array belongs to the directory we are about to leave */
+	subifds = g_memdup (subifds, n_subifds * sizeof (toff_t));
+
+	for (i = 0; i < n_subifds; i++) {
+		uint32 subfile_type = 0;
+		uint32 w, h;
+
+		if (!TIFFSetSubDirectory (tiff, subifds[i]))
+			continue;
+
+		if (!TIFFGetField (tiff, TIFFTAG_SUBFILETYPE, &subfile_type) ||
+		    !(subfile_type & FILETYPE_REDUCEDIMAGE))
+			continue;
+
+		if (!TIFFGetField (tiff, TIFFTAG_IMAGEWIDTH, &w) ||
+		    !TIFFGetField (tiff, TIFFTAG_IMAGELENGTH, &h))
+			continue;
+
+		if (w >= (uint32) dest_width && h >= (uint32) dest_height &&
+		    w < best_width && h < best_height) {
+			best = subifds[i];
+			best_width = w;
+			best_height = h;
+		}
+	}
+
+	if (best != 0 && TIFFSetSubDirectory (tiff, best)) {
+		*width = best_width;
+		*height = best_height;
+	} else {
+		TIFFSetDirectory (tiff, page);
+	}
+
+	g_free (subifds);
+}
+
+/* Whether @orientation has its first row at the top, and its first
+ * column on the left, as classified by libtiff */
+static gboolean
+orientation_is_top (int orientation)
+{
+	return orientation == ORIENTATION_TOPLEFT || orientation == ORIENTATION_LEFTTOP ||
+		orientation == ORIENTATION_TOPRIGHT || orientation == ORIENTATION_RIGHTTOP;
+}
+
+static gboolean
+orientation_is_left (int orientation)
+{
+	return orientation == ORIENTATION_TOPLEFT || orientation == ORIENTATION_LEFTTOP ||
+		orientation == ORIENTATION_BOTLEFT || orientation == ORIENTATION_LEFTBOT;
+}
+
+static void
+store_scaled_row (guchar  *row,
+		  guint64 *sums,
+		  guint   *column_counts,
+		  int      dest_width,
+		  guint    n_rows)
+{
+	guint32 *pixel = (guint32 *) row;
+	int      x;
+
+	for (x = 0; x < dest_width; x++) {
+		guint64 n = (guint64) column_counts[x] * n_rows;
+		guint64 *sum = sums + x * 3;
+
+		pixel[x] = 0xff000000 |
+			((sum[0] + n / 2) / n) << 16 |
+			((sum[1] + n / 2) / n) << 8 |
+			((sum[2] + n / 2) / n);
+	}
+}
+
+/* Decodes the current image a band of rows at a time, box-filtering
+ * it down to @dest_width x @dest_height on the way, so that the full
+ * resolution image is never in memory. The image is flipped to
+ * @orientation here: libtiff only flips the rows within each band.
+ */
 static cairo_surface_t *
-tiff_document_render (EvDocument      *document,
-		      EvRenderContext *rc)
+tiff_document_read_scaled (TiffDocument *tiff_document,
+			   int           width,
+			   int           height,
+			   int           orientation,
+			   int           dest_width,
+			   int           dest_height)
+{
+	TIFFRGBAImage    img;
+	char             emsg[1024];
+	cairo_surface_t *surface;
+	guchar          *data;
+	gint             stride;
+	uint32          *band = NULL;
+	int             *columns = NULL;
+	guint           *column_counts = NULL;
+	guint64         *sums = NULL;
+	int              band_height;
+	int              dest_y = -1;
+	guint            n_rows = 0;
+	gboolean         flip_horizontally, flip_vertically;
+	int              x, y;
+
+	g_return_val_if_fail (dest_width > 0 && dest_width <= width, NULL);
+	g_return_val_if_fail (dest_height > 0 && dest_height <= height, NULL);
+
+	if (!TIFFRGBAImageOK (tiff_document->tiff, emsg) ||
+	    !TIFFRGBAImageBegin (&img, tiff_document->tiff, 0, emsg)) {
+		g_warning ("Failed to read image: %s", emsg);
+		return NULL;
+	}
+	/* Rows are returned in the order they are stored */
+	img.req_orientation = img.orientation;
+	flip_horizontally = orientation_is_left (img.orientation) != orientation_is_left (orientation);
+	flip_vertically = orientation_is_top (img.orientation) != orientation_is_top (orientation);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, dest_width, dest_height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+		g_warning ("Failed to allocate memory for rendering.");
+		goto error;
+	}
+	data = cairo_image_surface_get_data (surface);
+	stride = cairo_image_surface_get_stride (surface);
+
+	band_height = MIN (BAND_HEIGHT, height);
+	band = g_try_new (uint32, (gsize) width * band_height);
+	columns = g_try_new (int, width);
+	column_counts = g_try_new0 (guint, dest_width);
+	sums = g_try_new0 (guint64, (gsize) dest_width * 3);
+	if (!band || !columns || !column_counts || !sums) {
+		g_warning ("Failed to allocate memory for rendering.");
+		goto error;
+	}
+
+	for (x = 0; x < width; x++) {
+		columns[x] = (gint64) x * dest_width / width;
+		if (flip_horizontally)
+			columns[x] = dest_width - 1 - columns[x];
+		column_counts[columns[x]]++;
+	}
+
+	for (y = 0; y < height; y += band_height) {
+		int rows = MIN (band_height, height - y);
+		int i;
+
+		img.row_offset = y;
+		img.col_offset = 0;
+		if (!TIFFRGBAImageGet (&img, band, width, rows)) {
+			g_warning ("Failed to read rows %d to %d", y, y + rows - 1);
+			goto error;
+		}
+
+		for (i = 0; i < rows; i++) {
+			const uint32 *row = band + (gsize) i * width;
+			int           dy = (gint64) (y + i) * dest_height / height;
+
+			if (flip_vertically)
+				dy = dest_height - 1 - dy;
+
+			if (dy != dest_y) {
+				if (dest_y >= 0)
+					store_scaled_row (data + dest_y * stride, sums,
+							  column_counts, dest_width, n_rows);
+				memset (sums, 0, sizeof (guint64) * dest_width * 3);
+				dest_y = dy;
+				n_rows = 0;
+			}
+
+			for (x = 0; x < width; x++) {
+				guint64 *sum = sums + columns[x] * 3;
+
+				sum[0] += TIFFGetR (row[x]);
+				sum[1] += TIFFGetG (row[x]);
+				sum[2] += TIFFGetB (row[x]);
+			}
+			n_rows++;
+		}
+	}
+	store_scaled_row (data + dest_y * stride, sums,
+			  column_counts, dest_width, n_rows);
+	cairo_surface_mark_dirty (surface);
+
+	g_free (band);
+	g_free (columns);
+	g_free (column_counts);
+	g_free (sums);
+	TIFFRGBAImageEnd (&img);
+
+	return surface;
+
+error:
+	g_free (band);
+	g_free (columns);
+	g_free (column_counts);
+	g_free (sums);
+	cairo_surface_destroy (surface);
+	TIFFRGBAImageEnd (&img);
+
+	return NULL;
+}
+
+static cairo_surface_t *
+tiff_document_render_scaled (TiffDocument    *tiff_document,
+			     EvRenderContext *rc,
+			     int              orientation_override,
+			     int             *scaled_width,
+			     int             *scaled_height)
 {
-	TiffDocument *tiff_document = TIFF_DOCUMENT (document);
 	int width, height;
-	int scaled_width, scaled_height;
+	int dest_width, dest_height;
 	float x_res, y_res;
-	gint rowstride, bytes;
-	guchar *pixels = NULL;
-	guchar *p;
 	int orientation;
 	cairo_surface_t *surface;
-	cairo_surface_t *rotated_surface;
-	static const cairo_user_data_key_t key;
-	
-	g_return_val_if_fail (TIFF_IS_DOCUMENT (document), NULL);
-	g_return_val_if_fail (tiff_document->tiff != NULL, NULL);
-  
+
 	push_handlers ();
 	if (TIFFSetDirectory (tiff_document->tiff, rc->page->index) != 1) {
 		pop_handlers ();
@@ -262,68 +481,53 @@ tiff_document_render (EvDocument      *document,
 	if (! TIFFGetField (tiff_document->tiff, TIFFTAG_ORIENTATION, &orientation)) {
 		orientation = ORIENTATION_TOPLEFT;
 	}
+	if (orientation_override > 0)
+		orientation = orientation_override;
 
 	tiff_document_get_resolution (tiff_document, &x_res, &y_res);
-	
-	pop_handlers ();
-  
+
 	/* Sanity check the doc */
 	if (width <= 0 || height <= 0) {
+		pop_handlers ();
 		g_warning("Invalid width or height.");
 		return NULL;
 	}
 
-	rowstride = cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
-	if (rowstride / 4 != width) {
-		g_warning("Overflow while rendering document.");
-		/* overflow, or cairo was changed in an unsupported way */
-		return NULL;                
-	}
-	
-	if (height >= INT_MAX / rowstride) {
-		g_warning("Overflow while rendering document.");
-		/* overflow */
-		return NULL;
-	}
-	bytes = height * rowstride;
-	
-	pixels = g_try_malloc (bytes);
-	if (!pixels) {
-		g_warning("Failed to allocate memory for rendering.");
-		return NULL;
-	}
-	
-	surface = cairo_image_surface_create_for_data (pixels,
-						       CAIRO_FORMAT_RGB24,
-						       width, height,
-						       rowstride);
-	cairo_surface_set_user_data (surface, &key,
-				     pixels, (cairo_destroy_func_t)g_free);
-
-	TIFFReadRGBAImageOriented (tiff_document->tiff,
-				   width, height,
-				   (uint32 *)pixels,
-				   orientation, 0);
+	ev_render_context_compute_scaled_size (rc, width, height * (x_res / y_res),
+					       scaled_width, scaled_height);
+
+	/* Never decode more pixels than displayed; larger sizes are
+	 * reached by scaling the decoded image up afterwards */
+	tiff_document_select_reduced_image (tiff_document, rc->page->index,
+					    *scaled_width, *scaled_height,
+					    &width, &height);
+	dest_width = CLAMP (*scaled_width, 1, width);
+	dest_height = CLAMP (*scaled_height, 1, height);
+
+	surface = tiff_document_read_scaled (tiff_document, width, height, orientation,
+					     dest_width, dest_height);
 	pop_handlers ();
 
-	/* Convert the format returned by libtiff to
-	* what cairo expects
-	*/
-	p = pixels;
-	while (p < pixels + bytes) {
-		guint32 *pixel = (guint32*)p;
-		guint8 r = TIFFGetR(*pixel);
-		guint8 g = TIFFGetG(*pixel);
-		guint8 b = TIFFGetB(*pixel);
-		guint8 a = TIFFGetA(*pixel);
+	return surface;
+}
 
-		*pixel = (a << 24) | (r << 16) | (g << 8) | b;
+static cairo_surface_t *
+tiff_document_render (EvDocument      *document,
+		      EvRenderContext *rc)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (document);
+	int scaled_width, scaled_height;
+	cairo_surface_t *surface;
+	cairo_surface_t *rotated_surface;
 
-		p += 4;
-	}
+	g_return_val_if_fail (TIFF_IS_DOCUMENT (document), NULL);
+	g_return_val_if_fail (tiff_document->tiff != NULL, NULL);
 
-	ev_render_context_compute_scaled_size (rc, width, height * (x_res / y_res),
+	surface = tiff_document_render_scaled (tiff_document, rc, 0,
 					       &scaled_width, &scaled_height);
+	if (!surface)
+		return NULL;
+
 	rotated_surface = ev_document_misc_surface_rotate_and_scale (surface,
 								     scaled_width, scaled_height,
 								     rc->rotation);
@@ -337,69 +541,30 @@ tiff_document_get_thumbnail (EvDocument      *document,
 			     EvRenderContext *rc)
 {
 	TiffDocument *tiff_document = TIFF_DOCUMENT (document);
-	int width, height;
 	int scaled_width, scaled_height;
-	float x_res, y_res;
-	gint rowstride, bytes;
-	guchar *pixels = NULL;
+	cairo_surface_t *surface;
 	GdkPixbuf *pixbuf;
 	GdkPixbuf *scaled_pixbuf;
 	GdkPixbuf *rotated_pixbuf;
-	
-	push_handlers ();
-	if (TIFFSetDirectory (tiff_document->tiff, rc->page->index) != 1) {
-		pop_handlers ();
-		return NULL;
-	}
 
-	if (!TIFFGetField (tiff_document->tiff, TIFFTAG_IMAGEWIDTH, &width)) {
-		pop_handlers ();
+	surface = tiff_document_render_scaled (tiff_document, rc, ORIENTATION_TOPLEFT,
+					       &scaled_width, &scaled_height);
+	if (!surface)
 		return NULL;
-	}
 
-	if (! TIFFGetField (tiff_document->tiff, TIFFTAG_IMAGELENGTH, &height)) {
-		pop_handlers ();
-		return NULL;
-	}
+	pixbuf = ev_document_misc_pixbuf_from_surface (surface);
+	cairo_surface_destroy (surface);
 
-	tiff_document_get_resolution (tiff_document, &x_res, &y_res);
-	
-	pop_handlers ();
-  
-	/* Sanity check the doc */
-	if (width <= 0 || height <= 0)
-		return NULL;                
-
-	if (width >= INT_MAX / 4)
-		/* overflow */
-		return NULL;                
-	rowstride = width * 4;
-        
-	if (height >= INT_MAX / rowstride)
-		/* overflow */
-		return NULL;                
-	bytes = height * rowstride;
-	
-	pixels = g_try_malloc (bytes);
-	if (!pixels)
-		return NULL;
-	
-	pixbuf = gdk_pixbuf_new_from_data (pixels, GDK_COLORSPACE_RGB, TRUE, 8, 
-					   width, height, rowstride,
-					   (GdkPixbufDestroyNotify) g_free, NULL);
-	TIFFReadRGBAImageOriented (tiff_document->tiff,
-				   width, height,
-				   (uint32 *)pixels,
-				   ORIENTATION_TOPLEFT, 0);
-	pop_handlers ();
+	if (gdk_pixbuf_get_width (pixbuf) != scaled_width ||
+	    gdk_pixbuf_get_height (pixbuf) != scaled_height) {
+		scaled_pixbuf = gdk_pixbuf_scale_simple (pixbuf,
+							 scaled_width, scaled_height,
+							 GDK_INTERP_BILINEAR);
+		g_object_unref (pixbuf);
+	} else {
+		scaled_pixbuf = pixbuf;
+	}
 
-	ev_render_context_compute_scaled_size (rc, width, height * (x_res / y_res),
-					       &scaled_width, &scaled_height);
-	scaled_pixbuf = gdk_pixbuf_scale_simple (pixbuf,
-						 scaled_width, scaled_height,
-						 GDK_INTERP_BILINEAR);
-	g_object_unref (pixbuf);
-	
 	rotated_pixbuf = gdk_pixbuf_rotate_simple (scaled_pixbuf, 360 - rc->rotation);
 	g_object_unref (scaled_pixbuf);
 	
@@ -155,6 +155,17 @@ ar_stream *ar_open_memory(const void *data, size_t datalen)
     return ar_open_stream(stm, memory_close, memory_read, memory_seek, memory_tell);
 }
 
+const void *ar_peek(ar_stream *stream, size_t count)
+{
+    struct MemoryStream *stm;
+    if (stream->read != memory_read)
+        return NULL;
+    stm = stream->data;
+    if (count > stm->length - stm->offset)
+        return NULL;
+    return stm->data + stm->offset;
+}
+
 #ifdef _WIN32
 /***** stream based on IStream *****/
 
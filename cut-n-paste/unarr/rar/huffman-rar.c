@@ -140,3 +140,20 @@ void rar_free_code(struct huffman_code *code)
     free(code->table);
     memset(code, 0, sizeof(*code));
 }
+
+bool rar_copy_code(struct huffman_code *dst, const struct huffman_code *src)
+{
+    *dst = *src;
+    dst->tree = NULL;
+    /* the table is recreated from the tree when it's needed */
+    dst->table = NULL;
+    if (!src->tree)
+        return true;
+    dst->tree = malloc(src->capacity * sizeof(*src->tree));
+    if (!dst->tree) {
+        warn("OOM during decompression");
+        return false;
+    }
+    memcpy(dst->tree, src->tree, src->capacity * sizeof(*src->tree));
+    return true;
+}
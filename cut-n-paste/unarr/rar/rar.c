@@ -202,6 +202,88 @@ static bool rar_uncompress(ar_archive *ar, void *buffer, size_t count)
     return true;
 }
 
+bool ar_rar_entry_is_solid(ar_archive *ar)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    return rar->entry.solid && rar->entry.method != METHOD_STORE;
+}
+
+off64_t ar_rar_entry_get_solid_position(ar_archive *ar)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    if (!ar_rar_entry_is_solid(ar) || rar->solid.restart)
+        return -1;
+    return (off64_t)rar->solid.size_total;
+}
+
+ar_rar_checkpoint *ar_rar_save_checkpoint(ar_archive *ar)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    ar_rar_checkpoint *checkpoint;
+    if (ar_rar_entry_get_solid_position(ar) < 0 || rar->progress.bytes_done != 0)
+        return NULL;
+    checkpoint = calloc(1, sizeof(*checkpoint));
+    if (!checkpoint)
+        return NULL;
+    if (!rar_copy_uncompress(&checkpoint->uncomp, &rar->uncomp)) {
+        free(checkpoint);
+        return NULL;
+    }
+    checkpoint->offset = ar->entry_offset;
+    checkpoint->solid = rar->solid;
+    return checkpoint;
+}
+
+bool ar_rar_restore_checkpoint(ar_archive *ar, const ar_rar_checkpoint *checkpoint)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    if (!ar_parse_entry_at(ar, checkpoint->offset))
+        return false;
+    if (!ar_rar_entry_is_solid(ar)) {
+        warn("No solid entry at checkpoint offset %" PRIi64, checkpoint->offset);
+        return false;
+    }
+    rar_clear_uncompress(&rar->uncomp);
+    if (!rar_copy_uncompress(&rar->uncomp, &checkpoint->uncomp)) {
+        /* the entry can still be uncompressed by restarting */
+        rar->solid.restart = true;
+        return false;
+    }
+    rar->solid = checkpoint->solid;
+    return true;
+}
+
+off64_t ar_rar_checkpoint_get_offset(const ar_rar_checkpoint *checkpoint)
+{
+    return checkpoint->offset;
+}
+
+void ar_rar_free_checkpoint(ar_rar_checkpoint *checkpoint)
+{
+    if (!checkpoint)
+        return;
+    rar_clear_uncompress(&checkpoint->uncomp);
+    free(checkpoint);
+}
+
+const void *ar_rar_entry_get_stored_data(ar_archive *ar)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    const void *data;
+    if (rar->entry.method != METHOD_STORE || rar->progress.bytes_done != 0)
+        return NULL;
+    if (rar->progress.data_left < ar->entry_size_uncompressed)
+        return NULL;
+    data = ar_peek(ar->stream, ar->entry_size_uncompressed);
+    if (!data)
+        return NULL;
+    if (ar_crc32(0, data, ar->entry_size_uncompressed) != rar->entry.crc) {
+        warn("Checksum of stored data doesn't match");
+        return NULL;
+    }
+    return data;
+}
+
 ar_archive *ar_open_rar_archive(ar_stream *stream)
 {
     char signature[FILE_SIGNATURE_SIZE];
@@ -122,6 +122,7 @@ bool rar_add_value(struct huffman_code *code, int value, int codebits, int lengt
 bool rar_create_code(struct huffman_code *code, uint8_t *lengths, int numsymbols);
 bool rar_make_table(struct huffman_code *code);
 void rar_free_code(struct huffman_code *code);
+bool rar_copy_code(struct huffman_code *dst, const struct huffman_code *src);
 
 static inline bool rar_is_leaf_node(struct huffman_code *code, int node) { return code->tree[node].branches[0] == code->tree[node].branches[1]; }
 
@@ -224,6 +225,7 @@ struct ar_archive_rar_uncomp {
 bool rar_uncompress_part(ar_archive_rar *rar, void *buffer, size_t buffer_size);
 int64_t rar_expand(ar_archive_rar *rar, int64_t end);
 void rar_clear_uncompress(struct ar_archive_rar_uncomp *uncomp);
+bool rar_copy_uncompress(struct ar_archive_rar_uncomp *dst, const struct ar_archive_rar_uncomp *src);
 static inline void br_clear_leftover_bits(struct ar_archive_rar_uncomp *uncomp) { uncomp->br.available &= ~0x07; }
 
 /***** rar *****/
@@ -240,6 +242,12 @@ struct ar_archive_rar_solid {
     bool restart;
 };
 
+struct ar_rar_checkpoint_s {
+    off64_t offset;
+    struct ar_archive_rar_uncomp uncomp;
+    struct ar_archive_rar_solid solid;
+};
+
 struct ar_archive_rar_s {
     ar_archive super;
     uint16_t archive_flags;
@@ -158,6 +158,72 @@ void rar_clear_uncompress(struct ar_archive_rar_uncomp *uncomp)
     uncomp->version = 0;
 }
 
+static int rar_get_codes(struct ar_archive_rar_uncomp *uncomp, struct huffman_code **codes)
+{
+    int i, n = 0;
+    if (uncomp->version == 2) {
+        codes[n++] = &uncomp->state.v2.maincode;
+        codes[n++] = &uncomp->state.v2.offsetcode;
+        codes[n++] = &uncomp->state.v2.lengthcode;
+        for (i = 0; i < 4; i++)
+            codes[n++] = &uncomp->state.v2.audiocode[i];
+    }
+    else {
+        codes[n++] = &uncomp->state.v3.maincode;
+        codes[n++] = &uncomp->state.v3.offsetcode;
+        codes[n++] = &uncomp->state.v3.lowoffsetcode;
+        codes[n++] = &uncomp->state.v3.lengthcode;
+    }
+    return n;
+}
+
+bool rar_copy_uncompress(struct ar_archive_rar_uncomp *dst, const struct ar_archive_rar_uncomp *src)
+{
+    struct huffman_code *dst_codes[7], *src_codes[7];
+    int i, n;
+
+    memset(dst, 0, sizeof(*dst));
+    if (!src->version)
+        return true;
+    if (src->version == 3) {
+        const struct ar_archive_rar_uncomp_v3 *src_v3 = &src->state.v3;
+        /* the PPMd model and the filter programs aren't copied */
+        if (Ppmd7_WasAllocated(&src_v3->ppmd7_context) || src_v3->filters.progs || src_v3->filters.stack || src_v3->filters.bytes_ready > 0)
+            return false;
+    }
+
+    *dst = *src;
+    dst->lzss.window = NULL;
+    n = rar_get_codes(dst, dst_codes);
+    rar_get_codes((struct ar_archive_rar_uncomp *)src, src_codes);
+    for (i = 0; i < n; i++)
+        memset(dst_codes[i], 0, sizeof(*dst_codes[i]));
+    if (dst->version == 3) {
+        memset(&dst->state.v3.ppmd7_context, 0, sizeof(dst->state.v3.ppmd7_context));
+        memset(&dst->state.v3.range_dec, 0, sizeof(dst->state.v3.range_dec));
+        memset(&dst->state.v3.bytein, 0, sizeof(dst->state.v3.bytein));
+        dst->state.v3.filters.vm = NULL;
+        dst->state.v3.filters.bytes = NULL;
+    }
+
+    dst->lzss.window = malloc(lzss_size(&dst->lzss));
+    if (!dst->lzss.window) {
+        warn("OOM during decompression");
+        goto error;
+    }
+    memcpy(dst->lzss.window, src->lzss.window, lzss_size(&dst->lzss));
+    for (i = 0; i < n; i++) {
+        if (!rar_copy_code(dst_codes[i], src_codes[i]))
+            goto error;
+    }
+    return true;
+
+error:
+    rar_clear_uncompress(dst);
+    memset(dst, 0, sizeof(*dst));
+    return false;
+}
+
 static int rar_read_next_symbol(ar_archive_rar *rar, struct huffman_code *code)
 {
     int node = 0;
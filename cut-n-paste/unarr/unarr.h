@@ -39,6 +39,8 @@ bool ar_seek(ar_stream *stream, off64_t offset, int origin);
 bool ar_skip(ar_stream *stream, off64_t count);
 /* returns the current read offset (or 0 on error) */
 off64_t ar_tell(ar_stream *stream);
+/* returns a pointer to the next 'count' bytes of a stream opened with ar_open_memory, without copying them or advancing the read offset pointer; returns NULL for other streams or if fewer bytes are left */
+const void *ar_peek(ar_stream *stream, size_t count);
 
 /***** common/unarr *****/
 
@@ -74,6 +76,23 @@ size_t ar_get_global_comment(ar_archive *ar, void *buffer, size_t count);
 
 /* checks whether 'stream' could contain RAR data and prepares for archive listing/extraction; returns NULL on failure */
 ar_archive *ar_open_rar_archive(ar_stream *stream);
+/* returns whether the current entry of a RAR archive can only be uncompressed after all the solid entries preceding it */
+bool ar_rar_entry_is_solid(ar_archive *ar);
+/* returns the size of the uncompressed data preceding the current entry of a RAR archive in its solid stream, or -1 if unknown */
+off64_t ar_rar_entry_get_solid_position(ar_archive *ar);
+
+typedef struct ar_rar_checkpoint_s ar_rar_checkpoint;
+
+/* saves the solid decompression state needed for the current entry of a RAR archive, before it is uncompressed; returns NULL if the state can't be saved */
+ar_rar_checkpoint *ar_rar_save_checkpoint(ar_archive *ar);
+/* reads the entry a checkpoint was saved for, so that it's uncompressed without restarting at the first solid entry; the checkpoint may be restored in any archive opened for the same data */
+bool ar_rar_restore_checkpoint(ar_archive *ar, const ar_rar_checkpoint *checkpoint);
+/* returns the stream offset of the entry a checkpoint was saved for */
+off64_t ar_rar_checkpoint_get_offset(const ar_rar_checkpoint *checkpoint);
+/* frees the state saved in a checkpoint */
+void ar_rar_free_checkpoint(ar_rar_checkpoint *checkpoint);
+/* returns the data of the current entry of a RAR archive without copying it, if the entry is stored uncompressed and the stream was opened with ar_open_memory (the pointer is valid as long as that memory); returns NULL otherwise (use ar_entry_uncompress) */
+const void *ar_rar_entry_get_stored_data(ar_archive *ar);
 
 /***** tar/tar *****/
 
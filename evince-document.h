@@ -52,6 +52,8 @@
 #include <libdocument/ev-link.h>
 #include <libdocument/ev-mapping-list.h>
 #include <libdocument/ev-page.h>
+#include <libdocument/ev-page-text.h>
+#include <libdocument/ev-range-stream.h>
 #include <libdocument/ev-render-context.h>
 #include <libdocument/ev-selection.h>
 #include <libdocument/ev-transition-effect.h>
@@ -356,7 +356,7 @@ ev_document_factory_get_document_full (const char           *uri,
 	}
 
 	result = ev_document_load_full (document, uri_unc ? uri_unc : uri,
-					EV_DOCUMENT_LOAD_FLAG_NONE, &err);
+					flags, &err);
 	if (result == FALSE) {
 		if (err == NULL) {
 			/* FIXME: this really should not happen; the backend should
@@ -535,6 +535,33 @@ ev_document_factory_get_document_for_stream (GInputStream *stream,
         return document;
 }
 
+/**
+ * ev_document_factory_can_load_stream:
+ * @mime_type: a mime type
+ *
+ * Returns: %TRUE if the backend handling @mime_type can load documents
+ *   with ev_document_factory_get_document_for_stream(), %FALSE otherwise
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_document_factory_can_load_stream (const char *mime_type)
+{
+        EvDocument *document;
+        gboolean    retval;
+
+        g_return_val_if_fail (mime_type != NULL, FALSE);
+
+        document = ev_document_factory_new_document_for_mime_type (mime_type, NULL);
+        if (document == NULL)
+                return FALSE;
+
+        retval = EV_DOCUMENT_GET_CLASS (document)->load_stream != NULL;
+        g_object_unref (document);
+
+        return retval;
+}
+
 static void
 file_filter_add_mime_types (EvBackendInfo *info, GtkFileFilter *filter)
 {
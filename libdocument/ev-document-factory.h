@@ -47,6 +47,7 @@ EvDocument* ev_document_factory_get_document_for_stream (GInputStream *stream,
                                                          EvDocumentLoadFlags flags,
                                                          GCancellable *cancellable,
                                                          GError **error);
+gboolean    ev_document_factory_can_load_stream (const char *mime_type);
 
 void 	    ev_document_factory_add_filters  (GtkWidget *chooser, EvDocument *document);
 
@@ -26,6 +26,7 @@
 #include <gtk/gtk.h>
 
 #include "ev-document-misc.h"
+#include "ev-pixel-kernels.h"
 
 /* Returns a new GdkPixbuf that is suitable for placing in the thumbnail view.
  * It is four pixels wider and taller than the source.  If source_pixbuf is not
@@ -370,19 +371,50 @@ cairo_surface_t *
 ev_document_misc_surface_from_pixbuf (GdkPixbuf *pixbuf)
 {
 	cairo_surface_t *surface;
-	cairo_t         *cr;
+	const guchar    *src;
+	guchar          *dest;
+	gint             width, height, src_stride, dest_stride, y;
+	gboolean         has_alpha;
 
 	g_return_val_if_fail (GDK_IS_PIXBUF (pixbuf), NULL);
 
-	surface = cairo_image_surface_create (gdk_pixbuf_get_has_alpha (pixbuf) ?
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+	surface = cairo_image_surface_create (has_alpha ?
 					      CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
-					      gdk_pixbuf_get_width (pixbuf),
-					      gdk_pixbuf_get_height (pixbuf));
-	cr = cairo_create (surface);
-	gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
-	cairo_paint (cr);
-	cairo_destroy (cr);
-	
+					      width, height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+		return surface;
+
+	if (gdk_pixbuf_get_bits_per_sample (pixbuf) != 8 ||
+	    gdk_pixbuf_get_n_channels (pixbuf) != (has_alpha ? 4 : 3)) {
+		cairo_t *cr;
+
+		cr = cairo_create (surface);
+		gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+
+		return surface;
+	}
+
+	src = gdk_pixbuf_get_pixels (pixbuf);
+	src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+	cairo_surface_flush (surface);
+	dest = cairo_image_surface_get_data (surface);
+	dest_stride = cairo_image_surface_get_stride (surface);
+
+	for (y = 0; y < height; y++) {
+		if (has_alpha)
+			ev_pixel_kernels_rgba_to_argb32 (src, (guint32 *) dest, width);
+		else
+			ev_pixel_kernels_rgb_to_rgb24 (src, (guint32 *) dest, width);
+		src += src_stride;
+		dest += dest_stride;
+	}
+	cairo_surface_mark_dirty (surface);
+
 	return surface;
 }
 
@@ -395,12 +427,42 @@ ev_document_misc_surface_from_pixbuf (GdkPixbuf *pixbuf)
 GdkPixbuf *
 ev_document_misc_pixbuf_from_surface (cairo_surface_t *surface)
 {
+	GdkPixbuf      *pixbuf;
+	const guchar   *src;
+	guchar         *dest;
+	gint            width, height, src_stride, dest_stride, y;
+	cairo_format_t  format;
+
 	g_return_val_if_fail (surface, NULL);	
 
-        return gdk_pixbuf_get_from_surface (surface,
-                                            0, 0,
-                                            cairo_image_surface_get_width (surface),
-                                            cairo_image_surface_get_height (surface));
+	width = cairo_image_surface_get_width (surface);
+	height = cairo_image_surface_get_height (surface);
+	format = cairo_image_surface_get_format (surface);
+	if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+		return gdk_pixbuf_get_from_surface (surface, 0, 0, width, height);
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+				 format == CAIRO_FORMAT_ARGB32,
+				 8, width, height);
+	if (!pixbuf)
+		return NULL;
+
+	cairo_surface_flush (surface);
+	src = cairo_image_surface_get_data (surface);
+	src_stride = cairo_image_surface_get_stride (surface);
+	dest = gdk_pixbuf_get_pixels (pixbuf);
+	dest_stride = gdk_pixbuf_get_rowstride (pixbuf);
+
+	for (y = 0; y < height; y++) {
+		if (format == CAIRO_FORMAT_ARGB32)
+			ev_pixel_kernels_argb32_to_rgba ((const guint32 *) src, dest, width);
+		else
+			ev_pixel_kernels_rgb24_to_rgb ((const guint32 *) src, dest, width);
+		src += src_stride;
+		dest += dest_stride;
+	}
+
+	return pixbuf;
 }
 
 cairo_surface_t *
@@ -479,8 +541,8 @@ ev_document_misc_invert_surface (cairo_surface_t *surface) {
 void
 ev_document_misc_invert_pixbuf (GdkPixbuf *pixbuf)
 {
-	guchar *data, *p;
-	guint   width, height, x, y, rowstride, n_channels;
+	guchar *data;
+	guint   width, height, y, rowstride, n_channels;
 
 	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
 	g_assert (gdk_pixbuf_get_colorspace (pixbuf) == GDK_COLORSPACE_RGB);
@@ -494,16 +556,8 @@ ev_document_misc_invert_pixbuf (GdkPixbuf *pixbuf)
 
 	width = gdk_pixbuf_get_width (pixbuf);
 	height = gdk_pixbuf_get_height (pixbuf);
-	for (x = 0; x < width; x++) {
-		for (y = 0; y < height; y++) {
-			/* Calculate pixel's offset into the data array. */
-			p = data + x * n_channels + y * rowstride;
-			/* Change the RGB values*/
-			p[0] = 255 - p[0];
-			p[1] = 255 - p[1];
-			p[2] = 255 - p[2];
-		}
-	}
+	for (y = 0; y < height; y++)
+		ev_pixel_kernels_invert_rgb (data + y * rowstride, width, n_channels);
 }
 
 gdouble
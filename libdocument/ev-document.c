@@ -26,6 +26,8 @@
 
 #include "ev-document.h"
 #include "ev-document-misc.h"
+#include "ev-trace.h"
+#include "ev-range-stream.h"
 #include "synctex_parser.h"
 
 #define EV_DOCUMENT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), EV_TYPE_DOCUMENT, EvDocumentPrivate))
@@ -35,6 +37,17 @@ enum {
 	PROP_MODIFIED
 };
 
+enum {
+	CACHE_UPDATED,
+	N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+/* Number of pages whose size and label are read at once when
+ * the cache is filled in the background */
+#define CACHE_CHUNK_SIZE 32
+
 typedef struct _EvPageSize
 {
 	gdouble width;
@@ -59,14 +72,33 @@ struct _EvDocumentPrivate
 	gdouble         min_width;
 	gdouble         min_height;
 	gint            max_label;
+	gboolean        custom_page_labels;
 
 	gchar         **page_labels;
 	EvPageSize     *page_sizes;
 	EvDocumentInfo *info;
 
+	/* Lazily filled cache. cache_mutex protects the
+	 * cached sizes and labels while cache_thread runs,
+	 * the thread keeps a reference on the document */
+	GMutex          cache_mutex;
+	GThread        *cache_thread;
+	gint            cache_n_pages;
+	guint           cache_updated_id;
+
 	synctex_scanner_t synctex_scanner;
+
+	GRWLock         doc_lock;
 };
 
+typedef struct _EvDocumentClassPrivate
+{
+	EvDocumentRenderFlags render_flags;
+} EvDocumentClassPrivate;
+
+#define EV_DOCUMENT_CLASS_GET_PRIVATE(klass) \
+	(G_TYPE_CLASS_GET_PRIVATE ((klass), EV_TYPE_DOCUMENT, EvDocumentClassPrivate))
+
 static guint64         _ev_document_get_size_gfile  (GFile      *file);
 static guint64         _ev_document_get_size        (const char *uri);
 static gint            _ev_document_get_n_pages     (EvDocument *document);
@@ -82,7 +114,9 @@ static gboolean        _ev_document_support_synctex (EvDocument *document);
 static GMutex ev_doc_mutex;
 static GMutex ev_fc_mutex;
 
-G_DEFINE_ABSTRACT_TYPE (EvDocument, ev_document, G_TYPE_OBJECT)
+G_DEFINE_ABSTRACT_TYPE_WITH_CODE (EvDocument, ev_document, G_TYPE_OBJECT,
+				  g_type_add_class_private (g_define_type_id,
+							    sizeof (EvDocumentClassPrivate)))
 
 GQuark
 ev_document_error_quark (void)
@@ -112,6 +146,11 @@ ev_document_finalize (GObject *object)
 {
 	EvDocument *document = EV_DOCUMENT (object);
 
+	if (document->priv->cache_updated_id > 0) {
+		g_source_remove (document->priv->cache_updated_id);
+		document->priv->cache_updated_id = 0;
+	}
+
 	if (document->priv->uri) {
 		g_free (document->priv->uri);
 		document->priv->uri = NULL;
@@ -134,6 +173,9 @@ ev_document_finalize (GObject *object)
 		document->priv->synctex_scanner = NULL;
 	}
 
+	g_rw_lock_clear (&document->priv->doc_lock);
+	g_mutex_clear (&document->priv->cache_mutex);
+
 	G_OBJECT_CLASS (ev_document_parent_class)->finalize (object);
 }
 
@@ -177,6 +219,9 @@ ev_document_init (EvDocument *document)
 {
 	document->priv = EV_DOCUMENT_GET_PRIVATE (document);
 
+	g_rw_lock_init (&document->priv->doc_lock);
+	g_mutex_init (&document->priv->cache_mutex);
+
 	/* Assume all pages are the same size until proven otherwise */
 	document->priv->uniform = TRUE;
 }
@@ -204,6 +249,26 @@ ev_document_class_init (EvDocumentClass *klass)
 							       FALSE,
 							       G_PARAM_READWRITE |
 							       G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * EvDocument::cache-updated:
+	 * @document: the object which received the signal
+	 *
+	 * Emitted in the main context when the sizes or labels of pages
+	 * found while filling the cache in the background, see
+	 * %EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE, changed what was
+	 * assumed so far.
+	 *
+	 * Since: 3.28
+	 */
+	signals[CACHE_UPDATED] =
+		g_signal_new ("cache-updated",
+			      G_OBJECT_CLASS_TYPE (g_object_class),
+			      G_SIGNAL_RUN_LAST,
+			      0,
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 }
 
 /**
@@ -246,24 +311,191 @@ ev_document_set_modified (EvDocument *document,
 	}
 }
 
+/**
+ * ev_document_doc_mutex_lock:
+ *
+ * Deprecated: 3.28: Use ev_document_lock() instead.
+ */
 void
 ev_document_doc_mutex_lock (void)
 {
 	g_mutex_lock (&ev_doc_mutex);
 }
 
+/**
+ * ev_document_doc_mutex_unlock:
+ *
+ * Deprecated: 3.28: Use ev_document_unlock() instead.
+ */
 void
 ev_document_doc_mutex_unlock (void)
 {
 	g_mutex_unlock (&ev_doc_mutex);
 }
 
+/**
+ * ev_document_doc_mutex_trylock:
+ *
+ * Deprecated: 3.28: Use ev_document_trylock() instead.
+ */
 gboolean
 ev_document_doc_mutex_trylock (void)
 {
 	return g_mutex_trylock (&ev_doc_mutex);
 }
 
+/**
+ * ev_document_lock:
+ * @document: an #EvDocument
+ *
+ * Takes the lock of @document for exclusive access. Backends are not
+ * thread-safe, so every call into a backend that can happen while
+ * jobs for @document are running in other threads must be done with
+ * the document locked. The lock is not recursive.
+ *
+ * Since: 3.28
+ */
+void
+ev_document_lock (EvDocument *document)
+{
+	gint64 start;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	if (g_rw_lock_writer_trylock (&document->priv->doc_lock))
+		return;
+
+	start = ev_trace_now ();
+	g_rw_lock_writer_lock (&document->priv->doc_lock);
+	ev_trace_record (EV_TRACE_LOCK_WAIT, "ev_document_lock", start, ev_trace_now ());
+}
+
+/**
+ * ev_document_unlock:
+ * @document: an #EvDocument
+ *
+ * Releases the lock taken with ev_document_lock() or ev_document_trylock().
+ *
+ * Since: 3.28
+ */
+void
+ev_document_unlock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	g_rw_lock_writer_unlock (&document->priv->doc_lock);
+}
+
+/**
+ * ev_document_trylock:
+ * @document: an #EvDocument
+ *
+ * Like ev_document_lock(), but returns %FALSE immediately when
+ * the lock is held by another thread.
+ *
+ * Returns: %TRUE if the lock was taken
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_document_trylock (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	return g_rw_lock_writer_trylock (&document->priv->doc_lock);
+}
+
+/**
+ * ev_document_class_set_render_flags:
+ * @klass: an #EvDocumentClass
+ * @flags: the #EvDocumentRenderFlags of the backend
+ *
+ * Declares the rendering capabilities of a backend. It must be called
+ * from the class_init function of the backend. Subclasses of @klass
+ * inherit @flags.
+ *
+ * Since: 3.28
+ */
+void
+ev_document_class_set_render_flags (EvDocumentClass      *klass,
+				    EvDocumentRenderFlags flags)
+{
+	g_return_if_fail (EV_IS_DOCUMENT_CLASS (klass));
+
+	EV_DOCUMENT_CLASS_GET_PRIVATE (klass)->render_flags = flags;
+}
+
+/**
+ * ev_document_get_render_flags:
+ * @document: an #EvDocument
+ *
+ * Returns: the #EvDocumentRenderFlags declared by the backend of @document
+ *
+ * Since: 3.28
+ */
+EvDocumentRenderFlags
+ev_document_get_render_flags (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), EV_DOCUMENT_RENDER_FLAG_NONE);
+
+	return EV_DOCUMENT_CLASS_GET_PRIVATE (EV_DOCUMENT_GET_CLASS (document))->render_flags;
+}
+
+/**
+ * ev_document_render_lock:
+ * @document: an #EvDocument
+ *
+ * Takes the lock of @document for rendering with ev_document_render().
+ * When the backend declares %EV_DOCUMENT_RENDER_FLAG_REENTRANT, meaning
+ * that ev_document_get_page(), ev_document_render(), the thumbnail methods
+ * and #EvSelection rendering can be called concurrently, several
+ * threads can hold the render lock at the same time, but never together
+ * with ev_document_lock(). Otherwise it is the same as ev_document_lock().
+ *
+ * Since: 3.28
+ */
+void
+ev_document_render_lock (EvDocument *document)
+{
+	gint64 start;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	if (ev_document_get_render_flags (document) & EV_DOCUMENT_RENDER_FLAG_REENTRANT) {
+		if (g_rw_lock_reader_trylock (&document->priv->doc_lock))
+			return;
+
+		start = ev_trace_now ();
+		g_rw_lock_reader_lock (&document->priv->doc_lock);
+	} else {
+		if (g_rw_lock_writer_trylock (&document->priv->doc_lock))
+			return;
+
+		start = ev_trace_now ();
+		g_rw_lock_writer_lock (&document->priv->doc_lock);
+	}
+	ev_trace_record (EV_TRACE_LOCK_WAIT, "ev_document_render_lock", start, ev_trace_now ());
+}
+
+/**
+ * ev_document_render_unlock:
+ * @document: an #EvDocument
+ *
+ * Releases the lock taken with ev_document_render_lock().
+ *
+ * Since: 3.28
+ */
+void
+ev_document_render_unlock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	if (ev_document_get_render_flags (document) & EV_DOCUMENT_RENDER_FLAG_REENTRANT)
+		g_rw_lock_reader_unlock (&document->priv->doc_lock);
+	else
+		g_rw_lock_writer_unlock (&document->priv->doc_lock);
+}
+
 void
 ev_document_fc_mutex_lock (void)
 {
@@ -282,11 +514,98 @@ ev_document_fc_mutex_trylock (void)
 	return g_mutex_trylock (&ev_fc_mutex);
 }
 
+/* Adds the size and label of page @i to the cache, taking ownership
+ * of @page_label. Returns %TRUE if the page changed something
+ * that could be assumed from the pages cached so far.
+ */
+static gboolean
+ev_document_cache_add_page (EvDocument *document,
+			    gint        i,
+			    gdouble     page_width,
+			    gdouble     page_height,
+			    gchar      *page_label)
+{
+        EvDocumentPrivate *priv = document->priv;
+        EvPageSize        *page_size;
+        gboolean           changed = FALSE;
+
+        if (i == 0) {
+                priv->uniform_width = page_width;
+                priv->uniform_height = page_height;
+                priv->max_width = priv->uniform_width;
+                priv->max_height = priv->uniform_height;
+                priv->min_width = priv->uniform_width;
+                priv->min_height = priv->uniform_height;
+        } else if (priv->uniform &&
+                    (priv->uniform_width != page_width ||
+                    priv->uniform_height != page_height)) {
+                /* It's a different page size.  Fill the array with the
+                 * uniform size, pages not cached yet are assumed to
+                 * have it too.
+                 */
+                int j;
+
+                priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
+
+                for (j = 0; j < priv->n_pages; j++) {
+                        page_size = &(priv->page_sizes[j]);
+                        page_size->width = priv->uniform_width;
+                        page_size->height = priv->uniform_height;
+                }
+                priv->uniform = FALSE;
+                changed = TRUE;
+        }
+        if (!priv->uniform) {
+                page_size = &(priv->page_sizes[i]);
+
+                page_size->width = page_width;
+                page_size->height = page_height;
+
+                if (page_width > priv->max_width)
+                        priv->max_width = page_width;
+                if (page_width < priv->min_width)
+                        priv->min_width = page_width;
+
+                if (page_height > priv->max_height)
+                        priv->max_height = page_height;
+                if (page_height < priv->min_height)
+                        priv->min_height = page_height;
+
+                changed = TRUE;
+        }
+
+        if (page_label) {
+                glong label_len;
+
+                if (!priv->page_labels)
+                        priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
+
+                if (!priv->custom_page_labels) {
+                        gchar *real_page_label;
+
+                        real_page_label = g_strdup_printf ("%d", i + 1);
+                        priv->custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
+                        changed |= priv->custom_page_labels;
+                        g_free (real_page_label);
+                }
+
+                priv->page_labels[i] = page_label;
+                label_len = g_utf8_strlen (page_label, 256);
+                if (label_len > priv->max_label) {
+                        priv->max_label = label_len;
+                        changed = TRUE;
+                }
+        }
+
+        priv->cache_n_pages = i + 1;
+
+        return changed;
+}
+
 static void
 ev_document_setup_cache (EvDocument *document)
 {
         EvDocumentPrivate *priv = document->priv;
-        gboolean custom_page_labels = FALSE;
         gint i;
 
         /* Cache some info about the document to avoid
@@ -298,73 +617,152 @@ ev_document_setup_cache (EvDocument *document)
                 EvPage     *page = ev_document_get_page (document, i);
                 gdouble     page_width = 0;
                 gdouble     page_height = 0;
-                EvPageSize *page_size;
-                gchar      *page_label;
 
                 _ev_document_get_page_size (document, page, &page_width, &page_height);
+                ev_document_cache_add_page (document, i, page_width, page_height,
+                                            _ev_document_get_page_label (document, page));
 
-                if (i == 0) {
-                        priv->uniform_width = page_width;
-                        priv->uniform_height = page_height;
-                        priv->max_width = priv->uniform_width;
-                        priv->max_height = priv->uniform_height;
-                        priv->min_width = priv->uniform_width;
-                        priv->min_height = priv->uniform_height;
-                } else if (priv->uniform &&
-                            (priv->uniform_width != page_width ||
-                            priv->uniform_height != page_height)) {
-                        /* It's a different page size.  Backfill the array. */
-                        int j;
-
-                        priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
-
-                        for (j = 0; j < i; j++) {
-                                page_size = &(priv->page_sizes[j]);
-                                page_size->width = priv->uniform_width;
-                                page_size->height = priv->uniform_height;
-                        }
-                        priv->uniform = FALSE;
-                }
-                if (!priv->uniform) {
-                        page_size = &(priv->page_sizes[i]);
+                g_object_unref (page);
+        }
 
-                        page_size->width = page_width;
-                        page_size->height = page_height;
+	if (!priv->custom_page_labels)
+		g_clear_pointer (&priv->page_labels, g_strfreev);
+}
 
-                        if (page_width > priv->max_width)
-                                priv->max_width = page_width;
-                        if (page_width < priv->min_width)
-                                priv->min_width = page_width;
+static gboolean
+ev_document_cache_updated_idle (EvDocument *document)
+{
+	g_mutex_lock (&document->priv->cache_mutex);
+	document->priv->cache_updated_id = 0;
+	g_mutex_unlock (&document->priv->cache_mutex);
 
-                        if (page_height > priv->max_height)
-                                priv->max_height = page_height;
-                        if (page_height < priv->min_height)
-                                priv->min_height = page_height;
-                }
+	g_signal_emit (document, signals[CACHE_UPDATED], 0);
 
-                page_label = _ev_document_get_page_label (document, page);
-                if (page_label) {
-                        if (!priv->page_labels)
-                                priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+ev_document_cache_thread_finished_idle (EvDocument *document)
+{
+	GThread *thread;
 
-                        if (!custom_page_labels) {
-                                gchar *real_page_label;
+	/* The thread may have been started from a job thread */
+	g_mutex_lock (&document->priv->cache_mutex);
+	thread = document->priv->cache_thread;
+	document->priv->cache_thread = NULL;
+	g_mutex_unlock (&document->priv->cache_mutex);
 
-                                real_page_label = g_strdup_printf ("%d", i + 1);
-                                custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
-                                g_free (real_page_label);
-                        }
+	g_thread_join (thread);
+	g_object_unref (document);
 
-                        priv->page_labels[i] = page_label;
-                        priv->max_label = MAX (priv->max_label,
-                                                g_utf8_strlen (page_label, 256));
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+ev_document_cache_thread (EvDocument *document)
+{
+        EvDocumentPrivate *priv = document->priv;
+        gdouble            sizes[CACHE_CHUNK_SIZE * 2];
+        gchar             *labels[CACHE_CHUNK_SIZE];
+        gint               i = 1;
+
+        /* Stop early when nobody else uses the document anymore */
+        while (i < priv->n_pages &&
+               g_atomic_int_get (&G_OBJECT (document)->ref_count) > 1) {
+                gint     n = MIN (CACHE_CHUNK_SIZE, priv->n_pages - i);
+                gboolean changed = FALSE;
+                gint     j;
+
+                /* The document lock is only held while reading a chunk,
+                 * so that rendering can go on in between.
+                 */
+                ev_document_lock (document);
+                for (j = 0; j < n; j++) {
+                        EvPage *page = ev_document_get_page (document, i + j);
+
+                        sizes[j * 2] = sizes[j * 2 + 1] = 0;
+                        _ev_document_get_page_size (document, page,
+                                                    &sizes[j * 2], &sizes[j * 2 + 1]);
+                        labels[j] = _ev_document_get_page_label (document, page);
+                        g_object_unref (page);
                 }
+                ev_document_unlock (document);
 
-                g_object_unref (page);
+                g_mutex_lock (&priv->cache_mutex);
+                for (j = 0; j < n; j++) {
+                        changed |= ev_document_cache_add_page (document, i + j,
+                                                               sizes[j * 2], sizes[j * 2 + 1],
+                                                               labels[j]);
+                }
+                if (changed && priv->cache_updated_id == 0) {
+                        priv->cache_updated_id =
+                                g_idle_add ((GSourceFunc) ev_document_cache_updated_idle,
+                                            document);
+                }
+                g_mutex_unlock (&priv->cache_mutex);
+
+                i += n;
         }
 
-	if (!custom_page_labels)
-		g_clear_pointer (&priv->page_labels, g_strfreev);
+        g_mutex_lock (&priv->cache_mutex);
+        if (!priv->custom_page_labels)
+                g_clear_pointer (&priv->page_labels, g_strfreev);
+        g_mutex_unlock (&priv->cache_mutex);
+
+        /* The document is released in the main thread, so that the
+         * backend is never finalized from here */
+        g_idle_add ((GSourceFunc) ev_document_cache_thread_finished_idle, document);
+
+        return NULL;
+}
+
+/* Caches the first page right away, assuming the others are the same,
+ * and fills the rest of the cache in a thread. EvDocument::cache-updated
+ * is emitted when the assumption turns out to be wrong.
+ */
+static void
+ev_document_setup_cache_lazily (EvDocument *document)
+{
+        EvDocumentPrivate *priv = document->priv;
+        EvPage            *page;
+        gdouble            page_width = 0;
+        gdouble            page_height = 0;
+
+	priv->cache_loaded = TRUE;
+
+        if (priv->n_pages <= 0)
+                return;
+
+        page = ev_document_get_page (document, 0);
+        _ev_document_get_page_size (document, page, &page_width, &page_height);
+        ev_document_cache_add_page (document, 0, page_width, page_height,
+                                    _ev_document_get_page_label (document, page));
+        g_object_unref (page);
+
+        if (priv->n_pages == 1) {
+                if (!priv->custom_page_labels)
+                        g_clear_pointer (&priv->page_labels, g_strfreev);
+                return;
+        }
+
+        g_mutex_lock (&priv->cache_mutex);
+        priv->cache_thread = g_thread_new ("EvDocumentCache",
+                                           (GThreadFunc) ev_document_cache_thread,
+                                           g_object_ref (document));
+        g_mutex_unlock (&priv->cache_mutex);
+}
+
+static void
+ev_document_setup_cache_full (EvDocument         *document,
+			      EvDocumentLoadFlags flags)
+{
+	if (flags & (EV_DOCUMENT_LOAD_FLAG_NO_CACHE | EV_DOCUMENT_LOAD_FLAG_PROBE))
+		return;
+
+	if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE)
+		ev_document_setup_cache_lazily (document);
+	else
+		ev_document_setup_cache (document);
 }
 
 static void
@@ -401,6 +799,10 @@ ev_document_initialize_synctex (EvDocument  *document,
  * used to load the document and the URI, e.g. #GIOError, #GFileError, and
  * #GConvertError.
  *
+ * With %EV_DOCUMENT_LOAD_FLAG_PROBE, the document is only loaded to get
+ * its info and render its first page: neither the page cache nor the
+ * synctex scanner are set up.
+ *
  * Returns: %TRUE on success, or %FALSE on failure.
  */
 gboolean
@@ -430,11 +832,11 @@ ev_document_load_full (EvDocument           *document,
 	} else {
 		document->priv->info = _ev_document_get_info (document);
 		document->priv->n_pages = _ev_document_get_n_pages (document);
-		if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
-			ev_document_setup_cache (document);
+		ev_document_setup_cache_full (document, flags);
 		document->priv->uri = g_strdup (uri);
 		document->priv->file_size = _ev_document_get_size (uri);
-		ev_document_initialize_synctex (document, uri);
+		if (!(flags & EV_DOCUMENT_LOAD_FLAG_PROBE))
+			ev_document_initialize_synctex (document, uri);
         }
 
 	return retval;
@@ -508,8 +910,18 @@ ev_document_load_stream (EvDocument         *document,
 	document->priv->info = _ev_document_get_info (document);
 	document->priv->n_pages = _ev_document_get_n_pages (document);
 
-        if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
-                ev_document_setup_cache (document);
+        ev_document_setup_cache_full (document, flags);
+
+	/* Like a remote document copied to a temp file, a document read
+	 * through a range stream has the URI of the local copy.
+	 */
+	if (EV_IS_RANGE_STREAM (stream)) {
+		EvRangeStream *range_stream = EV_RANGE_STREAM (stream);
+
+		g_free (document->priv->uri);
+		document->priv->uri = g_file_get_uri (ev_range_stream_get_cache_file (range_stream));
+		document->priv->file_size = ev_range_stream_get_size (range_stream);
+	}
 
         return TRUE;
 }
@@ -556,12 +968,12 @@ ev_document_load_gfile (EvDocument         *document,
 	document->priv->info = _ev_document_get_info (document);
 	document->priv->n_pages = _ev_document_get_n_pages (document);
 
-        if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
-                ev_document_setup_cache (document);
+        ev_document_setup_cache_full (document, flags);
 
 	document->priv->uri = g_file_get_uri (file);
 	document->priv->file_size = _ev_document_get_size_gfile (file);
-	ev_document_initialize_synctex (document, document->priv->uri);
+	if (!(flags & EV_DOCUMENT_LOAD_FLAG_PROBE))
+		ev_document_initialize_synctex (document, document->priv->uri);
 
         return TRUE;
 }
@@ -789,6 +1201,7 @@ ev_document_get_page_size (EvDocument *document,
 	priv = document->priv;
 
 	if (priv->cache_loaded) {
+		g_mutex_lock (&priv->cache_mutex);
 		if (width)
 			*width = priv->uniform ?
 				priv->uniform_width :
@@ -797,14 +1210,15 @@ ev_document_get_page_size (EvDocument *document,
 			*height = priv->uniform ?
 				priv->uniform_height :
 				priv->page_sizes[page_index].height;
+		g_mutex_unlock (&priv->cache_mutex);
 	} else {
 		EvPage *page;
 
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		page = ev_document_get_page (document, page_index);
 		_ev_document_get_page_size (document, page, width, height);
 		g_object_unref (page);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 }
 
@@ -822,25 +1236,37 @@ gchar *
 ev_document_get_page_label (EvDocument *document,
 			    gint        page_index)
 {
+	EvDocumentPrivate *priv;
+	gchar             *page_label;
+	gboolean           cached;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 	g_return_val_if_fail (page_index >= 0 || page_index < document->priv->n_pages, NULL);
 
-	if (!document->priv->cache_loaded) {
+	priv = document->priv;
+
+	g_mutex_lock (&priv->cache_mutex);
+	cached = priv->cache_loaded && page_index < priv->cache_n_pages;
+	if (cached) {
+		page_label = (priv->page_labels && priv->page_labels[page_index]) ?
+			g_strdup (priv->page_labels[page_index]) :
+			g_strdup_printf ("%d", page_index + 1);
+	}
+	g_mutex_unlock (&priv->cache_mutex);
+
+	if (!cached) {
 		EvPage *page;
-		gchar *page_label;
 
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		page = ev_document_get_page (document, page_index);
 		page_label = _ev_document_get_page_label (document, page);
 		g_object_unref (page);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 
 		return page_label ? page_label : g_strdup_printf ("%d", page_index + 1);
 	}
 
-	return (document->priv->page_labels && document->priv->page_labels[page_index]) ?
-		g_strdup (document->priv->page_labels[page_index]) :
-		g_strdup_printf ("%d", page_index + 1);
+	return page_label;
 }
 
 static EvDocumentInfo *
@@ -873,12 +1299,61 @@ ev_document_get_backend_info (EvDocument *document, EvDocumentBackendInfo *info)
 	return klass->get_backend_info (document, info);
 }
 
+static cairo_surface_t *
+_ev_document_render_area (EvDocument      *document,
+			  EvRenderContext *rc)
+{
+	EvDocumentClass      *klass = EV_DOCUMENT_GET_CLASS (document);
+	cairo_rectangle_int_t area;
+	cairo_surface_t      *page_surface;
+	cairo_surface_t      *surface;
+	cairo_t              *cr;
+
+	/* The backend can't render areas, render
+	 * the whole page and copy the requested area.
+	 */
+	ev_render_context_get_area (rc, &area);
+	ev_render_context_set_area (rc, NULL);
+	page_surface = klass->render (document, rc);
+	ev_render_context_set_area (rc, &area);
+	if (!page_surface)
+		return NULL;
+
+	surface = cairo_surface_create_similar (page_surface,
+						cairo_surface_get_content (page_surface),
+						area.width, area.height);
+	cr = cairo_create (surface);
+	cairo_set_source_surface (cr, page_surface, -area.x, -area.y);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+	cairo_surface_destroy (page_surface);
+
+	return surface;
+}
+
+/**
+ * ev_document_render:
+ * @document: an #EvDocument
+ * @rc: an #EvRenderContext
+ *
+ * Renders a page of @document with the parameters of @rc. When an area
+ * has been set with ev_render_context_set_area(), only that area is
+ * rendered. Backends declaring %EV_DOCUMENT_RENDER_FLAG_AREA render the
+ * area directly, for the others the whole page is rendered and then cropped.
+ *
+ * Returns: (transfer full): a #cairo_surface_t, or %NULL on error
+ */
 cairo_surface_t *
 ev_document_render (EvDocument      *document,
 		    EvRenderContext *rc)
 {
 	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
 
+	if (ev_render_context_get_area (rc, NULL) &&
+	    !(ev_document_get_render_flags (document) & EV_DOCUMENT_RENDER_FLAG_AREA))
+		return _ev_document_render_area (document, rc);
+
 	return klass->render (document, rc);
 }
 
@@ -959,15 +1434,21 @@ ev_document_get_title (EvDocument *document)
 gboolean
 ev_document_is_page_size_uniform (EvDocument *document)
 {
+	gboolean uniform;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), TRUE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->uniform;
+	g_mutex_lock (&document->priv->cache_mutex);
+	uniform = document->priv->uniform;
+	g_mutex_unlock (&document->priv->cache_mutex);
+
+	return uniform;
 }
 
 void
@@ -978,15 +1459,17 @@ ev_document_get_max_page_size (EvDocument *document,
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
+	g_mutex_lock (&document->priv->cache_mutex);
 	if (width)
 		*width = document->priv->max_width;
 	if (height)
 		*height = document->priv->max_height;
+	g_mutex_unlock (&document->priv->cache_mutex);
 }
 
 void
@@ -997,29 +1480,37 @@ ev_document_get_min_page_size (EvDocument *document,
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
+	g_mutex_lock (&document->priv->cache_mutex);
 	if (width)
 		*width = document->priv->min_width;
 	if (height)
 		*height = document->priv->min_height;
+	g_mutex_unlock (&document->priv->cache_mutex);
 }
 
 gboolean
 ev_document_check_dimensions (EvDocument *document)
 {
+	gboolean retval;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return (document->priv->max_width > 0 && document->priv->max_height > 0);
+	g_mutex_lock (&document->priv->cache_mutex);
+	retval = document->priv->max_width > 0 && document->priv->max_height > 0;
+	g_mutex_unlock (&document->priv->cache_mutex);
+
+	return retval;
 }
 
 guint64
@@ -1033,29 +1524,65 @@ ev_document_get_size (EvDocument *document)
 gint
 ev_document_get_max_label_len (EvDocument *document)
 {
+	gint max_label;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), -1);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->max_label;
+	g_mutex_lock (&document->priv->cache_mutex);
+	max_label = document->priv->max_label;
+	g_mutex_unlock (&document->priv->cache_mutex);
+
+	return max_label;
 }
 
 gboolean
 ev_document_has_text_page_labels (EvDocument *document)
 {
+	gboolean retval;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->page_labels != NULL;
+	g_mutex_lock (&document->priv->cache_mutex);
+	retval = document->priv->custom_page_labels;
+	g_mutex_unlock (&document->priv->cache_mutex);
+
+	return retval;
+}
+
+static gint
+find_page_by_label (gchar      **page_labels,
+		    gint         n_pages,
+		    const gchar *page_label)
+{
+	gint i;
+
+        /* First, look for a literal label match */
+	for (i = 0; page_labels && i < n_pages; i ++) {
+		if (page_labels[i] != NULL &&
+		    ! strcmp (page_label, page_labels[i]))
+			return i;
+	}
+
+	/* Second, look for a match with case insensitively */
+	for (i = 0; page_labels && i < n_pages; i++) {
+		if (page_labels[i] != NULL &&
+		    ! strcasecmp (page_label, page_labels[i]))
+			return i;
+	}
+
+	return -1;
 }
 
 gboolean
@@ -1066,6 +1593,7 @@ ev_document_find_page_by_label (EvDocument  *document,
 	gint i, page;
 	glong value;
 	gchar *endptr = NULL;
+	gchar **page_labels = NULL;
 	EvDocumentPrivate *priv = document->priv;
 
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
@@ -1073,27 +1601,44 @@ ev_document_find_page_by_label (EvDocument  *document,
 	g_return_val_if_fail (page_index != NULL, FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-        /* First, look for a literal label match */
-	for (i = 0; priv->page_labels && i < priv->n_pages; i ++) {
-		if (priv->page_labels[i] != NULL &&
-		    ! strcmp (page_label, priv->page_labels[i])) {
-			*page_index = i;
-			return TRUE;
-		}
+	g_mutex_lock (&priv->cache_mutex);
+	if (priv->cache_n_pages < priv->n_pages &&
+	    EV_DOCUMENT_GET_CLASS (document)->get_page_label) {
+		/* The cache is still being filled in the background,
+		 * the labels it doesn't have yet are read below */
+		page_labels = g_new0 (gchar *, priv->n_pages + 1);
+		for (i = 0; priv->page_labels && i < priv->cache_n_pages; i++)
+			page_labels[i] = g_strdup (priv->page_labels[i]);
+		i = priv->cache_n_pages;
+	} else {
+		page = find_page_by_label (priv->page_labels, priv->n_pages, page_label);
 	}
+	g_mutex_unlock (&priv->cache_mutex);
 
-	/* Second, look for a match with case insensitively */
-	for (i = 0; priv->page_labels && i < priv->n_pages; i++) {
-		if (priv->page_labels[i] != NULL &&
-		    ! strcasecmp (page_label, priv->page_labels[i])) {
-			*page_index = i;
-			return TRUE;
+	if (page_labels) {
+		ev_document_lock (document);
+		for (; i < priv->n_pages; i++) {
+			EvPage *ev_page = ev_document_get_page (document, i);
+
+			page_labels[i] = _ev_document_get_page_label (document, ev_page);
+			g_object_unref (ev_page);
 		}
+		ev_document_unlock (document);
+
+		page = find_page_by_label (page_labels, priv->n_pages, page_label);
+		for (i = 0; i < priv->n_pages; i++)
+			g_free (page_labels[i]);
+		g_free (page_labels);
+	}
+
+	if (page >= 0) {
+		*page_index = page;
+		return TRUE;
 	}
 
 	/* Next, parse the label, and see if the number fits */
@@ -34,6 +34,7 @@
 #include <cairo.h>
 
 #include "ev-document-info.h"
+#include "ev-macros.h"
 #include "ev-page.h"
 #include "ev-render-context.h"
 
@@ -51,14 +52,20 @@ typedef struct _EvDocumentClass   EvDocumentClass;
 typedef struct _EvDocumentPrivate EvDocumentPrivate;
 
 #define EV_DOCUMENT_ERROR ev_document_error_quark ()
-#define EV_DOC_MUTEX_LOCK (ev_document_doc_mutex_lock ())
-#define EV_DOC_MUTEX_UNLOCK (ev_document_doc_mutex_unlock ())
 
 typedef enum /*< flags >*/ {
-        EV_DOCUMENT_LOAD_FLAG_NONE = 0,
-        EV_DOCUMENT_LOAD_FLAG_NO_CACHE
+        EV_DOCUMENT_LOAD_FLAG_NONE       = 0,
+        EV_DOCUMENT_LOAD_FLAG_NO_CACHE   = 1 << 0,
+        EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE = 1 << 1,
+        EV_DOCUMENT_LOAD_FLAG_PROBE      = 1 << 2
 } EvDocumentLoadFlags;
 
+typedef enum /*< flags >*/ {
+        EV_DOCUMENT_RENDER_FLAG_NONE      = 0,
+        EV_DOCUMENT_RENDER_FLAG_REENTRANT = 1 << 0,
+        EV_DOCUMENT_RENDER_FLAG_AREA      = 1 << 1
+} EvDocumentRenderFlags;
+
 typedef enum
 {
         EV_DOCUMENT_ERROR_INVALID,
@@ -137,11 +144,30 @@ GType            ev_document_get_type             (void) G_GNUC_CONST;
 GQuark           ev_document_error_quark          (void);
 
 /* Document mutex */
+EV_DEPRECATED_FOR(ev_document_lock)
 GMutex          *ev_document_get_doc_mutex        (void);
+EV_DEPRECATED_FOR(ev_document_lock)
 void             ev_document_doc_mutex_lock       (void);
+EV_DEPRECATED_FOR(ev_document_unlock)
 void             ev_document_doc_mutex_unlock     (void);
+EV_DEPRECATED_FOR(ev_document_trylock)
 gboolean         ev_document_doc_mutex_trylock    (void);
 
+#ifndef EV_DISABLE_DEPRECATED
+#define EV_DOC_MUTEX_LOCK (ev_document_doc_mutex_lock ())
+#define EV_DOC_MUTEX_UNLOCK (ev_document_doc_mutex_unlock ())
+#endif
+
+/* Per document lock */
+void             ev_document_lock                 (EvDocument      *document);
+void             ev_document_unlock               (EvDocument      *document);
+gboolean         ev_document_trylock              (EvDocument      *document);
+void             ev_document_render_lock          (EvDocument      *document);
+void             ev_document_render_unlock        (EvDocument      *document);
+void             ev_document_class_set_render_flags (EvDocumentClass      *klass,
+						     EvDocumentRenderFlags flags);
+EvDocumentRenderFlags ev_document_get_render_flags (EvDocument     *document);
+
 /* FontConfig mutex */
 GMutex          *ev_document_get_fc_mutex         (void);
 void             ev_document_fc_mutex_lock        (void);
@@ -740,3 +740,312 @@ ev_file_compress (const gchar       *uri,
 
 	return compression_run (uri, type, TRUE, error);
 }
+
+/* Per-document cache files start with this header and the URI of the
+ * document, padded to 8 bytes. Numbers are stored in little endian.
+ */
+typedef struct {
+	gchar   magic[8];
+	guint32 version;
+	guint32 uri_length;
+	guint64 mtime;
+	guint64 size;
+} CacheFileHeader;
+
+#define CACHE_FILE_SUFFIX ".cache"
+
+static gchar *
+get_cache_file_dir (const gchar *cache_name)
+{
+	return g_build_filename (g_get_user_cache_dir (), "evince", cache_name, NULL);
+}
+
+static gchar *
+get_cache_file_filename (const gchar *cache_name,
+			 const gchar *uri)
+{
+	gchar *checksum;
+	gchar *basename;
+	gchar *dirname;
+	gchar *filename;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	basename = g_strconcat (checksum, CACHE_FILE_SUFFIX, NULL);
+	dirname = get_cache_file_dir (cache_name);
+	filename = g_build_filename (dirname, basename, NULL);
+	g_free (checksum);
+	g_free (basename);
+	g_free (dirname);
+
+	return filename;
+}
+
+static gsize
+get_cache_file_data_offset (guint32 uri_length)
+{
+	return sizeof (CacheFileHeader) + (((gsize) uri_length + 7) & ~7);
+}
+
+/**
+ * ev_cache_file_get_stamp:
+ * @uri: the URI of a document
+ * @mtime: (out): return location for the modification time, in microseconds
+ * @size: (out): return location for the size of the file
+ *
+ * Gets what a cache file of the document at @uri is validated with.
+ * It should be taken before reading the document, so that changes made
+ * in the meantime make the cache file stale.
+ *
+ * Returns: %TRUE on success, or %FALSE if the file can't be queried
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_cache_file_get_stamp (const gchar *uri,
+			 guint64     *mtime,
+			 guint64     *size)
+{
+	GFile     *file;
+	GFileInfo *info;
+
+	g_return_val_if_fail (uri != NULL, FALSE);
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_object_unref (file);
+	if (!info)
+		return FALSE;
+
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	*size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+	g_object_unref (info);
+
+	return *mtime != 0;
+}
+
+/**
+ * ev_cache_file_open:
+ * @cache_name: the name of the cache
+ * @magic: the 8 bytes identifying the files of the cache
+ * @version: the version of the file format
+ * @uri: the URI of a document
+ * @data_offset: (out): return location for the offset of the data
+ *
+ * Maps the file @cache_name keeps for @uri, when it has the given
+ * @magic and @version and was saved for the current contents of the
+ * document. The data saved after the header starts at @data_offset,
+ * aligned to 8 bytes.
+ *
+ * Returns: (transfer full): the mapped file, or %NULL
+ *
+ * Since: 3.28
+ */
+GMappedFile *
+ev_cache_file_open (const gchar *cache_name,
+		    const gchar *magic,
+		    guint32      version,
+		    const gchar *uri,
+		    gsize       *data_offset)
+{
+	GMappedFile           *file;
+	const gchar           *contents;
+	const CacheFileHeader *header;
+	gchar                 *filename;
+	gsize                  length;
+	guint64                mtime, size;
+	guint32                uri_length;
+
+	g_return_val_if_fail (cache_name != NULL, NULL);
+	g_return_val_if_fail (magic != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	if (!ev_cache_file_get_stamp (uri, &mtime, &size))
+		return NULL;
+
+	filename = get_cache_file_filename (cache_name, uri);
+	file = g_mapped_file_new (filename, FALSE, NULL);
+	g_free (filename);
+	if (!file)
+		return NULL;
+
+	contents = g_mapped_file_get_contents (file);
+	length = g_mapped_file_get_length (file);
+	header = (const CacheFileHeader *) contents;
+	uri_length = strlen (uri);
+
+	if (length < sizeof (CacheFileHeader) ||
+	    memcmp (header->magic, magic, sizeof (header->magic)) != 0 ||
+	    GUINT32_FROM_LE (header->version) != version ||
+	    GUINT64_FROM_LE (header->mtime) != mtime ||
+	    GUINT64_FROM_LE (header->size) != size ||
+	    GUINT32_FROM_LE (header->uri_length) != uri_length ||
+	    get_cache_file_data_offset (uri_length) > length ||
+	    memcmp (contents + sizeof (CacheFileHeader), uri, uri_length) != 0) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	*data_offset = get_cache_file_data_offset (uri_length);
+
+	return file;
+}
+
+/**
+ * ev_cache_file_new_data:
+ * @magic: the 8 bytes identifying the files of the cache
+ * @version: the version of the file format
+ * @uri: the URI of a document
+ * @mtime: the modification time from ev_cache_file_get_stamp()
+ * @size: the size from ev_cache_file_get_stamp()
+ *
+ * Starts the contents of a cache file for @uri. The data appended
+ * to the returned array is found by ev_cache_file_open() at the
+ * offset of the array length when this returns.
+ *
+ * Returns: (transfer full): a new #GByteArray with the file header
+ *
+ * Since: 3.28
+ */
+GByteArray *
+ev_cache_file_new_data (const gchar *magic,
+			guint32      version,
+			const gchar *uri,
+			guint64      mtime,
+			guint64      size)
+{
+	CacheFileHeader header;
+	GByteArray     *data;
+	guint32         uri_length;
+
+	g_return_val_if_fail (magic != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	uri_length = strlen (uri);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, magic, sizeof (header.magic));
+	header.version = GUINT32_TO_LE (version);
+	header.uri_length = GUINT32_TO_LE (uri_length);
+	header.mtime = GUINT64_TO_LE (mtime);
+	header.size = GUINT64_TO_LE (size);
+
+	data = g_byte_array_new ();
+	g_byte_array_append (data, (guint8 *) &header, sizeof (header));
+	g_byte_array_append (data, (guint8 *) uri, uri_length);
+	g_byte_array_set_size (data, get_cache_file_data_offset (uri_length));
+	memset (data->data + sizeof (header) + uri_length, 0,
+		data->len - sizeof (header) - uri_length);
+
+	return data;
+}
+
+typedef struct {
+	gchar  *filename;
+	time_t  mtime;
+} CacheFile;
+
+static gint
+compare_cache_files (gconstpointer a,
+		     gconstpointer b)
+{
+	const CacheFile *file_a = a;
+	const CacheFile *file_b = b;
+
+	return file_a->mtime < file_b->mtime ? 1 : file_a->mtime > file_b->mtime ? -1 : 0;
+}
+
+/* Removes the files of the least recently saved documents */
+static void
+prune_cache_files (const gchar *cache_name,
+		   guint        max_files)
+{
+	gchar       *dirname;
+	GDir        *dir;
+	const gchar *name;
+	GArray      *files;
+	guint        i;
+
+	dirname = get_cache_file_dir (cache_name);
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir) {
+		g_free (dirname);
+		return;
+	}
+
+	files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+	while ((name = g_dir_read_name (dir))) {
+		CacheFile file;
+		GStatBuf  buf;
+
+		if (!g_str_has_suffix (name, CACHE_FILE_SUFFIX))
+			continue;
+
+		file.filename = g_build_filename (dirname, name, NULL);
+		if (g_stat (file.filename, &buf) != 0) {
+			g_free (file.filename);
+			continue;
+		}
+		file.mtime = buf.st_mtime;
+		g_array_append_val (files, file);
+	}
+	g_dir_close (dir);
+	g_free (dirname);
+
+	g_array_sort (files, compare_cache_files);
+	for (i = 0; i < files->len; i++) {
+		CacheFile *file = &g_array_index (files, CacheFile, i);
+
+		if (i >= max_files)
+			g_unlink (file->filename);
+		g_free (file->filename);
+	}
+	g_array_free (files, TRUE);
+}
+
+/**
+ * ev_cache_file_save:
+ * @cache_name: the name of the cache
+ * @uri: the URI of a document
+ * @data: the contents started by ev_cache_file_new_data()
+ * @max_files: the number of documents the cache keeps files for
+ *
+ * Replaces the file @cache_name keeps for @uri, so that files still
+ * mapped stay valid, and removes the files of the least recently saved
+ * documents past @max_files. This does I/O, it is meant to be called
+ * from a thread.
+ *
+ * Returns: %TRUE on success, or %FALSE if the file couldn't be written
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_cache_file_save (const gchar *cache_name,
+		    const gchar *uri,
+		    GByteArray  *data,
+		    guint        max_files)
+{
+	gchar   *filename;
+	gchar   *dirname;
+	gboolean retval;
+
+	g_return_val_if_fail (cache_name != NULL, FALSE);
+	g_return_val_if_fail (uri != NULL, FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	filename = get_cache_file_filename (cache_name, uri);
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+	retval = g_file_set_contents (filename, (gchar *) data->data, data->len, NULL);
+	g_free (dirname);
+	g_free (filename);
+
+	if (retval)
+		prune_cache_files (cache_name, max_files);
+
+	return retval;
+}
@@ -69,6 +69,24 @@ gchar       *ev_file_compress         (const gchar       *uri,
 				       EvCompressionType  type,
 				       GError           **error);
 
+gboolean     ev_cache_file_get_stamp  (const gchar       *uri,
+				       guint64           *mtime,
+				       guint64           *size);
+GMappedFile *ev_cache_file_open       (const gchar       *cache_name,
+				       const gchar       *magic,
+				       guint32            version,
+				       const gchar       *uri,
+				       gsize             *data_offset);
+GByteArray  *ev_cache_file_new_data   (const gchar       *magic,
+				       guint32            version,
+				       const gchar       *uri,
+				       guint64            mtime,
+				       guint64            size);
+gboolean     ev_cache_file_save       (const gchar       *cache_name,
+				       const gchar       *uri,
+				       GByteArray        *data,
+				       guint              max_files);
+
 
 G_END_DECLS
 
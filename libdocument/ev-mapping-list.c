@@ -20,6 +20,35 @@
 
 #include "ev-mapping-list.h"
 
+/* Lists shorter than this are searched linearly */
+#define INDEX_MIN_LENGTH 16
+
+typedef struct {
+	EvRectangle area;
+	gdouble     size;
+	EvMapping  *mapping;
+} IndexEntry;
+
+/* A uniform grid over the bounding box of all the mappings. Every cell
+ * lists the entries overlapping it, in list order; entries overlapping
+ * too many cells are kept apart and checked for every point instead.
+ */
+typedef struct {
+	IndexEntry *entries;
+	guint       n_entries;
+
+	EvRectangle bounds;
+	guint       n_columns;
+	guint       n_rows;
+	gdouble     cell_width;
+	gdouble     cell_height;
+	guint      *cell_offsets;
+	guint      *cell_entries;
+
+	guint      *large_entries;
+	guint       n_large_entries;
+} MappingIndex;
+
 /**
  * SECTION: ev-mapping-list
  * @short_description: a refcounted list of #EvMappings.
@@ -31,6 +60,7 @@ struct _EvMappingList {
 	GList         *list;
 	GDestroyNotify data_destroy_func;
 	volatile gint  ref_count;
+	MappingIndex  *index;
 };
 
 G_DEFINE_BOXED_TYPE (EvMappingList, ev_mapping_list, ev_mapping_list_ref, ev_mapping_list_unref)
@@ -106,6 +136,188 @@ get_mapping_area_size (EvMapping *mapping)
 	       (mapping->area.y2 - mapping->area.y1);
 }
 
+static void
+mapping_index_free (MappingIndex *index)
+{
+	if (!index)
+		return;
+
+	g_free (index->entries);
+	g_free (index->cell_offsets);
+	g_free (index->cell_entries);
+	g_free (index->large_entries);
+	g_free (index);
+}
+
+static guint
+mapping_index_get_column (MappingIndex *index,
+			  gdouble       x)
+{
+	gdouble column = (x - index->bounds.x1) / index->cell_width;
+
+	return column > 0 ? MIN ((guint) column, index->n_columns - 1) : 0;
+}
+
+static guint
+mapping_index_get_row (MappingIndex *index,
+		       gdouble       y)
+{
+	gdouble row = (y - index->bounds.y1) / index->cell_height;
+
+	return row > 0 ? MIN ((guint) row, index->n_rows - 1) : 0;
+}
+
+static gboolean
+index_entry_is_large (MappingIndex *index,
+		      IndexEntry   *entry)
+{
+	guint n_columns, n_rows;
+
+	n_columns = mapping_index_get_column (index, entry->area.x2) -
+		mapping_index_get_column (index, entry->area.x1) + 1;
+	n_rows = mapping_index_get_row (index, entry->area.y2) -
+		mapping_index_get_row (index, entry->area.y1) + 1;
+
+	return n_columns * n_rows > MAX (index->n_columns * index->n_rows / 4, 1);
+}
+
+static MappingIndex *
+mapping_index_new (GList *list)
+{
+	MappingIndex *index;
+	GList        *l;
+	guint         n_cells, i, column, row;
+	guint        *cell_fill;
+
+	index = g_new0 (MappingIndex, 1);
+	index->n_entries = g_list_length (list);
+	index->entries = g_new (IndexEntry, index->n_entries);
+
+	for (l = list, i = 0; l; l = l->next, i++) {
+		EvMapping  *mapping = l->data;
+		IndexEntry *entry = &index->entries[i];
+
+		entry->area = mapping->area;
+		entry->size = get_mapping_area_size (mapping);
+		entry->mapping = mapping;
+
+		if (i == 0) {
+			index->bounds = entry->area;
+		} else {
+			index->bounds.x1 = MIN (index->bounds.x1, entry->area.x1);
+			index->bounds.y1 = MIN (index->bounds.y1, entry->area.y1);
+			index->bounds.x2 = MAX (index->bounds.x2, entry->area.x2);
+			index->bounds.y2 = MAX (index->bounds.y2, entry->area.y2);
+		}
+	}
+
+	/* About one cell per entry */
+	index->n_columns = 1;
+	while (index->n_columns * index->n_columns < index->n_entries)
+		index->n_columns++;
+	index->n_rows = index->n_columns;
+	n_cells = index->n_columns * index->n_rows;
+	index->cell_width = (index->bounds.x2 - index->bounds.x1) / index->n_columns;
+	index->cell_height = (index->bounds.y2 - index->bounds.y1) / index->n_rows;
+	if (!(index->cell_width > 0))
+		index->cell_width = 1;
+	if (!(index->cell_height > 0))
+		index->cell_height = 1;
+
+	/* Count the entries of every cell, then fill them in list order */
+	index->cell_offsets = g_new0 (guint, n_cells + 1);
+	index->large_entries = g_new (guint, index->n_entries);
+	for (i = 0; i < index->n_entries; i++) {
+		IndexEntry *entry = &index->entries[i];
+
+		if (index_entry_is_large (index, entry)) {
+			index->large_entries[index->n_large_entries++] = i;
+			continue;
+		}
+
+		for (row = mapping_index_get_row (index, entry->area.y1);
+		     row <= mapping_index_get_row (index, entry->area.y2); row++) {
+			for (column = mapping_index_get_column (index, entry->area.x1);
+			     column <= mapping_index_get_column (index, entry->area.x2); column++)
+				index->cell_offsets[row * index->n_columns + column + 1]++;
+		}
+	}
+
+	for (i = 0; i < n_cells; i++)
+		index->cell_offsets[i + 1] += index->cell_offsets[i];
+
+	index->cell_entries = g_new (guint, MAX (index->cell_offsets[n_cells], 1));
+	cell_fill = g_memdup (index->cell_offsets, n_cells * sizeof (guint));
+	for (i = 0; i < index->n_entries; i++) {
+		IndexEntry *entry = &index->entries[i];
+
+		if (index_entry_is_large (index, entry))
+			continue;
+
+		for (row = mapping_index_get_row (index, entry->area.y1);
+		     row <= mapping_index_get_row (index, entry->area.y2); row++) {
+			for (column = mapping_index_get_column (index, entry->area.x1);
+			     column <= mapping_index_get_column (index, entry->area.x2); column++)
+				index->cell_entries[cell_fill[row * index->n_columns + column]++] = i;
+		}
+	}
+	g_free (cell_fill);
+
+	return index;
+}
+
+/* Keeps the smallest entry containing (x, y), the first one in the
+ * list if several are as small, as the linear search does */
+static void
+mapping_index_check_entry (MappingIndex *index,
+			   guint         i,
+			   gdouble       x,
+			   gdouble       y,
+			   gint         *found)
+{
+	IndexEntry *entry = &index->entries[i];
+
+	if (x < entry->area.x1 || y < entry->area.y1 ||
+	    x > entry->area.x2 || y > entry->area.y2)
+		return;
+
+	if (*found < 0 || entry->size < index->entries[*found].size ||
+	    (entry->size == index->entries[*found].size && (gint) i < *found))
+		*found = i;
+}
+
+static EvMapping *
+mapping_index_get (MappingIndex *index,
+		   gdouble       x,
+		   gdouble       y)
+{
+	guint cell, i;
+	gint  found = -1;
+
+	if (x < index->bounds.x1 || y < index->bounds.y1 ||
+	    x > index->bounds.x2 || y > index->bounds.y2)
+		return NULL;
+
+	cell = mapping_index_get_row (index, y) * index->n_columns +
+		mapping_index_get_column (index, x);
+	for (i = index->cell_offsets[cell]; i < index->cell_offsets[cell + 1]; i++)
+		mapping_index_check_entry (index, index->cell_entries[i], x, y, &found);
+	for (i = 0; i < index->n_large_entries; i++)
+		mapping_index_check_entry (index, index->large_entries[i], x, y, &found);
+
+	return found >= 0 ? index->entries[found].mapping : NULL;
+}
+
+static void
+ev_mapping_list_update_index (EvMappingList *mapping_list)
+{
+	mapping_index_free (mapping_list->index);
+	mapping_list->index = NULL;
+
+	if (g_list_length (mapping_list->list) >= INDEX_MIN_LENGTH)
+		mapping_list->index = mapping_index_new (mapping_list->list);
+}
+
 /**
  * ev_mapping_list_get:
  * @mapping_list: an #EvMappingList
@@ -125,7 +337,10 @@ ev_mapping_list_get (EvMappingList *mapping_list,
 	EvMapping *found = NULL;
 
 	g_return_val_if_fail (mapping_list != NULL, NULL);
-	
+
+	if (mapping_list->index)
+		return mapping_index_get (mapping_list->index, x, y);
+
 	for (list = mapping_list->list; list; list = list->next) {
 		EvMapping *mapping = list->data;
 
@@ -195,6 +410,52 @@ ev_mapping_list_remove (EvMappingList *mapping_list,
 	mapping_list->list = g_list_remove (mapping_list->list, mapping);
         mapping_list->data_destroy_func (mapping->data);
         g_free (mapping);
+	ev_mapping_list_update_index (mapping_list);
+}
+
+/**
+ * ev_mapping_list_append:
+ * @mapping_list: an #EvMappingList
+ * @mapping: (transfer full): #EvMapping to add
+ *
+ * Adds @mapping at the end of @mapping_list, which frees it along
+ * with its data.
+ *
+ * Since: 3.28
+ */
+void
+ev_mapping_list_append (EvMappingList *mapping_list,
+			EvMapping     *mapping)
+{
+	g_return_if_fail (mapping_list != NULL);
+	g_return_if_fail (mapping != NULL);
+
+	mapping_list->list = g_list_append (mapping_list->list, mapping);
+	ev_mapping_list_update_index (mapping_list);
+}
+
+/**
+ * ev_mapping_list_update_area:
+ * @mapping_list: an #EvMappingList
+ * @mapping: an #EvMapping in @mapping_list
+ * @area: the new area of @mapping
+ *
+ * Changes the area of @mapping. The area of a mapping in a list must
+ * be changed this way, so that ev_mapping_list_get() finds it there.
+ *
+ * Since: 3.28
+ */
+void
+ev_mapping_list_update_area (EvMappingList *mapping_list,
+			     EvMapping     *mapping,
+			     EvRectangle   *area)
+{
+	g_return_if_fail (mapping_list != NULL);
+	g_return_if_fail (mapping != NULL);
+	g_return_if_fail (area != NULL);
+
+	mapping->area = *area;
+	ev_mapping_list_update_index (mapping_list);
 }
 
 guint
@@ -233,6 +494,9 @@ ev_mapping_list_new (guint          page,
 	mapping_list->list = list;
 	mapping_list->data_destroy_func = data_destroy_func;
 	mapping_list->ref_count = 1;
+	/* Built here, so usually in the thread that got the mappings */
+	mapping_list->index = NULL;
+	ev_mapping_list_update_index (mapping_list);
 
 	return mapping_list;
 }
@@ -267,6 +531,7 @@ ev_mapping_list_unref (EvMappingList *mapping_list)
 				(GFunc)mapping_list_free_foreach,
 				mapping_list->data_destroy_func);
 		g_list_free (mapping_list->list);
+		mapping_index_free (mapping_list->index);
 		g_slice_free (EvMappingList, mapping_list);
 	}
 }
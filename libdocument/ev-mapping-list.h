@@ -44,6 +44,11 @@ guint          ev_mapping_list_get_page    (EvMappingList *mapping_list);
 GList         *ev_mapping_list_get_list    (EvMappingList *mapping_list);
 void           ev_mapping_list_remove      (EvMappingList *mapping_list,
 					    EvMapping     *mapping);
+void           ev_mapping_list_append      (EvMappingList *mapping_list,
+					    EvMapping     *mapping);
+void           ev_mapping_list_update_area (EvMappingList *mapping_list,
+					    EvMapping     *mapping,
+					    EvRectangle   *area);
 EvMapping     *ev_mapping_list_find        (EvMappingList *mapping_list,
 					    gconstpointer  data);
 EvMapping     *ev_mapping_list_find_custom (EvMappingList *mapping_list,
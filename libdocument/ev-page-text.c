@@ -0,0 +1,369 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "ev-page-text.h"
+#include "ev-document-text.h"
+
+/**
+ * SECTION: ev-page-text
+ * @short_description: the shared text model of a page
+ *
+ * An #EvPageText holds the text of a page, the layout rectangle of every
+ * character and the pango log attributes of the text. There is one per
+ * page and document: the text is extracted from the backend the first
+ * time the page is asked for, and the log attributes are computed the
+ * first time they are asked for. The document keeps the most recently
+ * used pages, the others are extracted again when asked for. Every user
+ * of the text of a page, the page cache of the views, the find sidebar
+ * or the accessibility objects, gets the same #EvPageText.
+ *
+ * Since: 3.28
+ */
+struct _EvPageText {
+	gint           page;
+	gchar         *text;
+	EvRectangle   *layout;
+	guint          layout_length;
+	PangoLogAttr  *log_attrs;
+	gulong         log_attrs_length;
+	volatile gint  ref_count;
+};
+
+typedef struct {
+	GMutex       mutex;
+	GCond        cond;
+	EvPageText **pages;
+	GList      **links;   /* Link of every cached page in lru */
+	gboolean    *extracting;
+	gint         n_pages;
+	GQueue       lru;
+	gsize        size;
+} EvPageTextCache;
+
+#define EV_PAGE_TEXT_CACHE_KEY "ev-page-text-cache"
+
+/* The cached pages of a document, except the one just asked for */
+#define PAGE_TEXT_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+G_LOCK_DEFINE_STATIC (page_text_cache);
+
+G_DEFINE_BOXED_TYPE (EvPageText, ev_page_text, ev_page_text_ref, ev_page_text_unref)
+
+static void
+ev_page_text_cache_free (EvPageTextCache *cache)
+{
+	gint i;
+
+	for (i = 0; i < cache->n_pages; i++) {
+		if (cache->pages[i])
+			ev_page_text_unref (cache->pages[i]);
+	}
+	g_free (cache->pages);
+	g_free (cache->links);
+	g_free (cache->extracting);
+	g_queue_clear (&cache->lru);
+	g_mutex_clear (&cache->mutex);
+	g_cond_clear (&cache->cond);
+	g_free (cache);
+}
+
+static EvPageTextCache *
+ev_page_text_cache_get (EvDocument *document)
+{
+	EvPageTextCache *cache;
+
+	G_LOCK (page_text_cache);
+	cache = g_object_get_data (G_OBJECT (document), EV_PAGE_TEXT_CACHE_KEY);
+	if (!cache) {
+		cache = g_new0 (EvPageTextCache, 1);
+		g_mutex_init (&cache->mutex);
+		g_cond_init (&cache->cond);
+		cache->n_pages = ev_document_get_n_pages (document);
+		cache->pages = g_new0 (EvPageText *, cache->n_pages);
+		cache->links = g_new0 (GList *, cache->n_pages);
+		cache->extracting = g_new0 (gboolean, cache->n_pages);
+		g_queue_init (&cache->lru);
+		g_object_set_data_full (G_OBJECT (document),
+					EV_PAGE_TEXT_CACHE_KEY,
+					cache,
+					(GDestroyNotify)ev_page_text_cache_free);
+	}
+	G_UNLOCK (page_text_cache);
+
+	return cache;
+}
+
+static EvPageText *
+ev_page_text_extract (EvDocument *document,
+		      gint        page)
+{
+	EvDocumentText *document_text = EV_DOCUMENT_TEXT (document);
+	EvPageText     *page_text;
+	EvPage         *ev_page;
+
+	page_text = g_slice_new0 (EvPageText);
+	page_text->page = page;
+	page_text->ref_count = 1;
+
+	ev_document_render_lock (document);
+	ev_page = ev_document_get_page (document, page);
+	page_text->text = ev_document_text_get_text (document_text, ev_page);
+	if (!ev_document_text_get_text_layout (document_text, ev_page,
+					       &page_text->layout,
+					       &page_text->layout_length)) {
+		page_text->layout = NULL;
+		page_text->layout_length = 0;
+	}
+	g_object_unref (ev_page);
+	ev_document_render_unlock (document);
+
+	if (page_text->text)
+		page_text->log_attrs_length = g_utf8_strlen (page_text->text, -1);
+
+	return page_text;
+}
+
+/* Counts the log attributes, computed or not */
+static gsize
+ev_page_text_get_size (EvPageText *page_text)
+{
+	gsize size = sizeof (EvPageText);
+
+	if (page_text->text) {
+		size += strlen (page_text->text) + 1;
+		size += (page_text->log_attrs_length + 1) * sizeof (PangoLogAttr);
+	}
+	size += page_text->layout_length * sizeof (EvRectangle);
+
+	return size;
+}
+
+/* Adds @page_text to @cache, dropping the least recently used pages
+ * over the size limit. Must be called with the cache mutex held.
+ */
+static void
+ev_page_text_cache_add (EvPageTextCache *cache,
+			EvPageText      *page_text)
+{
+	cache->pages[page_text->page] = page_text;
+	g_queue_push_head (&cache->lru, GINT_TO_POINTER (page_text->page));
+	cache->links[page_text->page] = cache->lru.head;
+	cache->size += ev_page_text_get_size (page_text);
+
+	while (cache->size > PAGE_TEXT_CACHE_MAX_SIZE && cache->lru.length > 1) {
+		gint        old_page = GPOINTER_TO_INT (g_queue_pop_tail (&cache->lru));
+		EvPageText *old_page_text = cache->pages[old_page];
+
+		cache->size -= ev_page_text_get_size (old_page_text);
+		cache->pages[old_page] = NULL;
+		cache->links[old_page] = NULL;
+		ev_page_text_unref (old_page_text);
+	}
+}
+
+/* Marks @page as the most recently used one. Must be called with the
+ * cache mutex held.
+ */
+static void
+ev_page_text_cache_touch (EvPageTextCache *cache,
+			  gint             page)
+{
+	GList *link = cache->links[page];
+
+	if (link && link != cache->lru.head) {
+		g_queue_unlink (&cache->lru, link);
+		g_queue_push_head_link (&cache->lru, link);
+	}
+}
+
+/**
+ * ev_page_text_get:
+ * @document: an #EvDocument implementing #EvDocumentText
+ * @page: the page index
+ *
+ * Returns the text model of @page, extracting it from the backend if this
+ * is the first time it is asked for, or if it was dropped from the cache
+ * since. The render lock of the document is taken for the extraction, so
+ * it must not be held by the caller. When another thread is extracting
+ * the same page, this waits for it instead of extracting the page again.
+ *
+ * Returns: (transfer full): the #EvPageText of @page, or %NULL when
+ *     @document has no text
+ *
+ * Since: 3.28
+ */
+EvPageText *
+ev_page_text_get (EvDocument *document,
+		  gint        page)
+{
+	EvPageTextCache *cache;
+	EvPageText      *page_text;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+
+	if (!EV_IS_DOCUMENT_TEXT (document))
+		return NULL;
+
+	cache = ev_page_text_cache_get (document);
+	g_return_val_if_fail (page >= 0 && page < cache->n_pages, NULL);
+
+	g_mutex_lock (&cache->mutex);
+	while (cache->extracting[page])
+		g_cond_wait (&cache->cond, &cache->mutex);
+
+	if (cache->pages[page]) {
+		page_text = ev_page_text_ref (cache->pages[page]);
+		ev_page_text_cache_touch (cache, page);
+	} else {
+		cache->extracting[page] = TRUE;
+		g_mutex_unlock (&cache->mutex);
+
+		page_text = ev_page_text_extract (document, page);
+
+		g_mutex_lock (&cache->mutex);
+		ev_page_text_cache_add (cache, ev_page_text_ref (page_text));
+		cache->extracting[page] = FALSE;
+		g_cond_broadcast (&cache->cond);
+	}
+	g_mutex_unlock (&cache->mutex);
+
+	return page_text;
+}
+
+EvPageText *
+ev_page_text_ref (EvPageText *page_text)
+{
+	g_return_val_if_fail (page_text != NULL, NULL);
+	g_return_val_if_fail (page_text->ref_count > 0, page_text);
+
+	g_atomic_int_add (&page_text->ref_count, 1);
+
+	return page_text;
+}
+
+void
+ev_page_text_unref (EvPageText *page_text)
+{
+	g_return_if_fail (page_text != NULL);
+	g_return_if_fail (page_text->ref_count > 0);
+
+	if (g_atomic_int_add (&page_text->ref_count, -1) - 1 == 0) {
+		g_free (page_text->text);
+		g_free (page_text->layout);
+		g_free (page_text->log_attrs);
+		g_slice_free (EvPageText, page_text);
+	}
+}
+
+/**
+ * ev_page_text_get_page:
+ * @page_text: an #EvPageText
+ *
+ * Returns: the index of the page of @page_text
+ *
+ * Since: 3.28
+ */
+gint
+ev_page_text_get_page (EvPageText *page_text)
+{
+	g_return_val_if_fail (page_text != NULL, -1);
+
+	return page_text->page;
+}
+
+/**
+ * ev_page_text_get_text:
+ * @page_text: an #EvPageText
+ *
+ * Returns: (transfer none): the text of the page, or %NULL
+ */
+const gchar *
+ev_page_text_get_text (EvPageText *page_text)
+{
+	g_return_val_if_fail (page_text != NULL, NULL);
+
+	return page_text->text;
+}
+
+/**
+ * ev_page_text_get_layout:
+ * @page_text: an #EvPageText
+ * @areas: (out) (transfer none) (array length=n_areas): return location
+ *     for the area of every character of the text
+ * @n_areas: (out): return location for the length of @areas
+ *
+ * Returns: %TRUE if the backend gave a layout for the page, %FALSE otherwise
+ */
+gboolean
+ev_page_text_get_layout (EvPageText   *page_text,
+			 EvRectangle **areas,
+			 guint        *n_areas)
+{
+	g_return_val_if_fail (page_text != NULL, FALSE);
+
+	*areas = page_text->layout;
+	*n_areas = page_text->layout_length;
+
+	return page_text->layout != NULL;
+}
+
+/**
+ * ev_page_text_get_log_attrs:
+ * @page_text: an #EvPageText
+ * @log_attrs: (out) (transfer none) (array length=n_attrs): return location
+ *     for the log attributes of the text
+ * @n_attrs: (out): return location for the number of characters of the text
+ *
+ * The attributes are computed with pango_get_log_attrs() the first time
+ * they are asked for. @log_attrs has @n_attrs + 1 elements.
+ *
+ * Returns: %TRUE if the page has text, %FALSE otherwise
+ */
+gboolean
+ev_page_text_get_log_attrs (EvPageText    *page_text,
+			    PangoLogAttr **log_attrs,
+			    gulong        *n_attrs)
+{
+	g_return_val_if_fail (page_text != NULL, FALSE);
+
+	if (!page_text->text) {
+		*log_attrs = NULL;
+		*n_attrs = 0;
+
+		return FALSE;
+	}
+
+	/* Only the threads asking for the same page wait for each other */
+	if (g_once_init_enter (&page_text->log_attrs)) {
+		PangoLogAttr *attrs;
+
+		attrs = g_new0 (PangoLogAttr, page_text->log_attrs_length + 1);
+
+		/* FIXME: We need API to get the language of the document */
+		pango_get_log_attrs (page_text->text, -1, -1, NULL,
+				     attrs, page_text->log_attrs_length + 1);
+		g_once_init_leave (&page_text->log_attrs, attrs);
+	}
+	*log_attrs = page_text->log_attrs;
+	*n_attrs = page_text->log_attrs_length;
+
+	return TRUE;
+}
@@ -0,0 +1,741 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "ev-pixel-kernels.h"
+
+/* The vector kernels handle pixels as bytes, so they assume the
+ * little endian layout of cairo pixels: B, G, R, A.
+ */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__ ((target ("sse2")))
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+#endif
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define HAVE_NEON_KERNELS 1
+#include <arm_neon.h>
+#endif
+#endif
+
+typedef struct {
+	void (* rgba_to_argb32) (const guchar  *src,
+				 guint32       *dest,
+				 gsize          n_pixels);
+	void (* rgb_to_rgb24)   (const guchar  *src,
+				 guint32       *dest,
+				 gsize          n_pixels);
+	void (* argb32_to_rgba) (const guint32 *src,
+				 guchar        *dest,
+				 gsize          n_pixels);
+	void (* rgb24_to_rgb)   (const guint32 *src,
+				 guchar        *dest,
+				 gsize          n_pixels);
+	void (* invert_rgb)     (guchar        *pixels,
+				 gsize          n_bytes,
+				 guint          n_channels);
+} EvPixelKernels;
+
+static const gchar *isa_names[EV_PIXEL_KERNELS_N_ISAS] = {
+	"scalar", "sse2", "avx2", "neon"
+};
+
+/* Same rounding as gdk_cairo_set_source_pixbuf() */
+#define MULT(d,c,a,t) G_STMT_START { t = (c) * (a) + 0x80; d = ((t >> 8) + t) >> 8; } G_STMT_END
+
+/* Scalar kernels, also used for the leftover pixels of the others */
+static void
+rgba_to_argb32_scalar (const guchar *src,
+		       guint32      *dest,
+		       gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 4) {
+		guint a = src[3];
+		guint r, g, b, t;
+
+		if (a == 0xff) {
+			dest[i] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+		} else if (a == 0) {
+			dest[i] = 0;
+		} else {
+			MULT (r, src[0], a, t);
+			MULT (g, src[1], a, t);
+			MULT (b, src[2], a, t);
+			dest[i] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+}
+
+static void
+rgb_to_rgb24_scalar (const guchar *src,
+		     guint32      *dest,
+		     gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, src += 3)
+		dest[i] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+}
+
+/* Same rounding as gdk_pixbuf_get_from_surface() */
+static void
+argb32_to_rgba_scalar (const guint32 *src,
+		       guchar        *dest,
+		       gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, dest += 4) {
+		guint a = src[i] >> 24;
+
+		if (a == 0) {
+			dest[0] = dest[1] = dest[2] = dest[3] = 0;
+		} else if (a == 0xff) {
+			dest[0] = src[i] >> 16;
+			dest[1] = src[i] >> 8;
+			dest[2] = src[i];
+			dest[3] = 0xff;
+		} else {
+			dest[0] = (((src[i] >> 16) & 0xff) * 255 + a / 2) / a;
+			dest[1] = (((src[i] >> 8) & 0xff) * 255 + a / 2) / a;
+			dest[2] = ((src[i] & 0xff) * 255 + a / 2) / a;
+			dest[3] = a;
+		}
+	}
+}
+
+static void
+rgb24_to_rgb_scalar (const guint32 *src,
+		     guchar        *dest,
+		     gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i < n_pixels; i++, dest += 3) {
+		dest[0] = src[i] >> 16;
+		dest[1] = src[i] >> 8;
+		dest[2] = src[i];
+	}
+}
+
+static void
+invert_rgb_scalar (guchar *pixels,
+		   gsize   n_bytes,
+		   guint   n_channels)
+{
+	gsize i;
+
+	/* The vector kernels stop on a pixel boundary for RGBA, and
+	 * invert every byte for RGB
+	 */
+	for (i = 0; i < n_bytes; i++) {
+		if (n_channels != 4 || i % 4 != 3)
+			pixels[i] ^= 0xff;
+	}
+}
+
+static const EvPixelKernels kernels_scalar = {
+	rgba_to_argb32_scalar,
+	rgb_to_rgb24_scalar,
+	argb32_to_rgba_scalar,
+	rgb24_to_rgb_scalar,
+	invert_rgb_scalar
+};
+
+#ifdef HAVE_X86_KERNELS
+/* Premultiplies the 16 bit RGBA pixels in @c and swaps R and B */
+static inline TARGET_SSE2 __m128i
+premultiply_swizzle_sse2 (__m128i c)
+{
+	const __m128i alpha_mask = _mm_set_epi16 (-1, 0, 0, 0, -1, 0, 0, 0);
+	const __m128i alpha_255 = _mm_set_epi16 (0xff, 0, 0, 0, 0xff, 0, 0, 0);
+	__m128i       a, t;
+
+	/* Alpha in all channels, but 255 in its own to leave it as is */
+	a = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (c, _MM_SHUFFLE (3, 3, 3, 3)),
+				 _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, a), alpha_255);
+
+	t = _mm_add_epi16 (_mm_mullo_epi16 (c, a), _mm_set1_epi16 (0x80));
+	t = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+
+	return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2)),
+				    _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+static TARGET_SSE2 void
+rgba_to_argb32_sse2 (const guchar *src,
+		     guint32      *dest,
+		     gsize         n_pixels)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	gsize         i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+		__m128i lo = premultiply_swizzle_sse2 (_mm_unpacklo_epi8 (p, zero));
+		__m128i hi = premultiply_swizzle_sse2 (_mm_unpackhi_epi8 (p, zero));
+
+		_mm_storeu_si128 ((__m128i *) (dest + i), _mm_packus_epi16 (lo, hi));
+	}
+
+	rgba_to_argb32_scalar (src + i * 4, dest + i, n_pixels - i);
+}
+
+/* Unpremultiplies one channel of the pixels in @p, truncating the
+ * quotients as argb32_to_rgba_scalar() does. Dividing n + 1/2 instead
+ * of n keeps the exact quotient 1/2a away from integers, further than
+ * the rounding error of the reciprocal and the product.
+ */
+static inline TARGET_SSE2 __m128i
+unpremultiply_sse2 (__m128i p,
+		    gint    shift,
+		    __m128  half_alpha,
+		    __m128  reciprocal)
+{
+	__m128i c = _mm_and_si128 (_mm_srli_epi32 (p, shift), _mm_set1_epi32 (0xff));
+	__m128  n;
+
+	n = _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (c), _mm_set1_ps (255.f)), half_alpha);
+
+	return _mm_and_si128 (_mm_cvttps_epi32 (_mm_mul_ps (n, reciprocal)),
+			      _mm_set1_epi32 (0xff));
+}
+
+static inline TARGET_SSE2 __m128i
+argb32_to_rgba_4_sse2 (__m128i p)
+{
+	const __m128i alpha = _mm_set1_epi32 ((gint) 0xff000000);
+	const __m128i rb_mask = _mm_set1_epi32 (0x00ff00ff);
+	__m128i       a, rgba;
+	__m128        half_alpha, reciprocal;
+
+	if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (_mm_and_si128 (p, alpha), alpha)) == 0xffff) {
+		/* Opaque pixels only need R and B swapped */
+		return _mm_or_si128 (_mm_andnot_si128 (rb_mask, p),
+				     _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 (p, 16), _mm_set1_epi32 (0xff)),
+						   _mm_and_si128 (_mm_slli_epi32 (p, 16), _mm_set1_epi32 (0xff0000))));
+	}
+
+	a = _mm_srli_epi32 (p, 24);
+	half_alpha = _mm_add_ps (_mm_cvtepi32_ps (_mm_srli_epi32 (a, 1)), _mm_set1_ps (0.5f));
+	reciprocal = _mm_div_ps (_mm_set1_ps (1.f), _mm_cvtepi32_ps (a));
+
+	rgba = _mm_or_si128 (unpremultiply_sse2 (p, 16, half_alpha, reciprocal),
+			     _mm_slli_epi32 (unpremultiply_sse2 (p, 8, half_alpha, reciprocal), 8));
+	rgba = _mm_or_si128 (rgba, _mm_slli_epi32 (unpremultiply_sse2 (p, 0, half_alpha, reciprocal), 16));
+
+	/* Transparent pixels are all zero */
+	rgba = _mm_andnot_si128 (_mm_cmpeq_epi32 (a, _mm_setzero_si128 ()), rgba);
+
+	return _mm_or_si128 (rgba, _mm_and_si128 (p, alpha));
+}
+
+static TARGET_SSE2 void
+argb32_to_rgba_sse2 (const guint32 *src,
+		     guchar        *dest,
+		     gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 4 <= n_pixels; i += 4) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+		_mm_storeu_si128 ((__m128i *) (dest + i * 4), argb32_to_rgba_4_sse2 (p));
+	}
+
+	argb32_to_rgba_scalar (src + i, dest + i * 4, n_pixels - i);
+}
+
+static TARGET_SSE2 void
+invert_rgb_sse2 (guchar *pixels,
+		 gsize   n_bytes,
+		 guint   n_channels)
+{
+	const __m128i mask = n_channels == 4 ?
+		_mm_set1_epi32 (0x00ffffff) : _mm_set1_epi32 (-1);
+	gsize         i;
+
+	for (i = 0; i + 16 <= n_bytes; i += 16) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (pixels + i));
+
+		_mm_storeu_si128 ((__m128i *) (pixels + i), _mm_xor_si128 (p, mask));
+	}
+
+	invert_rgb_scalar (pixels + i, n_bytes - i, n_channels);
+}
+
+static const EvPixelKernels kernels_sse2 = {
+	rgba_to_argb32_sse2,
+	/* Packing 3 byte pixels needs a byte shuffle */
+	rgb_to_rgb24_scalar,
+	argb32_to_rgba_sse2,
+	rgb24_to_rgb_scalar,
+	invert_rgb_sse2
+};
+
+static inline TARGET_AVX2 __m256i
+premultiply_swizzle_avx2 (__m256i c)
+{
+	const __m256i alpha_mask = _mm256_set_epi16 (-1, 0, 0, 0, -1, 0, 0, 0,
+						     -1, 0, 0, 0, -1, 0, 0, 0);
+	const __m256i alpha_255 = _mm256_set_epi16 (0xff, 0, 0, 0, 0xff, 0, 0, 0,
+						    0xff, 0, 0, 0, 0xff, 0, 0, 0);
+	__m256i       a, t;
+
+	a = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (c, _MM_SHUFFLE (3, 3, 3, 3)),
+				    _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm256_or_si256 (_mm256_andnot_si256 (alpha_mask, a), alpha_255);
+
+	t = _mm256_add_epi16 (_mm256_mullo_epi16 (c, a), _mm256_set1_epi16 (0x80));
+	t = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+
+	return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2)),
+				       _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+static TARGET_AVX2 void
+rgba_to_argb32_avx2 (const guchar *src,
+		     guint32      *dest,
+		     gsize         n_pixels)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	gsize         i;
+
+	/* Unpacking and packing stay within 128 bit lanes, so the
+	 * pixels keep their order
+	 */
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i p = _mm256_loadu_si256 ((const __m256i *) (src + i * 4));
+		__m256i lo = premultiply_swizzle_avx2 (_mm256_unpacklo_epi8 (p, zero));
+		__m256i hi = premultiply_swizzle_avx2 (_mm256_unpackhi_epi8 (p, zero));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + i), _mm256_packus_epi16 (lo, hi));
+	}
+
+	rgba_to_argb32_scalar (src + i * 4, dest + i, n_pixels - i);
+}
+
+static TARGET_AVX2 void
+rgb_to_rgb24_avx2 (const guchar *src,
+		   guint32      *dest,
+		   gsize         n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (2, 1, 0, -1, 5, 4, 3, -1,
+						  8, 7, 6, -1, 11, 10, 9, -1,
+						  2, 1, 0, -1, 5, 4, 3, -1,
+						  8, 7, 6, -1, 11, 10, 9, -1);
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	/* Four pixels from each 16 byte load, which reads 4 bytes
+	 * past them: keep 2 pixels from the end of @src
+	 */
+	for (i = 0; i + 10 <= n_pixels; i += 8) {
+		__m128i lo = _mm_loadu_si128 ((const __m128i *) (src + i * 3));
+		__m128i hi = _mm_loadu_si128 ((const __m128i *) (src + i * 3 + 12));
+		__m256i p = _mm256_inserti128_si256 (_mm256_castsi128_si256 (lo), hi, 1);
+
+		p = _mm256_or_si256 (_mm256_shuffle_epi8 (p, shuffle), alpha);
+		_mm256_storeu_si256 ((__m256i *) (dest + i), p);
+	}
+
+	rgb_to_rgb24_scalar (src + i * 3, dest + i, n_pixels - i);
+}
+
+static inline TARGET_AVX2 __m256i
+unpremultiply_avx2 (__m256i p,
+		    gint    shift,
+		    __m256  half_alpha,
+		    __m256  reciprocal)
+{
+	__m256i c = _mm256_and_si256 (_mm256_srli_epi32 (p, shift), _mm256_set1_epi32 (0xff));
+	__m256  n;
+
+	n = _mm256_add_ps (_mm256_mul_ps (_mm256_cvtepi32_ps (c), _mm256_set1_ps (255.f)), half_alpha);
+
+	return _mm256_and_si256 (_mm256_cvttps_epi32 (_mm256_mul_ps (n, reciprocal)),
+				 _mm256_set1_epi32 (0xff));
+}
+
+static TARGET_AVX2 void
+argb32_to_rgba_avx2 (const guint32 *src,
+		     guchar        *dest,
+		     gsize          n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (2, 1, 0, 3, 6, 5, 4, 7,
+						  10, 9, 8, 11, 14, 13, 12, 15,
+						  2, 1, 0, 3, 6, 5, 4, 7,
+						  10, 9, 8, 11, 14, 13, 12, 15);
+	const __m256i alpha = _mm256_set1_epi32 ((gint) 0xff000000);
+	gsize         i;
+
+	for (i = 0; i + 8 <= n_pixels; i += 8) {
+		__m256i p = _mm256_loadu_si256 ((const __m256i *) (src + i));
+		__m256i a, rgba;
+		__m256  half_alpha, reciprocal;
+
+		if (_mm256_movemask_epi8 (_mm256_cmpeq_epi32 (_mm256_and_si256 (p, alpha), alpha)) == -1) {
+			_mm256_storeu_si256 ((__m256i *) (dest + i * 4), _mm256_shuffle_epi8 (p, shuffle));
+			continue;
+		}
+
+		/* As argb32_to_rgba_4_sse2() */
+		a = _mm256_srli_epi32 (p, 24);
+		half_alpha = _mm256_add_ps (_mm256_cvtepi32_ps (_mm256_srli_epi32 (a, 1)),
+					    _mm256_set1_ps (0.5f));
+		reciprocal = _mm256_div_ps (_mm256_set1_ps (1.f), _mm256_cvtepi32_ps (a));
+
+		rgba = _mm256_or_si256 (unpremultiply_avx2 (p, 16, half_alpha, reciprocal),
+					_mm256_slli_epi32 (unpremultiply_avx2 (p, 8, half_alpha, reciprocal), 8));
+		rgba = _mm256_or_si256 (rgba,
+					_mm256_slli_epi32 (unpremultiply_avx2 (p, 0, half_alpha, reciprocal), 16));
+		rgba = _mm256_andnot_si256 (_mm256_cmpeq_epi32 (a, _mm256_setzero_si256 ()), rgba);
+		rgba = _mm256_or_si256 (rgba, _mm256_and_si256 (p, alpha));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + i * 4), rgba);
+	}
+
+	argb32_to_rgba_scalar (src + i, dest + i * 4, n_pixels - i);
+}
+
+static TARGET_AVX2 void
+rgb24_to_rgb_avx2 (const guint32 *src,
+		   guchar        *dest,
+		   gsize          n_pixels)
+{
+	const __m256i shuffle = _mm256_setr_epi8 (2, 1, 0, 6, 5, 4, 10, 9,
+						  8, 14, 13, 12, -1, -1, -1, -1,
+						  2, 1, 0, 6, 5, 4, 10, 9,
+						  8, 14, 13, 12, -1, -1, -1, -1);
+	gsize         i;
+
+	/* Each 16 byte store writes 12 bytes of pixels and 4 bytes that
+	 * the next store, or the next iteration, overwrites: keep 2
+	 * pixels from the end of @dest
+	 */
+	for (i = 0; i + 10 <= n_pixels; i += 8) {
+		__m256i p = _mm256_loadu_si256 ((const __m256i *) (src + i));
+
+		p = _mm256_shuffle_epi8 (p, shuffle);
+		_mm_storeu_si128 ((__m128i *) (dest + i * 3), _mm256_castsi256_si128 (p));
+		_mm_storeu_si128 ((__m128i *) (dest + i * 3 + 12), _mm256_extracti128_si256 (p, 1));
+	}
+
+	rgb24_to_rgb_scalar (src + i, dest + i * 3, n_pixels - i);
+}
+
+static TARGET_AVX2 void
+invert_rgb_avx2 (guchar *pixels,
+		 gsize   n_bytes,
+		 guint   n_channels)
+{
+	const __m256i mask = n_channels == 4 ?
+		_mm256_set1_epi32 (0x00ffffff) : _mm256_set1_epi32 (-1);
+	gsize         i;
+
+	for (i = 0; i + 32 <= n_bytes; i += 32) {
+		__m256i p = _mm256_loadu_si256 ((const __m256i *) (pixels + i));
+
+		_mm256_storeu_si256 ((__m256i *) (pixels + i), _mm256_xor_si256 (p, mask));
+	}
+
+	invert_rgb_scalar (pixels + i, n_bytes - i, n_channels);
+}
+
+static const EvPixelKernels kernels_avx2 = {
+	rgba_to_argb32_avx2,
+	rgb_to_rgb24_avx2,
+	argb32_to_rgba_avx2,
+	rgb24_to_rgb_avx2,
+	invert_rgb_avx2
+};
+#endif /* HAVE_X86_KERNELS */
+
+#ifdef HAVE_NEON_KERNELS
+/* (c * a + 0x80 + ((c * a + 0x80) >> 8)) >> 8, as MULT() */
+static inline uint8x16_t
+multiply_neon (uint8x16_t c,
+	       uint8x16_t a)
+{
+	uint16x8_t lo = vmull_u8 (vget_low_u8 (c), vget_low_u8 (a));
+	uint16x8_t hi = vmull_u8 (vget_high_u8 (c), vget_high_u8 (a));
+
+	return vcombine_u8 (vraddhn_u16 (lo, vrshrq_n_u16 (lo, 8)),
+			    vraddhn_u16 (hi, vrshrq_n_u16 (hi, 8)));
+}
+
+static void
+rgba_to_argb32_neon (const guchar *src,
+		     guint32      *dest,
+		     gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 16 <= n_pixels; i += 16) {
+		uint8x16x4_t p = vld4q_u8 (src + i * 4);
+		uint8x16x4_t q;
+
+		q.val[0] = multiply_neon (p.val[2], p.val[3]);
+		q.val[1] = multiply_neon (p.val[1], p.val[3]);
+		q.val[2] = multiply_neon (p.val[0], p.val[3]);
+		q.val[3] = p.val[3];
+		vst4q_u8 ((guint8 *) (dest + i), q);
+	}
+
+	rgba_to_argb32_scalar (src + i * 4, dest + i, n_pixels - i);
+}
+
+static void
+rgb_to_rgb24_neon (const guchar *src,
+		   guint32      *dest,
+		   gsize         n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 16 <= n_pixels; i += 16) {
+		uint8x16x3_t p = vld3q_u8 (src + i * 3);
+		uint8x16x4_t q;
+
+		q.val[0] = p.val[2];
+		q.val[1] = p.val[1];
+		q.val[2] = p.val[0];
+		q.val[3] = vdupq_n_u8 (0xff);
+		vst4q_u8 ((guint8 *) (dest + i), q);
+	}
+
+	rgb_to_rgb24_scalar (src + i * 3, dest + i, n_pixels - i);
+}
+
+static void
+argb32_to_rgba_neon (const guint32 *src,
+		     guchar        *dest,
+		     gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 16 <= n_pixels; i += 16) {
+		uint8x16x4_t p = vld4q_u8 ((const guint8 *) (src + i));
+		uint8x16x4_t q;
+		uint8x8_t    opaque;
+
+		opaque = vand_u8 (vget_low_u8 (p.val[3]), vget_high_u8 (p.val[3]));
+		if (vget_lane_u64 (vreinterpret_u64_u8 (opaque), 0) != G_MAXUINT64) {
+			argb32_to_rgba_scalar (src + i, dest + i * 4, 16);
+			continue;
+		}
+
+		q.val[0] = p.val[2];
+		q.val[1] = p.val[1];
+		q.val[2] = p.val[0];
+		q.val[3] = p.val[3];
+		vst4q_u8 (dest + i * 4, q);
+	}
+
+	argb32_to_rgba_scalar (src + i, dest + i * 4, n_pixels - i);
+}
+
+static void
+rgb24_to_rgb_neon (const guint32 *src,
+		   guchar        *dest,
+		   gsize          n_pixels)
+{
+	gsize i;
+
+	for (i = 0; i + 16 <= n_pixels; i += 16) {
+		uint8x16x4_t p = vld4q_u8 ((const guint8 *) (src + i));
+		uint8x16x3_t q;
+
+		q.val[0] = p.val[2];
+		q.val[1] = p.val[1];
+		q.val[2] = p.val[0];
+		vst3q_u8 (dest + i * 3, q);
+	}
+
+	rgb24_to_rgb_scalar (src + i, dest + i * 3, n_pixels - i);
+}
+
+static void
+invert_rgb_neon (guchar *pixels,
+		 gsize   n_bytes,
+		 guint   n_channels)
+{
+	const uint8x16_t mask = n_channels == 4 ?
+		vreinterpretq_u8_u32 (vdupq_n_u32 (0x00ffffff)) : vdupq_n_u8 (0xff);
+	gsize            i;
+
+	for (i = 0; i + 16 <= n_bytes; i += 16)
+		vst1q_u8 (pixels + i, veorq_u8 (vld1q_u8 (pixels + i), mask));
+
+	invert_rgb_scalar (pixels + i, n_bytes - i, n_channels);
+}
+
+static const EvPixelKernels kernels_neon = {
+	rgba_to_argb32_neon,
+	rgb_to_rgb24_neon,
+	argb32_to_rgba_neon,
+	rgb24_to_rgb_neon,
+	invert_rgb_neon
+};
+#endif /* HAVE_NEON_KERNELS */
+
+static const EvPixelKernels *
+get_isa_kernels (EvPixelKernelsIsa isa)
+{
+	switch (isa) {
+	case EV_PIXEL_KERNELS_ISA_SCALAR:
+		return &kernels_scalar;
+#ifdef HAVE_X86_KERNELS
+	case EV_PIXEL_KERNELS_ISA_SSE2:
+		__builtin_cpu_init ();
+		return __builtin_cpu_supports ("sse2") ? &kernels_sse2 : NULL;
+	case EV_PIXEL_KERNELS_ISA_AVX2:
+		__builtin_cpu_init ();
+		return __builtin_cpu_supports ("avx2") ? &kernels_avx2 : NULL;
+#endif
+#ifdef HAVE_NEON_KERNELS
+	case EV_PIXEL_KERNELS_ISA_NEON:
+		return &kernels_neon;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static const EvPixelKernels *kernels = NULL;
+static EvPixelKernelsIsa     kernels_isa = EV_PIXEL_KERNELS_ISA_SCALAR;
+
+static const EvPixelKernels *
+get_kernels (void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		const gchar *env = g_getenv ("EV_PIXEL_KERNELS");
+		gint         isa;
+
+		/* The best one the CPU supports, unless overridden */
+		for (isa = EV_PIXEL_KERNELS_N_ISAS - 1; isa >= 0; isa--) {
+			if (env && g_ascii_strcasecmp (env, isa_names[isa]) != 0)
+				continue;
+			if (get_isa_kernels (isa))
+				break;
+		}
+
+		if (isa < 0) {
+			g_warning ("Pixel kernels \"%s\" are not supported, using the scalar ones", env);
+			isa = EV_PIXEL_KERNELS_ISA_SCALAR;
+		}
+
+		kernels_isa = isa;
+		g_atomic_pointer_set (&kernels, get_isa_kernels (isa));
+
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return g_atomic_pointer_get (&kernels);
+}
+
+EvPixelKernelsIsa
+ev_pixel_kernels_get_isa (void)
+{
+	get_kernels ();
+
+	return kernels_isa;
+}
+
+/* Meant for benchmarks and tests; conversions running at the same
+ * time may use either implementation
+ */
+gboolean
+ev_pixel_kernels_set_isa (EvPixelKernelsIsa isa)
+{
+	const EvPixelKernels *isa_kernels;
+
+	g_return_val_if_fail (isa < EV_PIXEL_KERNELS_N_ISAS, FALSE);
+
+	get_kernels ();
+
+	isa_kernels = get_isa_kernels (isa);
+	if (!isa_kernels)
+		return FALSE;
+
+	kernels_isa = isa;
+	g_atomic_pointer_set (&kernels, isa_kernels);
+
+	return TRUE;
+}
+
+const gchar *
+ev_pixel_kernels_get_isa_name (EvPixelKernelsIsa isa)
+{
+	g_return_val_if_fail (isa < EV_PIXEL_KERNELS_N_ISAS, NULL);
+
+	return isa_names[isa];
+}
+
+/* Non-premultiplied RGBA bytes to premultiplied ARGB32 */
+void
+ev_pixel_kernels_rgba_to_argb32 (const guchar *src,
+				 guint32      *dest,
+				 gsize         n_pixels)
+{
+	get_kernels ()->rgba_to_argb32 (src, dest, n_pixels);
+}
+
+/* RGB bytes to RGB24 */
+void
+ev_pixel_kernels_rgb_to_rgb24 (const guchar *src,
+			       guint32      *dest,
+			       gsize         n_pixels)
+{
+	get_kernels ()->rgb_to_rgb24 (src, dest, n_pixels);
+}
+
+/* Premultiplied ARGB32 to non-premultiplied RGBA bytes */
+void
+ev_pixel_kernels_argb32_to_rgba (const guint32 *src,
+				 guchar        *dest,
+				 gsize          n_pixels)
+{
+	get_kernels ()->argb32_to_rgba (src, dest, n_pixels);
+}
+
+/* RGB24 to RGB bytes */
+void
+ev_pixel_kernels_rgb24_to_rgb (const guint32 *src,
+			       guchar        *dest,
+			       gsize          n_pixels)
+{
+	get_kernels ()->rgb24_to_rgb (src, dest, n_pixels);
+}
+
+/* Inverts the colors of RGB or RGBA bytes, leaving alpha as is */
+void
+ev_pixel_kernels_invert_rgb (guchar *pixels,
+			     gsize   n_pixels,
+			     guint   n_channels)
+{
+	g_return_if_fail (n_channels == 3 || n_channels == 4);
+
+	get_kernels ()->invert_rgb (pixels, n_pixels * n_channels, n_channels);
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#ifndef EV_PIXEL_KERNELS_H
+#define EV_PIXEL_KERNELS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Conversions between GdkPixbuf pixels (RGB or non-premultiplied RGBA
+ * bytes) and cairo image surface pixels (native endian RGB24 or
+ * premultiplied ARGB32 words), one row at a time. The implementation
+ * is chosen at runtime for the instruction sets of the CPU, and can be
+ * forced with the EV_PIXEL_KERNELS environment variable, set to
+ * "scalar", "sse2", "avx2" or "neon".
+ */
+
+typedef enum {
+	EV_PIXEL_KERNELS_ISA_SCALAR,
+	EV_PIXEL_KERNELS_ISA_SSE2,
+	EV_PIXEL_KERNELS_ISA_AVX2,
+	EV_PIXEL_KERNELS_ISA_NEON,
+	EV_PIXEL_KERNELS_N_ISAS
+} EvPixelKernelsIsa;
+
+EvPixelKernelsIsa ev_pixel_kernels_get_isa        (void);
+gboolean          ev_pixel_kernels_set_isa        (EvPixelKernelsIsa isa);
+const gchar      *ev_pixel_kernels_get_isa_name   (EvPixelKernelsIsa isa);
+
+void              ev_pixel_kernels_rgba_to_argb32 (const guchar     *src,
+						   guint32          *dest,
+						   gsize             n_pixels);
+void              ev_pixel_kernels_rgb_to_rgb24   (const guchar     *src,
+						   guint32          *dest,
+						   gsize             n_pixels);
+void              ev_pixel_kernels_argb32_to_rgba (const guint32    *src,
+						   guchar           *dest,
+						   gsize             n_pixels);
+void              ev_pixel_kernels_rgb24_to_rgb   (const guint32    *src,
+						   guchar           *dest,
+						   gsize             n_pixels);
+void              ev_pixel_kernels_invert_rgb     (guchar           *pixels,
+						   gsize             n_pixels,
+						   guint             n_channels);
+
+G_END_DECLS
+
+#endif /* EV_PIXEL_KERNELS_H */
@@ -0,0 +1,634 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <glib/gi18n-lib.h>
+
+#include "ev-range-stream.h"
+
+/**
+ * SECTION: ev-range-stream
+ * @short_description: a seekable stream over a remote file
+ *
+ * An #EvRangeStream reads a remote file in blocks, on demand, and keeps
+ * the blocks read in a local cache file, at their offset in the remote
+ * file. Seeking the stream doesn't read anything, so a backend loading
+ * a document from it only downloads the parts of the file it needs,
+ * like the first page and the cross reference table of a linearized
+ * PDF. The remote file is read with range requests when its stream is
+ * seekable, and sequentially otherwise.
+ *
+ * ev_range_stream_download() fetches the remaining blocks, after which
+ * the cache file is a full copy of the remote file.
+ *
+ * Since: 3.28
+ */
+
+#define BLOCK_SIZE (64 * 1024)
+
+struct _EvRangeStreamPrivate {
+	GFile         *source;
+	GFile         *cache;
+	goffset        size;
+	goffset        position;
+
+	GMutex         mutex;
+	gboolean       closed;
+	GInputStream  *remote;
+	goffset        remote_offset;
+	GFileIOStream *cache_io;
+	guint8        *blocks;
+	guint          n_blocks;
+	guint          n_cached;
+};
+
+#define EV_RANGE_STREAM_GET_PRIVATE(object) \
+                (G_TYPE_INSTANCE_GET_PRIVATE ((object), EV_TYPE_RANGE_STREAM, EvRangeStreamPrivate))
+
+G_DEFINE_TYPE (EvRangeStream, ev_range_stream, G_TYPE_FILE_INPUT_STREAM)
+
+static void
+ev_range_stream_finalize (GObject *object)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (object)->priv;
+
+	g_clear_object (&priv->remote);
+	g_clear_object (&priv->cache_io);
+	g_clear_object (&priv->source);
+	g_clear_object (&priv->cache);
+	g_free (priv->blocks);
+	g_mutex_clear (&priv->mutex);
+
+	G_OBJECT_CLASS (ev_range_stream_parent_class)->finalize (object);
+}
+
+/* Fetches the blocks from @start to @end, which are all missing, with
+ * the lock held
+ */
+static gboolean
+ev_range_stream_fetch_run (EvRangeStream *stream,
+			   guint          start,
+			   guint          end,
+			   GCancellable  *cancellable,
+			   GError       **error)
+{
+	EvRangeStreamPrivate *priv = stream->priv;
+	GSeekable            *cache_seekable = G_SEEKABLE (priv->cache_io);
+	GOutputStream        *cache_out;
+	goffset               offset = (goffset) start * BLOCK_SIZE;
+	guchar               *buffer;
+	guint                 block;
+
+	if (priv->remote && priv->remote_offset != offset) {
+		if (G_IS_SEEKABLE (priv->remote) &&
+		    g_seekable_can_seek (G_SEEKABLE (priv->remote)) &&
+		    g_seekable_seek (G_SEEKABLE (priv->remote), offset, G_SEEK_SET, cancellable, NULL)) {
+			priv->remote_offset = offset;
+		} else if (priv->remote_offset > offset) {
+			/* Start over */
+			g_clear_object (&priv->remote);
+		} else {
+			/* Read on up to @start, keeping what's read on the way */
+			start = priv->remote_offset / BLOCK_SIZE;
+		}
+	}
+
+	if (!priv->remote) {
+		priv->remote = G_INPUT_STREAM (g_file_read (priv->source, cancellable, error));
+		if (!priv->remote)
+			return FALSE;
+		priv->remote_offset = 0;
+
+		return ev_range_stream_fetch_run (stream, start, end, cancellable, error);
+	}
+
+	cache_out = g_io_stream_get_output_stream (G_IO_STREAM (priv->cache_io));
+	buffer = g_malloc (BLOCK_SIZE);
+
+	for (block = start; block <= end; block++) {
+		goffset block_offset = (goffset) block * BLOCK_SIZE;
+		gsize   length = MIN (BLOCK_SIZE, priv->size - block_offset);
+		gsize   n_read;
+
+		if (!g_input_stream_read_all (priv->remote, buffer, length, &n_read,
+					      cancellable, error))
+			break;
+
+		if (n_read != length) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+					     _("The file is shorter than expected"));
+			break;
+		}
+		priv->remote_offset += length;
+
+		if (priv->blocks[block])
+			continue;
+
+		if (!g_seekable_seek (cache_seekable, block_offset, G_SEEK_SET, cancellable, error) ||
+		    !g_output_stream_write_all (cache_out, buffer, length, NULL, cancellable, error))
+			break;
+
+		priv->blocks[block] = TRUE;
+		priv->n_cached++;
+	}
+	g_free (buffer);
+
+	if (block <= end) {
+		/* The remote stream is in an unknown state */
+		g_clear_object (&priv->remote);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Opens the cache file if needed, with the lock held */
+static gboolean
+ev_range_stream_open_cache (EvRangeStream *stream,
+			    GCancellable  *cancellable,
+			    GError       **error)
+{
+	EvRangeStreamPrivate *priv = stream->priv;
+
+	if (priv->closed) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+				     _("Stream is already closed"));
+		return FALSE;
+	}
+
+	if (!priv->cache_io) {
+		priv->cache_io = g_file_open_readwrite (priv->cache, cancellable, error);
+		if (!priv->cache_io)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Makes sure that the blocks from @first to @last are in the cache,
+ * with the lock held
+ */
+static gboolean
+ev_range_stream_fetch (EvRangeStream *stream,
+		       guint          first,
+		       guint          last,
+		       GCancellable  *cancellable,
+		       GError       **error)
+{
+	EvRangeStreamPrivate *priv = stream->priv;
+	guint                 block = first;
+
+	if (!ev_range_stream_open_cache (stream, cancellable, error))
+		return FALSE;
+
+	while (block <= last) {
+		guint end;
+
+		if (priv->blocks[block]) {
+			block++;
+			continue;
+		}
+
+		for (end = block; end < last && !priv->blocks[end + 1]; end++);
+
+		if (!ev_range_stream_fetch_run (stream, block, end, cancellable, error))
+			return FALSE;
+		block = end + 1;
+	}
+
+	return TRUE;
+}
+
+static gssize
+ev_range_stream_read (GInputStream  *input_stream,
+		      void          *buffer,
+		      gsize          count,
+		      GCancellable  *cancellable,
+		      GError       **error)
+{
+	EvRangeStream        *stream = EV_RANGE_STREAM (input_stream);
+	EvRangeStreamPrivate *priv = stream->priv;
+	GInputStream         *cache_in;
+	gsize                 n_read = 0;
+	gboolean              retval;
+
+	g_mutex_lock (&priv->mutex);
+
+	if (priv->position >= priv->size || count == 0) {
+		g_mutex_unlock (&priv->mutex);
+		return 0;
+	}
+
+	count = MIN (count, priv->size - priv->position);
+	retval = ev_range_stream_fetch (stream,
+					priv->position / BLOCK_SIZE,
+					(priv->position + count - 1) / BLOCK_SIZE,
+					cancellable, error);
+	if (retval) {
+		cache_in = g_io_stream_get_input_stream (G_IO_STREAM (priv->cache_io));
+		retval = g_seekable_seek (G_SEEKABLE (priv->cache_io), priv->position,
+					  G_SEEK_SET, cancellable, error) &&
+			g_input_stream_read_all (cache_in, buffer, count, &n_read,
+						 cancellable, error);
+	}
+	if (retval)
+		priv->position += n_read;
+
+	g_mutex_unlock (&priv->mutex);
+
+	return retval ? (gssize) n_read : -1;
+}
+
+static gssize
+ev_range_stream_skip (GInputStream  *input_stream,
+		      gsize          count,
+		      GCancellable  *cancellable,
+		      GError       **error)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (input_stream)->priv;
+
+	g_mutex_lock (&priv->mutex);
+	count = priv->position < priv->size ? MIN (count, priv->size - priv->position) : 0;
+	priv->position += count;
+	g_mutex_unlock (&priv->mutex);
+
+	return count;
+}
+
+static gboolean
+ev_range_stream_close (GInputStream  *input_stream,
+		       GCancellable  *cancellable,
+		       GError       **error)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (input_stream)->priv;
+
+	g_mutex_lock (&priv->mutex);
+	priv->closed = TRUE;
+	g_clear_object (&priv->remote);
+	g_clear_object (&priv->cache_io);
+	g_mutex_unlock (&priv->mutex);
+
+	return TRUE;
+}
+
+static goffset
+ev_range_stream_tell (GFileInputStream *file_stream)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (file_stream)->priv;
+	goffset               position;
+
+	g_mutex_lock (&priv->mutex);
+	position = priv->position;
+	g_mutex_unlock (&priv->mutex);
+
+	return position;
+}
+
+static gboolean
+ev_range_stream_can_seek (GFileInputStream *file_stream)
+{
+	return TRUE;
+}
+
+static gboolean
+ev_range_stream_seek (GFileInputStream *file_stream,
+		      goffset           offset,
+		      GSeekType         type,
+		      GCancellable     *cancellable,
+		      GError          **error)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (file_stream)->priv;
+	goffset               position;
+
+	g_mutex_lock (&priv->mutex);
+
+	switch (type) {
+	case G_SEEK_CUR:
+		position = priv->position + offset;
+		break;
+	case G_SEEK_END:
+		position = priv->size + offset;
+		break;
+	case G_SEEK_SET:
+	default:
+		position = offset;
+		break;
+	}
+
+	if (position < 0) {
+		g_mutex_unlock (&priv->mutex);
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+				     _("Invalid seek request"));
+		return FALSE;
+	}
+	priv->position = position;
+
+	g_mutex_unlock (&priv->mutex);
+
+	return TRUE;
+}
+
+static GFileInfo *
+ev_range_stream_query_info (GFileInputStream *file_stream,
+			    const char       *attributes,
+			    GCancellable     *cancellable,
+			    GError          **error)
+{
+	EvRangeStreamPrivate *priv = EV_RANGE_STREAM (file_stream)->priv;
+
+	return g_file_query_info (priv->source, attributes, G_FILE_QUERY_INFO_NONE,
+				  cancellable, error);
+}
+
+static void
+ev_range_stream_class_init (EvRangeStreamClass *klass)
+{
+	GObjectClass          *g_object_class = G_OBJECT_CLASS (klass);
+	GInputStreamClass     *input_stream_class = G_INPUT_STREAM_CLASS (klass);
+	GFileInputStreamClass *file_stream_class = G_FILE_INPUT_STREAM_CLASS (klass);
+
+	g_object_class->finalize = ev_range_stream_finalize;
+
+	input_stream_class->read_fn = ev_range_stream_read;
+	input_stream_class->skip = ev_range_stream_skip;
+	input_stream_class->close_fn = ev_range_stream_close;
+
+	file_stream_class->tell = ev_range_stream_tell;
+	file_stream_class->can_seek = ev_range_stream_can_seek;
+	file_stream_class->seek = ev_range_stream_seek;
+	file_stream_class->query_info = ev_range_stream_query_info;
+
+	g_type_class_add_private (g_object_class, sizeof (EvRangeStreamPrivate));
+}
+
+static void
+ev_range_stream_init (EvRangeStream *stream)
+{
+	stream->priv = EV_RANGE_STREAM_GET_PRIVATE (stream);
+
+	g_mutex_init (&stream->priv->mutex);
+}
+
+/**
+ * ev_range_stream_new:
+ * @source: the remote #GFile
+ * @cache: a local #GFile, which must exist, to keep the blocks read
+ * @size: the size of @source
+ *
+ * Creates a stream reading @source. Nothing is read until the stream is.
+ *
+ * Returns: (transfer full): a new #EvRangeStream
+ */
+EvRangeStream *
+ev_range_stream_new (GFile  *source,
+		     GFile  *cache,
+		     goffset size)
+{
+	EvRangeStream *stream;
+
+	g_return_val_if_fail (G_IS_FILE (source), NULL);
+	g_return_val_if_fail (G_IS_FILE (cache), NULL);
+	g_return_val_if_fail (size >= 0, NULL);
+
+	stream = g_object_new (EV_TYPE_RANGE_STREAM, NULL);
+	stream->priv->source = g_object_ref (source);
+	stream->priv->cache = g_object_ref (cache);
+	stream->priv->size = size;
+	stream->priv->n_blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	stream->priv->blocks = g_new0 (guint8, stream->priv->n_blocks);
+
+	return stream;
+}
+
+/**
+ * ev_range_stream_get_cache_file:
+ * @stream: an #EvRangeStream
+ *
+ * Returns: (transfer none): the cache file of @stream
+ */
+GFile *
+ev_range_stream_get_cache_file (EvRangeStream *stream)
+{
+	g_return_val_if_fail (EV_IS_RANGE_STREAM (stream), NULL);
+
+	return stream->priv->cache;
+}
+
+goffset
+ev_range_stream_get_size (EvRangeStream *stream)
+{
+	g_return_val_if_fail (EV_IS_RANGE_STREAM (stream), 0);
+
+	return stream->priv->size;
+}
+
+/**
+ * ev_range_stream_is_complete:
+ * @stream: an #EvRangeStream
+ *
+ * Returns: %TRUE if the whole remote file is in the cache file
+ */
+gboolean
+ev_range_stream_is_complete (EvRangeStream *stream)
+{
+	gboolean retval;
+
+	g_return_val_if_fail (EV_IS_RANGE_STREAM (stream), FALSE);
+
+	g_mutex_lock (&stream->priv->mutex);
+	retval = stream->priv->n_cached == stream->priv->n_blocks;
+	g_mutex_unlock (&stream->priv->mutex);
+
+	return retval;
+}
+
+/**
+ * ev_range_stream_download:
+ * @stream: an #EvRangeStream
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): a #GError location to store an error, or %NULL
+ *
+ * Synchronously fetches the blocks of the remote file which are not in
+ * the cache yet. The stream can be read from other threads meanwhile.
+ *
+ * Returns: %TRUE if the cache file is complete, %FALSE on error
+ */
+gboolean
+ev_range_stream_download (EvRangeStream *stream,
+			  GCancellable  *cancellable,
+			  GError       **error)
+{
+	EvRangeStreamPrivate *priv;
+	GInputStream         *remote = NULL;
+	goffset               remote_offset = 0;
+	guchar               *buffer;
+	guint                 block = 0;
+	gboolean              retval = FALSE;
+
+	g_return_val_if_fail (EV_IS_RANGE_STREAM (stream), FALSE);
+
+	priv = stream->priv;
+
+	/* The download has its own remote stream, and the blocks are read
+	 * without the lock: it is only held to write them to the cache,
+	 * so reads of the stream never wait for the network.
+	 */
+	buffer = g_malloc (BLOCK_SIZE);
+
+	while (TRUE) {
+		goffset offset;
+		gsize   length;
+		gsize   n_read;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			goto out;
+
+		g_mutex_lock (&priv->mutex);
+		while (block < priv->n_blocks && priv->blocks[block])
+			block++;
+		g_mutex_unlock (&priv->mutex);
+
+		if (block == priv->n_blocks)
+			break;
+
+		if (!remote) {
+			remote = G_INPUT_STREAM (g_file_read (priv->source, cancellable, error));
+			if (!remote)
+				goto out;
+			remote_offset = 0;
+		}
+
+		offset = (goffset) block * BLOCK_SIZE;
+		if (remote_offset != offset) {
+			if (G_IS_SEEKABLE (remote) &&
+			    g_seekable_can_seek (G_SEEKABLE (remote)) &&
+			    g_seekable_seek (G_SEEKABLE (remote), offset, G_SEEK_SET, cancellable, NULL)) {
+				remote_offset = offset;
+			} else {
+				/* Read on up to @block, keeping what's read on the way */
+				block = remote_offset / BLOCK_SIZE;
+				offset = remote_offset;
+			}
+		}
+
+		length = MIN (BLOCK_SIZE, priv->size - offset);
+		if (!g_input_stream_read_all (remote, buffer, length, &n_read, cancellable, error))
+			goto out;
+
+		if (n_read != length) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+					     _("The file is shorter than expected"));
+			goto out;
+		}
+		remote_offset += length;
+
+		g_mutex_lock (&priv->mutex);
+		if (!ev_range_stream_open_cache (stream, cancellable, error)) {
+			g_mutex_unlock (&priv->mutex);
+			goto out;
+		}
+
+		/* Unless a read of the stream fetched it meanwhile */
+		if (!priv->blocks[block]) {
+			if (!g_seekable_seek (G_SEEKABLE (priv->cache_io), offset, G_SEEK_SET, cancellable, error) ||
+			    !g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (priv->cache_io)),
+							buffer, length, NULL, cancellable, error)) {
+				g_mutex_unlock (&priv->mutex);
+				goto out;
+			}
+
+			priv->blocks[block] = TRUE;
+			priv->n_cached++;
+		}
+		g_mutex_unlock (&priv->mutex);
+
+		block++;
+	}
+
+	/* Everything is local now */
+	g_mutex_lock (&priv->mutex);
+	g_clear_object (&priv->remote);
+	g_mutex_unlock (&priv->mutex);
+
+	retval = TRUE;
+
+ out:
+	g_free (buffer);
+	g_clear_object (&remote);
+
+	return retval;
+}
+
+static void
+download_thread (GTask        *task,
+		 gpointer      source_object,
+		 gpointer      task_data,
+		 GCancellable *cancellable)
+{
+	GError *error = NULL;
+
+	if (ev_range_stream_download (EV_RANGE_STREAM (source_object), cancellable, &error))
+		g_task_return_boolean (task, TRUE);
+	else
+		g_task_return_error (task, error);
+}
+
+/**
+ * ev_range_stream_download_async:
+ * @stream: an #EvRangeStream
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the download is done
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronous version of ev_range_stream_download(), run in a thread.
+ */
+void
+ev_range_stream_download_async (EvRangeStream      *stream,
+				gint                io_priority,
+				GCancellable       *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer            user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (EV_IS_RANGE_STREAM (stream));
+
+	task = g_task_new (stream, cancellable, callback, user_data);
+	g_task_set_priority (task, io_priority);
+	g_task_run_in_thread (task, download_thread);
+	g_object_unref (task);
+}
+
+/**
+ * ev_range_stream_download_finish:
+ * @stream: an #EvRangeStream
+ * @result: a #GAsyncResult
+ * @error: (allow-none): a #GError location to store an error, or %NULL
+ *
+ * Returns: %TRUE if the cache file is complete, %FALSE on error
+ */
+gboolean
+ev_range_stream_download_finish (EvRangeStream *stream,
+				 GAsyncResult  *result,
+				 GError       **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, stream), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,71 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_DOCUMENT_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-document.h> can be included directly."
+#endif
+
+#ifndef __EV_RANGE_STREAM_H__
+#define __EV_RANGE_STREAM_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvRangeStream        EvRangeStream;
+typedef struct _EvRangeStreamClass   EvRangeStreamClass;
+typedef struct _EvRangeStreamPrivate EvRangeStreamPrivate;
+
+#define EV_TYPE_RANGE_STREAM              (ev_range_stream_get_type())
+#define EV_RANGE_STREAM(object)           (G_TYPE_CHECK_INSTANCE_CAST((object), EV_TYPE_RANGE_STREAM, EvRangeStream))
+#define EV_RANGE_STREAM_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass), EV_TYPE_RANGE_STREAM, EvRangeStreamClass))
+#define EV_IS_RANGE_STREAM(object)        (G_TYPE_CHECK_INSTANCE_TYPE((object), EV_TYPE_RANGE_STREAM))
+#define EV_IS_RANGE_STREAM_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass), EV_TYPE_RANGE_STREAM))
+#define EV_RANGE_STREAM_GET_CLASS(object) (G_TYPE_INSTANCE_GET_CLASS((object), EV_TYPE_RANGE_STREAM, EvRangeStreamClass))
+
+struct _EvRangeStream {
+	GFileInputStream base_instance;
+
+	EvRangeStreamPrivate *priv;
+};
+
+struct _EvRangeStreamClass {
+	GFileInputStreamClass base_class;
+};
+
+GType          ev_range_stream_get_type        (void) G_GNUC_CONST;
+EvRangeStream *ev_range_stream_new             (GFile               *source,
+						GFile               *cache,
+						goffset              size);
+GFile         *ev_range_stream_get_cache_file  (EvRangeStream       *stream);
+goffset        ev_range_stream_get_size        (EvRangeStream       *stream);
+gboolean       ev_range_stream_is_complete     (EvRangeStream       *stream);
+gboolean       ev_range_stream_download        (EvRangeStream       *stream,
+						GCancellable        *cancellable,
+						GError             **error);
+void           ev_range_stream_download_async  (EvRangeStream       *stream,
+						gint                 io_priority,
+						GCancellable        *cancellable,
+						GAsyncReadyCallback  callback,
+						gpointer             user_data);
+gboolean       ev_range_stream_download_finish (EvRangeStream       *stream,
+						GAsyncResult        *result,
+						GError             **error);
+
+G_END_DECLS
+
+#endif /* __EV_RANGE_STREAM_H__ */
@@ -0,0 +1,358 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "ev-init.h"
+#include "ev-document-factory.h"
+#include "ev-render-context.h"
+
+static gchar   *pages_option = NULL;
+static gchar   *scales_option = NULL;
+static gchar   *rotations_option = NULL;
+static gint     n_threads = 1;
+static gint     n_runs = 1;
+static gchar  **files = NULL;
+
+static const GOptionEntry entries[] = {
+	{ "pages", 'p', 0, G_OPTION_ARG_STRING, &pages_option,
+	  "Pages to render, as FIRST-LAST counting from 1 (default: all)", "RANGE" },
+	{ "scales", 's', 0, G_OPTION_ARG_STRING, &scales_option,
+	  "Comma separated scales to render at (default: 1)", "SCALES" },
+	{ "rotations", 'r', 0, G_OPTION_ARG_STRING, &rotations_option,
+	  "Comma separated rotations to render with (default: 0)", "ROTATIONS" },
+	{ "threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+	  "Number of threads rendering at the same time (default: 1)", "N" },
+	{ "runs", 'n', 0, G_OPTION_ARG_INT, &n_runs,
+	  "Number of times every page is rendered (default: 1)", "N" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &files, NULL, "FILE…" },
+	{ NULL }
+};
+
+typedef struct {
+	gint    page;
+	gdouble scale;
+	gint    rotation;
+} RenderTask;
+
+typedef struct {
+	EvDocument *document;
+	GMutex      mutex;
+	gint64     *latencies;
+	guint       n_latencies;
+	guint64     n_pixels;
+	guint       n_failed;
+} Bench;
+
+static GArray *
+parse_doubles (const gchar *str,
+	       gdouble      default_value)
+{
+	GArray *values = g_array_new (FALSE, FALSE, sizeof (gdouble));
+	gchar **tokens;
+	gint    i;
+
+	if (!str) {
+		g_array_append_val (values, default_value);
+		return values;
+	}
+
+	tokens = g_strsplit (str, ",", -1);
+	for (i = 0; tokens[i]; i++) {
+		gdouble value = g_ascii_strtod (tokens[i], NULL);
+
+		if (value > 0)
+			g_array_append_val (values, value);
+	}
+	g_strfreev (tokens);
+
+	return values;
+}
+
+static GArray *
+parse_rotations (const gchar *str)
+{
+	GArray *values = g_array_new (FALSE, FALSE, sizeof (gint));
+	gchar **tokens;
+	gint    i;
+
+	if (!str) {
+		gint value = 0;
+
+		g_array_append_val (values, value);
+		return values;
+	}
+
+	tokens = g_strsplit (str, ",", -1);
+	for (i = 0; tokens[i]; i++) {
+		gint value = atoi (tokens[i]);
+
+		if (value % 90 == 0)
+			g_array_append_val (values, value);
+	}
+	g_strfreev (tokens);
+
+	return values;
+}
+
+static void
+parse_pages (const gchar *str,
+	     gint         n_pages,
+	     gint        *first,
+	     gint        *last)
+{
+	*first = 0;
+	*last = n_pages - 1;
+
+	if (str) {
+		gchar **tokens = g_strsplit (str, "-", 2);
+
+		*first = atoi (tokens[0]) - 1;
+		*last = tokens[1] ? atoi (tokens[1]) - 1 : *first;
+		g_strfreev (tokens);
+	}
+
+	*first = CLAMP (*first, 0, n_pages - 1);
+	*last = CLAMP (*last, *first, n_pages - 1);
+}
+
+static void
+render_task (RenderTask *task,
+	     Bench      *bench)
+{
+	EvPage          *page;
+	EvRenderContext *rc;
+	cairo_surface_t *surface;
+	gint64           begin, latency;
+	gboolean         need_fc_lock;
+
+	begin = g_get_monotonic_time ();
+
+	/* Lock the same way EvJobRender does, so that the numbers match
+	 * what the viewer gets with several render threads.
+	 */
+	ev_document_render_lock (bench->document);
+	need_fc_lock = !(ev_document_get_render_flags (bench->document) & EV_DOCUMENT_RENDER_FLAG_REENTRANT);
+	if (need_fc_lock)
+		ev_document_fc_mutex_lock ();
+	page = ev_document_get_page (bench->document, task->page);
+	rc = ev_render_context_new (page, task->rotation, task->scale);
+	surface = ev_document_render (bench->document, rc);
+	if (need_fc_lock)
+		ev_document_fc_mutex_unlock ();
+	ev_document_render_unlock (bench->document);
+
+	latency = g_get_monotonic_time () - begin;
+
+	g_mutex_lock (&bench->mutex);
+	if (surface && cairo_surface_status (surface) == CAIRO_STATUS_SUCCESS) {
+		bench->latencies[bench->n_latencies++] = latency;
+		if (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE)
+			bench->n_pixels += (guint64)cairo_image_surface_get_width (surface) *
+				cairo_image_surface_get_height (surface);
+	} else {
+		g_printerr ("Failed to render page %d at scale %.2f, rotation %d\n",
+			    task->page + 1, task->scale, task->rotation);
+		bench->n_failed++;
+	}
+	g_mutex_unlock (&bench->mutex);
+
+	if (surface)
+		cairo_surface_destroy (surface);
+	g_object_unref (rc);
+	g_object_unref (page);
+	g_free (task);
+}
+
+static gint
+compare_latencies (gconstpointer a,
+		   gconstpointer b)
+{
+	gint64 la = *(const gint64 *)a;
+	gint64 lb = *(const gint64 *)b;
+
+	return la < lb ? -1 : la > lb;
+}
+
+static gdouble
+percentile (Bench  *bench,
+	    gdouble p)
+{
+	guint index;
+
+	if (bench->n_latencies == 0)
+		return 0;
+
+	index = MIN ((guint)(p * bench->n_latencies), bench->n_latencies - 1);
+
+	return bench->latencies[index] / 1000.;
+}
+
+static glong
+get_peak_rss (void)
+{
+#ifdef G_OS_UNIX
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+#endif
+	return -1;
+}
+
+static gboolean
+bench_file (const gchar *filename,
+	    GArray      *scales,
+	    GArray      *rotations)
+{
+	Bench        bench;
+	GThreadPool *pool;
+	GError      *error = NULL;
+	GFile       *file;
+	gchar       *uri;
+	gint64       load_time, begin, total;
+	gint         n_pages, first, last, page, run;
+	guint        i, j, n_tasks;
+
+	file = g_file_new_for_commandline_arg (filename);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	begin = g_get_monotonic_time ();
+	bench.document = ev_document_factory_get_document (uri, &error);
+	load_time = g_get_monotonic_time () - begin;
+	g_free (uri);
+	if (!bench.document) {
+		g_printerr ("%s: %s\n", filename, error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	n_pages = ev_document_get_n_pages (bench.document);
+	if (n_pages <= 0) {
+		g_printerr ("%s: the document has no pages\n", filename);
+		g_object_unref (bench.document);
+		return FALSE;
+	}
+	parse_pages (pages_option, n_pages, &first, &last);
+	n_tasks = (last - first + 1) * scales->len * rotations->len * n_runs;
+
+	g_mutex_init (&bench.mutex);
+	bench.latencies = g_new (gint64, n_tasks);
+	bench.n_latencies = 0;
+	bench.n_pixels = 0;
+	bench.n_failed = 0;
+
+	pool = g_thread_pool_new ((GFunc)render_task, &bench, n_threads, TRUE, NULL);
+
+	begin = g_get_monotonic_time ();
+	for (run = 0; run < n_runs; run++) {
+		for (page = first; page <= last; page++) {
+			for (i = 0; i < scales->len; i++) {
+				for (j = 0; j < rotations->len; j++) {
+					RenderTask *task = g_new (RenderTask, 1);
+
+					task->page = page;
+					task->scale = g_array_index (scales, gdouble, i);
+					task->rotation = g_array_index (rotations, gint, j);
+					g_thread_pool_push (pool, task, NULL);
+				}
+			}
+		}
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	total = g_get_monotonic_time () - begin;
+
+	qsort (bench.latencies, bench.n_latencies, sizeof (gint64), compare_latencies);
+
+	g_print ("%s: %s, %d pages, loaded in %.1f ms\n",
+		 filename, G_OBJECT_TYPE_NAME (bench.document), n_pages, load_time / 1000.);
+	g_print ("  pages %d-%d, %u renders, %u failed, %d threads\n",
+		 first + 1, last + 1, n_tasks, bench.n_failed, n_threads);
+	g_print ("  latency ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+		 percentile (&bench, 0.5), percentile (&bench, 0.9),
+		 percentile (&bench, 0.99), percentile (&bench, 1.));
+	g_print ("  throughput: %.2f pages/s, %.2f Mpixels/s\n",
+		 bench.n_latencies / (total / (gdouble)G_USEC_PER_SEC),
+		 bench.n_pixels / 1e6 / (total / (gdouble)G_USEC_PER_SEC));
+	g_print ("  peak RSS: %ld KiB\n", get_peak_rss ());
+
+	g_free (bench.latencies);
+	g_mutex_clear (&bench.mutex);
+	g_object_unref (bench.document);
+
+	return bench.n_failed == 0;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	GArray         *scales, *rotations;
+	gboolean        failed = FALSE;
+	gint            i;
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context,
+				      "Renders the pages of documents with every backend, "
+				      "and reports the latency, throughput and peak memory use.");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (!files || n_threads < 1 || n_runs < 1) {
+		g_printerr ("Usage: %s [OPTION…] FILE…\n", argv[0]);
+		return 1;
+	}
+
+	scales = parse_doubles (scales_option, 1.);
+	rotations = parse_rotations (rotations_option);
+	if (scales->len == 0 || rotations->len == 0) {
+		g_printerr ("No valid scale or rotation given\n");
+		return 1;
+	}
+
+	if (!ev_init ()) {
+		g_printerr ("No document backends found\n");
+		return 1;
+	}
+
+	for (i = 0; files[i]; i++)
+		failed |= !bench_file (files[i], scales, rotations);
+
+	ev_shutdown ();
+
+	g_array_free (scales, TRUE);
+	g_array_free (rotations, TRUE);
+	g_strfreev (files);
+
+	return failed ? 1 : 0;
+}
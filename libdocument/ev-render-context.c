@@ -68,6 +68,10 @@ ev_render_context_new (EvPage *page,
 	rc->scale = scale;
 	rc->target_width = -1;
 	rc->target_height = -1;
+	rc->area.x = 0;
+	rc->area.y = 0;
+	rc->area.width = -1;
+	rc->area.height = -1;
 
 	return rc;
 }
@@ -113,6 +117,61 @@ ev_render_context_set_target_size (EvRenderContext *rc,
 	rc->target_height = target_height;
 }
 
+/**
+ * ev_render_context_set_area:
+ * @rc: an #EvRenderContext
+ * @area: (allow-none): the area to render, or %NULL to render the whole page
+ *
+ * Restricts rendering to @area, given in pixels of the transformed page, that
+ * is, with the scale, target size and rotation of @rc already applied. The
+ * surface returned by ev_document_render() will then have the size of @area,
+ * with its origin at the top left corner of @area.
+ *
+ * Since: 3.28
+ */
+void
+ev_render_context_set_area (EvRenderContext             *rc,
+			    const cairo_rectangle_int_t *area)
+{
+	g_return_if_fail (rc != NULL);
+
+	if (area) {
+		g_return_if_fail (area->width > 0 && area->height > 0);
+
+		rc->area = *area;
+	} else {
+		rc->area.x = 0;
+		rc->area.y = 0;
+		rc->area.width = -1;
+		rc->area.height = -1;
+	}
+}
+
+/**
+ * ev_render_context_get_area:
+ * @rc: an #EvRenderContext
+ * @area: (out) (allow-none): return location for the area to render
+ *
+ * Returns: %TRUE if only an area of the page is rendered with @rc,
+ *   %FALSE if the whole page is rendered.
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_render_context_get_area (EvRenderContext       *rc,
+			    cairo_rectangle_int_t *area)
+{
+	g_return_val_if_fail (rc != NULL, FALSE);
+
+	if (rc->area.width < 0 || rc->area.height < 0)
+		return FALSE;
+
+	if (area)
+		*area = rc->area;
+
+	return TRUE;
+}
+
 void
 ev_render_context_compute_scaled_size (EvRenderContext *rc,
 				       double		width_points,
@@ -25,6 +25,7 @@
 #define EV_RENDER_CONTEXT_H
 
 #include <glib-object.h>
+#include <cairo.h>
 
 #include "ev-page.h"
 
@@ -52,6 +53,10 @@ struct _EvRenderContext
 	gdouble scale;
 	gint	target_width;
 	gint	target_height;
+
+	/* Sub-rectangle of the transformed page to render,
+	 * width and height are -1 when the whole page is rendered */
+	cairo_rectangle_int_t area;
 };
 
 
@@ -68,6 +73,10 @@ void             ev_render_context_set_scale       (EvRenderContext *rc,
 void             ev_render_context_set_target_size (EvRenderContext *rc,
                                                     int              target_width,
                                                     int              target_height);
+void             ev_render_context_set_area        (EvRenderContext *rc,
+                                                    const cairo_rectangle_int_t *area);
+gboolean         ev_render_context_get_area        (EvRenderContext *rc,
+                                                    cairo_rectangle_int_t *area);
 void             ev_render_context_compute_scaled_size      (EvRenderContext *rc,
                                                              double           width_points,
                                                              double           height_points,
@@ -0,0 +1,311 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include "ev-trace.h"
+
+/* Recorded events are kept in a ring, the oldest ones are
+ * dropped when it's full.
+ */
+#define EV_TRACE_MAX_EVENTS (1 << 18)
+
+typedef struct {
+	const gchar     *name;
+	EvTraceCategory  category;
+	guint            tid;
+	gint64           ts;
+	gint64           value; /* Duration for spans, value for counters */
+	gboolean         is_counter;
+} EvTraceEvent;
+
+static EvTraceFlags  ev_trace_flags = EV_TRACE_NONE;
+static gint64        ev_trace_start_time = 0;
+
+static GMutex        trace_mutex;
+static EvTraceEvent *events = NULL;
+static guint         n_events = 0;
+static guint         first_event = 0;
+static EvTraceStats  stats[EV_TRACE_N_CATEGORIES];
+
+static GPrivate      thread_id;
+static gint          next_thread_id = 0;
+
+static const gchar *category_names[EV_TRACE_N_CATEGORIES] = {
+	"job-queue",
+	"job-run",
+	"lock-wait",
+	"draw",
+	"surface-bytes"
+};
+
+void
+_ev_trace_init (void)
+{
+	const GDebugKey keys[] = {
+		{ "record",  EV_TRACE_RECORD  },
+		{ "overlay", EV_TRACE_OVERLAY }
+	};
+
+	ev_trace_flags = g_parse_debug_string (g_getenv ("EV_TRACE"), keys, G_N_ELEMENTS (keys));
+	if (ev_trace_flags == EV_TRACE_NONE)
+		return;
+
+	ev_trace_start_time = g_get_monotonic_time ();
+	if (ev_trace_flags & EV_TRACE_RECORD)
+		events = g_new (EvTraceEvent, EV_TRACE_MAX_EVENTS);
+}
+
+void
+_ev_trace_shutdown (void)
+{
+	if (ev_trace_flags & EV_TRACE_RECORD) {
+		const gchar *filename;
+		gchar       *default_filename = NULL;
+		GError      *error = NULL;
+
+		filename = g_getenv ("EV_TRACE_FILE");
+		if (!filename) {
+			gchar *basename;
+
+			basename = g_strdup_printf ("evince-trace-%d.json", getpid ());
+			default_filename = g_build_filename (g_get_tmp_dir (), basename, NULL);
+			g_free (basename);
+			filename = default_filename;
+		}
+
+		if (!ev_trace_dump (filename, &error)) {
+			g_warning ("Failed to write trace: %s", error->message);
+			g_error_free (error);
+		}
+		g_free (default_filename);
+	}
+
+	/* Other threads can still be recording */
+	g_mutex_lock (&trace_mutex);
+	ev_trace_flags = EV_TRACE_NONE;
+	g_clear_pointer (&events, g_free);
+	n_events = 0;
+	first_event = 0;
+	g_mutex_unlock (&trace_mutex);
+}
+
+EvTraceFlags
+ev_trace_get_flags (void)
+{
+	return ev_trace_flags;
+}
+
+/* Returns 0 when tracing is off, so that callers can pass the
+ * result on to ev_trace_record() without checking.
+ */
+gint64
+ev_trace_now (void)
+{
+	if (G_LIKELY (ev_trace_flags == EV_TRACE_NONE))
+		return 0;
+
+	return g_get_monotonic_time ();
+}
+
+static guint
+get_thread_id (void)
+{
+	guint tid;
+
+	tid = GPOINTER_TO_UINT (g_private_get (&thread_id));
+	if (tid == 0) {
+		tid = g_atomic_int_add (&next_thread_id, 1) + 1;
+		g_private_set (&thread_id, GUINT_TO_POINTER (tid));
+	}
+
+	return tid;
+}
+
+static void
+ev_trace_add (EvTraceCategory category,
+	      const gchar    *name,
+	      gint64          ts,
+	      gint64          value,
+	      gboolean        is_counter)
+{
+	EvTraceStats *category_stats = &stats[category];
+
+	g_mutex_lock (&trace_mutex);
+
+	/* Tracing was shut down since the caller checked the flags */
+	if (ev_trace_flags == EV_TRACE_NONE) {
+		g_mutex_unlock (&trace_mutex);
+		return;
+	}
+
+	category_stats->count++;
+	category_stats->total += value;
+	category_stats->max = MAX (category_stats->max, value);
+	category_stats->last = value;
+
+	if (events) {
+		EvTraceEvent *event;
+
+		if (n_events < EV_TRACE_MAX_EVENTS) {
+			event = &events[(first_event + n_events) % EV_TRACE_MAX_EVENTS];
+			n_events++;
+		} else {
+			event = &events[first_event];
+			first_event = (first_event + 1) % EV_TRACE_MAX_EVENTS;
+		}
+
+		event->name = name;
+		event->category = category;
+		event->tid = get_thread_id ();
+		event->ts = ts - ev_trace_start_time;
+		event->value = value;
+		event->is_counter = is_counter;
+	}
+
+	g_mutex_unlock (&trace_mutex);
+}
+
+/**
+ * ev_trace_record:
+ * @category: the category of the span
+ * @name: a static or interned name for the span
+ * @start: start time returned by ev_trace_now()
+ * @end: end time returned by ev_trace_now()
+ *
+ * Records a span of time. Nothing is recorded if @start is 0, which
+ * is what ev_trace_now() returns when tracing is off.
+ */
+void
+ev_trace_record (EvTraceCategory category,
+		 const gchar    *name,
+		 gint64          start,
+		 gint64          end)
+{
+	if (G_LIKELY (ev_trace_flags == EV_TRACE_NONE) || start == 0)
+		return;
+
+	ev_trace_add (category, name, start, end - start, FALSE);
+}
+
+/**
+ * ev_trace_count:
+ * @category: the category of the value
+ * @name: a static or interned name for the value
+ * @value: the value
+ *
+ * Records a value at the current time, like a surface size.
+ */
+void
+ev_trace_count (EvTraceCategory category,
+		const gchar    *name,
+		gint64          value)
+{
+	if (G_LIKELY (ev_trace_flags == EV_TRACE_NONE))
+		return;
+
+	ev_trace_add (category, name, g_get_monotonic_time (), value, TRUE);
+}
+
+void
+ev_trace_get_stats (EvTraceCategory category,
+		    EvTraceStats   *category_stats)
+{
+	g_mutex_lock (&trace_mutex);
+	*category_stats = stats[category];
+	g_mutex_unlock (&trace_mutex);
+}
+
+const gchar *
+ev_trace_get_category_name (EvTraceCategory category)
+{
+	return category_names[category];
+}
+
+static void
+append_json_string (GString     *json,
+		    const gchar *str)
+{
+	const gchar *p;
+
+	g_string_append_c (json, '"');
+	for (p = str; *p; p++) {
+		if (*p == '"' || *p == '\\')
+			g_string_append_c (json, '\\');
+		if ((guchar)*p < 0x20)
+			g_string_append_printf (json, "\\u%04x", *p);
+		else
+			g_string_append_c (json, *p);
+	}
+	g_string_append_c (json, '"');
+}
+
+/**
+ * ev_trace_dump:
+ * @filename: the file to write
+ * @error: location to store the error occurring, or %NULL to ignore
+ *
+ * Writes the recorded events to @filename in the Chrome trace event
+ * format, which can be loaded in chrome://tracing or Perfetto. Spans
+ * are complete events and values are counter events.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ */
+gboolean
+ev_trace_dump (const gchar *filename,
+	       GError     **error)
+{
+	GString  *json;
+	gboolean  retval;
+	guint     i;
+	gint      pid = getpid ();
+
+	json = g_string_new ("{\"traceEvents\":[");
+
+	g_mutex_lock (&trace_mutex);
+	for (i = 0; i < n_events; i++) {
+		EvTraceEvent *event = &events[(first_event + i) % EV_TRACE_MAX_EVENTS];
+
+		if (i > 0)
+			g_string_append_c (json, ',');
+		g_string_append (json, "\n{\"name\":");
+		append_json_string (json, event->name ? event->name : "");
+		g_string_append_printf (json,
+					",\"cat\":\"%s\",\"pid\":%d,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT,
+					category_names[event->category], pid, event->tid, event->ts);
+		if (event->is_counter) {
+			g_string_append_printf (json,
+						",\"ph\":\"C\",\"args\":{\"%s\":%" G_GINT64_FORMAT "}}",
+						category_names[event->category], event->value);
+		} else {
+			g_string_append_printf (json,
+						",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT "}",
+						event->value);
+		}
+	}
+	g_mutex_unlock (&trace_mutex);
+
+	g_string_append (json, "\n]}\n");
+
+	retval = g_file_set_contents (filename, json->str, json->len, error);
+	g_string_free (json, TRUE);
+
+	return retval;
+}
@@ -0,0 +1,83 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#ifndef __EV_TRACE_H__
+#define __EV_TRACE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Unlike the profiler in ev-debug.h, tracing is always built in. It is
+ * turned on at run time with the EV_TRACE env var, a list of:
+ *
+ *  record:  keeps the events in memory and writes them in Chrome trace
+ *           JSON format at shutdown, to EV_TRACE_FILE or to
+ *           evince-trace-<pid>.json in the tmp dir
+ *  overlay: draws the statistics of every category over EvView
+ *
+ * When tracing is off, ev_trace_now() returns 0 and the other calls
+ * return right away.
+ */
+typedef enum {
+	EV_TRACE_NONE    = 0,
+	EV_TRACE_RECORD  = 1 << 0,
+	EV_TRACE_OVERLAY = 1 << 1
+} EvTraceFlags;
+
+typedef enum {
+	EV_TRACE_JOB_QUEUE,     /* From push to run of a thread job, in us */
+	EV_TRACE_JOB_RUN,       /* Run of a job, in us */
+	EV_TRACE_LOCK_WAIT,     /* Wait for a contended document lock, in us */
+	EV_TRACE_DRAW,          /* EvView draw, in us */
+	EV_TRACE_SURFACE_BYTES, /* Size of the rendered surfaces, in bytes */
+	EV_TRACE_N_CATEGORIES
+} EvTraceCategory;
+
+typedef struct {
+	guint  count;
+	gint64 total;
+	gint64 max;
+	gint64 last;
+} EvTraceStats;
+
+void         _ev_trace_init                (void);
+void         _ev_trace_shutdown            (void);
+
+EvTraceFlags ev_trace_get_flags            (void);
+gint64       ev_trace_now                  (void);
+void         ev_trace_record               (EvTraceCategory  category,
+					    const gchar     *name,
+					    gint64           start,
+					    gint64           end);
+void         ev_trace_count                (EvTraceCategory  category,
+					    const gchar     *name,
+					    gint64           value);
+void         ev_trace_get_stats            (EvTraceCategory  category,
+					    EvTraceStats    *stats);
+const gchar *ev_trace_get_category_name    (EvTraceCategory  category);
+gboolean     ev_trace_dump                 (const gchar     *filename,
+					    GError         **error);
+
+G_END_DECLS
+
+#endif /* __EV_TRACE_H__ */
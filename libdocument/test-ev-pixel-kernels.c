@@ -0,0 +1,258 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "ev-pixel-kernels.h"
+
+#define DEFAULT_WIDTH  1920
+#define DEFAULT_HEIGHT 1080
+#define N_RUNS         20
+
+typedef enum {
+	KERNEL_RGBA_TO_ARGB32,
+	KERNEL_RGB_TO_RGB24,
+	KERNEL_ARGB32_TO_RGBA,
+	KERNEL_RGB24_TO_RGB,
+	KERNEL_INVERT_RGBA,
+	KERNEL_INVERT_RGB,
+	N_KERNELS
+} Kernel;
+
+static const gchar *kernel_names[N_KERNELS] = {
+	"rgba_to_argb32",
+	"rgb_to_rgb24",
+	"argb32_to_rgba",
+	"rgb24_to_rgb",
+	"invert_rgb (RGBA)",
+	"invert_rgb (RGB)"
+};
+
+typedef struct {
+	gint     width;
+	gint     height;
+	guchar  *bytes;
+	guint32 *words;
+	guchar  *bytes_out;
+	guint32 *words_out;
+} Image;
+
+/* Odd row lengths so that every kernel has leftover pixels. A third
+ * of the pixels is translucent, like antialiased edges and
+ * annotations.
+ */
+static void
+image_init (Image *image,
+	    gint   width,
+	    gint   height)
+{
+	gsize n_pixels = (gsize) width * height;
+	gsize i;
+
+	image->width = width;
+	image->height = height;
+	image->bytes = g_malloc (n_pixels * 4);
+	image->words = g_new (guint32, n_pixels);
+	image->bytes_out = g_malloc (n_pixels * 4);
+	image->words_out = g_new (guint32, n_pixels);
+
+	for (i = 0; i < n_pixels * 4; i++)
+		image->bytes[i] = g_random_int_range (0, 256);
+	for (i = 0; i < n_pixels; i++) {
+		if (i % 3 != 0)
+			image->bytes[i * 4 + 3] = 0xff;
+	}
+
+	/* Premultiplied input for the conversions back */
+	ev_pixel_kernels_set_isa (EV_PIXEL_KERNELS_ISA_SCALAR);
+	ev_pixel_kernels_rgba_to_argb32 (image->bytes, image->words, n_pixels);
+}
+
+static void
+image_finish (Image *image)
+{
+	g_free (image->bytes);
+	g_free (image->words);
+	g_free (image->bytes_out);
+	g_free (image->words_out);
+}
+
+static void
+run_kernel (Image  *image,
+	    Kernel  kernel)
+{
+	gint y;
+
+	/* Row by row, as ev-document-misc does */
+	for (y = 0; y < image->height; y++) {
+		gsize offset = (gsize) y * image->width;
+
+		switch (kernel) {
+		case KERNEL_RGBA_TO_ARGB32:
+			ev_pixel_kernels_rgba_to_argb32 (image->bytes + offset * 4,
+							 image->words_out + offset,
+							 image->width);
+			break;
+		case KERNEL_RGB_TO_RGB24:
+			ev_pixel_kernels_rgb_to_rgb24 (image->bytes + offset * 3,
+						       image->words_out + offset,
+						       image->width);
+			break;
+		case KERNEL_ARGB32_TO_RGBA:
+			ev_pixel_kernels_argb32_to_rgba (image->words + offset,
+							 image->bytes_out + offset * 4,
+							 image->width);
+			break;
+		case KERNEL_RGB24_TO_RGB:
+			ev_pixel_kernels_rgb24_to_rgb (image->words + offset,
+						       image->bytes_out + offset * 3,
+						       image->width);
+			break;
+		case KERNEL_INVERT_RGBA:
+			ev_pixel_kernels_invert_rgb (image->bytes_out + offset * 4,
+						     image->width, 4);
+			break;
+		case KERNEL_INVERT_RGB:
+			ev_pixel_kernels_invert_rgb (image->bytes_out + offset * 3,
+						     image->width, 3);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+}
+
+/* Runs @kernel once and returns a copy of its output */
+static gpointer
+kernel_output (Image  *image,
+	       Kernel  kernel,
+	       gsize  *size)
+{
+	gsize n_pixels = (gsize) image->width * image->height;
+
+	switch (kernel) {
+	case KERNEL_RGBA_TO_ARGB32:
+	case KERNEL_RGB_TO_RGB24:
+		run_kernel (image, kernel);
+		*size = n_pixels * 4;
+		return g_memdup (image->words_out, *size);
+	case KERNEL_ARGB32_TO_RGBA:
+	case KERNEL_INVERT_RGBA:
+		memcpy (image->bytes_out, image->bytes, n_pixels * 4);
+		run_kernel (image, kernel);
+		*size = n_pixels * 4;
+		return g_memdup (image->bytes_out, *size);
+	case KERNEL_RGB24_TO_RGB:
+	case KERNEL_INVERT_RGB:
+		memcpy (image->bytes_out, image->bytes, n_pixels * 3);
+		run_kernel (image, kernel);
+		*size = n_pixels * 3;
+		return g_memdup (image->bytes_out, *size);
+	default:
+		g_assert_not_reached ();
+	}
+
+	return NULL;
+}
+
+/* Returns the best time of N_RUNS in µs */
+static gint64
+time_kernel (Image  *image,
+	     Kernel  kernel)
+{
+	gint64 best = G_MAXINT64;
+	gint   i;
+
+	for (i = 0; i < N_RUNS; i++) {
+		gint64 begin = g_get_monotonic_time ();
+
+		run_kernel (image, kernel);
+		best = MIN (best, g_get_monotonic_time () - begin);
+	}
+
+	return best;
+}
+
+int
+main (int argc, char **argv)
+{
+	Image    image;
+	gint     width = DEFAULT_WIDTH;
+	gint     height = DEFAULT_HEIGHT;
+	Kernel   kernel;
+	gboolean failed = FALSE;
+
+	if (argc == 3) {
+		width = atoi (argv[1]);
+		height = atoi (argv[2]);
+	}
+	if (argc == 2 || argc > 3 || width <= 0 || height <= 0) {
+		g_print ("- Checks and times the pixel conversion kernels\n");
+		g_print ("Usage: %s [width height]\n", argv[0]);
+		return 1;
+	}
+
+	/* Make every row length odd */
+	width |= 1;
+	image_init (&image, width, height);
+
+	g_print ("%d×%d pixels, best of %d runs\n", width, height, N_RUNS);
+	for (kernel = 0; kernel < N_KERNELS; kernel++) {
+		gpointer          reference;
+		gsize             size;
+		gint64            scalar_time;
+		EvPixelKernelsIsa isa;
+
+		g_print ("%s:\n", kernel_names[kernel]);
+
+		ev_pixel_kernels_set_isa (EV_PIXEL_KERNELS_ISA_SCALAR);
+		reference = kernel_output (&image, kernel, &size);
+		scalar_time = time_kernel (&image, kernel);
+
+		for (isa = EV_PIXEL_KERNELS_ISA_SCALAR; isa < EV_PIXEL_KERNELS_N_ISAS; isa++) {
+			gpointer output;
+			gint64   time;
+
+			if (!ev_pixel_kernels_set_isa (isa))
+				continue;
+
+			output = kernel_output (&image, kernel, &size);
+			if (memcmp (output, reference, size) != 0) {
+				g_print ("  %-8s differs from scalar\n",
+					 ev_pixel_kernels_get_isa_name (isa));
+				failed = TRUE;
+			} else {
+				time = isa == EV_PIXEL_KERNELS_ISA_SCALAR ?
+					scalar_time : time_kernel (&image, kernel);
+				g_print ("  %-8s %8.2f ms  %5.2fx\n",
+					 ev_pixel_kernels_get_isa_name (isa),
+					 time / 1000., (gdouble) scalar_time / MAX (time, 1));
+			}
+			g_free (output);
+		}
+
+		g_free (reference);
+	}
+
+	image_finish (&image);
+
+	return failed ? 1 : 0;
+}
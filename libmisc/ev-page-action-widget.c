@@ -269,12 +269,21 @@ ev_page_action_widget_set_document (EvPageActionWidget *action_widget,
                 action_widget->signal_id = 0;
         }
 
-        if (action_widget->document)
+        if (action_widget->document) {
+                g_signal_handlers_disconnect_by_func (action_widget->document,
+                                                      ev_page_action_widget_update_max_width,
+                                                      action_widget);
                 g_object_unref (action_widget->document);
+        }
         action_widget->document = document;
         if (!action_widget->document)
                 return;
 
+        /* Labels may only be known once the document is fully cached */
+        g_signal_connect_swapped (action_widget->document, "cache-updated",
+                                  G_CALLBACK (ev_page_action_widget_update_max_width),
+                                  action_widget);
+
         action_widget->signal_id =
                 g_signal_connect (action_widget->doc_model,
                                   "page-changed",
@@ -0,0 +1,594 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "ev-find-index.h"
+#include "ev-debug.h"
+
+#define INDEX_NAME    "find-index"
+#define INDEX_MAGIC   "EvFindIx"
+#define INDEX_VERSION 3
+
+/* The indices of the least recently built documents are removed */
+#define INDEX_MAX_DOCUMENTS 64
+
+/* After the header of cache files, the index has this header followed
+ * by the trigrams, sorted, and their page lists. The page lists are the
+ * differences between consecutive pages, minus one, as base 128 varints.
+ * Numbers are stored in little endian.
+ */
+typedef struct {
+	guint32 n_pages;
+	guint32 n_trigrams;
+} IndexHeader;
+
+typedef struct {
+	guint64 trigram;
+	guint32 offset;
+	guint32 n_pages;
+} IndexEntry;
+
+struct _EvFindIndex {
+	volatile gint     ref_count;
+
+	GMappedFile      *file;
+	guint             n_pages;
+	const IndexEntry *entries;
+	guint             n_entries;
+	const guchar     *postings;
+	gsize             postings_size;
+};
+
+G_LOCK_DEFINE_STATIC (building);
+static GHashTable *building = NULL;
+
+#define CANCELLABLE_DATA "ev-find-index-cancellable"
+
+/* Case folds and decomposes @text, and drops the characters a search
+ * can match across or ignore: spaces, line breaks, dashes, marks and
+ * format characters. Every character is mapped on its own, so a string
+ * found in a page is still in the page once both are normalized, and
+ * the trigrams of the string are a subset of those of the page.
+ */
+static gunichar *
+normalize_text (const gchar *text,
+		glong       *length)
+{
+	gchar       *folded;
+	gchar       *normalized;
+	gunichar    *chars;
+	const gchar *p;
+	glong        n = 0;
+
+	*length = 0;
+
+	if (!g_utf8_validate (text, -1, NULL))
+		return NULL;
+
+	folded = g_utf8_casefold (text, -1);
+	normalized = g_utf8_normalize (folded, -1, G_NORMALIZE_ALL);
+	g_free (folded);
+	if (!normalized)
+		return NULL;
+
+	chars = g_new (gunichar, g_utf8_strlen (normalized, -1) + 1);
+	for (p = normalized; *p; p = g_utf8_next_char (p)) {
+		gunichar c = g_utf8_get_char (p);
+
+		switch (g_unichar_type (c)) {
+		case G_UNICODE_CONTROL:
+		case G_UNICODE_FORMAT:
+		case G_UNICODE_SPACE_SEPARATOR:
+		case G_UNICODE_LINE_SEPARATOR:
+		case G_UNICODE_PARAGRAPH_SEPARATOR:
+		case G_UNICODE_DASH_PUNCTUATION:
+		case G_UNICODE_NON_SPACING_MARK:
+		case G_UNICODE_SPACING_MARK:
+		case G_UNICODE_ENCLOSING_MARK:
+			break;
+		default:
+			chars[n++] = c;
+		}
+	}
+	g_free (normalized);
+
+	*length = n;
+
+	return chars;
+}
+
+/* Lists the pages without text, which are always searched. Characters
+ * fit in 21 bits, so no trigram has this value.
+ */
+#define NO_TEXT_TRIGRAM G_MAXUINT64
+
+/* Characters fit in 21 bits */
+static inline guint64
+get_trigram (const gunichar *chars)
+{
+	return ((guint64) chars[0] << 42) | ((guint64) chars[1] << 21) | chars[2];
+}
+
+static void
+ev_find_index_free (EvFindIndex *index)
+{
+	g_mapped_file_unref (index->file);
+	g_free (index);
+}
+
+/* Loads the index of @document, when one was built for the current
+ * contents of its file
+ */
+EvFindIndex *
+ev_find_index_lookup (EvDocument *document)
+{
+	EvFindIndex       *index;
+	const gchar       *uri;
+	GMappedFile       *file;
+	const IndexHeader *header;
+	const gchar       *contents;
+	gsize              size, header_offset, entries_offset, postings_offset;
+	guint32            n_trigrams;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return NULL;
+
+	file = ev_cache_file_open (INDEX_NAME, INDEX_MAGIC, INDEX_VERSION, uri, &header_offset);
+	if (!file)
+		return NULL;
+
+	contents = g_mapped_file_get_contents (file);
+	size = g_mapped_file_get_length (file);
+	header = (const IndexHeader *) (contents + header_offset);
+	entries_offset = header_offset + sizeof (IndexHeader);
+
+	if (entries_offset > size ||
+	    GUINT32_FROM_LE (header->n_pages) != (guint32) ev_document_get_n_pages (document)) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	n_trigrams = GUINT32_FROM_LE (header->n_trigrams);
+	postings_offset = entries_offset + (gsize) n_trigrams * sizeof (IndexEntry);
+	if (postings_offset > size) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	index = g_new0 (EvFindIndex, 1);
+	index->ref_count = 1;
+	index->file = file;
+	index->n_pages = GUINT32_FROM_LE (header->n_pages);
+	index->entries = (const IndexEntry *) (contents + entries_offset);
+	index->n_entries = n_trigrams;
+	index->postings = (const guchar *) contents + postings_offset;
+	index->postings_size = size - postings_offset;
+
+	return index;
+}
+
+EvFindIndex *
+ev_find_index_ref (EvFindIndex *index)
+{
+	g_return_val_if_fail (index != NULL, NULL);
+
+	g_atomic_int_inc (&index->ref_count);
+
+	return index;
+}
+
+void
+ev_find_index_unref (EvFindIndex *index)
+{
+	g_return_if_fail (index != NULL);
+
+	if (g_atomic_int_dec_and_test (&index->ref_count))
+		ev_find_index_free (index);
+}
+
+static const IndexEntry *
+ev_find_index_lookup_trigram (EvFindIndex *index,
+			      guint64      trigram)
+{
+	guint lo = 0, hi = index->n_entries;
+
+	while (lo < hi) {
+		guint   mid = lo + (hi - lo) / 2;
+		guint64 value = GUINT64_FROM_LE (index->entries[mid].trigram);
+
+		if (value == trigram)
+			return &index->entries[mid];
+		if (value < trigram)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/* Sets the pages in the page list of @entry to TRUE in @pages */
+static void
+ev_find_index_read_pages (EvFindIndex      *index,
+			  const IndexEntry *entry,
+			  gboolean         *pages)
+{
+	gsize   offset = GUINT32_FROM_LE (entry->offset);
+	guint32 n_pages = GUINT32_FROM_LE (entry->n_pages);
+	guint64 page = 0;
+	guint32 i;
+
+	for (i = 0; i < n_pages; i++) {
+		guint64 delta = 0;
+		guint   shift = 0;
+
+		while (offset < index->postings_size && shift < 35) {
+			guchar byte = index->postings[offset++];
+
+			delta |= (guint64) (byte & 0x7f) << shift;
+			shift += 7;
+			if (!(byte & 0x80))
+				break;
+		}
+
+		page += delta;
+		if (page >= index->n_pages)
+			return;
+
+		pages[page++] = TRUE;
+	}
+}
+
+static gint
+compare_entries_by_n_pages (gconstpointer a,
+			    gconstpointer b)
+{
+	const IndexEntry *entry_a = *(const IndexEntry **) a;
+	const IndexEntry *entry_b = *(const IndexEntry **) b;
+
+	return (gint) GUINT32_FROM_LE (entry_a->n_pages) - (gint) GUINT32_FROM_LE (entry_b->n_pages);
+}
+
+/* Returns an array with an element per page, TRUE for the pages that
+ * can contain @text, or NULL when @text is too short to use the index
+ * and every page can
+ */
+gboolean *
+ev_find_index_get_candidates (EvFindIndex *index,
+			      const gchar *text)
+{
+	gunichar         *chars;
+	glong             length, i;
+	GPtrArray        *entries;
+	const IndexEntry *no_text;
+	gboolean         *candidates;
+	gboolean         *pages;
+	guint             j, page;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (text != NULL, NULL);
+
+	chars = normalize_text (text, &length);
+	if (length < 3) {
+		g_free (chars);
+		return NULL;
+	}
+
+	candidates = g_new0 (gboolean, index->n_pages);
+	pages = g_new (gboolean, index->n_pages);
+
+	entries = g_ptr_array_new ();
+	for (i = 0; i + 2 < length; i++) {
+		const IndexEntry *entry;
+
+		entry = ev_find_index_lookup_trigram (index, get_trigram (chars + i));
+		if (!entry) {
+			/* No page has it */
+			g_ptr_array_set_size (entries, 0);
+			break;
+		}
+		g_ptr_array_add (entries, (gpointer) entry);
+	}
+	g_free (chars);
+
+	if (entries->len > 0) {
+		/* Start with the rarest trigrams, they rule out the most pages */
+		g_ptr_array_sort (entries, compare_entries_by_n_pages);
+
+		ev_find_index_read_pages (index, g_ptr_array_index (entries, 0), candidates);
+		for (j = 1; j < entries->len; j++) {
+			memset (pages, 0, index->n_pages * sizeof (gboolean));
+			ev_find_index_read_pages (index, g_ptr_array_index (entries, j), pages);
+
+			for (page = 0; page < index->n_pages; page++)
+				candidates[page] = candidates[page] && pages[page];
+		}
+	}
+	g_ptr_array_free (entries, TRUE);
+
+	no_text = ev_find_index_lookup_trigram (index, NO_TEXT_TRIGRAM);
+	if (no_text)
+		ev_find_index_read_pages (index, no_text, candidates);
+	g_free (pages);
+
+	return candidates;
+}
+
+typedef struct {
+	guint64     trigram;
+	guint32     next_page;
+	guint32     n_pages;
+	GByteArray *postings;
+} Posting;
+
+static void
+posting_free (Posting *posting)
+{
+	g_byte_array_unref (posting->postings);
+	g_slice_free (Posting, posting);
+}
+
+static Posting *
+get_posting (GHashTable *postings,
+	     guint64     trigram)
+{
+	Posting *posting;
+
+	posting = g_hash_table_lookup (postings, &trigram);
+	if (!posting) {
+		posting = g_slice_new0 (Posting);
+		posting->trigram = trigram;
+		posting->postings = g_byte_array_new ();
+		g_hash_table_insert (postings, &posting->trigram, posting);
+	}
+
+	return posting;
+}
+
+static gint
+compare_postings (gconstpointer a,
+		  gconstpointer b)
+{
+	const Posting *posting_a = *(const Posting **) a;
+	const Posting *posting_b = *(const Posting **) b;
+
+	if (posting_a->trigram == posting_b->trigram)
+		return 0;
+
+	return posting_a->trigram < posting_b->trigram ? -1 : 1;
+}
+
+static void
+posting_add_page (Posting *posting,
+		  guint32  page)
+{
+	guint32 delta;
+	guint8  byte;
+
+	/* Every trigram of a page is added, the page only once */
+	if (posting->n_pages > 0 && posting->next_page > page)
+		return;
+
+	delta = page - posting->next_page;
+	while (delta >= 0x80) {
+		byte = (delta & 0x7f) | 0x80;
+
+		g_byte_array_append (posting->postings, &byte, 1);
+		delta >>= 7;
+	}
+	byte = delta;
+	g_byte_array_append (posting->postings, &byte, 1);
+
+	posting->next_page = page + 1;
+	posting->n_pages++;
+}
+
+static void
+ev_find_index_save (const gchar *uri,
+		    guint64      mtime,
+		    guint64      file_size,
+		    guint32      n_pages,
+		    GHashTable  *postings)
+{
+	GPtrArray     *sorted;
+	GByteArray    *data;
+	GHashTableIter iter;
+	IndexHeader    header;
+	Posting       *posting;
+	guint32        offset = 0;
+	guint          i;
+
+	sorted = g_ptr_array_sized_new (g_hash_table_size (postings));
+	g_hash_table_iter_init (&iter, postings);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &posting))
+		g_ptr_array_add (sorted, posting);
+	g_ptr_array_sort (sorted, compare_postings);
+
+	header.n_pages = GUINT32_TO_LE (n_pages);
+	header.n_trigrams = GUINT32_TO_LE (sorted->len);
+
+	data = ev_cache_file_new_data (INDEX_MAGIC, INDEX_VERSION, uri, mtime, file_size);
+	g_byte_array_append (data, (guint8 *) &header, sizeof (header));
+
+	for (i = 0; i < sorted->len; i++) {
+		IndexEntry entry;
+
+		posting = g_ptr_array_index (sorted, i);
+		entry.trigram = GUINT64_TO_LE (posting->trigram);
+		entry.offset = GUINT32_TO_LE (offset);
+		entry.n_pages = GUINT32_TO_LE (posting->n_pages);
+		g_byte_array_append (data, (guint8 *) &entry, sizeof (entry));
+
+		offset += posting->postings->len;
+	}
+
+	for (i = 0; i < sorted->len; i++) {
+		posting = g_ptr_array_index (sorted, i);
+		g_byte_array_append (data, posting->postings->data, posting->postings->len);
+	}
+	g_ptr_array_free (sorted, TRUE);
+
+	ev_cache_file_save (INDEX_NAME, uri, data, INDEX_MAX_DOCUMENTS);
+	g_byte_array_unref (data);
+}
+
+typedef struct {
+	GWeakRef      document;
+	gchar        *uri;
+	gint          n_pages;
+	GCancellable *cancellable;
+} BuildData;
+
+static void
+build_data_free (BuildData *data)
+{
+	g_weak_ref_clear (&data->document);
+	g_free (data->uri);
+	g_object_unref (data->cancellable);
+	g_slice_free (BuildData, data);
+}
+
+static void
+cancel_build (GCancellable *cancellable)
+{
+	g_cancellable_cancel (cancellable);
+	g_object_unref (cancellable);
+}
+
+static gpointer
+ev_find_index_build_thread (BuildData *data)
+{
+	guint64     mtime, file_size;
+	GHashTable *postings;
+	gint        page;
+	gboolean    complete;
+
+	/* Taken first: a change while building makes the index stale */
+	complete = ev_cache_file_get_stamp (data->uri, &mtime, &file_size);
+
+	ev_debug_message (DEBUG_JOBS, "building find index for %s", data->uri);
+	ev_profiler_start (EV_PROFILE_JOBS, "Find index (%s)", data->uri);
+
+	postings = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+					  NULL, (GDestroyNotify) posting_free);
+
+	for (page = 0; page < data->n_pages && complete; page++) {
+		EvDocument *document;
+		EvPage     *ev_page;
+		gchar      *text;
+		gunichar   *chars;
+		glong       length, i;
+
+		/* The document is only kept alive while reading a page,
+		 * closing it cancels the build
+		 */
+		document = g_weak_ref_get (&data->document);
+		if (!document || g_cancellable_is_cancelled (data->cancellable)) {
+			g_clear_object (&document);
+			complete = FALSE;
+			break;
+		}
+
+		ev_document_render_lock (document);
+		ev_page = ev_document_get_page (document, page);
+		text = ev_document_text_get_text (EV_DOCUMENT_TEXT (document), ev_page);
+		g_object_unref (ev_page);
+		ev_document_render_unlock (document);
+		g_object_unref (document);
+
+		if (!text) {
+			posting_add_page (get_posting (postings, NO_TEXT_TRIGRAM), page);
+			continue;
+		}
+
+		chars = normalize_text (text, &length);
+		g_free (text);
+
+		for (i = 0; i + 2 < length; i++)
+			posting_add_page (get_posting (postings, get_trigram (chars + i)), page);
+		g_free (chars);
+	}
+
+	if (complete)
+		ev_find_index_save (data->uri, mtime, file_size, data->n_pages, postings);
+	g_hash_table_destroy (postings);
+
+	ev_profiler_stop (EV_PROFILE_JOBS, "Find index (%s)", data->uri);
+
+	G_LOCK (building);
+	g_hash_table_remove (building, data->uri);
+	G_UNLOCK (building);
+
+	build_data_free (data);
+
+	return NULL;
+}
+
+/* Builds the index of @document in a thread, unless it is already
+ * being built. The text of the pages is read with the document lock
+ * held one page at a time, so rendering goes on in the meantime. The
+ * build is cancelled when @document is finalized. Documents that were
+ * opened with a password aren't indexed, their text isn't written to
+ * the disk.
+ */
+void
+ev_find_index_build (EvDocument *document)
+{
+	const gchar *uri;
+	BuildData   *data;
+	GThread     *thread;
+
+	if (!EV_IS_DOCUMENT_TEXT (document))
+		return;
+
+	if (EV_IS_DOCUMENT_SECURITY (document) &&
+	    ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document)))
+		return;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return;
+
+	G_LOCK (building);
+	if (!building)
+		building = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (g_hash_table_contains (building, uri)) {
+		G_UNLOCK (building);
+		return;
+	}
+	g_hash_table_add (building, g_strdup (uri));
+	G_UNLOCK (building);
+
+	data = g_slice_new0 (BuildData);
+	g_weak_ref_init (&data->document, document);
+	data->uri = g_strdup (uri);
+	data->n_pages = ev_document_get_n_pages (document);
+	data->cancellable = g_cancellable_new ();
+	g_object_set_data_full (G_OBJECT (document), CANCELLABLE_DATA,
+				g_object_ref (data->cancellable),
+				(GDestroyNotify) cancel_build);
+
+	thread = g_thread_new ("EvFindIndex",
+			       (GThreadFunc) ev_find_index_build_thread,
+			       data);
+	g_thread_unref (thread);
+}
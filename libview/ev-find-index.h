@@ -0,0 +1,46 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_VIEW_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-view.h> can be included directly."
+#endif
+
+#ifndef EV_FIND_INDEX_H
+#define EV_FIND_INDEX_H
+
+#include <glib.h>
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+/* An on-disk trigram index of the text of a document, stored in the
+ * user cache dir and keyed by the document URI, modification time and
+ * size. It only tells which pages can contain a search string: the
+ * backend still finds the matches on those pages.
+ */
+typedef struct _EvFindIndex EvFindIndex;
+
+EvFindIndex *ev_find_index_lookup         (EvDocument   *document);
+EvFindIndex *ev_find_index_ref            (EvFindIndex  *index);
+void         ev_find_index_unref          (EvFindIndex  *index);
+gboolean    *ev_find_index_get_candidates (EvFindIndex  *index,
+					   const gchar  *text);
+void         ev_find_index_build          (EvDocument   *document);
+
+G_END_DECLS
+
+#endif /* EV_FIND_INDEX_H */
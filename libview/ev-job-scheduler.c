@@ -19,64 +19,126 @@
  */
 
 #include "ev-debug.h"
+#include "ev-trace.h"
 #include "ev-job-scheduler.h"
 
+/* Upper bound for the number of worker threads, the pool
+ * size can be overridden with the EV_JOB_THREADS env var.
+ */
+#define EV_JOB_SCHEDULER_MAX_WORKERS 32
+
+typedef struct _EvJobWorker EvJobWorker;
+
 typedef struct _EvSchedulerJob {
 	EvJob         *job;
 	EvJobPriority  priority;
 	GSList        *job_link;
+	EvJobWorker   *worker; /* Worker whose queue holds the job, NULL once dequeued */
+	gint64         push_time;
 } EvSchedulerJob;
 
+/* Every worker owns one queue per priority. The owner takes
+ * jobs from the head of its queues, idle workers steal from
+ * the tail of other workers' queues. A job is always taken
+ * from the highest non-empty priority across all the workers,
+ * so urgent jobs never wait behind low priority ones.
+ */
+struct _EvJobWorker {
+	guint          index;
+	GThread       *thread;
+	GQueue         queue[EV_JOB_N_PRIORITIES];
+	volatile EvJob *running_job;
+};
+
 G_LOCK_DEFINE_STATIC(job_list);
 static GSList *job_list = NULL;
 
-static volatile EvJob *running_job = NULL;
-
 static gpointer ev_job_thread_proxy               (gpointer        data);
 static void     ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 						   GCancellable   *cancellable);
 
 /* EvJobQueue */
-static GQueue queue_urgent = G_QUEUE_INIT;
-static GQueue queue_high = G_QUEUE_INIT;
-static GQueue queue_low = G_QUEUE_INIT;
-static GQueue queue_none = G_QUEUE_INIT;
-static GCond job_queue_cond;
-static GMutex job_queue_mutex;
-
-static GQueue *job_queue[EV_JOB_N_PRIORITIES] = {
-	&queue_urgent,
-	&queue_high,
-	&queue_low,
-	&queue_none
-};
+static EvJobWorker *workers = NULL;
+static guint        n_workers = 0;
+static guint        next_worker = 0;
+static GPrivate     current_worker;
+static GCond        job_queue_cond;
+static GMutex       job_queue_mutex;
+
+static guint
+ev_job_scheduler_get_n_workers (void)
+{
+	const gchar *env;
+	guint        n;
+
+	n = g_get_num_processors ();
+
+	env = g_getenv ("EV_JOB_THREADS");
+	if (env) {
+		guint64 value = g_ascii_strtoull (env, NULL, 10);
+
+		if (value > 0)
+			n = MIN (value, EV_JOB_SCHEDULER_MAX_WORKERS);
+	}
+
+	return CLAMP (n, 1, EV_JOB_SCHEDULER_MAX_WORKERS);
+}
 
 static void
 ev_job_queue_push (EvSchedulerJob *job,
 		   EvJobPriority   priority)
 {
+	EvJobWorker *worker;
+
 	ev_debug_message (DEBUG_JOBS, "%s priority %d", EV_GET_TYPE_NAME (job->job), priority);
 	
 	g_mutex_lock (&job_queue_mutex);
 
-	g_queue_push_tail (job_queue[priority], job);
-	g_cond_broadcast (&job_queue_cond);
+	/* Jobs pushed from a worker stay on that worker,
+	 * the rest are spread over the pool.
+	 */
+	worker = g_private_get (&current_worker);
+	if (!worker) {
+		worker = &workers[next_worker];
+		next_worker = (next_worker + 1) % n_workers;
+	}
+
+	job->worker = worker;
+	g_queue_push_tail (&worker->queue[priority], job);
+	g_cond_signal (&job_queue_cond);
 	
 	g_mutex_unlock (&job_queue_mutex);
 }
 
 static EvSchedulerJob *
-ev_job_queue_get_next_unlocked (void)
+ev_job_queue_get_next_unlocked (EvJobWorker *worker)
 {
 	gint i;
 	EvSchedulerJob *job = NULL;
 	
-	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES; i++) {
-		job = (EvSchedulerJob *) g_queue_pop_head (job_queue[i]);
+	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES && !job; i++) {
+		guint j;
+
+		job = (EvSchedulerJob *) g_queue_pop_head (&worker->queue[i]);
 		if (job)
 			break;
+
+		for (j = 1; j < n_workers; j++) {
+			EvJobWorker *victim = &workers[(worker->index + j) % n_workers];
+
+			job = (EvSchedulerJob *) g_queue_pop_tail (&victim->queue[i]);
+			if (job) {
+				ev_debug_message (DEBUG_JOBS, "worker %u stole %s from worker %u",
+						  worker->index, EV_GET_TYPE_NAME (job->job),
+						  victim->index);
+				break;
+			}
+		}
 	}
 
+	if (job)
+		job->worker = NULL;
+
 	ev_debug_message (DEBUG_JOBS, "%s", job ? EV_GET_TYPE_NAME (job->job) : "No jobs in queue");
 
 	return job;
@@ -85,7 +147,31 @@ ev_job_queue_get_next_unlocked (void)
 static gpointer
 ev_job_scheduler_init (gpointer data)
 {
-	g_thread_new ("EvJobScheduler", ev_job_thread_proxy, NULL);
+	guint i, n;
+
+	n = ev_job_scheduler_get_n_workers ();
+	workers = g_new0 (EvJobWorker, n);
+
+	for (i = 0; i < n; i++) {
+		EvJobWorker *worker = &workers[i];
+		gint         j;
+
+		worker->index = i;
+		for (j = 0; j < EV_JOB_N_PRIORITIES; j++)
+			g_queue_init (&worker->queue[j]);
+	}
+
+	g_atomic_int_set (&n_workers, n);
+
+	/* Start the threads once all the queues are ready,
+	 * since any worker can steal from any other.
+	 */
+	for (i = 0; i < n; i++) {
+		gchar *name = g_strdup_printf ("EvJobScheduler%u", i);
+
+		workers[i].thread = g_thread_new (name, ev_job_thread_proxy, &workers[i]);
+		g_free (name);
+	}
 
 	return NULL;
 }
@@ -148,7 +234,7 @@ static void
 ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 				   GCancellable   *cancellable)
 {
-	GList   *list;
+	GList   *list = NULL;
 	
 	ev_debug_message (DEBUG_JOBS, "%s", EV_GET_TYPE_NAME (job->job));
 
@@ -159,9 +245,11 @@ ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 	 * If the job is currently running, it will be
 	 * destroyed as soon as it finishes. 
 	 */
-	list = g_queue_find (job_queue[job->priority], job);
+	if (job->worker)
+		list = g_queue_find (&job->worker->queue[job->priority], job);
 	if (list) {
-		g_queue_delete_link (job_queue[job->priority], list);
+		g_queue_delete_link (&job->worker->queue[job->priority], list);
+		job->worker = NULL;
 		g_mutex_unlock (&job_queue_mutex);
 		ev_scheduler_job_destroy (job);
 	} else {
@@ -170,51 +258,69 @@ ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 }
 
 static void
-ev_job_thread (EvJob *job)
+ev_job_thread (EvJobWorker *worker,
+	       EvJob       *job)
 {
 	gboolean result;
+	gint64   start;
 
 	ev_debug_message (DEBUG_JOBS, "%s", EV_GET_TYPE_NAME (job));
 
+	start = ev_trace_now ();
 	do {
 		if (g_cancellable_is_cancelled (job->cancellable))
 			result = FALSE;
 		else {
-                        g_atomic_pointer_set (&running_job, job);
+                        g_atomic_pointer_set (&worker->running_job, job);
 			result = ev_job_run (job);
                 }
 	} while (result);
 
-        g_atomic_pointer_set (&running_job, NULL);
+        g_atomic_pointer_set (&worker->running_job, NULL);
+
+	ev_trace_record (EV_TRACE_JOB_RUN, EV_GET_TYPE_NAME (job), start, ev_trace_now ());
 }
 
 static gboolean
 ev_job_idle (EvJob *job)
 {
+	gboolean result;
+	gint64   start;
+
 	ev_debug_message (DEBUG_JOBS, "%s", EV_GET_TYPE_NAME (job));
 
 	if (g_cancellable_is_cancelled (job->cancellable))
 		return FALSE;
 
-	return ev_job_run (job);
+	start = ev_trace_now ();
+	result = ev_job_run (job);
+	ev_trace_record (EV_TRACE_JOB_RUN, EV_GET_TYPE_NAME (job), start, ev_trace_now ());
+
+	return result;
 }
 
 static gpointer
 ev_job_thread_proxy (gpointer data)
 {
+	EvJobWorker *worker = (EvJobWorker *)data;
+
+	g_private_set (&current_worker, worker);
+
 	while (TRUE) {
 		EvSchedulerJob *job;
 
 		g_mutex_lock (&job_queue_mutex);
-		job = ev_job_queue_get_next_unlocked ();
+		job = ev_job_queue_get_next_unlocked (worker);
 		if (!job) {
 			g_cond_wait (&job_queue_cond, &job_queue_mutex);
 			g_mutex_unlock (&job_queue_mutex);
 			continue;
 		}
 		g_mutex_unlock (&job_queue_mutex);
-		
-		ev_job_thread (job->job);
+
+		ev_trace_record (EV_TRACE_JOB_QUEUE, EV_GET_TYPE_NAME (job->job),
+				 job->push_time, ev_trace_now ());
+		ev_job_thread (worker, job->job);
 		ev_scheduler_job_destroy (job);
 	}
 
@@ -235,6 +341,7 @@ ev_job_scheduler_push_job (EvJob         *job,
 	s_job = g_new0 (EvSchedulerJob, 1);
 	s_job->job = g_object_ref (job);
 	s_job->priority = priority;
+	s_job->push_time = ev_trace_now ();
 
 	ev_scheduler_job_list_add (s_job);
 	
@@ -290,17 +397,19 @@ ev_job_scheduler_update_job (EvJob         *job,
 	G_UNLOCK (job_list);
 
 	if (need_resort) {
-		GList *list;
+		GList *list = NULL;
 	
 		g_mutex_lock (&job_queue_mutex);
 		
-		list = g_queue_find (job_queue[s_job->priority], s_job);
+		if (s_job->worker)
+			list = g_queue_find (&s_job->worker->queue[s_job->priority], s_job);
 		if (list) {
 			ev_debug_message (DEBUG_JOBS, "Moving job %s from pirority %d to %d",
 					  EV_GET_TYPE_NAME (job), s_job->priority, priority);
-			g_queue_delete_link (job_queue[s_job->priority], list);
-			g_queue_push_tail (job_queue[priority], s_job);
-			g_cond_broadcast (&job_queue_cond);
+			g_queue_delete_link (&s_job->worker->queue[s_job->priority], list);
+			g_queue_push_tail (&s_job->worker->queue[priority], s_job);
+			s_job->priority = priority;
+			g_cond_signal (&job_queue_cond);
 		}
 		
 		g_mutex_unlock (&job_queue_mutex);
@@ -310,10 +419,50 @@ ev_job_scheduler_update_job (EvJob         *job,
 /**
  * ev_job_scheduler_get_running_thread_job:
  *
+ * When called from a worker thread, returns the job running in that
+ * thread. Otherwise returns any of the jobs currently running in the
+ * worker threads; use ev_job_scheduler_is_job_running() to check for
+ * a particular job.
+ *
  * Returns: (transfer none): an #EvJob
  */
 EvJob *
 ev_job_scheduler_get_running_thread_job (void)
 {
-        return g_atomic_pointer_get (&running_job);
+	EvJobWorker *worker;
+	guint        i;
+
+	worker = g_private_get (&current_worker);
+	if (worker)
+		return g_atomic_pointer_get (&worker->running_job);
+
+	for (i = 0; i < g_atomic_int_get (&n_workers); i++) {
+		EvJob *job = g_atomic_pointer_get (&workers[i].running_job);
+
+		if (job)
+			return job;
+	}
+
+	return NULL;
+}
+
+/**
+ * ev_job_scheduler_is_job_running:
+ * @job: an #EvJob
+ *
+ * Returns: %TRUE if @job is currently running in one of the worker threads
+ *
+ * Since: 3.28
+ */
+gboolean
+ev_job_scheduler_is_job_running (EvJob *job)
+{
+	guint i;
+
+	for (i = 0; i < g_atomic_int_get (&n_workers); i++) {
+		if (g_atomic_pointer_get (&workers[i].running_job) == job)
+			return TRUE;
+	}
+
+	return FALSE;
 }
@@ -37,7 +37,10 @@
 #include "ev-document-attachments.h"
 #include "ev-document-media.h"
 #include "ev-document-text.h"
+#include "ev-find-index.h"
+#include "ev-job-scheduler.h"
 #include "ev-debug.h"
+#include "ev-trace.h"
 
 #include <errno.h>
 #include <glib/gstdio.h>
@@ -87,6 +90,12 @@ enum {
 	FIND_LAST_SIGNAL
 };
 
+#define EV_JOB_LOAD_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), EV_TYPE_JOB_LOAD, EvJobLoadPrivate))
+
+typedef struct {
+	EvDocumentLoadFlags flags;
+} EvJobLoadPrivate;
+
 static guint job_signals[LAST_SIGNAL] = { 0 };
 static guint job_fonts_signals[FONTS_LAST_SIGNAL] = { 0 };
 static guint job_find_signals[FIND_LAST_SIGNAL] = { 0 };
@@ -385,9 +394,9 @@ ev_job_links_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_links->model = ev_document_links_get_links_model (EV_DOCUMENT_LINKS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	gtk_tree_model_foreach (job_links->model, (GtkTreeModelForeachFunc)fill_page_labels, job);
 
@@ -468,10 +477,10 @@ ev_job_attachments_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_attachments->attachments =
 		ev_document_attachments_get_attachments (EV_DOCUMENT_ATTACHMENTS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -535,7 +544,7 @@ ev_job_annots_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	for (i = 0; i < ev_document_get_n_pages (job->document); i++) {
 		EvMappingList *mapping_list;
 		EvPage        *page;
@@ -548,7 +557,7 @@ ev_job_annots_run (EvJob *job)
 		if (mapping_list)
 			job_annots->annots = g_list_prepend (job_annots->annots, mapping_list);
 	}
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	job_annots->annots = g_list_reverse (job_annots->annots);
 
@@ -585,6 +594,8 @@ static void
 ev_job_render_init (EvJobRender *job)
 {
 	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+	job->area.width = -1;
+	job->area.height = -1;
 }
 
 static void
@@ -620,27 +631,36 @@ ev_job_render_run (EvJob *job)
 	EvJobRender     *job_render = EV_JOB_RENDER (job);
 	EvPage          *ev_page;
 	EvRenderContext *rc;
+	gboolean         need_fc_lock;
 
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_render->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_render_lock (job->document);
 
 	ev_profiler_start (EV_PROFILE_JOBS, "Rendering page %d", job_render->page);
-		
-	ev_document_fc_mutex_lock ();
+
+	/* Backends with re-entrant rendering take care of
+	 * serializing their own FontConfig usage.
+	 */
+	need_fc_lock = !(ev_document_get_render_flags (job->document) & EV_DOCUMENT_RENDER_FLAG_REENTRANT);
+	if (need_fc_lock)
+		ev_document_fc_mutex_lock ();
 
 	ev_page = ev_document_get_page (job->document, job_render->page);
 	rc = ev_render_context_new (ev_page, job_render->rotation, job_render->scale);
 	ev_render_context_set_target_size (rc,
 					   job_render->target_width, job_render->target_height);
+	if (job_render->area.width > 0 && job_render->area.height > 0)
+		ev_render_context_set_area (rc, &job_render->area);
 	g_object_unref (ev_page);
 
 	job_render->surface = ev_document_render (job->document, rc);
 
 	if (job_render->surface == NULL) {
-		ev_document_fc_mutex_unlock ();
-		ev_document_doc_mutex_unlock ();
+		if (need_fc_lock)
+			ev_document_fc_mutex_unlock ();
+		ev_document_render_unlock (job->document);
 		g_object_unref (rc);
 
 		ev_job_failed (job,
@@ -656,8 +676,9 @@ ev_job_render_run (EvJob *job)
 	 * we return now, so that the thread is finished ASAP
 	 */
 	if (g_cancellable_is_cancelled (job->cancellable)) {
-		ev_document_fc_mutex_unlock ();
-		ev_document_doc_mutex_unlock ();
+		if (need_fc_lock)
+			ev_document_fc_mutex_unlock ();
+		ev_document_render_unlock (job->document);
 		g_object_unref (rc);
 
 		return FALSE;
@@ -680,9 +701,15 @@ ev_job_render_run (EvJob *job)
 
 	g_object_unref (rc);
 
-	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
-	
+	if (need_fc_lock)
+		ev_document_fc_mutex_unlock ();
+	ev_document_render_unlock (job->document);
+
+	if (cairo_surface_get_type (job_render->surface) == CAIRO_SURFACE_TYPE_IMAGE)
+		ev_trace_count (EV_TRACE_SURFACE_BYTES, EV_GET_TYPE_NAME (job),
+				(gint64)cairo_image_surface_get_stride (job_render->surface) *
+				cairo_image_surface_get_height (job_render->surface));
+
 	ev_job_succeeded (job);
 	
 	return FALSE;
@@ -737,6 +764,27 @@ ev_job_render_set_selection_info (EvJobRender     *job,
 	job->base = *base;
 }
 
+/**
+ * ev_job_render_set_area:
+ * @job: an #EvJobRender
+ * @area: the area of the page to render
+ *
+ * Restricts the rendering of @job to @area, in pixels of the page
+ * rendered at the job scale and rotation. The resulting surface
+ * has the size of @area. See ev_render_context_set_area().
+ *
+ * Since: 3.28
+ */
+void
+ev_job_render_set_area (EvJobRender  *job,
+			GdkRectangle *area)
+{
+	g_return_if_fail (EV_IS_JOB_RENDER (job));
+	g_return_if_fail (area != NULL);
+
+	job->area = *area;
+}
+
 /* EvJobPageData */
 static void
 ev_job_page_data_init (EvJobPageData *job)
@@ -753,31 +801,30 @@ ev_job_page_data_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_pd->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	/* Shared with the other users of the page text, and extracted only
+	 * once. It takes the document lock itself. */
+	if (job_pd->flags & (EV_PAGE_DATA_INCLUDE_TEXT |
+			     EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT |
+			     EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)) {
+		job_pd->page_text = ev_page_text_get (job->document, job_pd->page);
+		if (job_pd->page_text && (job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)) {
+			PangoLogAttr *log_attrs;
+			gulong        n_attrs;
+
+			ev_page_text_get_log_attrs (job_pd->page_text, &log_attrs, &n_attrs);
+		}
+	}
+
+	ev_document_lock (job->document);
 	ev_page = ev_document_get_page (job->document, job_pd->page);
 
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING) && EV_IS_DOCUMENT_TEXT (job->document))
 		job_pd->text_mapping =
 			ev_document_text_get_text_mapping (EV_DOCUMENT_TEXT (job->document), ev_page);
-	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT) && EV_IS_DOCUMENT_TEXT (job->document))
-		job_pd->text =
-			ev_document_text_get_text (EV_DOCUMENT_TEXT (job->document), ev_page);
-	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) && EV_IS_DOCUMENT_TEXT (job->document))
-		ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (job->document),
-						  ev_page,
-						  &(job_pd->text_layout),
-						  &(job_pd->text_layout_length));
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS) && EV_IS_DOCUMENT_TEXT (job->document))
 		job_pd ->text_attrs =
 			ev_document_text_get_text_attrs (EV_DOCUMENT_TEXT (job->document),
 							 ev_page);
-        if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) && job_pd->text) {
-                job_pd->text_log_attrs_length = g_utf8_strlen (job_pd->text, -1);
-                job_pd->text_log_attrs = g_new0 (PangoLogAttr, job_pd->text_log_attrs_length + 1);
-
-                /* FIXME: We need API to get the language of the document */
-                pango_get_log_attrs (job_pd->text, -1, -1, NULL, job_pd->text_log_attrs, job_pd->text_log_attrs_length + 1);
-        }
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_LINKS) && EV_IS_DOCUMENT_LINKS (job->document))
 		job_pd->link_mapping =
 			ev_document_links_get_links (EV_DOCUMENT_LINKS (job->document), ev_page);
@@ -798,7 +845,7 @@ ev_job_page_data_run (EvJob *job)
                         ev_document_media_get_media_mapping (EV_DOCUMENT_MEDIA (job->document),
                                                              ev_page);
 	g_object_unref (ev_page);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -871,7 +918,7 @@ ev_job_thumbnail_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, "%d (%p)", job_thumb->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_render_lock (job->document);
 
 	page = ev_document_get_page (job->document, job_thumb->page);
 	rc = ev_render_context_new (page, job_thumb->rotation, job_thumb->scale);
@@ -884,7 +931,7 @@ ev_job_thumbnail_run (EvJob *job)
         else
                 job_thumb->thumbnail_surface = ev_document_get_thumbnail_surface (job->document, rc);
 	g_object_unref (rc);
-	ev_document_doc_mutex_unlock ();
+	ev_document_render_unlock (job->document);
 
         /* EV_JOB_THUMBNAIL_SURFACE is not compatible with has_frame = TRUE */
         if (job_thumb->format == EV_JOB_THUMBNAIL_PIXBUF && pixbuf) {
@@ -1003,11 +1050,13 @@ ev_job_fonts_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	
 	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
+	if (!ev_document_trylock (job->document))
 		return TRUE;
 	
-	if (!ev_document_fc_mutex_trylock ())
+	if (!ev_document_fc_mutex_trylock ()) {
+		ev_document_unlock (job->document);
 		return TRUE;
+	}
 
 #ifdef EV_ENABLE_DEBUG
 	/* We use the #ifdef in this case because of the if */
@@ -1020,7 +1069,7 @@ ev_job_fonts_run (EvJob *job)
 		       ev_document_fonts_get_progress (fonts));
 
 	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	if (job_fonts->scan_completed)
 		ev_job_succeeded (job);
@@ -1084,14 +1133,17 @@ ev_job_load_dispose (GObject *object)
 		job->password = NULL;
 	}
 
+	g_clear_object (&job->stream);
+
 	(* G_OBJECT_CLASS (ev_job_load_parent_class)->dispose) (object);
 }
 
 static gboolean
 ev_job_load_run (EvJob *job)
 {
-	EvJobLoad *job_load = EV_JOB_LOAD (job);
-	GError    *error = NULL;
+	EvJobLoad        *job_load = EV_JOB_LOAD (job);
+	EvJobLoadPrivate *priv = EV_JOB_LOAD_GET_PRIVATE (job);
+	GError           *error = NULL;
 	
 	ev_debug_message (DEBUG_JOBS, "%s", job_load->uri);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
@@ -1113,14 +1165,30 @@ ev_job_load_run (EvJob *job)
 		job->finished = FALSE;
 		g_clear_error (&job->error);
 
-		uncompressed_uri = g_object_get_data (G_OBJECT (job->document),
-						      "uri-uncompressed");
-		ev_document_load (job->document,
-				  uncompressed_uri ? uncompressed_uri : job_load->uri,
-				  &error);
+		if (job_load->stream) {
+			if (g_seekable_seek (G_SEEKABLE (job_load->stream), 0, G_SEEK_SET,
+					     job->cancellable, &error)) {
+				ev_document_load_stream (job->document, job_load->stream,
+							 priv->flags, job->cancellable,
+							 &error);
+			}
+		} else {
+			uncompressed_uri = g_object_get_data (G_OBJECT (job->document),
+							      "uri-uncompressed");
+			ev_document_load_full (job->document,
+					       uncompressed_uri ? uncompressed_uri : job_load->uri,
+					       priv->flags, &error);
+		}
+	} else if (job_load->stream) {
+		job->document = ev_document_factory_get_document_for_stream (job_load->stream,
+									     NULL,
+									     priv->flags,
+									     job->cancellable,
+									     &error);
 	} else {
-		job->document = ev_document_factory_get_document (job_load->uri,
-								  &error);
+		job->document = ev_document_factory_get_document_full (job_load->uri,
+								       priv->flags,
+								       &error);
 	}
 
 	ev_document_fc_mutex_unlock ();
@@ -1141,6 +1209,8 @@ ev_job_load_class_init (EvJobLoadClass *class)
 	GObjectClass *oclass = G_OBJECT_CLASS (class);
 	EvJobClass   *job_class = EV_JOB_CLASS (class);
 
+	g_type_class_add_private (class, sizeof (EvJobLoadPrivate));
+
 	oclass->dispose = ev_job_load_dispose;
 	job_class->run = ev_job_load_run;
 }
@@ -1168,6 +1238,48 @@ ev_job_load_set_uri (EvJobLoad *job, const gchar *uri)
 	job->uri = g_strdup (uri);
 }
 
+/**
+ * ev_job_load_set_stream:
+ * @job: an #EvJobLoad
+ * @stream: (allow-none): a seekable #GInputStream, or %NULL
+ *
+ * Makes @job load the document from @stream instead of its URI, which
+ * is still the URI the document is known by. This is used to read
+ * remote documents through an #EvRangeStream.
+ *
+ * Since: 3.28
+ */
+void
+ev_job_load_set_stream (EvJobLoad    *job,
+			GInputStream *stream)
+{
+	g_return_if_fail (EV_IS_JOB_LOAD (job));
+	g_return_if_fail (stream == NULL || G_IS_SEEKABLE (stream));
+
+	if (stream)
+		g_object_ref (stream);
+	g_clear_object (&job->stream);
+	job->stream = stream;
+}
+
+/**
+ * ev_job_load_set_load_flags:
+ * @job: an #EvJobLoad
+ * @flags: flags from #EvDocumentLoadFlags
+ *
+ * Sets the flags used to load the document.
+ *
+ * Since: 3.28
+ */
+void
+ev_job_load_set_load_flags (EvJobLoad          *job,
+			    EvDocumentLoadFlags flags)
+{
+	g_return_if_fail (EV_IS_JOB_LOAD (job));
+
+	EV_JOB_LOAD_GET_PRIVATE (job)->flags = flags;
+}
+
 void
 ev_job_load_set_password (EvJobLoad *job, const gchar *password)
 {
@@ -1512,7 +1624,7 @@ ev_job_save_run (EvJob *job)
 	}
 	close (fd);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	/* Save document to temp filename */
 	local_uri = g_filename_to_uri (tmp_filename, NULL, &error);
@@ -1520,7 +1632,7 @@ ev_job_save_run (EvJob *job)
                 ev_document_save (job->document, local_uri, &error);
         }
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	if (error) {
 		g_free (local_uri);
@@ -1618,10 +1730,32 @@ ev_job_save_new (EvDocument  *document,
 }
 
 /* EvJobFind */
+
+/* Pages are handed out to the search threads in chunks, following the
+ * search order, so results come in roughly from the start page on.
+ */
+#define FIND_CHUNK_SIZE 4
+
 static void
 ev_job_find_init (EvJobFind *job)
 {
-	EV_JOB (job)->run_mode = EV_JOB_RUN_MAIN_LOOP;
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+
+	g_mutex_init (&job->mutex);
+}
+
+static void
+ev_job_find_free_results (GList **pages,
+			  gint    n_pages)
+{
+	gint i;
+
+	for (i = 0; i < n_pages; i++) {
+		g_list_foreach (pages[i], (GFunc)ev_rectangle_free, NULL);
+		g_list_free (pages[i]);
+	}
+
+	g_free (pages);
 }
 
 static void
@@ -1637,61 +1771,244 @@ ev_job_find_dispose (GObject *object)
 	}
 
 	if (job->pages) {
-		gint i;
+		ev_job_find_free_results (job->pages, job->n_pages);
+		job->pages = NULL;
+	}
+
+	if (job->found) {
+		ev_job_find_free_results (job->found, job->n_pages);
+		job->found = NULL;
+	}
+
+	g_clear_pointer (&job->searched, g_free);
+	g_clear_pointer (&job->candidates, g_free);
+
+	(* G_OBJECT_CLASS (ev_job_find_parent_class)->dispose) (object);
+}
+
+static void
+ev_job_find_finalize (GObject *object)
+{
+	EvJobFind *job = EV_JOB_FIND (object);
+
+	g_mutex_clear (&job->mutex);
+
+	(* G_OBJECT_CLASS (ev_job_find_parent_class)->finalize) (object);
+}
+
+/* Moves the results of the pages searched since the last time to the
+ * results array and emits updated for them, in search order, stopping
+ * at the first page still being searched.
+ */
+static gboolean
+ev_job_find_emit_updated (EvJobFind *job)
+{
+	EvJob *ev_job = EV_JOB (job);
+
+	g_mutex_lock (&job->mutex);
+	job->updated_id = 0;
+	g_mutex_unlock (&job->mutex);
+
+	if (g_cancellable_is_cancelled (ev_job->cancellable))
+		return FALSE;
 
-		for (i = 0; i < job->n_pages; i++) {
-			g_list_foreach (job->pages[i], (GFunc)ev_rectangle_free, NULL);
-			g_list_free (job->pages[i]);
+	while (TRUE) {
+		gint     page = job->current_page;
+		gboolean searched;
+
+		g_mutex_lock (&job->mutex);
+		searched = job->searched[page];
+		if (searched) {
+			job->pages[page] = job->found[page];
+			job->found[page] = NULL;
 		}
+		g_mutex_unlock (&job->mutex);
 
-		g_free (job->pages);
-		job->pages = NULL;
+		if (!searched)
+			break;
+
+		if (!job->has_results)
+			job->has_results = (job->pages[page] != NULL);
+
+		g_signal_emit (job, job_find_signals[FIND_UPDATED], 0, page);
+
+		/* A handler might have cancelled the search */
+		if (g_cancellable_is_cancelled (ev_job->cancellable))
+			return FALSE;
+
+		job->current_page = (page + 1) % job->n_pages;
+		if (job->current_page == job->start_page) {
+			ev_job_succeeded (ev_job);
+			break;
+		}
 	}
-	
-	(* G_OBJECT_CLASS (ev_job_find_parent_class)->dispose) (object);
+
+	return FALSE;
+}
+
+static void
+ev_job_find_page_searched (EvJobFind *job,
+			   gint       page,
+			   GList     *matches)
+{
+	g_mutex_lock (&job->mutex);
+
+	job->found[page] = matches;
+	job->searched[page] = TRUE;
+
+	/* Updates are batched: the pages searched before the idle
+	 * runs are all emitted at once
+	 */
+	if (!job->updated_id) {
+		job->updated_id =
+			g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+					 (GSourceFunc)ev_job_find_emit_updated,
+					 g_object_ref (job),
+					 (GDestroyNotify)g_object_unref);
+	}
+
+	g_mutex_unlock (&job->mutex);
+}
+
+static gpointer
+ev_job_find_thread (EvJobFind *job_find)
+{
+	EvJob          *job = EV_JOB (job_find);
+	EvDocumentFind *find = EV_DOCUMENT_FIND (job->document);
+
+	while (!g_cancellable_is_cancelled (job->cancellable)) {
+		gint first, i;
+
+		first = g_atomic_int_add (&job_find->next_page, FIND_CHUNK_SIZE);
+		if (first >= job_find->n_pages)
+			break;
+
+		for (i = first; i < MIN (first + FIND_CHUNK_SIZE, job_find->n_pages); i++) {
+			gint    page = (job_find->start_page + i) % job_find->n_pages;
+			EvPage *ev_page;
+			GList  *matches;
+
+			if (g_cancellable_is_cancelled (job->cancellable))
+				break;
+
+			/* Pages the index rules out have no matches */
+			if (job_find->candidates && !job_find->candidates[page]) {
+				ev_job_find_page_searched (job_find, page, NULL);
+				continue;
+			}
+
+			/* Text search is as re-entrant as rendering is */
+			ev_document_render_lock (job->document);
+			ev_page = ev_document_get_page (job->document, page);
+			matches = ev_document_find_find_text_with_options (find, ev_page, job_find->text,
+									   job_find->options);
+			g_object_unref (ev_page);
+			ev_document_render_unlock (job->document);
+
+			ev_job_find_page_searched (job_find, page, matches);
+		}
+	}
+
+	return NULL;
+}
+
+/* Searches pages of an EvJobFind in another worker of the
+ * scheduler. It's only used by EvJobFind, so it's not public. */
+typedef struct {
+	EvJob      parent;
+
+	EvJobFind *job_find;
+} EvJobFindPages;
+
+typedef EvJobClass EvJobFindPagesClass;
+
+G_DEFINE_TYPE (EvJobFindPages, ev_job_find_pages, EV_TYPE_JOB)
+
+static void
+ev_job_find_pages_init (EvJobFindPages *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static void
+ev_job_find_pages_dispose (GObject *object)
+{
+	EvJobFindPages *job = (EvJobFindPages *) object;
+
+	g_clear_object (&job->job_find);
+
+	(* G_OBJECT_CLASS (ev_job_find_pages_parent_class)->dispose) (object);
+}
+
+static gboolean
+ev_job_find_pages_run (EvJob *job)
+{
+	/* Pages left are shared with the EvJobFind and the other
+	 * helpers, so this ends at once if they're all taken */
+	ev_job_find_thread (((EvJobFindPages *) job)->job_find);
+
+	return FALSE;
+}
+
+static void
+ev_job_find_pages_class_init (EvJobFindPagesClass *class)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+
+	oclass->dispose = ev_job_find_pages_dispose;
+	class->run = ev_job_find_pages_run;
 }
 
 static gboolean
 ev_job_find_run (EvJob *job)
 {
-	EvJobFind      *job_find = EV_JOB_FIND (job);
-	EvDocumentFind *find = EV_DOCUMENT_FIND (job->document);
-	EvPage         *ev_page;
-	GList          *matches;
+	EvJobFind   *job_find = EV_JOB_FIND (job);
+	EvFindIndex *index;
+	gboolean     indexed = FALSE;
+	gint         n_helpers, i;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
-#ifdef EV_ENABLE_DEBUG
-	/* We use the #ifdef in this case because of the if */
-	if (job_find->current_page == job_find->start_page)
-		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-#endif
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_page = ev_document_get_page (job->document, job_find->current_page);
-	matches = ev_document_find_find_text_with_options (find, ev_page, job_find->text,
-                                                           job_find->options);
-	g_object_unref (ev_page);
-	
-	ev_document_doc_mutex_unlock ();
+	/* Only the pages the index doesn't rule out are searched */
+	index = ev_find_index_lookup (job->document);
+	if (index) {
+		job_find->candidates = ev_find_index_get_candidates (index, job_find->text);
+		ev_find_index_unref (index);
+		indexed = TRUE;
+	}
 
-	if (!job_find->has_results)
-		job_find->has_results = (matches != NULL);
+	/* Pages can only be searched in parallel when the backend
+	 * doesn't serialize them anyway. The helpers go through the
+	 * scheduler, after the render jobs, and idle workers steal them
+	 * from this one: this job searches pages too, so it never waits
+	 * for a helper that isn't running.
+	 */
+	n_helpers = 0;
+	if (ev_document_get_render_flags (job->document) & EV_DOCUMENT_RENDER_FLAG_REENTRANT) {
+		n_helpers = CLAMP ((job_find->n_pages + FIND_CHUNK_SIZE - 1) / FIND_CHUNK_SIZE,
+				   1, (gint) g_get_num_processors ()) - 1;
+	}
 
-	job_find->pages[job_find->current_page] = matches;
-	g_signal_emit (job_find, job_find_signals[FIND_UPDATED], 0, job_find->current_page);
-		       
-	job_find->current_page = (job_find->current_page + 1) % job_find->n_pages;
-	if (job_find->current_page == job_find->start_page) {
-		ev_job_succeeded (job);
+	for (i = 0; i < n_helpers; i++) {
+		EvJobFindPages *helper;
 
-		return FALSE;
+		helper = g_object_new (ev_job_find_pages_get_type (), NULL);
+		EV_JOB (helper)->document = g_object_ref (job->document);
+		helper->job_find = g_object_ref (job_find);
+		ev_job_scheduler_push_job (EV_JOB (helper), EV_JOB_PRIORITY_NONE);
+		g_object_unref (helper);
 	}
+	ev_job_find_thread (job_find);
+
+	/* Searching the same document again is likely */
+	if (!indexed)
+		ev_find_index_build (job->document);
 
-	return TRUE;
+	/* The job succeeds once the updates for all the
+	 * pages have been emitted in the main loop
+	 */
+	return FALSE;
 }
 
 static void
@@ -1702,6 +2019,7 @@ ev_job_find_class_init (EvJobFindClass *class)
 	
 	job_class->run = ev_job_find_run;
 	gobject_class->dispose = ev_job_find_dispose;
+	gobject_class->finalize = ev_job_find_finalize;
 	
 	job_find_signals[FIND_UPDATED] =
 		g_signal_new ("updated",
@@ -1732,6 +2050,8 @@ ev_job_find_new (EvDocument  *document,
 	job->current_page = start_page;
 	job->n_pages = n_pages;
 	job->pages = g_new0 (GList *, n_pages);
+	job->found = g_new0 (GList *, n_pages);
+	job->searched = g_new0 (gboolean, n_pages);
 	job->text = g_strdup (text);
         /* Keep for compatibility */
 	job->case_sensitive = case_sensitive;
@@ -1848,9 +2168,9 @@ ev_job_layers_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_layers->model = ev_document_layers_get_layers (EV_DOCUMENT_LAYERS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -1916,7 +2236,7 @@ ev_job_export_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	
 	ev_page = ev_document_get_page (job->document, job_export->page);
 	if (job_export->rc) {
@@ -1932,7 +2252,7 @@ ev_job_export_run (EvJob *job)
 	
 	ev_file_exporter_do_page (EV_FILE_EXPORTER (job->document), job_export->rc);
 	
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -2011,14 +2331,14 @@ ev_job_print_run (EvJob *job)
 	job->finished = FALSE;
 	g_clear_error (&job->error);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	ev_page = ev_document_get_page (job->document, job_print->page);
 	ev_document_print_print_page (EV_DOCUMENT_PRINT (job->document),
 				      ev_page, job_print->cr);
 	g_object_unref (ev_page);
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
         if (g_cancellable_is_cancelled (job->cancellable))
                 return FALSE;
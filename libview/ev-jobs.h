@@ -285,6 +285,8 @@ struct _EvJobRender
 	EvSelectionStyle selection_style;
 	GdkColor base;
 	GdkColor text;
+
+	GdkRectangle area;
 };
 
 struct _EvJobRenderClass
@@ -320,12 +322,15 @@ struct _EvJobPageData
 	EvMappingList  *annot_mapping;
         EvMappingList  *media_mapping;
 	cairo_region_t *text_mapping;
+	/* Deprecated: never set anymore, use page_text */
 	gchar *text;
 	EvRectangle *text_layout;
 	guint text_layout_length;
         PangoAttrList *text_attrs;
+        /* Deprecated: never set anymore, use page_text */
         PangoLogAttr *text_log_attrs;
         gulong text_log_attrs_length;
+	EvPageText *page_text;
 };
 
 struct _EvJobPageDataClass
@@ -381,6 +386,7 @@ struct _EvJobLoad
 
 	gchar *uri;
 	gchar *password;
+	GInputStream *stream;
 };
 
 struct _EvJobLoadClass
@@ -441,6 +447,14 @@ struct _EvJobFind
 	gboolean case_sensitive;
 	gboolean has_results;
         EvFindOptions options;
+
+	/*< private >*/
+	GMutex    mutex;
+	GList   **found;
+	gboolean *searched;
+	gboolean *candidates;
+	gint      next_page;
+	guint     updated_id;
 };
 
 struct _EvJobFindClass
@@ -534,6 +548,8 @@ void     ev_job_render_set_selection_info (EvJobRender     *job,
 					   EvSelectionStyle selection_style,
 					   GdkColor        *text,
 					   GdkColor        *base);
+void     ev_job_render_set_area           (EvJobRender     *job,
+					   GdkRectangle    *area);
 /* EvJobPageData */
 GType           ev_job_page_data_get_type (void) G_GNUC_CONST;
 EvJob          *ev_job_page_data_new      (EvDocument      *document,
@@ -564,6 +580,10 @@ GType 		ev_job_load_get_type 	  (void) G_GNUC_CONST;
 EvJob 	       *ev_job_load_new 	  (const gchar 	   *uri);
 void            ev_job_load_set_uri       (EvJobLoad       *load,
 					   const gchar     *uri);
+void            ev_job_load_set_stream    (EvJobLoad       *job,
+					   GInputStream    *stream);
+void            ev_job_load_set_load_flags (EvJobLoad      *job,
+					   EvDocumentLoadFlags flags);
 void            ev_job_load_set_password  (EvJobLoad       *job,
 					   const gchar     *password);
 
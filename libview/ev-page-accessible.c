@@ -734,13 +734,13 @@ ev_page_accessible_get_selection (AtkText *text,
 
 			page = ev_document_get_page (view->document, selection->page);
 
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			selected_text = ev_selection_get_selected_text (EV_SELECTION (view->document),
 									page,
 									selection->style,
 									&(selection->rect));
 
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 			g_object_unref (page);
 
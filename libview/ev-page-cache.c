@@ -51,12 +51,8 @@ typedef struct _EvPageCacheData {
 	EvMappingList     *annot_mapping;
         EvMappingList     *media_mapping;
 	cairo_region_t    *text_mapping;
-	EvRectangle       *text_layout;
-	guint              text_layout_length;
-	gchar             *text;
+	EvPageText        *page_text;
 	PangoAttrList     *text_attrs;
-        PangoLogAttr      *text_log_attrs;
-        gulong             text_log_attrs_length;
 } EvPageCacheData;
 
 struct _EvPageCache {
@@ -132,27 +128,15 @@ ev_page_cache_data_free (EvPageCacheData *data)
 		data->text_mapping = NULL;
 	}
 
-	if (data->text_layout) {
-		g_free (data->text_layout);
-		data->text_layout = NULL;
-		data->text_layout_length = 0;
-	}
-
-	if (data->text) {
-		g_free (data->text);
-		data->text = NULL;
+	if (data->page_text) {
+		ev_page_text_unref (data->page_text);
+		data->page_text = NULL;
 	}
 
 	if (data->text_attrs) {
 		pango_attr_list_unref (data->text_attrs);
 		data->text_attrs = NULL;
 	}
-
-        if (data->text_log_attrs) {
-                g_free (data->text_log_attrs);
-                data->text_log_attrs = NULL;
-                data->text_log_attrs_length = 0;
-        }
 }
 
 static void
@@ -260,13 +244,13 @@ ev_page_cache_get_flags_for_data (EvPageCache     *cache,
 	}
 
 	if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT) {
-		flags = (data->text) ?
+		flags = (data->page_text) ?
 			flags & ~EV_PAGE_DATA_INCLUDE_TEXT :
 			flags | EV_PAGE_DATA_INCLUDE_TEXT;
 	}
 
 	if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-		flags = (data->text_layout_length > 0) ?
+		flags = (data->page_text) ?
 			flags & ~EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT :
 			flags | EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT;
 	}
@@ -278,7 +262,7 @@ ev_page_cache_get_flags_for_data (EvPageCache     *cache,
         }
 
         if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                flags = (data->text_log_attrs) ?
+                flags = (data->page_text) ?
                         flags & ~EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS :
                         flags | EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS;
         }
@@ -323,18 +307,13 @@ job_page_data_finished_cb (EvJob       *job,
                 data->media_mapping = job_data->media_mapping;
 	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING)
 		data->text_mapping = job_data->text_mapping;
-	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-		data->text_layout = job_data->text_layout;
-		data->text_layout_length = job_data->text_layout_length;
+	if (job_data->page_text) {
+		if (data->page_text)
+			ev_page_text_unref (data->page_text);
+		data->page_text = job_data->page_text;
 	}
-	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT)
-		data->text = job_data->text;
 	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)
 		data->text_attrs = job_data->text_attrs;
-        if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                data->text_log_attrs = job_data->text_log_attrs;
-                data->text_log_attrs_length = job_data->text_log_attrs_length;
-        }
 
 	data->done = TRUE;
 	data->dirty = FALSE;
@@ -464,22 +443,14 @@ ev_page_cache_mark_dirty (EvPageCache       *cache,
 	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING)
                 g_clear_pointer (&data->text_mapping, cairo_region_destroy);
 
-	if (flags & EV_PAGE_DATA_INCLUDE_TEXT)
-                g_clear_pointer (&data->text, g_free);
-
-	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-                g_clear_pointer (&data->text_layout, g_free);
-                data->text_layout_length = 0;
-        }
+	if (flags & (EV_PAGE_DATA_INCLUDE_TEXT |
+		     EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT |
+		     EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS))
+                g_clear_pointer (&data->page_text, ev_page_text_unref);
 
         if (flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)
                 g_clear_pointer (&data->text_attrs, pango_attr_list_unref);
 
-        if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                g_clear_pointer (&data->text_log_attrs, g_free);
-                data->text_log_attrs_length = 0;
-        }
-
 	/* Update the current range */
 	ev_page_cache_set_page_range (cache, cache->start_page, cache->end_page);
 }
@@ -616,11 +587,23 @@ ev_page_cache_get_text_mapping (EvPageCache *cache,
 	return data->text_mapping;
 }
 
+static EvPageText *
+ev_page_cache_get_page_text (EvPageCacheData *data)
+{
+	if (data->done)
+		return data->page_text;
+
+	if (data->job)
+		return EV_JOB_PAGE_DATA (data->job)->page_text;
+
+	return data->page_text;
+}
+
 const gchar *
 ev_page_cache_get_text (EvPageCache *cache,
 			     gint         page)
 {
-	EvPageCacheData *data;
+	EvPageText *page_text;
 
 	g_return_val_if_fail (EV_IS_PAGE_CACHE (cache), NULL);
 	g_return_val_if_fail (page >= 0 && page < cache->n_pages, NULL);
@@ -628,14 +611,9 @@ ev_page_cache_get_text (EvPageCache *cache,
 	if (!(cache->flags & EV_PAGE_DATA_INCLUDE_TEXT))
 		return NULL;
 
-	data = &cache->page_list[page];
-	if (data->done)
-		return data->text;
-
-	if (data->job)
-		return EV_JOB_PAGE_DATA (data->job)->text;
+	page_text = ev_page_cache_get_page_text (&cache->page_list[page]);
 
-	return data->text;
+	return page_text ? ev_page_text_get_text (page_text) : NULL;
 }
 
 gboolean
@@ -645,6 +623,7 @@ ev_page_cache_get_text_layout (EvPageCache  *cache,
 			       guint        *n_areas)
 {
 	EvPageCacheData *data;
+	EvPageText      *page_text;
 
 	g_return_val_if_fail (EV_IS_PAGE_CACHE (cache), FALSE);
 	g_return_val_if_fail (page >= 0 && page < cache->n_pages, FALSE);
@@ -653,21 +632,16 @@ ev_page_cache_get_text_layout (EvPageCache  *cache,
 		return FALSE;
 
 	data = &cache->page_list[page];
-	if (data->done)	{
-		*areas = data->text_layout;
-		*n_areas = data->text_layout_length;
-
-		return TRUE;
-	}
-
-	if (data->job) {
-		*areas = EV_JOB_PAGE_DATA (data->job)->text_layout;
-		*n_areas = EV_JOB_PAGE_DATA (data->job)->text_layout_length;
+	if (!data->done && !data->job)
+		return FALSE;
 
-		return TRUE;
-	}
+	*areas = NULL;
+	*n_areas = 0;
+	page_text = ev_page_cache_get_page_text (data);
+	if (page_text)
+		ev_page_text_get_layout (page_text, areas, n_areas);
 
-	return FALSE;
+	return TRUE;
 }
 
 /**
@@ -721,6 +695,7 @@ ev_page_cache_get_text_log_attrs (EvPageCache   *cache,
                                   gulong        *n_attrs)
 {
         EvPageCacheData *data;
+        EvPageText      *page_text;
 
         g_return_val_if_fail (EV_IS_PAGE_CACHE (cache), FALSE);
         g_return_val_if_fail (page >= 0 && page < cache->n_pages, FALSE);
@@ -729,21 +704,16 @@ ev_page_cache_get_text_log_attrs (EvPageCache   *cache,
                 return FALSE;
 
         data = &cache->page_list[page];
-        if (data->done) {
-                *log_attrs = data->text_log_attrs;
-                *n_attrs = data->text_log_attrs_length;
-
-                return TRUE;
-        }
-
-        if (data->job) {
-                *log_attrs = EV_JOB_PAGE_DATA (data->job)->text_log_attrs;
-                *n_attrs = EV_JOB_PAGE_DATA (data->job)->text_log_attrs_length;
+        if (!data->done && !data->job)
+                return FALSE;
 
-                return TRUE;
-        }
+        *log_attrs = NULL;
+        *n_attrs = 0;
+        page_text = ev_page_cache_get_page_text (data);
+        if (page_text)
+                ev_page_text_get_log_attrs (page_text, log_attrs, n_attrs);
 
-        return FALSE;
+        return TRUE;
 }
 
 void
@@ -1,13 +1,39 @@
 #include <config.h>
+#include <math.h>
 #include "ev-pixbuf-cache.h"
 #include "ev-job-scheduler.h"
 #include "ev-view-private.h"
+#include "ev-debug.h"
 
 typedef enum {
         SCROLL_DIRECTION_DOWN,
         SCROLL_DIRECTION_UP
 } ScrollDirection;
 
+typedef struct _CacheTile
+{
+	EvPixbufCacheTile tile;
+
+	EvJob  *job;
+	guint64 key;
+	gdouble scale;
+	gint    rotation;
+	gint    device_scale;
+	gint64  last_used;
+} CacheTile;
+
+/* A page surface kept after the page left the cached range */
+typedef struct _RetainedSurface
+{
+	gint             page;
+	gdouble          scale;
+	gint             rotation;
+	gint             device_scale;
+	gboolean         inverted;
+	cairo_surface_t *surface;
+	gsize            size;
+} RetainedSurface;
+
 typedef struct _CacheJobInfo
 {
 	EvJob *job;
@@ -18,6 +44,8 @@ typedef struct _CacheJobInfo
 
 	/* Data we get from rendering */
 	cairo_surface_t *surface;
+	gdouble          surface_scale;
+	gint             surface_rotation;
 
 	/* Device scale factor of target widget */
 	int device_scale;
@@ -36,6 +64,11 @@ typedef struct _CacheJobInfo
 	cairo_region_t *selection_region;
 	gdouble         selection_region_scale;
 	EvRectangle     selection_region_points;
+
+	/* Pages too large to be rendered at once are rendered in
+	 * tiles, drawn over a whole page surface at a lower scale */
+	gboolean    tiled;
+	GHashTable *tiles;
 } CacheJobInfo;
 
 struct _EvPixbufCache
@@ -63,6 +96,15 @@ struct _EvPixbufCache
 	CacheJobInfo *prev_job;
 	CacheJobInfo *job_list;
 	CacheJobInfo *next_job;
+
+	/* Surfaces of pages out of the range, most recently used first.
+	 * They use whatever max_size leaves after the pages in range. */
+	GQueue retained;
+	gsize  retained_size;
+
+	guint hits;
+	guint misses;
+	guint evictions;
 };
 
 struct _EvPixbufCacheClass
@@ -87,12 +129,16 @@ static void          ev_pixbuf_cache_finalize   (GObject            *object);
 static void          ev_pixbuf_cache_dispose    (GObject            *object);
 static void          job_finished_cb            (EvJob              *job,
 						 EvPixbufCache      *pixbuf_cache);
+static void          tile_job_finished_cb       (EvJob              *job,
+						 EvPixbufCache      *pixbuf_cache);
 static CacheJobInfo *find_job_cache             (EvPixbufCache      *pixbuf_cache,
 						 int                 page);
 static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cache,
 						  CacheJobInfo       *job_info,
 						  gint                page,
 						  gfloat              scale);
+static void          ev_pixbuf_cache_clear_job_sizes (EvPixbufCache *pixbuf_cache,
+						      gfloat         scale);
 
 
 /* These are used for iterating through the prev and next arrays */
@@ -105,6 +151,15 @@ static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cac
 
 #define MAX_PRELOADED_PAGES 3
 
+/* Size in device pixels of the tiles of tiled pages */
+#define TILE_SIZE 512
+/* Key of the tile at @row and @col in the tiles table of a page */
+#define TILE_KEY(row, col) ((guint64) (row) << 32 | (guint32) (col))
+/* Pages smaller than this are never tiled */
+#define TILED_PAGE_MIN_SIZE (16 * 1024 * 1024)
+/* Size of the whole page surface drawn under the tiles */
+#define TILED_BACKDROP_SIZE (4 * 1024 * 1024)
+
 G_DEFINE_TYPE (EvPixbufCache, ev_pixbuf_cache, G_TYPE_OBJECT)
 
 static void
@@ -112,6 +167,7 @@ ev_pixbuf_cache_init (EvPixbufCache *pixbuf_cache)
 {
 	pixbuf_cache->start_page = -1;
 	pixbuf_cache->end_page = -1;
+	g_queue_init (&pixbuf_cache->retained);
 }
 
 static void
@@ -175,6 +231,74 @@ end_job (CacheJobInfo *job_info,
 	job_info->job = NULL;
 }
 
+static void
+end_tile_job (CacheTile *tile,
+	      gpointer   data)
+{
+	g_signal_handlers_disconnect_by_func (tile->job,
+					      G_CALLBACK (tile_job_finished_cb),
+					      data);
+	ev_job_cancel (tile->job);
+	g_object_unref (tile->job);
+	tile->job = NULL;
+}
+
+static void
+dispose_tile (CacheTile *tile,
+	      gpointer   data)
+{
+	if (tile->job)
+		end_tile_job (tile, data);
+	if (tile->tile.surface)
+		cairo_surface_destroy (tile->tile.surface);
+	g_slice_free (CacheTile, tile);
+}
+
+static void
+dispose_tiles (CacheJobInfo *job_info,
+	       gpointer      data)
+{
+	GHashTableIter iter;
+	gpointer       tile;
+
+	if (!job_info->tiles)
+		return;
+
+	g_hash_table_iter_init (&iter, job_info->tiles);
+	while (g_hash_table_iter_next (&iter, NULL, &tile))
+		dispose_tile ((CacheTile *)tile, data);
+	g_hash_table_destroy (job_info->tiles);
+	job_info->tiles = NULL;
+}
+
+/* Drops the tiles of @job_info still being rendered that are
+ * outside @area, or all of them when @area is %NULL
+ */
+static void
+cancel_pending_tiles (CacheJobInfo *job_info,
+		      GdkRectangle *area,
+		      gpointer      data)
+{
+	GHashTableIter iter;
+	gpointer       value;
+
+	if (!job_info->tiles)
+		return;
+
+	g_hash_table_iter_init (&iter, job_info->tiles);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		CacheTile *tile = (CacheTile *)value;
+
+		if (!tile->job)
+			continue;
+		if (area && gdk_rectangle_intersect (&tile->tile.area, area, NULL))
+			continue;
+
+		g_hash_table_iter_remove (&iter);
+		dispose_tile (tile, data);
+	}
+}
+
 static void
 dispose_cache_job_info (CacheJobInfo *job_info,
 			gpointer      data)
@@ -184,6 +308,7 @@ dispose_cache_job_info (CacheJobInfo *job_info,
 
 	if (job_info->job)
 		end_job (job_info, data);
+	dispose_tiles (job_info, data);
 
 	if (job_info->surface) {
 		cairo_surface_destroy (job_info->surface);
@@ -205,6 +330,21 @@ dispose_cache_job_info (CacheJobInfo *job_info,
 	job_info->points_set = FALSE;
 }
 
+static void
+retained_surface_free (RetainedSurface *retained)
+{
+	cairo_surface_destroy (retained->surface);
+	g_slice_free (RetainedSurface, retained);
+}
+
+static void
+clear_retained_surfaces (EvPixbufCache *pixbuf_cache)
+{
+	g_queue_free_full (&pixbuf_cache->retained, (GDestroyNotify)retained_surface_free);
+	g_queue_init (&pixbuf_cache->retained);
+	pixbuf_cache->retained_size = 0;
+}
+
 static void
 ev_pixbuf_cache_dispose (GObject *object)
 {
@@ -213,6 +353,10 @@ ev_pixbuf_cache_dispose (GObject *object)
 
 	pixbuf_cache = EV_PIXBUF_CACHE (object);
 
+	ev_debug_message (DEBUG_JOBS, "hits: %u, misses: %u, evictions: %u",
+			  pixbuf_cache->hits, pixbuf_cache->misses, pixbuf_cache->evictions);
+	clear_retained_surfaces (pixbuf_cache);
+
 	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
 		dispose_cache_job_info (pixbuf_cache->prev_job + i, pixbuf_cache);
 		dispose_cache_job_info (pixbuf_cache->next_job + i, pixbuf_cache);
@@ -225,6 +369,17 @@ ev_pixbuf_cache_dispose (GObject *object)
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->dispose (object);
 }
 
+static void
+ev_pixbuf_cache_document_cache_updated_cb (EvDocument    *document,
+					   EvPixbufCache *pixbuf_cache)
+{
+	/* Surfaces rendered with the page sizes assumed while the
+	 * document was cached in the background may be wrong now */
+	clear_retained_surfaces (pixbuf_cache);
+	if (pixbuf_cache->job_list)
+		ev_pixbuf_cache_clear_job_sizes (pixbuf_cache,
+						 ev_document_model_get_scale (pixbuf_cache->model));
+}
 
 EvPixbufCache *
 ev_pixbuf_cache_new (GtkWidget       *view,
@@ -239,6 +394,9 @@ ev_pixbuf_cache_new (GtkWidget       *view,
 	pixbuf_cache->model = g_object_ref (model);
 	pixbuf_cache->document = ev_document_model_get_document (model);
 	pixbuf_cache->max_size = max_size;
+	g_signal_connect_object (pixbuf_cache->document, "cache-updated",
+				 G_CALLBACK (ev_pixbuf_cache_document_cache_updated_cb),
+				 pixbuf_cache, 0);
 
 	return pixbuf_cache;
 }
@@ -276,6 +434,43 @@ set_device_scale_on_surface (cairo_surface_t *surface,
 #endif
 }
 
+/* Returns the scale the whole page surface is rendered at. It's @scale,
+ * unless the backend can render page areas and the page at @scale would
+ * take more than half of the cache. Those pages are rendered in tiles of
+ * TILE_SIZE pixels over a smaller backdrop of the whole page, so that the
+ * memory used at high zoom levels depends on the size of the view rather
+ * than on the size of the page.
+ */
+static gdouble
+get_render_scale (EvPixbufCache *pixbuf_cache,
+		  gint           page,
+		  gdouble        scale,
+		  gint           rotation,
+		  gboolean      *tiled)
+{
+	gint  device_scale = get_device_scale (pixbuf_cache);
+	gint  width, height;
+	gsize page_size;
+
+	if (tiled)
+		*tiled = FALSE;
+
+	if (!(ev_document_get_render_flags (pixbuf_cache->document) & EV_DOCUMENT_RENDER_FLAG_AREA))
+		return scale;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       &width, &height);
+	page_size = (gsize) width * device_scale * height * device_scale * 4;
+	if (page_size <= MAX (pixbuf_cache->max_size / 2, TILED_PAGE_MIN_SIZE))
+		return scale;
+
+	if (tiled)
+		*tiled = TRUE;
+
+	return scale * sqrt ((gdouble) TILED_BACKDROP_SIZE / page_size);
+}
+
 static void
 copy_job_to_job_info (EvJobRender   *job_render,
 		      CacheJobInfo  *job_info,
@@ -285,6 +480,8 @@ copy_job_to_job_info (EvJobRender   *job_render,
 		cairo_surface_destroy (job_info->surface);
 	}
 	job_info->surface = cairo_surface_reference (job_render->surface);
+	job_info->surface_scale = job_render->scale;
+	job_info->surface_rotation = job_render->rotation;
 	set_device_scale_on_surface (job_info->surface, job_info->device_scale);
 	if (pixbuf_cache->inverted_colors) {
 		ev_document_misc_invert_surface (job_info->surface);
@@ -357,6 +554,7 @@ check_job_size_and_unref (EvPixbufCache *pixbuf_cache,
 {
 	gint width, height;
 	gint device_scale;
+	gdouble render_scale;
 
 	g_assert (job_info);
 
@@ -365,9 +563,14 @@ check_job_size_and_unref (EvPixbufCache *pixbuf_cache,
 
         device_scale = get_device_scale (pixbuf_cache);
 	if (job_info->device_scale == device_scale) {
+		render_scale = get_render_scale (pixbuf_cache,
+						 EV_JOB_RENDER (job_info->job)->page,
+						 scale,
+						 EV_JOB_RENDER (job_info->job)->rotation,
+						 NULL);
 		_get_page_size_for_scale_and_rotation (job_info->job->document,
 						       EV_JOB_RENDER (job_info->job)->page,
-						       scale,
+						       render_scale,
 						       EV_JOB_RENDER (job_info->job)->rotation,
 						       &width, &height);
 		if (width * device_scale == EV_JOB_RENDER (job_info->job)->target_width &&
@@ -378,6 +581,95 @@ check_job_size_and_unref (EvPixbufCache *pixbuf_cache,
 	end_job (job_info, pixbuf_cache);
 }
 
+/* Keeps the surface of a page leaving the cached range, so that going back
+ * to the page doesn't need to render it again. The surface is keyed by the
+ * page, scale, rotation and colors it was rendered with.
+ */
+static void
+retain_surface (EvPixbufCache *pixbuf_cache,
+		CacheJobInfo  *job_info,
+		gint           page)
+{
+	RetainedSurface *retained;
+
+	if (!job_info->page_ready || !job_info->surface || pixbuf_cache->max_size == 0)
+		return;
+
+	retained = g_slice_new (RetainedSurface);
+	retained->page = page;
+	retained->scale = job_info->surface_scale;
+	retained->rotation = job_info->surface_rotation;
+	retained->device_scale = job_info->device_scale;
+	retained->inverted = pixbuf_cache->inverted_colors;
+	retained->surface = cairo_surface_reference (job_info->surface);
+	retained->size = cairo_image_surface_get_stride (job_info->surface) *
+		cairo_image_surface_get_height (job_info->surface);
+
+	g_queue_push_head (&pixbuf_cache->retained, retained);
+	pixbuf_cache->retained_size += retained->size;
+}
+
+static gboolean
+take_retained_surface (EvPixbufCache *pixbuf_cache,
+		       CacheJobInfo  *job_info,
+		       gint           page,
+		       gdouble        scale,
+		       gint           rotation)
+{
+	gint   device_scale = get_device_scale (pixbuf_cache);
+	GList *l;
+
+	for (l = pixbuf_cache->retained.head; l; l = g_list_next (l)) {
+		RetainedSurface *retained = (RetainedSurface *)l->data;
+
+		if (retained->page != page ||
+		    retained->scale != scale * device_scale ||
+		    retained->rotation != rotation ||
+		    retained->device_scale != device_scale ||
+		    retained->inverted != pixbuf_cache->inverted_colors)
+			continue;
+
+		g_queue_delete_link (&pixbuf_cache->retained, l);
+		pixbuf_cache->retained_size -= retained->size;
+
+		if (job_info->surface)
+			cairo_surface_destroy (job_info->surface);
+		job_info->surface = cairo_surface_reference (retained->surface);
+		job_info->surface_scale = retained->scale;
+		job_info->surface_rotation = retained->rotation;
+		job_info->device_scale = device_scale;
+		job_info->page_ready = TRUE;
+		retained_surface_free (retained);
+
+		pixbuf_cache->hits++;
+
+		return TRUE;
+	}
+
+	pixbuf_cache->misses++;
+
+	return FALSE;
+}
+
+static void
+drop_retained_surfaces (EvPixbufCache *pixbuf_cache,
+			gint           page)
+{
+	GList *l = pixbuf_cache->retained.head;
+
+	while (l) {
+		RetainedSurface *retained = (RetainedSurface *)l->data;
+		GList           *next = g_list_next (l);
+
+		if (retained->page == page) {
+			g_queue_delete_link (&pixbuf_cache->retained, l);
+			pixbuf_cache->retained_size -= retained->size;
+			retained_surface_free (retained);
+		}
+		l = next;
+	}
+}
+
 /* Do all function that copies a job from an older cache to it's position in the
  * new cache.  It clears the old job if it doesn't have a place.
  */
@@ -399,6 +691,7 @@ move_one_job (CacheJobInfo  *job_info,
 
 	if (page < (start_page - new_preload_cache_size) ||
 	    page > (end_page + new_preload_cache_size)) {
+		retain_surface (pixbuf_cache, job_info, page);
 		dispose_cache_job_info (job_info, pixbuf_cache);
 		return;
 	}
@@ -430,6 +723,7 @@ move_one_job (CacheJobInfo  *job_info,
 	job_info->job = NULL;
 	job_info->region = NULL;
 	job_info->surface = NULL;
+	job_info->tiles = NULL;
 
 	if (new_priority != priority && target_page->job) {
 		ev_job_scheduler_update_job (target_page->job, new_priority);
@@ -444,12 +738,42 @@ ev_pixbuf_cache_get_page_size (EvPixbufCache *pixbuf_cache,
 {
 	gint width, height;
 
+	scale = get_render_scale (pixbuf_cache, page_index, scale, rotation, NULL);
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page_index, scale, rotation,
 					       &width, &height);
 	return height * cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
 }
 
+/* Drops the least recently used retained surfaces that don't fit in
+ * what the pages in the cached range leave of max_size.
+ */
+static void
+trim_retained_surfaces (EvPixbufCache *pixbuf_cache,
+			gdouble        scale,
+			gint           rotation)
+{
+	gsize range_size = 0;
+	gsize max_size;
+	gint  n_pages = ev_document_get_n_pages (pixbuf_cache->document);
+	gint  page;
+
+	for (page = MAX (0, pixbuf_cache->start_page - pixbuf_cache->preload_cache_size);
+	     page <= MIN (n_pages - 1, pixbuf_cache->end_page + pixbuf_cache->preload_cache_size);
+	     page++) {
+		range_size += ev_pixbuf_cache_get_page_size (pixbuf_cache, page, scale, rotation);
+	}
+
+	max_size = pixbuf_cache->max_size > range_size ? pixbuf_cache->max_size - range_size : 0;
+	while (pixbuf_cache->retained_size > max_size) {
+		RetainedSurface *retained = g_queue_pop_tail (&pixbuf_cache->retained);
+
+		pixbuf_cache->retained_size -= retained->size;
+		retained_surface_free (retained);
+		pixbuf_cache->evictions++;
+	}
+}
+
 static gint
 ev_pixbuf_cache_get_preload_size (EvPixbufCache *pixbuf_cache,
 				  gint           start_page,
@@ -694,7 +1018,9 @@ add_job (EvPixbufCache  *pixbuf_cache,
 					   width * job_info->device_scale,
                                            height * job_info->device_scale);
 
-	if (new_selection_surface_needed (pixbuf_cache, job_info, page, scale)) {
+	/* The selection of tiled pages is drawn from the selection region */
+	if (!job_info->tiled &&
+	    new_selection_surface_needed (pixbuf_cache, job_info, page, scale)) {
 		GdkColor text, base;
 
 		get_selection_colors (EV_VIEW (pixbuf_cache->view), &text, &base);
@@ -720,10 +1046,16 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 {
 	gint device_scale = get_device_scale (pixbuf_cache);
 	gint width, height;
+	gboolean tiled;
 
 	if (job_info->job)
 		return;
 
+	scale = get_render_scale (pixbuf_cache, page, scale, rotation, &tiled);
+	if (!tiled)
+		dispose_tiles (job_info, pixbuf_cache);
+	job_info->tiled = tiled;
+
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page, scale, rotation,
 					       &width, &height);
@@ -747,6 +1079,11 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 		}
 	}
 
+	if (take_retained_surface (pixbuf_cache, job_info, page, scale, rotation)) {
+		g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+		return;
+	}
+
 	add_job (pixbuf_cache, job_info, NULL,
 		 width, height, page, rotation, scale,
 		 priority);
@@ -845,6 +1182,7 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 {
 	gdouble scale = ev_document_model_get_scale (pixbuf_cache->model);
 	gint    rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	gint    i;
 
 	g_return_if_fail (EV_IS_PIXBUF_CACHE (pixbuf_cache));
 
@@ -854,9 +1192,10 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 
         pixbuf_cache->scroll_direction = ev_pixbuf_cache_get_scroll_direction (pixbuf_cache, start_page, end_page);
 
-	/* First, resize the page_range as needed.  We cull old pages
-	 * mercilessly. */
+	/* First, resize the page_range as needed.  Surfaces of the pages
+	 * leaving the range are retained while they fit in the cache. */
 	ev_pixbuf_cache_update_range (pixbuf_cache, start_page, end_page, rotation, scale);
+	trim_retained_surfaces (pixbuf_cache, scale, rotation);
 
 	/* Then, we update the current jobs to see if any of them are the wrong
 	 * size, we remove them if we need to. */
@@ -868,6 +1207,28 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 	/* Finally, we add the new jobs for all the sizes that don't have a
 	 * pixbuf */
 	ev_pixbuf_cache_add_jobs_if_needed (pixbuf_cache, rotation, scale);
+
+	/* Tiles of the pages that scrolled out of the view are not needed */
+	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		cancel_pending_tiles (pixbuf_cache->prev_job + i, NULL, pixbuf_cache);
+		cancel_pending_tiles (pixbuf_cache->next_job + i, NULL, pixbuf_cache);
+	}
+}
+
+static void
+invert_tiles (CacheJobInfo *job_info)
+{
+	GHashTableIter iter;
+	gpointer       tile;
+
+	if (!job_info || !job_info->tiles)
+		return;
+
+	g_hash_table_iter_init (&iter, job_info->tiles);
+	while (g_hash_table_iter_next (&iter, NULL, &tile)) {
+		if (((CacheTile *)tile)->tile.surface)
+			ev_document_misc_invert_surface (((CacheTile *)tile)->tile.surface);
+	}
 }
 
 void
@@ -887,10 +1248,12 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 		job_info = pixbuf_cache->prev_job + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		invert_tiles (job_info);
 
 		job_info = pixbuf_cache->next_job + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		invert_tiles (job_info);
 	}
 
 	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++) {
@@ -899,6 +1262,7 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 		job_info = pixbuf_cache->job_list + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		invert_tiles (job_info);
 	}
 }
 
@@ -925,6 +1289,272 @@ ev_pixbuf_cache_get_surface (EvPixbufCache *pixbuf_cache,
 	return job_info->surface;
 }
 
+static void
+tile_job_finished_cb (EvJob         *job,
+		      EvPixbufCache *pixbuf_cache)
+{
+	EvJobRender  *job_render = EV_JOB_RENDER (job);
+	CacheJobInfo *job_info;
+	CacheTile    *tile = NULL;
+	guint64       key;
+
+	key = TILE_KEY (job_render->area.y / TILE_SIZE, job_render->area.x / TILE_SIZE);
+	job_info = find_job_cache (pixbuf_cache, job_render->page);
+	if (job_info && job_info->tiles)
+		tile = g_hash_table_lookup (job_info->tiles, &key);
+	g_return_if_fail (tile != NULL && tile->job == job);
+
+	if (ev_job_is_failed (job)) {
+		end_tile_job (tile, pixbuf_cache);
+		return;
+	}
+
+	tile->tile.surface = cairo_surface_reference (job_render->surface);
+	set_device_scale_on_surface (tile->tile.surface, tile->device_scale);
+	if (pixbuf_cache->inverted_colors)
+		ev_document_misc_invert_surface (tile->tile.surface);
+	end_tile_job (tile, pixbuf_cache);
+
+	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+}
+
+static void
+add_tile_job (EvPixbufCache *pixbuf_cache,
+	      CacheTile     *tile,
+	      gint           page,
+	      GdkRectangle  *area,
+	      gint           page_width,
+	      gint           page_height)
+{
+	tile->job = ev_job_render_new (pixbuf_cache->document,
+				       page, tile->rotation, tile->scale,
+				       page_width, page_height);
+	ev_job_render_set_area (EV_JOB_RENDER (tile->job), area);
+	g_signal_connect (tile->job, "finished",
+			  G_CALLBACK (tile_job_finished_cb),
+			  pixbuf_cache);
+	/* The backdrop of the visible pages goes first, without it
+	 * there is nothing to draw the tiles over */
+	ev_job_scheduler_push_job (tile->job, EV_JOB_PRIORITY_HIGH);
+}
+
+typedef struct {
+	GHashTable *tiles;
+	CacheTile  *tile;
+} TileRef;
+
+static gint
+compare_tile_refs (gconstpointer a,
+		   gconstpointer b)
+{
+	gint64 a_used = ((const TileRef *)a)->tile->last_used;
+	gint64 b_used = ((const TileRef *)b)->tile->last_used;
+
+	return a_used < b_used ? -1 : (a_used > b_used ? 1 : 0);
+}
+
+static void
+collect_tiles (CacheJobInfo *job_info,
+	       GArray       *refs,
+	       gsize        *size)
+{
+	GHashTableIter iter;
+	gpointer       value;
+
+	if (!job_info->tiles)
+		return;
+
+	g_hash_table_iter_init (&iter, job_info->tiles);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		TileRef ref = { job_info->tiles, (CacheTile *)value };
+
+		/* Pending tiles are accounted as full tiles */
+		if (ref.tile->tile.surface)
+			*size += cairo_image_surface_get_stride (ref.tile->tile.surface) *
+				cairo_image_surface_get_height (ref.tile->tile.surface);
+		else
+			*size += TILE_SIZE * TILE_SIZE * 4;
+		g_array_append_val (refs, ref);
+	}
+}
+
+/* Tiles are kept while they fit in the cache size or in twice the
+ * view size, whichever is larger. The least recently drawn ones are
+ * dropped first, never the ones requested at @now.
+ */
+static void
+ev_pixbuf_cache_evict_tiles (EvPixbufCache *pixbuf_cache,
+			     gint64         now)
+{
+	GtkAllocation allocation;
+	GArray       *refs;
+	gsize         size = 0;
+	gsize         max_size;
+	gint          device_scale;
+	guint         i;
+
+	device_scale = get_device_scale (pixbuf_cache);
+	gtk_widget_get_allocation (pixbuf_cache->view, &allocation);
+	max_size = (gsize) (allocation.width * device_scale + TILE_SIZE) *
+		(allocation.height * device_scale + TILE_SIZE) * 4 * 2;
+	max_size = MAX (max_size, pixbuf_cache->max_size);
+
+	refs = g_array_new (FALSE, FALSE, sizeof (TileRef));
+	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		collect_tiles (pixbuf_cache->prev_job + i, refs, &size);
+		collect_tiles (pixbuf_cache->next_job + i, refs, &size);
+	}
+	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++)
+		collect_tiles (pixbuf_cache->job_list + i, refs, &size);
+
+	if (size > max_size) {
+		g_array_sort (refs, compare_tile_refs);
+
+		for (i = 0; i < refs->len && size > max_size; i++) {
+			TileRef *ref = &g_array_index (refs, TileRef, i);
+
+			if (ref->tile->last_used >= now)
+				break;
+
+			if (ref->tile->tile.surface)
+				size -= cairo_image_surface_get_stride (ref->tile->tile.surface) *
+					cairo_image_surface_get_height (ref->tile->tile.surface);
+			else
+				size -= TILE_SIZE * TILE_SIZE * 4;
+			g_hash_table_remove (ref->tiles, &ref->tile->key);
+			dispose_tile (ref->tile, pixbuf_cache);
+			pixbuf_cache->evictions++;
+		}
+	}
+
+	g_array_free (refs, TRUE);
+}
+
+/* Whether the surface of @page is a lower resolution
+ * backdrop for the tiles returned by ev_pixbuf_cache_get_tiles()
+ */
+gboolean
+ev_pixbuf_cache_is_page_tiled (EvPixbufCache *pixbuf_cache,
+			       gint           page)
+{
+	CacheJobInfo *job_info;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+
+	return job_info && job_info->tiled;
+}
+
+/* Returns the rendered tiles of a tiled page covering @area, given in
+ * view pixels relative to the page, and schedules the rendering of the
+ * missing ones. The list must be freed, the tiles are owned by the cache.
+ */
+GList *
+ev_pixbuf_cache_get_tiles (EvPixbufCache *pixbuf_cache,
+			   gint           page,
+			   GdkRectangle  *area)
+{
+	CacheJobInfo *job_info;
+	GList        *retval = NULL;
+	gdouble       scale;
+	gint          rotation;
+	gint          device_scale;
+	gint          width, height;
+	gint          first_col, last_col;
+	gint          first_row, last_row;
+	gint          row, col;
+	gint64        now;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+	if (job_info == NULL || !job_info->tiled)
+		return NULL;
+
+	scale = ev_document_model_get_scale (pixbuf_cache->model);
+	rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	device_scale = get_device_scale (pixbuf_cache);
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       &width, &height);
+	width *= device_scale;
+	height *= device_scale;
+
+	first_col = MAX (area->x * device_scale, 0) / TILE_SIZE;
+	first_row = MAX (area->y * device_scale, 0) / TILE_SIZE;
+	last_col = MIN ((area->x + area->width) * device_scale, width) - 1;
+	last_row = MIN ((area->y + area->height) * device_scale, height) - 1;
+	if (last_col < 0 || last_row < 0)
+		return NULL;
+	last_col /= TILE_SIZE;
+	last_row /= TILE_SIZE;
+
+	if (!job_info->tiles)
+		job_info->tiles = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+	now = g_get_monotonic_time ();
+
+	for (row = first_row; row <= last_row; row++) {
+		for (col = first_col; col <= last_col; col++) {
+			GdkRectangle tile_area;
+			CacheTile   *tile;
+			guint64      key = TILE_KEY (row, col);
+
+			tile_area.x = col * TILE_SIZE;
+			tile_area.y = row * TILE_SIZE;
+			tile_area.width = MIN (TILE_SIZE, width - tile_area.x);
+			tile_area.height = MIN (TILE_SIZE, height - tile_area.y);
+
+			tile = g_hash_table_lookup (job_info->tiles, &key);
+			if (tile && (tile->scale != scale * device_scale ||
+				     tile->rotation != rotation ||
+				     tile->device_scale != device_scale)) {
+				g_hash_table_remove (job_info->tiles, &key);
+				dispose_tile (tile, pixbuf_cache);
+				tile = NULL;
+			}
+
+			if (!tile) {
+				tile = g_slice_new0 (CacheTile);
+				tile->key = key;
+				tile->scale = scale * device_scale;
+				tile->rotation = rotation;
+				tile->device_scale = device_scale;
+				tile->tile.area.x = tile_area.x / device_scale;
+				tile->tile.area.y = tile_area.y / device_scale;
+				tile->tile.area.width = tile_area.width / device_scale;
+				tile->tile.area.height = tile_area.height / device_scale;
+				g_hash_table_insert (job_info->tiles, &tile->key, tile);
+
+				add_tile_job (pixbuf_cache, tile, page, &tile_area, width, height);
+			}
+
+			tile->last_used = now;
+			if (tile->tile.surface)
+				retval = g_list_prepend (retval, &tile->tile);
+		}
+	}
+
+	ev_pixbuf_cache_evict_tiles (pixbuf_cache, now);
+
+	return g_list_reverse (retval);
+}
+
+/* Cancels the rendering of the tiles of @page outside @visible_area,
+ * given in view pixels relative to the page, once they scrolled off
+ */
+void
+ev_pixbuf_cache_cancel_tiles (EvPixbufCache *pixbuf_cache,
+			      gint           page,
+			      GdkRectangle  *visible_area)
+{
+	CacheJobInfo *job_info;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+	if (job_info == NULL || !job_info->tiled)
+		return;
+
+	cancel_pending_tiles (job_info, visible_area, pixbuf_cache);
+}
+
 static gboolean
 new_selection_surface_needed (EvPixbufCache *pixbuf_cache,
 			      CacheJobInfo  *job_info,
@@ -982,6 +1612,8 @@ ev_pixbuf_cache_clear (EvPixbufCache *pixbuf_cache)
 {
 	int i;
 
+	clear_retained_surfaces (pixbuf_cache);
+
 	if (!pixbuf_cache->job_list)
 		return;
 
@@ -1054,6 +1686,11 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 	if (!job_info->points_set)
 		return NULL;
 
+	/* A selection surface as large as the page is
+	 * what tiling avoids, use the selection region */
+	if (job_info->tiled)
+		return NULL;
+
 	/* If we have a running job, we just return what we have under the
 	 * assumption that it'll be updated later and we can scale it as need
 	 * be */
@@ -1077,7 +1714,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		gint width, height;
 
 		/* we need to get a new selection pixbuf */
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (pixbuf_cache->document);
 		if (job_info->selection_points.x1 < 0) {
 			g_assert (job_info->selection == NULL);
 			old_points = NULL;
@@ -1107,7 +1744,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		job_info->selection_points = job_info->target_points;
 		job_info->selection_scale = scale * job_info->device_scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection;
 }
@@ -1150,7 +1787,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		EvPage *ev_page;
 		gint width, height;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (pixbuf_cache->document);
 		ev_page = ev_document_get_page (pixbuf_cache->document, page);
 
 		_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
@@ -1170,7 +1807,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		job_info->selection_region_points = job_info->target_points;
 		job_info->selection_region_scale = scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection_region && !cairo_region_is_empty(job_info->selection_region) ?
                 job_info->selection_region : NULL;
@@ -1368,10 +2005,14 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 	CacheJobInfo *job_info;
         gint width, height;
 
+	drop_retained_surfaces (pixbuf_cache, page);
+
 	job_info = find_job_cache (pixbuf_cache, page);
 	if (job_info == NULL)
 		return;
 
+	dispose_tiles (job_info, pixbuf_cache);
+	scale = get_render_scale (pixbuf_cache, page, scale, rotation, &job_info->tiled);
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page, scale, rotation,
 					       &width, &height);
@@ -1380,4 +2021,22 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 		 EV_JOB_PRIORITY_URGENT);
 }
 
+/* Returns the number of pages found among the retained surfaces, the
+ * number of pages that had to be rendered again and the number of
+ * retained surfaces and tiles dropped to stay within the cache size.
+ */
+void
+ev_pixbuf_cache_get_stats (EvPixbufCache *pixbuf_cache,
+			   guint         *hits,
+			   guint         *misses,
+			   guint         *evictions)
+{
+	g_return_if_fail (EV_IS_PIXBUF_CACHE (pixbuf_cache));
 
+	if (hits)
+		*hits = pixbuf_cache->hits;
+	if (misses)
+		*misses = pixbuf_cache->misses;
+	if (evictions)
+		*evictions = pixbuf_cache->evictions;
+}
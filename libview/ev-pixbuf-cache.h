@@ -56,6 +56,16 @@ struct _EvViewSelection {
 typedef struct _EvPixbufCache       EvPixbufCache;
 typedef struct _EvPixbufCacheClass  EvPixbufCacheClass;
 
+/* A rendered tile of a tiled page. The area is in view
+ * pixels, relative to the top left corner of the page.
+ */
+typedef struct _EvPixbufCacheTile EvPixbufCacheTile;
+
+struct _EvPixbufCacheTile {
+	cairo_surface_t *surface;
+	GdkRectangle     area;
+};
+
 GType          ev_pixbuf_cache_get_type             (void) G_GNUC_CONST;
 EvPixbufCache *ev_pixbuf_cache_new                  (GtkWidget     *view,
 						     EvDocumentModel *model,
@@ -68,6 +78,14 @@ void           ev_pixbuf_cache_set_page_range       (EvPixbufCache *pixbuf_cache
 						     GList          *selection_list);
 cairo_surface_t *ev_pixbuf_cache_get_surface        (EvPixbufCache *pixbuf_cache,
 						     gint           page);
+gboolean       ev_pixbuf_cache_is_page_tiled        (EvPixbufCache *pixbuf_cache,
+						     gint           page);
+GList         *ev_pixbuf_cache_get_tiles            (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     GdkRectangle  *area);
+void           ev_pixbuf_cache_cancel_tiles         (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     GdkRectangle  *visible_area);
 void           ev_pixbuf_cache_clear                (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_style_changed        (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
@@ -77,6 +95,10 @@ void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
 						     gdouble         scale);
 void           ev_pixbuf_cache_set_inverted_colors  (EvPixbufCache *pixbuf_cache,
 						     gboolean       inverted_colors);
+void           ev_pixbuf_cache_get_stats            (EvPixbufCache *pixbuf_cache,
+						     guint         *hits,
+						     guint         *misses,
+						     guint         *evictions);
 /* Selection */
 cairo_surface_t *ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 							gint             page,
@@ -36,7 +36,9 @@ enum {
 	PROP_DOCUMENT,
 	PROP_CURRENT_PAGE,
 	PROP_ROTATION,
-	PROP_INVERTED_COLORS
+	PROP_INVERTED_COLORS,
+	PROP_LOOK_AHEAD,
+	PROP_SLIDES_READY
 };
 
 enum {
@@ -86,9 +88,11 @@ struct _EvViewPresentation
 	/* Links */
 	EvPageCache           *page_cache;
 
-	EvJob *prev_job;
-	EvJob *curr_job;
-	EvJob *next_job;
+	/* Slides: render jobs of the current page, the previous one and
+	 * look_ahead pages after it, keyed by page */
+	GHashTable            *slide_jobs;
+	guint                  look_ahead;
+	guint                  slides_ready;
 };
 
 struct _EvViewPresentationClass
@@ -111,6 +115,14 @@ static void ev_view_presentation_set_cursor_for_location (EvViewPresentation *pv
 
 #define HIDE_CURSOR_TIMEOUT 5
 
+#define DEFAULT_LOOK_AHEAD 2
+#define MAX_LOOK_AHEAD     16
+
+/* Slides ready indicator */
+#define INDICATOR_DOT_SIZE    6
+#define INDICATOR_DOT_SPACING 4
+#define INDICATOR_MARGIN      12
+
 G_DEFINE_TYPE (EvViewPresentation, ev_view_presentation, GTK_TYPE_WIDGET)
 
 #if !GTK_CHECK_VERSION(3, 20, 0)
@@ -291,6 +303,13 @@ ev_view_presentation_transition_animation_frame (EvViewPresentation *pview,
 	gtk_widget_queue_draw (GTK_WIDGET (pview));
 }
 
+static EvJob *
+ev_view_presentation_get_slide_job (EvViewPresentation *pview,
+				    gint                page)
+{
+	return g_hash_table_lookup (pview->slide_jobs, GINT_TO_POINTER (page));
+}
+
 static cairo_surface_t *
 get_surface_from_job (EvViewPresentation *pview,
                       EvJob              *job)
@@ -321,7 +340,6 @@ ev_view_presentation_animation_start (EvViewPresentation *pview,
 	EvTransitionEffect *effect = NULL;
 	EvJob		   *job;
 	cairo_surface_t    *surface;
-	gint                jump;
 
 	if (!pview->enable_animations)
 		return;
@@ -336,18 +354,15 @@ ev_view_presentation_animation_start (EvViewPresentation *pview,
 
 	pview->animation = ev_transition_animation_new (effect);
 
-	surface = pview->curr_job ? EV_JOB_RENDER (pview->curr_job)->surface : NULL;
+	job = ev_view_presentation_get_slide_job (pview, pview->current_page);
+	surface = job ? EV_JOB_RENDER (job)->surface : NULL;
 	ev_transition_animation_set_origin_surface (pview->animation,
 						    surface != NULL ?
 						    surface : pview->current_surface);
 
-	jump = new_page - pview->current_page;
-	if (jump == -1)
-		job = pview->prev_job;
-	else if (jump == 1)
-		job = pview->next_job;
-	else
-		job = NULL;
+	/* Any slide in the window can be the destination, not only the
+	 * next and previous ones */
+	job = ev_view_presentation_get_slide_job (pview, new_page);
 	surface = get_surface_from_job (pview, job);
 	if (surface)
 		ev_transition_animation_set_dest_surface (pview->animation, surface);
@@ -360,6 +375,97 @@ ev_view_presentation_animation_start (EvViewPresentation *pview,
 				  pview);
 }
 
+/* Slides ready indicator */
+static void
+ev_view_presentation_get_indicator_area (EvViewPresentation *pview,
+					 GdkRectangle       *area)
+{
+	GtkWidget    *widget = GTK_WIDGET (pview);
+	GtkAllocation allocation;
+
+	gtk_widget_get_allocation (widget, &allocation);
+
+	area->width = pview->look_ahead * (INDICATOR_DOT_SIZE + INDICATOR_DOT_SPACING) - INDICATOR_DOT_SPACING;
+	area->height = INDICATOR_DOT_SIZE;
+	area->x = allocation.width - INDICATOR_MARGIN - area->width;
+	area->y = allocation.height - INDICATOR_MARGIN - area->height;
+}
+
+static void
+ev_view_presentation_queue_draw_indicator (EvViewPresentation *pview)
+{
+	GdkRectangle area;
+
+	if (!gtk_widget_get_realized (GTK_WIDGET (pview)))
+		return;
+
+	ev_view_presentation_get_indicator_area (pview, &area);
+	gtk_widget_queue_draw_area (GTK_WIDGET (pview),
+				    area.x, area.y, area.width, area.height);
+}
+
+/* The indicator is only shown together with the pointer, so that it
+ * doesn't get in the way of the audience */
+static void
+ev_view_presentation_draw_indicator (EvViewPresentation *pview,
+				     cairo_t            *cr)
+{
+	GdkRectangle area;
+	guint        i;
+
+	if (pview->cursor == EV_VIEW_CURSOR_HIDDEN)
+		return;
+
+	ev_view_presentation_get_indicator_area (pview, &area);
+
+	cairo_save (cr);
+	cairo_set_line_width (cr, 1.);
+	for (i = 0; i < pview->look_ahead; i++) {
+		gdouble x = area.x + i * (INDICATOR_DOT_SIZE + INDICATOR_DOT_SPACING);
+
+		cairo_arc (cr,
+			   x + INDICATOR_DOT_SIZE / 2.,
+			   area.y + INDICATOR_DOT_SIZE / 2.,
+			   INDICATOR_DOT_SIZE / 2. - 0.5,
+			   0, 2 * G_PI);
+		cairo_set_source_rgba (cr, 0.5, 0.5, 0.5, 0.8);
+		if (i < pview->slides_ready)
+			cairo_fill_preserve (cr);
+		cairo_stroke (cr);
+	}
+	cairo_restore (cr);
+}
+
+/* Counts the slides after the current one that are rendered, up to the
+ * first one that isn't. Past the end of the document there's nothing
+ * left to wait for. */
+static void
+ev_view_presentation_update_slides_ready (EvViewPresentation *pview)
+{
+	guint slides_ready = 0;
+	guint n_pages;
+	guint i;
+
+	n_pages = ev_document_get_n_pages (pview->document);
+	for (i = 1; i <= pview->look_ahead; i++) {
+		EvJob *job;
+
+		if (pview->current_page + i < n_pages) {
+			job = ev_view_presentation_get_slide_job (pview, pview->current_page + i);
+			if (!job || !ev_job_is_finished (job))
+				break;
+		}
+		slides_ready++;
+	}
+
+	if (pview->slides_ready == slides_ready)
+		return;
+
+	pview->slides_ready = slides_ready;
+	ev_view_presentation_queue_draw_indicator (pview);
+	g_object_notify (G_OBJECT (pview), "slides-ready");
+}
+
 /* Page Navigation */
 static void
 job_finished_cb (EvJob              *job,
@@ -370,7 +476,9 @@ job_finished_cb (EvJob              *job,
 	if (pview->inverted_colors)
 		ev_document_misc_invert_surface (job_render->surface);
 
-	if (job != pview->curr_job)
+	ev_view_presentation_update_slides_ready (pview);
+
+	if (job != ev_view_presentation_get_slide_job (pview, pview->current_page))
 		return;
 
 	if (pview->animation) {
@@ -426,27 +534,82 @@ ev_view_presentation_delete_job (EvViewPresentation *pview,
 static void
 ev_view_presentation_reset_jobs (EvViewPresentation *pview)
 {
-        if (pview->curr_job) {
-                ev_view_presentation_delete_job (pview, pview->curr_job);
-                pview->curr_job = NULL;
-        }
+	GHashTableIter iter;
+	gpointer       job;
 
-        if (pview->prev_job) {
-                ev_view_presentation_delete_job (pview, pview->prev_job);
-                pview->prev_job = NULL;
-        }
+	g_hash_table_iter_init (&iter, pview->slide_jobs);
+	while (g_hash_table_iter_next (&iter, NULL, &job)) {
+		ev_view_presentation_delete_job (pview, EV_JOB (job));
+		g_hash_table_iter_remove (&iter);
+	}
+}
 
-        if (pview->next_job) {
-                ev_view_presentation_delete_job (pview, pview->next_job);
-                pview->next_job = NULL;
-        }
+static EvJobPriority
+ev_view_presentation_get_slide_priority (gint page,
+					 gint slide,
+					 gint jump)
+{
+	gint direction = jump < 0 ? -1 : 1;
+
+	if (slide == page)
+		return EV_JOB_PRIORITY_URGENT;
+	if (slide == page + direction)
+		return EV_JOB_PRIORITY_HIGH;
+	if (slide == page - direction || direction > 0)
+		return EV_JOB_PRIORITY_LOW;
+
+	/* Looking ahead while going backwards */
+	return EV_JOB_PRIORITY_NONE;
+}
+
+/* Keeps the jobs of the slides from the one before @page to look_ahead
+ * slides after it, so that moving to any of them doesn't have to wait
+ * for the slide to be rendered. Jobs of slides that leave the window are
+ * cancelled, the others are kept and reprioritized.
+ */
+static void
+ev_view_presentation_update_slides (EvViewPresentation *pview,
+				    gint                page,
+				    gint                jump)
+{
+	GHashTableIter iter;
+	gpointer       key, value;
+	gint           first, last, i;
+
+	first = MAX (page - 1, 0);
+	last = MIN (page + (gint)pview->look_ahead,
+		    ev_document_get_n_pages (pview->document) - 1);
+
+	g_hash_table_iter_init (&iter, pview->slide_jobs);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		gint slide = GPOINTER_TO_INT (key);
+
+		if (slide < first || slide > last) {
+			ev_view_presentation_delete_job (pview, EV_JOB (value));
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+
+	for (i = first; i <= last; i++) {
+		EvJobPriority priority;
+		EvJob        *job;
+
+		priority = ev_view_presentation_get_slide_priority (page, i, jump);
+		job = ev_view_presentation_get_slide_job (pview, i);
+		if (!job) {
+			job = ev_view_presentation_schedule_new_job (pview, i, priority);
+			g_hash_table_insert (pview->slide_jobs, GINT_TO_POINTER (i), job);
+		} else if (!ev_job_is_finished (job)) {
+			ev_job_scheduler_update_job (job, priority);
+		}
+	}
 }
 
 static void
 ev_view_presentation_update_current_page (EvViewPresentation *pview,
 					  guint               page)
 {
-	gint jump;
+	EvJob *job;
 
 	if (page < 0 || page >= ev_document_get_n_pages (pview->document))
 		return;
@@ -454,81 +617,7 @@ ev_view_presentation_update_current_page (EvViewPresentation *pview,
 	ev_view_presentation_animation_cancel (pview);
 	ev_view_presentation_animation_start (pview, page);
 
-	jump = page - pview->current_page;
-
-	switch (jump) {
-	case 0:
-		if (!pview->curr_job)
-			pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		if (!pview->next_job)
-			pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_HIGH);
-		if (!pview->prev_job)
-			pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_LOW);
-		break;
-	case -1:
-		ev_view_presentation_delete_job (pview, pview->next_job);
-		pview->next_job = pview->curr_job;
-		pview->curr_job = pview->prev_job;
-
-		if (!pview->curr_job)
-			pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		else
-			ev_job_scheduler_update_job (pview->curr_job, EV_JOB_PRIORITY_URGENT);
-		pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_HIGH);
-		ev_job_scheduler_update_job (pview->next_job, EV_JOB_PRIORITY_LOW);
-
-		break;
-	case 1:
-		ev_view_presentation_delete_job (pview, pview->prev_job);
-		pview->prev_job = pview->curr_job;
-		pview->curr_job = pview->next_job;
-
-		if (!pview->curr_job)
-			pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		else
-			ev_job_scheduler_update_job (pview->curr_job, EV_JOB_PRIORITY_URGENT);
-		pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_HIGH);
-		ev_job_scheduler_update_job (pview->prev_job, EV_JOB_PRIORITY_LOW);
-
-		break;
-	case -2:
-		ev_view_presentation_delete_job (pview, pview->next_job);
-		ev_view_presentation_delete_job (pview, pview->curr_job);
-		pview->next_job = pview->prev_job;
-
-		pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_HIGH);
-		if (!pview->next_job)
-			pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_LOW);
-		else
-			ev_job_scheduler_update_job (pview->next_job, EV_JOB_PRIORITY_LOW);
-		break;
-	case 2:
-		ev_view_presentation_delete_job (pview, pview->prev_job);
-		ev_view_presentation_delete_job (pview, pview->curr_job);
-		pview->prev_job = pview->next_job;
-
-		pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_HIGH);
-		if (!pview->prev_job)
-			pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_LOW);
-		else
-			ev_job_scheduler_update_job (pview->prev_job, EV_JOB_PRIORITY_LOW);
-		break;
-	default:
-		ev_view_presentation_delete_job (pview, pview->prev_job);
-		ev_view_presentation_delete_job (pview, pview->curr_job);
-		ev_view_presentation_delete_job (pview, pview->next_job);
-
-		pview->curr_job = ev_view_presentation_schedule_new_job (pview, page, EV_JOB_PRIORITY_URGENT);
-		if (jump > 0) {
-			pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_HIGH);
-			pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_LOW);
-		} else {
-			pview->prev_job = ev_view_presentation_schedule_new_job (pview, page - 1, EV_JOB_PRIORITY_HIGH);
-			pview->next_job = ev_view_presentation_schedule_new_job (pview, page + 1, EV_JOB_PRIORITY_LOW);
-		}
-	}
+	ev_view_presentation_update_slides (pview, page, page - pview->current_page);
 
 	if (pview->current_page != page) {
 		pview->current_page = page;
@@ -545,7 +634,10 @@ ev_view_presentation_update_current_page (EvViewPresentation *pview,
 		ev_view_presentation_set_cursor_for_location (pview, x, y);
 	}
 
-	if (EV_JOB_RENDER (pview->curr_job)->surface)
+	ev_view_presentation_update_slides_ready (pview);
+
+	job = ev_view_presentation_get_slide_job (pview, page);
+	if (EV_JOB_RENDER (job)->surface)
 		gtk_widget_queue_draw (GTK_WIDGET (pview));
 }
 
@@ -934,6 +1026,8 @@ ev_view_presentation_set_cursor (EvViewPresentation *pview,
 	if (!gtk_widget_get_realized (widget))
 		gtk_widget_realize (widget);
 
+	if (pview->cursor == EV_VIEW_CURSOR_HIDDEN || view_cursor == EV_VIEW_CURSOR_HIDDEN)
+		ev_view_presentation_queue_draw_indicator (pview);
 	pview->cursor = view_cursor;
 
 	cursor = ev_view_cursor_new (gtk_widget_get_display (widget), view_cursor);
@@ -1007,7 +1101,11 @@ ev_view_presentation_dispose (GObject *object)
 	ev_view_presentation_animation_cancel (pview);
 	ev_view_presentation_transition_stop (pview);
 	ev_view_presentation_hide_cursor_timeout_stop (pview);
-        ev_view_presentation_reset_jobs (pview);
+	if (pview->slide_jobs) {
+		ev_view_presentation_reset_jobs (pview);
+		g_hash_table_destroy (pview->slide_jobs);
+		pview->slide_jobs = NULL;
+	}
 
 	if (pview->current_surface) {
 		cairo_surface_destroy (pview->current_surface);
@@ -1127,7 +1225,8 @@ ev_view_presentation_draw (GtkWidget *widget,
 		return TRUE;
 	}
 
-	surface = get_surface_from_job (pview, pview->curr_job);
+	surface = get_surface_from_job (pview,
+					ev_view_presentation_get_slide_job (pview, pview->current_page));
 	if (surface) {
 		ev_view_presentation_update_current_surface (pview, surface);
 	} else if (pview->current_surface) {
@@ -1151,6 +1250,8 @@ ev_view_presentation_draw (GtkWidget *widget,
                 cairo_restore (cr);
 	}
 
+	ev_view_presentation_draw_indicator (pview, cr);
+
 	return FALSE;
 }
 
@@ -1431,6 +1532,9 @@ ev_view_presentation_set_property (GObject      *object,
 	case PROP_INVERTED_COLORS:
 		pview->inverted_colors = g_value_get_boolean (value);
 		break;
+	case PROP_LOOK_AHEAD:
+		ev_view_presentation_set_look_ahead (pview, g_value_get_uint (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	}
@@ -1451,6 +1555,12 @@ ev_view_presentation_get_property (GObject    *object,
         case PROP_ROTATION:
                 g_value_set_uint (value, ev_view_presentation_get_rotation (pview));
                 break;
+        case PROP_LOOK_AHEAD:
+                g_value_set_uint (value, ev_view_presentation_get_look_ahead (pview));
+                break;
+        case PROP_SLIDES_READY:
+                g_value_set_uint (value, ev_view_presentation_get_slides_ready (pview));
+                break;
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         }
@@ -1464,6 +1574,18 @@ ev_view_presentation_notify_scale_factor (EvViewPresentation *pview)
         ev_view_presentation_update_current_page (pview, pview->current_page);
 }
 
+static void
+ev_view_presentation_document_cache_updated (EvViewPresentation *pview)
+{
+	/* The slides were rendered with page sizes that turned out
+	 * to be wrong while the document was cached in the background */
+	if (!gtk_widget_get_realized (GTK_WIDGET (pview)))
+		return;
+
+	ev_view_presentation_reset_jobs (pview);
+	ev_view_presentation_update_current_page (pview, pview->current_page);
+}
+
 static GObject *
 ev_view_presentation_constructor (GType                  type,
 				  guint                  n_construct_properties,
@@ -1485,6 +1607,9 @@ ev_view_presentation_constructor (GType                  type,
 
         g_signal_connect (object, "notify::scale-factor",
                           G_CALLBACK (ev_view_presentation_notify_scale_factor), NULL);
+	g_signal_connect_object (pview->document, "cache-updated",
+				 G_CALLBACK (ev_view_presentation_document_cache_updated),
+				 pview, G_CONNECT_SWAPPED);
 
 	return object;
 }
@@ -1554,6 +1679,22 @@ ev_view_presentation_class_init (EvViewPresentationClass *klass)
 							       G_PARAM_WRITABLE |
 							       G_PARAM_CONSTRUCT_ONLY |
                                                                G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (gobject_class,
+					 PROP_LOOK_AHEAD,
+					 g_param_spec_uint ("look-ahead",
+							    "Look Ahead",
+							    "Number of slides after the current one rendered in advance",
+							    1, MAX_LOOK_AHEAD, DEFAULT_LOOK_AHEAD,
+							    G_PARAM_READWRITE |
+                                                            G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (gobject_class,
+					 PROP_SLIDES_READY,
+					 g_param_spec_uint ("slides-ready",
+							    "Slides Ready",
+							    "Number of slides after the current one already rendered",
+							    0, MAX_LOOK_AHEAD, 0,
+							    G_PARAM_READABLE |
+                                                            G_PARAM_STATIC_STRINGS));
 
 	signals[CHANGE_PAGE] =
 		g_signal_new ("change_page",
@@ -1645,6 +1786,8 @@ ev_view_presentation_init (EvViewPresentation *pview)
 {
 	gtk_widget_set_can_focus (GTK_WIDGET (pview), TRUE);
         pview->is_constructing = TRUE;
+	pview->slide_jobs = g_hash_table_new (NULL, NULL);
+	pview->look_ahead = DEFAULT_LOOK_AHEAD;
 #if !GTK_CHECK_VERSION(3, 20, 0)
         ev_view_presentation_init_css();
 #endif
@@ -1699,3 +1842,60 @@ ev_view_presentation_get_rotation (EvViewPresentation *pview)
 {
         return pview->rotation;
 }
+
+/**
+ * ev_view_presentation_set_look_ahead:
+ * @pview: an #EvViewPresentation
+ * @look_ahead: the number of slides to render in advance
+ *
+ * Sets how many slides after the current one are rendered in advance, at
+ * the resolution of the monitor, so that moving to them is immediate.
+ *
+ * Since: 3.28
+ */
+void
+ev_view_presentation_set_look_ahead (EvViewPresentation *pview,
+                                     guint               look_ahead)
+{
+        g_return_if_fail (EV_IS_VIEW_PRESENTATION (pview));
+
+        look_ahead = CLAMP (look_ahead, 1, MAX_LOOK_AHEAD);
+        if (pview->look_ahead == look_ahead)
+                return;
+
+        ev_view_presentation_queue_draw_indicator (pview);
+        pview->look_ahead = look_ahead;
+        g_object_notify (G_OBJECT (pview), "look-ahead");
+
+        if (!gtk_widget_get_realized (GTK_WIDGET (pview)))
+                return;
+
+        ev_view_presentation_update_slides (pview, pview->current_page, 0);
+        ev_view_presentation_update_slides_ready (pview);
+        ev_view_presentation_queue_draw_indicator (pview);
+}
+
+guint
+ev_view_presentation_get_look_ahead (EvViewPresentation *pview)
+{
+        g_return_val_if_fail (EV_IS_VIEW_PRESENTATION (pview), DEFAULT_LOOK_AHEAD);
+
+        return pview->look_ahead;
+}
+
+/**
+ * ev_view_presentation_get_slides_ready:
+ * @pview: an #EvViewPresentation
+ *
+ * Returns: the number of slides after the current one that are already
+ *     rendered, up to the look ahead
+ *
+ * Since: 3.28
+ */
+guint
+ev_view_presentation_get_slides_ready (EvViewPresentation *pview)
+{
+        g_return_val_if_fail (EV_IS_VIEW_PRESENTATION (pview), 0);
+
+        return pview->slides_ready;
+}
@@ -53,6 +53,10 @@ void            ev_view_presentation_previous_page    (EvViewPresentation *pview
 void            ev_view_presentation_set_rotation     (EvViewPresentation *pview,
                                                        gint                rotation);
 guint           ev_view_presentation_get_rotation     (EvViewPresentation *pview);
+void            ev_view_presentation_set_look_ahead   (EvViewPresentation *pview,
+                                                       guint               look_ahead);
+guint           ev_view_presentation_get_look_ahead   (EvViewPresentation *pview);
+guint           ev_view_presentation_get_slides_ready (EvViewPresentation *pview);
 
 G_END_DECLS
 
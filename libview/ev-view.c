@@ -45,6 +45,7 @@
 #include "ev-view-private.h"
 #include "ev-view-type-builtins.h"
 #include "ev-debug.h"
+#include "ev-trace.h"
 
 #ifdef ENABLE_MULTIMEDIA
 #include "ev-media-player.h"
@@ -103,6 +104,8 @@ typedef struct {
 } EvViewChild;
 
 #define MIN_SCALE 0.2
+/* Maximum scale of backends rendering pages in tiles */
+#define MAX_TILED_SCALE 64.0
 #define ZOOM_IN_FACTOR  1.2
 #define ZOOM_OUT_FACTOR (1.0/ZOOM_IN_FACTOR)
 
@@ -128,6 +131,8 @@ static void       compute_border                             (EvView
 static void       get_page_y_offset                          (EvView             *view,
 							      int                 page,
 							      int                *y_offset);
+static gint       find_first_page_at_y_offset                (EvView             *view,
+							      gint                y);
 static void       find_page_at_location                      (EvView             *view,
 							      gdouble             x,
 							      gdouble             y,
@@ -226,6 +231,8 @@ static void       ev_view_page_changed_cb                    (EvDocumentModel
 							      EvView             *view);
 static void       on_adjustment_value_changed                (GtkAdjustment      *adjustment,
 							      EvView             *view);
+static void       ev_view_document_cache_updated_cb          (EvDocument         *document,
+							      EvView             *view);
 /*** GObject ***/
 static void       ev_view_finalize                           (GObject            *object);
 static void       ev_view_dispose                            (GObject            *object);
@@ -734,10 +741,16 @@ view_update_range_and_current_page (EvView *view)
 		current_area.y = gtk_adjustment_get_value (view->vadjustment);
 		current_area.height = gtk_adjustment_get_page_size (view->vadjustment);
 
-		for (i = 0; i < ev_document_get_n_pages (view->document); i++) {
+		for (i = find_first_page_at_y_offset (view, current_area.y);
+		     i < ev_document_get_n_pages (view->document); i++) {
 
 			ev_view_get_page_extents (view, i, &page_area, &border);
 
+			/* Pages are laid out top to bottom,
+			 * none of the next ones is visible */
+			if (page_area.y >= current_area.y + current_area.height)
+				break;
+
 			if (gdk_rectangle_intersect (&current_area, &page_area, &unused)) {
 				area = unused.width * unused.height;
 
@@ -940,11 +953,11 @@ compute_scroll_increment (EvView        *view,
 		doc_rect.x1 = doc_rect.x2 = rect.x + 0.5;
 		doc_rect.y1 = doc_rect.y2 = rect.y + 0.5;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (view->document);
 		sel_region = ev_selection_get_selection_region (EV_SELECTION (view->document),
 								rc, EV_SELECTION_STYLE_LINE,
 								&doc_rect);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 
 		g_object_unref (rc);
 
@@ -1248,6 +1261,39 @@ get_page_y_offset (EvView *view, int page, int *y_offset)
 	return;
 }
 
+/* Returns the first page of the row containing @y in continuous mode. The
+ * offsets of the pages never decrease with the page index, so it's found
+ * with a binary search on the height to page cache.
+ */
+static gint
+find_first_page_at_y_offset (EvView *view,
+			     gint    y)
+{
+	gint low = 0;
+	gint high = ev_document_get_n_pages (view->document) - 1;
+	gint offset, prev_offset;
+
+	while (low < high) {
+		gint mid = low + (high - low + 1) / 2;
+
+		get_page_y_offset (view, mid, &offset);
+		if (offset <= y)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	/* In dual mode the other page of the row has the same offset */
+	if (low > 0 && is_dual_page (view, NULL)) {
+		get_page_y_offset (view, low, &offset);
+		get_page_y_offset (view, low - 1, &prev_offset);
+		if (prev_offset == offset)
+			low--;
+	}
+
+	return low;
+}
+
 gboolean
 ev_view_get_page_extents (EvView       *view,
 			  gint          page,
@@ -3113,10 +3159,10 @@ ev_view_annotation_save_contents (EvView       *view,
 	if (!view->document)
 		return;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 						 annot, EV_ANNOTATIONS_SAVE_CONTENTS);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 }
 
 static GtkWidget *
@@ -3352,7 +3398,7 @@ ev_view_create_annotation (EvView *view)
 	_ev_view_transform_view_point_to_doc_point (view, &view->adding_annot_info.stop, &page_area, &border,
 						    &end.x, &end.y);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	page = ev_document_get_page (view->document, annot_page);
         switch (view->adding_annot_info.type) {
         case EV_ANNOTATION_TYPE_TEXT:
@@ -3372,7 +3418,7 @@ ev_view_create_annotation (EvView *view)
 	case EV_ANNOTATION_TYPE_ATTACHMENT:
 		/* TODO */
 		g_object_unref (page);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 		return;
 	default:
 		g_assert_not_reached ();
@@ -3397,7 +3443,7 @@ ev_view_create_annotation (EvView *view)
 	}
 	ev_document_annotations_add_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 						annot, &doc_rect);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 
 	/* If the page didn't have annots, mark the cache as dirty */
 	if (!ev_page_cache_get_annot_mapping (view->page_cache, annot_page))
@@ -3474,10 +3520,10 @@ ev_view_remove_annotation (EvView       *view,
 
         _ev_view_set_focused_element (view, NULL, -1);
 
-        ev_document_doc_mutex_lock ();
+        ev_document_lock (view->document);
         ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
                                                    annot);
-        ev_document_doc_mutex_unlock ();
+        ev_document_unlock (view->document);
 
         ev_page_cache_mark_dirty (view->page_cache, page, EV_PAGE_DATA_INCLUDE_ANNOTS);
 
@@ -4569,6 +4615,52 @@ draw_debug_borders (EvView       *view,
 }
 #endif
 
+static void
+draw_trace_overlay (EvView  *view,
+		    cairo_t *cr)
+{
+	GString     *text;
+	PangoLayout *layout;
+	gint         width, height;
+	gint         i;
+
+	text = g_string_new (NULL);
+	for (i = 0; i < EV_TRACE_N_CATEGORIES; i++) {
+		EvTraceStats stats;
+
+		ev_trace_get_stats (i, &stats);
+		if (i > 0)
+			g_string_append_c (text, '\n');
+		if (i == EV_TRACE_SURFACE_BYTES) {
+			g_string_append_printf (text, "%s: %u, last %.1f MiB, total %.1f MiB",
+						ev_trace_get_category_name (i), stats.count,
+						stats.last / (1024. * 1024.),
+						stats.total / (1024. * 1024.));
+		} else {
+			g_string_append_printf (text, "%s: %u, last %.2f ms, avg %.2f ms, max %.2f ms",
+						ev_trace_get_category_name (i), stats.count,
+						stats.last / 1000.,
+						stats.count ? stats.total / 1000. / stats.count : 0.,
+						stats.max / 1000.);
+		}
+	}
+
+	layout = gtk_widget_create_pango_layout (GTK_WIDGET (view), text->str);
+	g_string_free (text, TRUE);
+	pango_layout_get_pixel_size (layout, &width, &height);
+
+	cairo_save (cr);
+	cairo_rectangle (cr, 0, 0, width + 8, height + 8);
+	cairo_set_source_rgba (cr, 0., 0., 0., 0.7);
+	cairo_fill (cr);
+	cairo_move_to (cr, 4, 4);
+	cairo_set_source_rgb (cr, 1., 1., 1.);
+	pango_cairo_show_layout (cr, layout);
+	cairo_restore (cr);
+
+	g_object_unref (layout);
+}
+
 static gboolean
 ev_view_draw (GtkWidget *widget,
               cairo_t   *cr)
@@ -4576,6 +4668,9 @@ ev_view_draw (GtkWidget *widget,
 	EvView      *view = EV_VIEW (widget);
 	gint         i;
 	GdkRectangle clip_rect;
+	gint64       start;
+
+	start = ev_trace_now ();
 
 	gtk_render_background (gtk_widget_get_style_context (widget),
 			       cr,
@@ -4621,6 +4716,10 @@ ev_view_draw (GtkWidget *widget,
         if (GTK_WIDGET_CLASS (ev_view_parent_class)->draw)
                 GTK_WIDGET_CLASS (ev_view_parent_class)->draw (widget, cr);
 
+	ev_trace_record (EV_TRACE_DRAW, "ev_view_draw", start, ev_trace_now ());
+	if (ev_trace_get_flags () & EV_TRACE_OVERLAY)
+		draw_trace_overlay (view, cr);
+
 	return FALSE;
 }
 
@@ -5182,10 +5281,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 			if (view->image_dnd_info.image) {
 				GdkPixbuf *pixbuf;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				gtk_selection_data_set_pixbuf (selection_data, pixbuf);
 				g_object_unref (pixbuf);
@@ -5197,10 +5296,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 				const gchar *tmp_uri;
 				gchar       *uris[2];
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				tmp_uri = ev_image_save_tmp (view->image_dnd_info.image, pixbuf);
 				g_object_unref (pixbuf);
@@ -5470,13 +5569,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->adding_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->adding_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 
 			/* FIXME: reload only annotation area */
@@ -5534,13 +5633,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->moving_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->moving_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 			/* FIXME: reload only annotation area */
 			ev_view_reload_page (view, annot_page, NULL);
@@ -5685,10 +5784,10 @@ ev_view_button_release_event (GtkWidget      *widget,
 				/* Do not create empty annots */
 				annot_added = FALSE;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									   view->adding_annot_info.annot);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 
 				ev_page_cache_mark_dirty (view->page_cache,
 							  ev_annotation_get_page_index (view->adding_annot_info.annot),
@@ -5701,11 +5800,11 @@ ev_view_button_release_event (GtkWidget      *widget,
 
 				if (ev_annotation_markup_set_rectangle (EV_ANNOTATION_MARKUP (view->adding_annot_info.annot),
 									&popup_rect)) {
-					ev_document_doc_mutex_lock ();
+					ev_document_lock (view->document);
 					ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 										 view->adding_annot_info.annot,
 										 EV_ANNOTATIONS_SAVE_POPUP_RECT);
-					ev_document_doc_mutex_unlock ();
+					ev_document_unlock (view->document);
 				}
 				/* the annotation window might already exist */
 				window = get_window_for_annot (view, view->adding_annot_info.annot);
@@ -6783,6 +6882,44 @@ draw_one_page (EvView       *view,
 
 		draw_surface (cr, page_surface, overlap.x, overlap.y, offset_x, offset_y, width, height);
 
+		if (ev_pixbuf_cache_is_page_tiled (view->pixbuf_cache, page)) {
+			GdkRectangle tiles_area, visible_area;
+			GList       *tiles, *l;
+
+			/* Tiles still rendering for the parts of the page
+			 * that scrolled off are not needed anymore */
+			visible_area.x = 0;
+			visible_area.y = 0;
+			visible_area.width = gtk_widget_get_allocated_width (GTK_WIDGET (view));
+			visible_area.height = gtk_widget_get_allocated_height (GTK_WIDGET (view));
+			if (gdk_rectangle_intersect (&real_page_area, &visible_area, &visible_area)) {
+				visible_area.x -= real_page_area.x;
+				visible_area.y -= real_page_area.y;
+				ev_pixbuf_cache_cancel_tiles (view->pixbuf_cache, page, &visible_area);
+			}
+
+			tiles_area.x = offset_x;
+			tiles_area.y = offset_y;
+			tiles_area.width = overlap.width;
+			tiles_area.height = overlap.height;
+			tiles = ev_pixbuf_cache_get_tiles (view->pixbuf_cache, page, &tiles_area);
+			for (l = tiles; l; l = g_list_next (l)) {
+				EvPixbufCacheTile *tile = (EvPixbufCacheTile *)l->data;
+				GdkRectangle       tile_area, tile_overlap;
+
+				tile_area = tile->area;
+				tile_area.x += real_page_area.x;
+				tile_area.y += real_page_area.y;
+				if (!gdk_rectangle_intersect (&tile_area, &overlap, &tile_overlap))
+					continue;
+
+				draw_surface (cr, tile->surface, tile_overlap.x, tile_overlap.y,
+					      tile_overlap.x - tile_area.x, tile_overlap.y - tile_area.y,
+					      tile->area.width, tile->area.height);
+			}
+			g_list_free (tiles);
+		}
+
 		/* Get the selection pixbuf iff we have something to draw */
 		if (!find_selection_for_page (view, page))
 			return;
@@ -6814,6 +6951,10 @@ draw_one_page (EvView       *view,
 			scale_x *= device_scale_x;
 			scale_y *= device_scale_y;
 
+			/* The region of tiled pages is at the view scale */
+			if (ev_pixbuf_cache_is_page_tiled (view->pixbuf_cache, page))
+				scale_x = scale_y = 1.0;
+
 			_ev_view_get_selection_colors (view, &color, NULL);
 			draw_selection_region (cr, region, &color, real_page_area.x, real_page_area.y,
 					       scale_x, scale_y);
@@ -6867,6 +7008,9 @@ ev_view_dispose (GObject *object)
 	}
 
 	if (view->document) {
+		g_signal_handlers_disconnect_by_func (view->document,
+						      ev_view_document_cache_updated_cb,
+						      view);
 		g_object_unref (view->document);
 		view->document = NULL;
 	}
@@ -7070,6 +7214,10 @@ view_update_scale_limits (EvView *view)
 	height = (rotation == 0 || rotation == 180) ? min_height : min_width;
 	max_scale = sqrt (view->pixbuf_cache_size / (width * dpi * 4 * height * dpi));
 
+	/* Pages that don't fit in the cache are rendered in tiles */
+	if (ev_document_get_render_flags (view->document) & EV_DOCUMENT_RENDER_FLAG_AREA)
+		max_scale = MAX (max_scale, MAX_TILED_SCALE);
+
 	ev_document_model_set_min_scale (view->model, MIN_SCALE * dpi);
 	ev_document_model_set_max_scale (view->model, max_scale * dpi);
 }
@@ -7988,6 +8136,20 @@ ev_view_autoscroll_stop (EvView *view)
 	ev_view_handle_cursor_over_xy (view, x, y);
 }
 
+static void
+ev_view_document_cache_updated_cb (EvDocument *document,
+				   EvView     *view)
+{
+	/* Page sizes found in the background differ from the
+	 * ones the layout was computed with */
+	if (view->height_to_page_cache)
+		ev_view_build_height_to_page_cache (view, view->height_to_page_cache);
+
+	view_update_scale_limits (view);
+	view->pending_scroll = SCROLL_TO_KEEP_POSITION;
+	gtk_widget_queue_resize (GTK_WIDGET (view));
+}
+
 static void
 ev_view_document_changed_cb (EvDocumentModel *model,
 			     GParamSpec      *pspec,
@@ -8002,6 +8164,9 @@ ev_view_document_changed_cb (EvDocumentModel *model,
 		clear_caches (view);
 
 		if (view->document) {
+			g_signal_handlers_disconnect_by_func (view->document,
+							      ev_view_document_cache_updated_cb,
+							      view);
 			g_object_unref (view->document);
                 }
 
@@ -8010,6 +8175,10 @@ ev_view_document_changed_cb (EvDocumentModel *model,
 		view->find_result = 0;
 
 		if (view->document) {
+			g_signal_connect (view->document, "cache-updated",
+					  G_CALLBACK (ev_view_document_cache_updated_cb),
+					  view);
+
 			if (ev_document_get_n_pages (view->document) <= 0 ||
 			    !ev_document_check_dimensions (view->document))
 				return;
@@ -9269,7 +9438,7 @@ get_selected_text (EvView *view)
 
 	text = g_string_new (NULL);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 
 	for (l = view->selection_info.selections; l != NULL; l = l->next) {
 		EvViewSelection *selection = (EvViewSelection *)l->data;
@@ -9285,7 +9454,7 @@ get_selected_text (EvView *view)
 		g_free (tmp);
 	}
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 	
 	normalized_text = g_utf8_normalize (text->str, text->len, G_NORMALIZE_NFKC);
 	g_string_free (text, TRUE);
@@ -0,0 +1,213 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <gtk/gtk.h>
+
+#include <evince-document.h>
+#include <evince-view.h>
+
+#define DEFAULT_N_PAGES 50000
+#define N_SCROLL_STEPS  200
+
+/* A document with many blank pages, every seventh one in landscape
+ * so that the page size isn't uniform.
+ */
+typedef struct {
+	EvDocument parent;
+
+	gint n_pages;
+} SyntheticDocument;
+
+typedef struct {
+	EvDocumentClass parent_class;
+} SyntheticDocumentClass;
+
+static GType synthetic_document_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (SyntheticDocument, synthetic_document, EV_TYPE_DOCUMENT)
+
+static gboolean
+synthetic_document_load (EvDocument  *document,
+			 const char  *uri,
+			 GError     **error)
+{
+	return TRUE;
+}
+
+static gint
+synthetic_document_get_n_pages (EvDocument *document)
+{
+	return ((SyntheticDocument *)document)->n_pages;
+}
+
+static void
+synthetic_document_get_page_size (EvDocument *document,
+				  EvPage     *page,
+				  double     *width,
+				  double     *height)
+{
+	gboolean landscape = page->index % 7 == 6;
+
+	*width = landscape ? 842 : 595;
+	*height = landscape ? 595 : 842;
+}
+
+static cairo_surface_t *
+synthetic_document_render (EvDocument      *document,
+			   EvRenderContext *rc)
+{
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	double           width_points, height_points;
+	gint             width, height;
+
+	synthetic_document_get_page_size (document, rc->page, &width_points, &height_points);
+	ev_render_context_compute_transformed_size (rc, width_points, height_points,
+						    &width, &height);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+	cr = cairo_create (surface);
+	cairo_set_source_rgb (cr, 1., 1., 1.);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	return surface;
+}
+
+static void
+synthetic_document_init (SyntheticDocument *document)
+{
+}
+
+static void
+synthetic_document_class_init (SyntheticDocumentClass *klass)
+{
+	EvDocumentClass *ev_document_class = EV_DOCUMENT_CLASS (klass);
+
+	ev_document_class->load = synthetic_document_load;
+	ev_document_class->get_n_pages = synthetic_document_get_n_pages;
+	ev_document_class->get_page_size = synthetic_document_get_page_size;
+	ev_document_class->render = synthetic_document_render;
+}
+
+static void
+flush_events (void)
+{
+	while (gtk_events_pending ())
+		gtk_main_iteration ();
+}
+
+/* Scrolls the view by N_SCROLL_STEPS viewports from @start, a fraction
+ * of the document height, and returns the mean time per step in µs.
+ */
+static gdouble
+scroll_from (GtkAdjustment *vadjustment,
+	     gdouble        start)
+{
+	gdouble lower = gtk_adjustment_get_lower (vadjustment);
+	gdouble upper = gtk_adjustment_get_upper (vadjustment);
+	gdouble page_size = gtk_adjustment_get_page_size (vadjustment);
+	gdouble value = lower + (upper - page_size - lower) * start;
+	gint64  elapsed = 0;
+	gint    i;
+
+	for (i = 0; i < N_SCROLL_STEPS; i++) {
+		gint64 begin;
+
+		value = MIN (value + page_size / 3, upper - page_size);
+
+		begin = g_get_monotonic_time ();
+		gtk_adjustment_set_value (vadjustment, value);
+		elapsed += g_get_monotonic_time () - begin;
+
+		flush_events ();
+	}
+
+	return (gdouble) elapsed / N_SCROLL_STEPS;
+}
+
+int
+main (int argc, char **argv)
+{
+	SyntheticDocument *document;
+	EvDocumentModel   *model;
+	GtkWidget         *window;
+	GtkWidget         *scrolled_window;
+	GtkWidget         *view;
+	GtkAdjustment     *vadjustment;
+	gint               n_pages = DEFAULT_N_PAGES;
+	gboolean           dual;
+
+	if (!gtk_init_check (&argc, &argv)) {
+		g_printerr ("Cannot open display, skipping\n");
+		return 77;
+	}
+
+	if (argc > 1)
+		n_pages = atoi (argv[1]);
+	if (n_pages <= 0) {
+		g_print ("- Scrolls through a synthetic document\n");
+		g_print ("Usage: %s [n-pages]\n", argv[0]);
+		return 1;
+	}
+
+	ev_init ();
+
+	document = g_object_new (synthetic_document_get_type (), NULL);
+	document->n_pages = n_pages;
+	ev_document_load (EV_DOCUMENT (document), "file:///dev/null", NULL);
+
+	model = ev_document_model_new_with_document (EV_DOCUMENT (document));
+	ev_document_model_set_continuous (model, TRUE);
+	ev_document_model_set_sizing_mode (model, EV_SIZING_FIT_WIDTH);
+
+	window = gtk_offscreen_window_new ();
+	gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+	scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+	gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+	view = ev_view_new ();
+	ev_view_set_model (EV_VIEW (view), model);
+	gtk_container_add (GTK_CONTAINER (scrolled_window), view);
+	gtk_widget_show_all (window);
+	flush_events ();
+
+	vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (view));
+
+	g_print ("%d pages\n", n_pages);
+	for (dual = FALSE; dual <= TRUE; dual++) {
+		ev_document_model_set_page_layout (model, dual ?
+						   EV_PAGE_LAYOUT_DUAL :
+						   EV_PAGE_LAYOUT_SINGLE);
+		flush_events ();
+
+		g_print ("%s continuous:\n", dual ? "Dual" : "Single");
+		g_print ("  start:  %8.1f µs/scroll\n", scroll_from (vadjustment, 0.));
+		g_print ("  middle: %8.1f µs/scroll\n", scroll_from (vadjustment, 0.5));
+		g_print ("  end:    %8.1f µs/scroll\n", scroll_from (vadjustment, 0.99));
+	}
+
+	gtk_widget_destroy (window);
+	g_object_unref (model);
+	g_object_unref (document);
+
+	ev_shutdown ();
+
+	return 0;
+}
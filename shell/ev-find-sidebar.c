@@ -386,28 +386,6 @@ get_surrounding_text_markup (const gchar  *text,
         return markup;
 }
 
-static gchar *
-get_page_text (EvDocument   *document,
-               EvPage       *page,
-               EvRectangle **areas,
-               guint        *n_areas)
-{
-        gchar   *text;
-        gboolean success;
-
-        ev_document_doc_mutex_lock ();
-        text = ev_document_text_get_text (EV_DOCUMENT_TEXT (document), page);
-        success = ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (document), page, areas, n_areas);
-        ev_document_doc_mutex_unlock ();
-
-        if (!success) {
-                g_free (text);
-                return NULL;
-        }
-
-        return text;
-}
-
 static gint
 get_match_offset (EvRectangle *areas,
                   guint        n_areas,
@@ -457,10 +435,10 @@ process_matches_idle (EvFindSidebar *sidebar)
 
         do {
                 GList        *matches, *l;
-                EvPage       *page;
+                EvPageText   *page_text;
                 gint          result;
                 gchar        *page_label;
-                gchar        *page_text;
+                const gchar  *text;
                 EvRectangle  *areas = NULL;
                 guint         n_areas;
                 PangoLogAttr *text_log_attrs;
@@ -474,16 +452,17 @@ process_matches_idle (EvFindSidebar *sidebar)
                 if (!matches)
                         continue;
 
-                page = ev_document_get_page (document, current_page);
-		page_label = ev_document_get_page_label (document, current_page);
-                page_text = get_page_text (document, page, &areas, &n_areas);
-                g_object_unref (page);
+                page_text = ev_page_text_get (document, current_page);
                 if (!page_text)
                         continue;
 
-                text_log_attrs_length = g_utf8_strlen (page_text, -1);
-                text_log_attrs = g_new0 (PangoLogAttr, text_log_attrs_length + 1);
-                pango_get_log_attrs (page_text, -1, -1, NULL, text_log_attrs, text_log_attrs_length + 1);
+                text = ev_page_text_get_text (page_text);
+                if (!text || !ev_page_text_get_layout (page_text, &areas, &n_areas)) {
+                        ev_page_text_unref (page_text);
+                        continue;
+                }
+                ev_page_text_get_log_attrs (page_text, &text_log_attrs, &text_log_attrs_length);
+		page_label = ev_document_get_page_label (document, current_page);
 
                 if (priv->first_match_page == -1)
                         priv->first_match_page = current_page;
@@ -510,7 +489,7 @@ process_matches_idle (EvFindSidebar *sidebar)
                                 priv->insert_position++;
                         }
 
-                        markup = get_surrounding_text_markup (page_text,
+                        markup = get_surrounding_text_markup (text,
                                                               priv->job->text,
                                                               priv->job->case_sensitive,
                                                               text_log_attrs,
@@ -527,9 +506,7 @@ process_matches_idle (EvFindSidebar *sidebar)
                 }
 
                 g_free (page_label);
-                g_free (page_text);
-                g_free (text_log_attrs);
-                g_free (areas);
+                ev_page_text_unref (page_text);
         } while (current_page != priv->job_current_page);
 
         if (ev_job_is_finished (EV_JOB (priv->job)) && priv->current_page == priv->job->start_page)
@@ -53,6 +53,7 @@ struct _EvRecentViewPrivate {
         GtkRecentManager *recent_manager;
         GtkTreePath      *pressed_item_tree_path;
         guint             recent_manager_changed_handler_id;
+        guint             needs_refresh : 1;
 
 #ifdef HAVE_LIBGNOME_DESKTOP
         GnomeDesktopThumbnailFactory *thumbnail_factory;
@@ -71,6 +72,8 @@ G_DEFINE_TYPE (EvRecentView, ev_recent_view, GTK_TYPE_SCROLLED_WINDOW)
 #define ICON_VIEW_SIZE 128
 #define MAX_RECENT_VIEW_ITEMS 20
 
+static void ev_recent_view_refresh (EvRecentView *ev_recent_view);
+
 typedef struct {
         EvRecentView        *ev_recent_view;
         char                *uri;
@@ -126,6 +129,29 @@ ev_recent_view_clear_async_data (GtkTreeModel *model,
         return FALSE;
 }
 
+static gboolean
+ev_recent_view_cancel_async_data (GtkTreeModel *model,
+                                  GtkTreePath  *path,
+                                  GtkTreeIter  *iter,
+                                  EvRecentView *ev_recent_view)
+{
+        GetDocumentInfoAsyncData *data;
+
+        gtk_tree_model_get (model, iter, EV_RECENT_VIEW_COLUMN_ASYNC_DATA, &data, -1);
+
+        if (data == NULL)
+                return FALSE;
+
+        ev_recent_view->priv->needs_refresh = TRUE;
+        g_cancellable_cancel (data->cancellable);
+
+        /* A cancelled job doesn't emit finished, so free the data now */
+        if (data->job && !ev_job_is_finished (data->job))
+                get_document_info_async_data_free (data);
+
+        return FALSE;
+}
+
 static void
 ev_recent_view_clear_model (EvRecentView *ev_recent_view)
 {
@@ -164,6 +190,31 @@ ev_recent_view_dispose (GObject *obj)
         G_OBJECT_CLASS (ev_recent_view_parent_class)->dispose (obj);
 }
 
+static void
+ev_recent_view_map (GtkWidget *widget)
+{
+        EvRecentView *ev_recent_view = EV_RECENT_VIEW (widget);
+
+        GTK_WIDGET_CLASS (ev_recent_view_parent_class)->map (widget);
+
+        /* Get again what was cancelled when the view was hidden */
+        if (ev_recent_view->priv->needs_refresh)
+                ev_recent_view_refresh (ev_recent_view);
+}
+
+static void
+ev_recent_view_unmap (GtkWidget *widget)
+{
+        EvRecentView *ev_recent_view = EV_RECENT_VIEW (widget);
+
+        /* Don't keep loading documents for a view nobody sees */
+        gtk_tree_model_foreach (GTK_TREE_MODEL (ev_recent_view->priv->model),
+                                (GtkTreeModelForeachFunc)ev_recent_view_cancel_async_data,
+                                ev_recent_view);
+
+        GTK_WIDGET_CLASS (ev_recent_view_parent_class)->unmap (widget);
+}
+
 static gint
 compare_recent_items (GtkRecentInfo *a,
                       GtkRecentInfo *b)
@@ -343,9 +394,7 @@ save_thumbnail_in_cache_thread (GTask                    *task,
         cairo_surface_t *surface;
 
         surface = EV_JOB_THUMBNAIL (data->job)->thumbnail_surface;
-        thumbnail = gdk_pixbuf_get_from_surface (surface, 0, 0,
-                                                 cairo_image_surface_get_width (surface),
-                                                 cairo_image_surface_get_height (surface));
+        thumbnail = ev_document_misc_pixbuf_from_surface (surface);
 
         gnome_desktop_thumbnail_factory_save_thumbnail (ev_recent_view->priv->thumbnail_factory,
                                                         thumbnail, data->uri, data->mtime);
@@ -428,7 +477,7 @@ document_load_job_completed_callback (EvJobLoad                *job_load,
                 g_signal_connect (data->job, "finished",
                                   G_CALLBACK (thumbnail_job_completed_callback),
                                   data);
-                ev_job_scheduler_push_job (data->job, EV_JOB_PRIORITY_HIGH);
+                ev_job_scheduler_push_job (data->job, EV_JOB_PRIORITY_NONE);
         }
 
         if (data->needs_metadata) {
@@ -479,10 +528,13 @@ static void
 load_document_and_get_document_info (GetDocumentInfoAsyncData *data)
 {
         data->job = EV_JOB (ev_job_load_new (data->uri));
+        /* Only the info and the first page are needed */
+        ev_job_load_set_load_flags (EV_JOB_LOAD (data->job),
+                                    EV_DOCUMENT_LOAD_FLAG_PROBE);
         g_signal_connect (data->job, "finished",
                           G_CALLBACK (document_load_job_completed_callback),
                           data);
-        ev_job_scheduler_push_job (data->job, EV_JOB_PRIORITY_HIGH);
+        ev_job_scheduler_push_job (data->job, EV_JOB_PRIORITY_NONE);
 }
 
 #ifdef HAVE_LIBGNOME_DESKTOP
@@ -736,6 +788,7 @@ ev_recent_view_refresh (EvRecentView *ev_recent_view)
         items = gtk_recent_manager_get_items (priv->recent_manager);
         items = g_list_sort (items, (GCompareFunc) compare_recent_items);
 
+        priv->needs_refresh = FALSE;
         gtk_list_store_clear (priv->model);
 
         for (l = items; l && l->data; l = g_list_next (l)) {
@@ -875,11 +928,15 @@ ev_recent_view_init (EvRecentView *ev_recent_view)
 static void
 ev_recent_view_class_init (EvRecentViewClass *klass)
 {
-        GObjectClass *g_object_class = G_OBJECT_CLASS (klass);
+        GObjectClass   *g_object_class = G_OBJECT_CLASS (klass);
+        GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
         g_object_class->constructed = ev_recent_view_constructed;
         g_object_class->dispose = ev_recent_view_dispose;
 
+        widget_class->map = ev_recent_view_map;
+        widget_class->unmap = ev_recent_view_unmap;
+
         signals[ITEM_ACTIVATED] =
                   g_signal_new ("item-activated",
                                 EV_TYPE_RECENT_VIEW,
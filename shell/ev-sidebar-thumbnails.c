@@ -37,6 +37,7 @@
 #include "ev-job-scheduler.h"
 #include "ev-sidebar-page.h"
 #include "ev-sidebar-thumbnails.h"
+#include "ev-thumbnail-cache.h"
 #include "ev-utils.h"
 #include "ev-window.h"
 
@@ -69,6 +70,7 @@ struct _EvSidebarThumbnailsPrivate {
 	EvDocument *document;
 	EvDocumentModel *model;
 	EvThumbsSizeCache *size_cache;
+	EvThumbnailCache *thumbnail_cache;
         gint width;
 
 	gint n_pages, pages_done;
@@ -102,6 +104,9 @@ static void         ev_sidebar_thumbnails_set_current_page (EvSidebarThumbnails
 							    gint     page);
 static void         thumbnail_job_completed_callback       (EvJobThumbnail          *job,
 							    EvSidebarThumbnails     *sidebar_thumbnails);
+static void         ev_sidebar_thumbnails_set_thumbnail    (EvSidebarThumbnails     *sidebar_thumbnails,
+							    GtkTreeIter             *iter,
+							    cairo_surface_t         *thumbnail);
 static void         ev_sidebar_thumbnails_reload           (EvSidebarThumbnails     *sidebar_thumbnails);
 static void         adjustment_changed_cb                  (EvSidebarThumbnails     *sidebar_thumbnails);
 
@@ -286,6 +291,11 @@ ev_sidebar_thumbnails_dispose (GObject *object)
 		sidebar_thumbnails->priv->list_store = NULL;
 	}
 
+	if (sidebar_thumbnails->priv->thumbnail_cache) {
+		ev_thumbnail_cache_close (sidebar_thumbnails->priv->thumbnail_cache);
+		sidebar_thumbnails->priv->thumbnail_cache = NULL;
+	}
+
 	G_OBJECT_CLASS (ev_sidebar_thumbnails_parent_class)->dispose (object);
 }
 
@@ -529,8 +539,21 @@ add_range (EvSidebarThumbnails *sidebar_thumbnails,
 
 		if (job == NULL && !thumbnail_set) {
 			gint thumbnail_width, thumbnail_height;
+			cairo_surface_t *surface = NULL;
+
 			get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
 
+			/* Thumbnails of a previous session don't need a job */
+			if (priv->thumbnail_cache)
+				surface = ev_thumbnail_cache_lookup (priv->thumbnail_cache,
+								     page, priv->rotation,
+								     thumbnail_width, thumbnail_height);
+			if (surface) {
+				ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails, &iter, surface);
+				cairo_surface_destroy (surface);
+				continue;
+			}
+
 			job = ev_job_thumbnail_new_with_target_size (priv->document,
 								     page, priv->rotation,
 								     thumbnail_width, thumbnail_height);
@@ -966,30 +989,24 @@ ev_sidebar_thumbnails_inverted_colors_changed_cb (EvDocumentModel     *model,
 }
 
 static void
-thumbnail_job_completed_callback (EvJobThumbnail      *job,
-				  EvSidebarThumbnails *sidebar_thumbnails)
+ev_sidebar_thumbnails_set_thumbnail (EvSidebarThumbnails *sidebar_thumbnails,
+				     GtkTreeIter         *iter,
+				     cairo_surface_t     *thumbnail)
 {
         GtkWidget                  *widget = GTK_WIDGET (sidebar_thumbnails);
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreeIter                *iter;
         cairo_surface_t            *surface;
 #ifdef HAVE_HIDPI_SUPPORT
         gint                        device_scale;
-#endif
 
-        if (ev_job_is_failed (EV_JOB (job)))
-          return;
-
-#ifdef HAVE_HIDPI_SUPPORT
         device_scale = gtk_widget_get_scale_factor (widget);
-        cairo_surface_set_device_scale (job->thumbnail_surface, device_scale, device_scale);
+        cairo_surface_set_device_scale (thumbnail, device_scale, device_scale);
 #endif
 
         surface = ev_document_misc_render_thumbnail_surface_with_frame (widget,
-                                                                        job->thumbnail_surface,
+                                                                        thumbnail,
                                                                         -1, -1);
 
-	iter = (GtkTreeIter *) g_object_get_data (G_OBJECT (job), "tree_iter");
 	if (priv->inverted_colors)
 		ev_document_misc_invert_surface (surface);
 	gtk_list_store_set (priv->list_store,
@@ -1000,7 +1017,44 @@ thumbnail_job_completed_callback (EvJobThumbnail      *job,
 			    -1);
         cairo_surface_destroy (surface);
 
-        gtk_widget_queue_draw (priv->icon_view);
+        if (priv->icon_view)
+                gtk_widget_queue_draw (priv->icon_view);
+}
+
+static void
+thumbnail_job_completed_callback (EvJobThumbnail      *job,
+				  EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	GtkTreeIter                *iter;
+
+        if (ev_job_is_failed (EV_JOB (job)))
+          return;
+
+	if (priv->thumbnail_cache)
+		ev_thumbnail_cache_add (priv->thumbnail_cache,
+					job->page, job->rotation,
+					job->target_width, job->target_height,
+					job->thumbnail_surface);
+
+	iter = (GtkTreeIter *) g_object_get_data (G_OBJECT (job), "tree_iter");
+	ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails, iter, job->thumbnail_surface);
+}
+
+static void
+ev_sidebar_thumbnails_cache_updated_cb (EvDocument          *document,
+					EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+
+	if (document != priv->document)
+		return;
+
+	/* Page sizes or labels found in the background differ
+	 * from the ones the thumbnails were laid out with */
+	g_object_set_data (G_OBJECT (document), EV_THUMBNAILS_SIZE_CACHE_KEY, NULL);
+	priv->size_cache = ev_thumbnails_size_cache_get (document);
+	ev_sidebar_thumbnails_reload (sidebar_thumbnails);
 }
 
 static void
@@ -1016,7 +1070,17 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 		return;
 	}
 
+	g_signal_handlers_disconnect_by_func (document,
+					      ev_sidebar_thumbnails_cache_updated_cb,
+					      sidebar_thumbnails);
+	g_signal_connect_object (document, "cache-updated",
+				 G_CALLBACK (ev_sidebar_thumbnails_cache_updated_cb),
+				 sidebar_thumbnails, 0);
+
 	priv->size_cache = ev_thumbnails_size_cache_get (document);
+	if (priv->thumbnail_cache)
+		ev_thumbnail_cache_close (priv->thumbnail_cache);
+	priv->thumbnail_cache = ev_thumbnail_cache_new (document);
 	priv->document = document;
 	priv->n_pages = ev_document_get_n_pages (document);
 	priv->rotation = ev_document_model_get_rotation (model);
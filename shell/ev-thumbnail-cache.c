@@ -0,0 +1,421 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "ev-thumbnail-cache.h"
+
+#define CACHE_NAME    "thumbnails"
+#define CACHE_MAGIC   "EvThumbs"
+#define CACHE_VERSION 2
+
+/* Pixels written for one document, and documents kept in the cache dir */
+#define CACHE_MAX_SIZE      (64 * 1024 * 1024)
+#define CACHE_MAX_DOCUMENTS 64
+
+/* After the header of cache files, the file has this header followed
+ * by the entries sorted by key, and then the pixels of every thumbnail,
+ * each one aligned to 16 bytes so that cairo can use them in place.
+ * Numbers are stored in little endian, pixels in the byte order of the
+ * machine, like cairo does.
+ */
+typedef struct {
+	guint32 n_pages;
+	guint32 n_entries;
+} CacheHeader;
+
+typedef struct {
+	guint64 key;
+	guint32 width;
+	guint32 height;
+	guint32 stride;
+	guint32 format;
+	guint64 offset;
+} CacheEntry;
+
+typedef struct {
+	const CacheEntry *entry;   /* In the mapped file, or NULL */
+	cairo_surface_t  *surface; /* Created on lookup, or added */
+} Thumbnail;
+
+struct _EvThumbnailCache {
+	gchar       *uri;
+	guint64      mtime;
+	guint64      size;
+	guint32      n_pages;
+
+	GMappedFile *file;
+	GHashTable  *thumbnails;
+	gboolean     changed;
+};
+
+static const cairo_user_data_key_t mapped_file_key;
+
+/* Returns 0 for thumbnails that can't be cached */
+static guint64
+get_key (gint page,
+	 gint rotation,
+	 gint width,
+	 gint height)
+{
+	if (page < 0 || page >= (1 << 29) ||
+	    width <= 0 || width >= (1 << 16) ||
+	    height <= 0 || height >= (1 << 16))
+		return 0;
+
+	return ((guint64) page << 34) | ((guint64) ((rotation / 90) & 3) << 32) |
+		((guint64) width << 16) | (guint64) height;
+}
+
+static void
+thumbnail_free (Thumbnail *thumbnail)
+{
+	if (thumbnail->surface)
+		cairo_surface_destroy (thumbnail->surface);
+	g_slice_free (Thumbnail, thumbnail);
+}
+
+static void
+ev_thumbnail_cache_insert (EvThumbnailCache *cache,
+			   guint64           key,
+			   const CacheEntry *entry,
+			   cairo_surface_t  *surface)
+{
+	Thumbnail *thumbnail;
+	guint64   *hash_key;
+
+	thumbnail = g_slice_new (Thumbnail);
+	thumbnail->entry = entry;
+	thumbnail->surface = surface;
+
+	hash_key = g_new (guint64, 1);
+	*hash_key = key;
+	g_hash_table_insert (cache->thumbnails, hash_key, thumbnail);
+}
+
+static void
+ev_thumbnail_cache_load (EvThumbnailCache *cache)
+{
+	GMappedFile       *file;
+	const gchar       *contents;
+	const CacheHeader *header;
+	const CacheEntry  *entries;
+	gsize              size, header_offset, entries_offset;
+	guint32            n_entries, i;
+
+	file = ev_cache_file_open (CACHE_NAME, CACHE_MAGIC, CACHE_VERSION,
+				   cache->uri, &header_offset);
+	if (!file)
+		return;
+
+	contents = g_mapped_file_get_contents (file);
+	size = g_mapped_file_get_length (file);
+	header = (const CacheHeader *) (contents + header_offset);
+	entries_offset = header_offset + sizeof (CacheHeader);
+
+	if (entries_offset > size ||
+	    GUINT32_FROM_LE (header->n_pages) != cache->n_pages) {
+		g_mapped_file_unref (file);
+		return;
+	}
+
+	n_entries = GUINT32_FROM_LE (header->n_entries);
+	if (entries_offset + (gsize) n_entries * sizeof (CacheEntry) > size) {
+		g_mapped_file_unref (file);
+		return;
+	}
+
+	cache->file = file;
+
+	entries = (const CacheEntry *) (contents + entries_offset);
+	for (i = 0; i < n_entries; i++) {
+		const CacheEntry *entry = &entries[i];
+		guint32           width = GUINT32_FROM_LE (entry->width);
+		guint32           height = GUINT32_FROM_LE (entry->height);
+		guint32           stride = GUINT32_FROM_LE (entry->stride);
+		cairo_format_t    format = GUINT32_FROM_LE (entry->format);
+		guint64           offset = GUINT64_FROM_LE (entry->offset);
+
+		/* Don't trust a corrupted file */
+		if ((format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24) ||
+		    width == 0 || width >= (1 << 16) || height >= (1 << 16) ||
+		    stride != (guint32) cairo_format_stride_for_width (format, width) ||
+		    offset % 16 != 0 || offset > size || (guint64) stride * height > size - offset)
+			continue;
+
+		ev_thumbnail_cache_insert (cache, GUINT64_FROM_LE (entry->key), entry, NULL);
+	}
+}
+
+/**
+ * ev_thumbnail_cache_new:
+ * @document: an #EvDocument
+ *
+ * Opens the thumbnail cache of @document, reading the thumbnails saved
+ * by a previous session if the document file didn't change since then.
+ *
+ * Returns: a new #EvThumbnailCache, or %NULL if @document is not a
+ *     local file
+ */
+EvThumbnailCache *
+ev_thumbnail_cache_new (EvDocument *document)
+{
+	EvThumbnailCache *cache;
+	const gchar      *uri;
+	GFile            *file;
+	gboolean          is_native;
+	guint64           mtime, size;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return NULL;
+
+	file = g_file_new_for_uri (uri);
+	is_native = g_file_is_native (file);
+	g_object_unref (file);
+	if (!is_native || !ev_cache_file_get_stamp (uri, &mtime, &size))
+		return NULL;
+
+	cache = g_new0 (EvThumbnailCache, 1);
+	cache->uri = g_strdup (uri);
+	cache->mtime = mtime;
+	cache->size = size;
+	cache->n_pages = ev_document_get_n_pages (document);
+	cache->thumbnails = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+						   g_free,
+						   (GDestroyNotify) thumbnail_free);
+	ev_thumbnail_cache_load (cache);
+
+	return cache;
+}
+
+/**
+ * ev_thumbnail_cache_lookup:
+ * @cache: an #EvThumbnailCache
+ * @page: the page index
+ * @rotation: the rotation of the thumbnail
+ * @width: the target width of the thumbnail, in device pixels
+ * @height: the target height of the thumbnail, in device pixels
+ *
+ * Returns: (transfer full): the thumbnail, or %NULL. A thumbnail from
+ *     the cache file must not be drawn to.
+ */
+cairo_surface_t *
+ev_thumbnail_cache_lookup (EvThumbnailCache *cache,
+			   gint              page,
+			   gint              rotation,
+			   gint              width,
+			   gint              height)
+{
+	Thumbnail *thumbnail;
+	guint64    key;
+
+	key = get_key (page, rotation, width, height);
+	if (key == 0)
+		return NULL;
+
+	thumbnail = g_hash_table_lookup (cache->thumbnails, &key);
+	if (!thumbnail)
+		return NULL;
+
+	if (!thumbnail->surface) {
+		const CacheEntry *entry = thumbnail->entry;
+		guchar           *data;
+
+		data = (guchar *) g_mapped_file_get_contents (cache->file) +
+			GUINT64_FROM_LE (entry->offset);
+		thumbnail->surface = cairo_image_surface_create_for_data (data,
+									  GUINT32_FROM_LE (entry->format),
+									  GUINT32_FROM_LE (entry->width),
+									  GUINT32_FROM_LE (entry->height),
+									  GUINT32_FROM_LE (entry->stride));
+		/* The surface can outlive the cache */
+		cairo_surface_set_user_data (thumbnail->surface, &mapped_file_key,
+					     g_mapped_file_ref (cache->file),
+					     (cairo_destroy_func_t) g_mapped_file_unref);
+	}
+
+	return cairo_surface_reference (thumbnail->surface);
+}
+
+/**
+ * ev_thumbnail_cache_add:
+ * @cache: an #EvThumbnailCache
+ * @page: the page index
+ * @rotation: the rotation of the thumbnail
+ * @width: the target width of the thumbnail, in device pixels
+ * @height: the target height of the thumbnail, in device pixels
+ * @surface: the rendered thumbnail
+ *
+ * Adds a thumbnail to be saved when @cache is closed. @surface is kept
+ * alive until then, and must not be drawn to anymore.
+ */
+void
+ev_thumbnail_cache_add (EvThumbnailCache *cache,
+			gint              page,
+			gint              rotation,
+			gint              width,
+			gint              height,
+			cairo_surface_t  *surface)
+{
+	cairo_format_t format;
+	guint64        key;
+
+	key = get_key (page, rotation, width, height);
+	if (key == 0 || g_hash_table_contains (cache->thumbnails, &key))
+		return;
+
+	if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+		return;
+
+	format = cairo_image_surface_get_format (surface);
+	if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+		return;
+
+	ev_thumbnail_cache_insert (cache, key, NULL, cairo_surface_reference (surface));
+	cache->changed = TRUE;
+}
+
+static void
+ev_thumbnail_cache_free (EvThumbnailCache *cache)
+{
+	g_hash_table_destroy (cache->thumbnails);
+	if (cache->file)
+		g_mapped_file_unref (cache->file);
+	g_free (cache->uri);
+	g_free (cache);
+}
+
+static gint
+compare_keys (gconstpointer a,
+	      gconstpointer b)
+{
+	guint64 key_a = **(guint64 **) a;
+	guint64 key_b = **(guint64 **) b;
+
+	return key_a < key_b ? -1 : key_a > key_b;
+}
+
+static void
+ev_thumbnail_cache_save (EvThumbnailCache *cache)
+{
+	GPtrArray    *keys;
+	GByteArray   *data;
+	CacheHeader   header;
+	GHashTableIter iter;
+	guint64      *key;
+	gsize         header_offset, entries_offset, offset, total_size = 0;
+	guint         i, n_entries = 0;
+
+	/* Thumbnails are written by page, up to the size limit */
+	keys = g_ptr_array_sized_new (g_hash_table_size (cache->thumbnails));
+	g_hash_table_iter_init (&iter, cache->thumbnails);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+		g_ptr_array_add (keys, key);
+	g_ptr_array_sort (keys, compare_keys);
+
+	data = ev_cache_file_new_data (CACHE_MAGIC, CACHE_VERSION, cache->uri,
+				      cache->mtime, cache->size);
+	header_offset = data->len;
+	entries_offset = header_offset + sizeof (CacheHeader);
+	offset = (entries_offset + keys->len * sizeof (CacheEntry) + 15) & ~15;
+
+	g_byte_array_set_size (data, offset);
+	memset (data->data + header_offset, 0, offset - header_offset);
+
+	for (i = 0; i < keys->len; i++) {
+		Thumbnail    *thumbnail;
+		CacheEntry    entry;
+		const guchar *pixels;
+		gsize         pixels_size;
+
+		key = g_ptr_array_index (keys, i);
+		thumbnail = g_hash_table_lookup (cache->thumbnails, key);
+
+		if (thumbnail->surface) {
+			cairo_surface_t *surface = thumbnail->surface;
+
+			cairo_surface_flush (surface);
+			entry.width = GUINT32_TO_LE (cairo_image_surface_get_width (surface));
+			entry.height = GUINT32_TO_LE (cairo_image_surface_get_height (surface));
+			entry.stride = GUINT32_TO_LE (cairo_image_surface_get_stride (surface));
+			entry.format = GUINT32_TO_LE (cairo_image_surface_get_format (surface));
+			pixels = cairo_image_surface_get_data (surface);
+		} else {
+			entry = *thumbnail->entry;
+			pixels = (const guchar *) g_mapped_file_get_contents (cache->file) +
+				GUINT64_FROM_LE (entry.offset);
+		}
+		pixels_size = (gsize) GUINT32_FROM_LE (entry.stride) * GUINT32_FROM_LE (entry.height);
+
+		if (total_size + pixels_size > CACHE_MAX_SIZE)
+			break;
+		total_size += pixels_size;
+
+		entry.key = GUINT64_TO_LE (*key);
+		entry.offset = GUINT64_TO_LE (data->len);
+		memcpy (data->data + entries_offset + n_entries * sizeof (CacheEntry),
+			&entry, sizeof (CacheEntry));
+		n_entries++;
+
+		g_byte_array_append (data, pixels, pixels_size);
+		g_byte_array_set_size (data, (data->len + 15) & ~15);
+	}
+	g_ptr_array_free (keys, TRUE);
+
+	header.n_pages = GUINT32_TO_LE (cache->n_pages);
+	header.n_entries = GUINT32_TO_LE (n_entries);
+	memcpy (data->data + header_offset, &header, sizeof (header));
+
+	/* The file is replaced, so thumbnails still mapped stay valid */
+	ev_cache_file_save (CACHE_NAME, cache->uri, data, CACHE_MAX_DOCUMENTS);
+	g_byte_array_unref (data);
+}
+
+static gpointer
+ev_thumbnail_cache_save_thread (EvThumbnailCache *cache)
+{
+	ev_thumbnail_cache_save (cache);
+	ev_thumbnail_cache_free (cache);
+
+	return NULL;
+}
+
+/**
+ * ev_thumbnail_cache_close:
+ * @cache: an #EvThumbnailCache
+ *
+ * Frees @cache, after saving it in a thread if thumbnails were added.
+ */
+void
+ev_thumbnail_cache_close (EvThumbnailCache *cache)
+{
+	GThread *thread;
+
+	if (!cache->changed) {
+		ev_thumbnail_cache_free (cache);
+		return;
+	}
+
+	thread = g_thread_new ("EvThumbnailCache",
+			       (GThreadFunc) ev_thumbnail_cache_save_thread,
+			       cache);
+	g_thread_unref (thread);
+}
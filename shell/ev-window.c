@@ -200,6 +200,7 @@ struct _EvWindowPrivate {
 	char *uri;
 	glong uri_mtime;
 	char *local_uri;
+	GCancellable *download_cancellable;
 	gboolean in_reload;
 	EvFileMonitor *monitor;
 	guint setup_document_idle;
@@ -264,6 +265,7 @@ struct _EvWindowPrivate {
 #define GS_LAST_DOCUMENT_DIRECTORY "document-directory"
 #define GS_LAST_PICTURES_DIRECTORY "pictures-directory"
 #define GS_ALLOW_LINKS_CHANGE_ZOOM "allow-links-change-zoom"
+#define GS_PRESENTATION_LOOK_AHEAD "presentation-look-ahead"
 
 #define SIDEBAR_DEFAULT_SIZE    132
 #define LINKS_SIDEBAR_ID "links"
@@ -1620,9 +1622,20 @@ ev_window_clear_reload_job (EvWindow *ev_window)
 	}
 }
 
+static void
+ev_window_cancel_download (EvWindow *ev_window)
+{
+	if (ev_window->priv->download_cancellable) {
+		g_cancellable_cancel (ev_window->priv->download_cancellable);
+		g_clear_object (&ev_window->priv->download_cancellable);
+	}
+}
+
 static void
 ev_window_clear_local_uri (EvWindow *ev_window)
 {
+	ev_window_cancel_download (ev_window);
+
 	if (ev_window->priv->local_uri) {
 		ev_tmp_uri_unlink (ev_window->priv->local_uri);
 		g_free (ev_window->priv->local_uri);
@@ -2051,11 +2064,106 @@ window_open_file_copy_progress_cb (goffset   n_bytes,
 }
 
 static void
-ev_window_load_file_remote (EvWindow *ev_window,
+ev_window_copy_file_remote (EvWindow *ev_window,
 			    GFile    *source_file)
 {
 	GFile *target_file;
-	
+
+	target_file = g_file_new_for_uri (ev_window->priv->local_uri);
+	g_file_copy_async (source_file, target_file,
+			   G_FILE_COPY_OVERWRITE,
+			   G_PRIORITY_DEFAULT,
+			   ev_window->priv->progress_cancellable,
+			   (GFileProgressCallback)window_open_file_copy_progress_cb,
+			   ev_window, 
+			   (GAsyncReadyCallback)window_open_file_copy_ready_cb,
+			   ev_window);
+	g_object_unref (target_file);
+
+	ev_window_show_progress_message (ev_window, 1,
+					 (GSourceFunc)show_loading_progress);
+}
+
+static void
+window_open_remote_download_cb (EvRangeStream *stream,
+				GAsyncResult  *async_result,
+				EvWindow      *ev_window)
+{
+	GCancellable *cancellable;
+	GFile        *source_file;
+
+	/* The window may be gone if the download was cancelled */
+	cancellable = g_task_get_cancellable (G_TASK (async_result));
+	if (g_cancellable_is_cancelled (cancellable) ||
+	    !ev_range_stream_download_finish (stream, async_result, NULL))
+		return;
+
+	g_clear_object (&ev_window->priv->download_cancellable);
+
+	source_file = g_file_new_for_uri (ev_window->priv->uri);
+	g_file_query_info_async (source_file,
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED,
+				 0, G_PRIORITY_DEFAULT,
+				 NULL,
+				 (GAsyncReadyCallback)set_uri_mtime,
+				 ev_window);
+}
+
+static void
+window_open_remote_info_cb (GFile        *source_file,
+			    GAsyncResult *async_result,
+			    EvWindow     *ev_window)
+{
+	GFileInfo     *info;
+	EvRangeStream *stream;
+	GFile         *target_file;
+	const gchar   *content_type;
+	gchar         *mime_type = NULL;
+	goffset        size = 0;
+
+	/* On error, the copy reports it or mounts the volume */
+	info = g_file_query_info_finish (source_file, async_result, NULL);
+	if (info) {
+		content_type = g_file_info_get_content_type (info);
+		if (content_type)
+			mime_type = g_content_type_get_mime_type (content_type);
+		size = g_file_info_get_size (info);
+		g_object_unref (info);
+	}
+
+	if (!mime_type || size <= 0 || !ev_document_factory_can_load_stream (mime_type)) {
+		g_free (mime_type);
+		ev_window_copy_file_remote (ev_window, source_file);
+		return;
+	}
+	g_free (mime_type);
+
+	/* The document is read as it's downloaded, so the first page
+	 * can be shown long before the download completes.
+	 */
+	target_file = g_file_new_for_uri (ev_window->priv->local_uri);
+	stream = ev_range_stream_new (source_file, target_file, size);
+	g_object_unref (target_file);
+	g_object_unref (source_file);
+
+	ev_job_load_set_stream (EV_JOB_LOAD (ev_window->priv->load_job),
+				G_INPUT_STREAM (stream));
+	ev_window_show_loading_message (ev_window);
+	ev_job_scheduler_push_job (ev_window->priv->load_job, EV_JOB_PRIORITY_NONE);
+
+	ev_window_cancel_download (ev_window);
+	ev_window->priv->download_cancellable = g_cancellable_new ();
+	ev_range_stream_download_async (stream, G_PRIORITY_LOW,
+					ev_window->priv->download_cancellable,
+					(GAsyncReadyCallback)window_open_remote_download_cb,
+					ev_window);
+	g_object_unref (stream);
+}
+
+static void
+ev_window_load_file_remote (EvWindow *ev_window,
+			    GFile    *source_file)
+{
 	if (!ev_window->priv->local_uri) {
 		char *base_name, *template;
                 GFile *tmp_file;
@@ -2085,20 +2193,15 @@ ev_window_load_file_remote (EvWindow *ev_window,
 	}
 
 	ev_window_reset_progress_cancellable (ev_window);
-	
-	target_file = g_file_new_for_uri (ev_window->priv->local_uri);
-	g_file_copy_async (source_file, target_file,
-			   G_FILE_COPY_OVERWRITE,
-			   G_PRIORITY_DEFAULT,
-			   ev_window->priv->progress_cancellable,
-			   (GFileProgressCallback)window_open_file_copy_progress_cb,
-			   ev_window, 
-			   (GAsyncReadyCallback)window_open_file_copy_ready_cb,
-			   ev_window);
-	g_object_unref (target_file);
 
-	ev_window_show_progress_message (ev_window, 1,
-					 (GSourceFunc)show_loading_progress);
+	g_file_query_info_async (source_file,
+				 G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+				 G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				 G_FILE_QUERY_INFO_NONE,
+				 G_PRIORITY_DEFAULT,
+				 ev_window->priv->progress_cancellable,
+				 (GAsyncReadyCallback)window_open_remote_info_cb,
+				 ev_window);
 }
 
 void
@@ -2170,6 +2273,8 @@ ev_window_open_uri (EvWindow       *ev_window,
 	setup_model_from_metadata (ev_window);
 
 	ev_window->priv->load_job = ev_job_load_new (uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (ev_window->priv->load_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE);
 	g_signal_connect (ev_window->priv->load_job,
 			  "finished",
 			  G_CALLBACK (ev_window_load_job_cb),
@@ -2296,6 +2401,8 @@ ev_window_reload_local (EvWindow *ev_window)
 	
 	uri = ev_window->priv->local_uri ? ev_window->priv->local_uri : ev_window->priv->uri;
 	ev_window->priv->reload_job = ev_job_load_new (uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (ev_window->priv->reload_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE);
 	g_signal_connect (ev_window->priv->reload_job, "finished",
 			  G_CALLBACK (ev_window_reload_job_cb),
 			  ev_window);
@@ -2403,6 +2510,7 @@ query_remote_uri_mtime_cb (GFile        *remote,
 		/* Remote file has changed */
 		ev_window->priv->uri_mtime = mtime.tv_sec;
 
+		ev_window_cancel_download (ev_window);
 		ev_window_reset_progress_cancellable (ev_window);
 		
 		target_file = g_file_new_for_uri (ev_window->priv->local_uri);
@@ -4315,6 +4423,9 @@ ev_window_run_presentation (EvWindow *window)
 								    current_page,
 								    rotation,
 								    inverted_colors);
+	ev_view_presentation_set_look_ahead (EV_VIEW_PRESENTATION (window->priv->presentation_view),
+					     g_settings_get_uint (ev_window_ensure_settings (window),
+								  GS_PRESENTATION_LOOK_AHEAD));
 	g_signal_connect_swapped (window->priv->presentation_view, "finished",
 				  G_CALLBACK (ev_window_view_presentation_finished),
 				  window);
@@ -6235,10 +6346,10 @@ image_save_dialog_response_cb (GtkWidget *fc,
                         goto has_error;
 	}
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (ev_window->priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (ev_window->priv->document),
 					       ev_window->priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (ev_window->priv->document);
 
 	file_format = gdk_pixbuf_format_get_name (format);
 	gdk_pixbuf_save (pixbuf, filename, file_format, &error, NULL);
@@ -6326,10 +6437,10 @@ ev_window_popup_cmd_copy_image (GSimpleAction *action,
 	
 	clipboard = gtk_widget_get_clipboard (GTK_WIDGET (window),
 					      GDK_SELECTION_CLIPBOARD);
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (window->priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (window->priv->document),
 					       window->priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (window->priv->document);
 	
 	gtk_clipboard_set_image (clipboard, pixbuf);
 	g_object_unref (pixbuf);
@@ -6394,11 +6505,11 @@ ev_window_popup_cmd_annot_properties (GSimpleAction *action,
 	}
 
 	if (mask != EV_ANNOTATIONS_SAVE_NONE) {
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (window->priv->document);
 		ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (window->priv->document),
 							 window->priv->annot,
 							 mask);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (window->priv->document);
 
 		/* FIXME: update annot region only */
 		ev_view_reload (EV_VIEW (window->priv->view));
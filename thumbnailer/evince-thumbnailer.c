@@ -25,6 +25,9 @@
 #include <locale.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef G_OS_UNIX
+#include <signal.h>
+#endif
 
 #ifdef G_OS_WIN32
 #include <io.h>
@@ -42,11 +45,17 @@ static gboolean finished = TRUE;
 
 static gint size = THUMBNAIL_SIZE;
 static gboolean time_limit = TRUE;
+static gboolean batch = FALSE;
+static gboolean worker = FALSE;
+static gint n_workers = 0;
 static const gchar **file_arguments;
 
 static const GOptionEntry goption_options[] = {
 	{ "size", 's', 0, G_OPTION_ARG_INT, &size, NULL, "SIZE" },
         { "no-limit", 'l', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &time_limit, "Don't limit the thumbnailing time to 15 seconds", NULL },
+	{ "batch", 'b', 0, G_OPTION_ARG_NONE, &batch, "Read lines of <input> and <output>, separated by a tab, from the standard input", NULL },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &n_workers, "Number of files thumbnailed at the same time in batch mode", "N" },
+	{ "worker", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &worker, NULL, NULL },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "<input> <ouput>" },
 	{ NULL }
 };
@@ -126,11 +135,56 @@ get_local_path (GFile *file)
 	return g_file_get_path (file);
 }
 
+/* Only the first page is needed, so when the backend can read a
+ * stream, the remote file is read through a range stream instead of
+ * being copied.
+ */
+static EvDocument *
+evince_thumbnailer_get_document_for_range_stream (GFile   *file,
+						  GFile   *tmp_file,
+						  GError **error)
+{
+	EvDocument    *document;
+	EvRangeStream *stream;
+	GFileInfo     *info;
+	const gchar   *content_type;
+	gchar         *mime_type = NULL;
+	goffset        size;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (!info)
+		return NULL;
+
+	content_type = g_file_info_get_content_type (info);
+	if (content_type)
+		mime_type = g_content_type_get_mime_type (content_type);
+	size = g_file_info_get_size (info);
+	g_object_unref (info);
+
+	if (!mime_type || size <= 0 || !ev_document_factory_can_load_stream (mime_type)) {
+		g_free (mime_type);
+		return NULL;
+	}
+
+	stream = ev_range_stream_new (file, tmp_file, size);
+	document = ev_document_factory_get_document_for_stream (G_INPUT_STREAM (stream),
+								mime_type,
+								EV_DOCUMENT_LOAD_FLAG_NO_CACHE,
+								NULL, error);
+	g_object_unref (stream);
+	g_free (mime_type);
+
+	return document;
+}
+
 static EvDocument *
 evince_thumbnailer_get_document (GFile *file)
 {
 	EvDocument *document = NULL;
-	gchar      *uri, *path;
+	gchar      *uri = NULL, *path;
 	GFile      *tmp_file = NULL;
 	GError     *error = NULL;
 
@@ -152,22 +206,27 @@ evince_thumbnailer_get_document (GFile *file)
 			return NULL;
 		}
 
-		g_file_copy (file, tmp_file, G_FILE_COPY_OVERWRITE,
-			     NULL, NULL, NULL, &error);
-		if (error) {
-			g_printerr ("Error loading remote document: %s\n", error->message);
-			g_error_free (error);
-			g_object_unref (tmp_file);
-
-			return NULL;
+		document = evince_thumbnailer_get_document_for_range_stream (file, tmp_file, &error);
+		if (!document && !error) {
+			g_file_copy (file, tmp_file, G_FILE_COPY_OVERWRITE,
+				     NULL, NULL, NULL, &error);
+			if (error) {
+				g_printerr ("Error loading remote document: %s\n", error->message);
+				g_error_free (error);
+				ev_tmp_file_unlink (tmp_file);
+				g_object_unref (tmp_file);
+
+				return NULL;
+			}
+			uri = g_file_get_uri (tmp_file);
 		}
-		uri = g_file_get_uri (tmp_file);
 	} else {
 		uri = g_filename_to_uri (path, NULL, NULL);
 		g_free (path);
 	}
 
-	document = ev_document_factory_get_document_full (uri, EV_DOCUMENT_LOAD_FLAG_NO_CACHE, &error);
+	if (uri)
+		document = ev_document_factory_get_document_full (uri, EV_DOCUMENT_LOAD_FLAG_NO_CACHE, &error);
 	if (tmp_file) {
 		if (document) {
 			g_object_weak_ref (G_OBJECT (document),
@@ -226,17 +285,391 @@ evince_thumbnail_pngenc_get (EvDocument *document, const char *thumbnail, int si
 static gpointer
 evince_thumbnail_pngenc_get_async (struct AsyncData *data)
 {
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (data->document);
 	data->success = evince_thumbnail_pngenc_get (data->document,
 						     data->output,
 						     data->size);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (data->document);
 	
 	g_idle_add ((GSourceFunc)gtk_main_quit, NULL);
 	
 	return NULL;
 }
 
+static gboolean
+evince_thumbnailer_render (EvDocument *document,
+			   const char *output)
+{
+	struct AsyncData data;
+	GThread         *thread;
+
+	if (!EV_IS_ASYNC_RENDERER (document))
+		return evince_thumbnail_pngenc_get (document, output, size);
+
+	gtk_init (NULL, NULL);
+
+	data.document = document;
+	data.output = output;
+	data.size = size;
+
+	thread = g_thread_new ("ThmbnlrAsyncRndr",
+			       (GThreadFunc) evince_thumbnail_pngenc_get_async,
+			       &data);
+
+	gtk_main ();
+	g_thread_join (thread);
+
+	return data.success;
+}
+
+/* Batch mode: the files are thumbnailed by worker processes, which are
+ * this same program run with --worker. A worker loads the backends
+ * once and thumbnails the files it's given one at a time: it reads a
+ * line with the input and output from its stdin and answers with a
+ * line, OK or FAILED, on its stdout. A worker taking too much time for
+ * a file, or crashing, is replaced by a new one.
+ */
+static gint
+evince_thumbnailer_worker (void)
+{
+	GIOChannel *channel;
+	gchar      *line;
+	gsize       eol;
+
+	channel = g_io_channel_unix_new (0);
+	g_io_channel_set_encoding (channel, NULL, NULL);
+
+	while (g_io_channel_read_line (channel, &line, NULL, &eol, NULL) == G_IO_STATUS_NORMAL) {
+		EvDocument *document;
+		GFile      *file;
+		gchar      *output;
+		gboolean    success = FALSE;
+
+		line[eol] = '\0';
+		output = strchr (line, '\t');
+		if (output) {
+			*output++ = '\0';
+
+			file = g_file_new_for_commandline_arg (line);
+			document = evince_thumbnailer_get_document (file);
+			g_object_unref (file);
+
+			if (document) {
+				success = evince_thumbnailer_render (document, output);
+				g_object_unref (document);
+			}
+		}
+		g_free (line);
+
+		g_print ("%s\n", success ? "OK" : "FAILED");
+		fflush (stdout);
+	}
+
+	g_io_channel_unref (channel);
+
+	return 0;
+}
+
+typedef struct _Batch Batch;
+
+typedef struct {
+	Batch      *batch;
+	GPid        pid;
+	GIOChannel *in;
+	GIOChannel *out;
+	guint       out_watch_id;
+	guint       timeout_id;
+	gchar      *task;
+} Worker;
+
+struct _Batch {
+	const gchar *program;
+	GMainLoop   *loop;
+	GQueue       tasks;
+	gboolean     eof;
+	gboolean     failed;
+	Worker      *workers;
+	gint         n_workers;
+};
+
+static void batch_dispatch (Batch *batch);
+
+static void
+batch_report (Batch       *batch,
+	      const gchar *task,
+	      const gchar *status)
+{
+	const gchar *tab = strchr (task, '\t');
+
+	if (strcmp (status, "OK") != 0)
+		batch->failed = TRUE;
+
+	g_print ("%.*s\t%s\n", (int) (tab - task), task, status);
+	fflush (stdout);
+}
+
+static void
+worker_exited_cb (GPid     pid,
+		  gint     status,
+		  gpointer user_data)
+{
+	g_spawn_close_pid (pid);
+}
+
+static void
+worker_stop (Worker *worker)
+{
+	if (worker->out_watch_id > 0) {
+		g_source_remove (worker->out_watch_id);
+		worker->out_watch_id = 0;
+	}
+	if (worker->timeout_id > 0) {
+		g_source_remove (worker->timeout_id);
+		worker->timeout_id = 0;
+	}
+	g_clear_pointer (&worker->in, g_io_channel_unref);
+	g_clear_pointer (&worker->out, g_io_channel_unref);
+	g_clear_pointer (&worker->task, g_free);
+
+	if (worker->pid) {
+#ifdef G_OS_WIN32
+		TerminateProcess (worker->pid, 1);
+#else
+		kill (worker->pid, SIGKILL);
+#endif
+		worker->pid = 0;
+	}
+}
+
+static gboolean
+worker_timeout_cb (Worker *worker)
+{
+	const gchar *app_name;
+
+	worker->timeout_id = 0;
+
+	app_name = g_get_application_name ();
+	if (app_name == NULL)
+		app_name = g_get_prgname ();
+	g_printerr ("%s couldn't process file: '%.*s'\n"
+		    "Reason: Took too much time to process.\n",
+		    app_name,
+		    (int) strcspn (worker->task, "\t"), worker->task);
+
+	batch_report (worker->batch, worker->task, "TIMEOUT");
+	worker_stop (worker);
+	batch_dispatch (worker->batch);
+
+	return FALSE;
+}
+
+static gboolean
+worker_out_cb (GIOChannel   *channel,
+	       GIOCondition  condition,
+	       Worker       *worker)
+{
+	gchar *line;
+	gsize  eol;
+
+	if (g_io_channel_read_line (channel, &line, NULL, &eol, NULL) != G_IO_STATUS_NORMAL) {
+		worker->out_watch_id = 0;
+		if (worker->task)
+			batch_report (worker->batch, worker->task, "CRASHED");
+		worker_stop (worker);
+		batch_dispatch (worker->batch);
+
+		return FALSE;
+	}
+
+	line[eol] = '\0';
+	if (worker->task) {
+		batch_report (worker->batch, worker->task, line);
+		g_clear_pointer (&worker->task, g_free);
+	}
+	g_free (line);
+
+	if (worker->timeout_id > 0) {
+		g_source_remove (worker->timeout_id);
+		worker->timeout_id = 0;
+	}
+
+	batch_dispatch (worker->batch);
+
+	return TRUE;
+}
+
+static gboolean
+worker_start (Worker *worker)
+{
+	gchar   *argv[5];
+	gchar    size_str[16];
+	gint     in_fd, out_fd;
+	GError  *error = NULL;
+
+	g_snprintf (size_str, sizeof (size_str), "%d", size);
+	argv[0] = (gchar *) worker->batch->program;
+	argv[1] = "--worker";
+	argv[2] = "--size";
+	argv[3] = size_str;
+	argv[4] = NULL;
+
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL,
+				       G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+				       NULL, NULL,
+				       &worker->pid, &in_fd, &out_fd, NULL,
+				       &error)) {
+		g_printerr ("Error starting worker: %s\n", error->message);
+		g_error_free (error);
+
+		return FALSE;
+	}
+	g_child_watch_add (worker->pid, worker_exited_cb, NULL);
+
+	worker->in = g_io_channel_unix_new (in_fd);
+	g_io_channel_set_encoding (worker->in, NULL, NULL);
+	g_io_channel_set_close_on_unref (worker->in, TRUE);
+
+	worker->out = g_io_channel_unix_new (out_fd);
+	g_io_channel_set_encoding (worker->out, NULL, NULL);
+	g_io_channel_set_close_on_unref (worker->out, TRUE);
+	worker->out_watch_id = g_io_add_watch (worker->out, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					       (GIOFunc) worker_out_cb, worker);
+
+	return TRUE;
+}
+
+static gboolean
+worker_run_task (Worker *worker,
+		 gchar  *task)
+{
+	worker->task = task;
+
+	if (g_io_channel_write_chars (worker->in, task, -1, NULL, NULL) != G_IO_STATUS_NORMAL ||
+	    g_io_channel_write_chars (worker->in, "\n", 1, NULL, NULL) != G_IO_STATUS_NORMAL ||
+	    g_io_channel_flush (worker->in, NULL) != G_IO_STATUS_NORMAL)
+		return FALSE;
+
+	if (time_limit)
+		worker->timeout_id = g_timeout_add_seconds (DEFAULT_SLEEP_TIME / G_USEC_PER_SEC,
+							    (GSourceFunc) worker_timeout_cb,
+							    worker);
+
+	return TRUE;
+}
+
+static void
+batch_dispatch (Batch *batch)
+{
+	gboolean busy = FALSE;
+	gint     i;
+
+	for (i = 0; i < batch->n_workers; i++) {
+		Worker *worker = &batch->workers[i];
+
+		while (!worker->task && !g_queue_is_empty (&batch->tasks)) {
+			gchar *task = g_queue_pop_head (&batch->tasks);
+
+			if (!worker->pid && !worker_start (worker)) {
+				batch_report (batch, task, "FAILED");
+				g_free (task);
+				continue;
+			}
+
+			if (!worker_run_task (worker, task)) {
+				batch_report (batch, task, "CRASHED");
+				worker_stop (worker);
+				continue;
+			}
+		}
+
+		busy |= worker->task != NULL;
+	}
+
+	if (batch->eof && !busy && g_queue_is_empty (&batch->tasks))
+		g_main_loop_quit (batch->loop);
+}
+
+static gboolean
+batch_input_cb (GIOChannel   *channel,
+		GIOCondition  condition,
+		Batch        *batch)
+{
+	GIOStatus status;
+	gchar    *line;
+	gsize     eol;
+
+	/* The channel is non-blocking: it keeps a partial line in its
+	 * buffer until the rest of it is available.
+	 */
+	while ((status = g_io_channel_read_line (channel, &line, NULL, &eol, NULL)) == G_IO_STATUS_NORMAL) {
+		line[eol] = '\0';
+		if (strchr (line, '\t')) {
+			g_queue_push_tail (&batch->tasks, line);
+		} else {
+			if (*line)
+				g_printerr ("Invalid line: '%s', expected <input> and <output> separated by a tab\n", line);
+			g_free (line);
+		}
+	}
+
+	if (status != G_IO_STATUS_AGAIN)
+		batch->eof = TRUE;
+	batch_dispatch (batch);
+
+	return !batch->eof;
+}
+
+static gint
+evince_thumbnailer_batch (const gchar *program)
+{
+	Batch       batch;
+	GIOChannel *channel;
+	GIOFlags    flags;
+	gint        i;
+
+#ifdef G_OS_UNIX
+	/* A worker can die while we write to it */
+	signal (SIGPIPE, SIG_IGN);
+#endif
+
+	memset (&batch, 0, sizeof (batch));
+	batch.program = program;
+	batch.loop = g_main_loop_new (NULL, FALSE);
+	g_queue_init (&batch.tasks);
+	batch.n_workers = n_workers > 0 ? n_workers : (gint) g_get_num_processors ();
+	batch.workers = g_new0 (Worker, batch.n_workers);
+	for (i = 0; i < batch.n_workers; i++)
+		batch.workers[i].batch = &batch;
+
+	/* Reading stdin must not block the workers in the main loop */
+	channel = g_io_channel_unix_new (0);
+	g_io_channel_set_encoding (channel, NULL, NULL);
+	flags = g_io_channel_get_flags (channel);
+	g_io_channel_set_flags (channel, flags | G_IO_FLAG_NONBLOCK, NULL);
+	g_io_add_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+			(GIOFunc) batch_input_cb, &batch);
+
+	g_main_loop_run (batch.loop);
+
+	/* stdin can be shared with the process that started us */
+	g_io_channel_set_flags (channel, flags, NULL);
+
+	/* Idle workers exit when their stdin is closed */
+	for (i = 0; i < batch.n_workers; i++) {
+		Worker *worker = &batch.workers[i];
+
+		if (worker->out_watch_id > 0)
+			g_source_remove (worker->out_watch_id);
+		g_clear_pointer (&worker->in, g_io_channel_unref);
+		g_clear_pointer (&worker->out, g_io_channel_unref);
+	}
+	g_free (batch.workers);
+	g_io_channel_unref (channel);
+	g_main_loop_unref (batch.loop);
+
+	return batch.failed ? -2 : 0;
+}
+
 static void
 print_usage (GOptionContext *context)
 {
@@ -273,7 +706,7 @@ main (int argc, char *argv[])
 
 	input = file_arguments ? file_arguments[0] : NULL;
 	output = input ? file_arguments[1] : NULL;
-	if (!input || !output) {
+	if ((!input || !output) && !batch && !worker) {
 		print_usage (context);
 		g_option_context_free (context);
 
@@ -287,12 +720,20 @@ main (int argc, char *argv[])
 		return -1;
 	}
 
-	input = file_arguments[0];
-	output = file_arguments[1];
+	if (batch)
+		return evince_thumbnailer_batch (argv[0]);
 
         if (!ev_init ())
                 return -1;
 
+	if (worker) {
+		gint retval = evince_thumbnailer_worker ();
+
+		ev_shutdown ();
+
+		return retval;
+	}
+
 	file = g_file_new_for_commandline_arg (input);
 	document = evince_thumbnailer_get_document (file);
 	g_object_unref (file);
@@ -305,28 +746,7 @@ main (int argc, char *argv[])
         if (time_limit)
                 time_monitor_start (input);
 
-	if (EV_IS_ASYNC_RENDERER (document)) {
-		struct AsyncData data;
-
-		gtk_init (&argc, &argv);
-		
-		data.document = document;
-		data.output = output;
-		data.size = size;
-
-		g_thread_new ("ThmbnlrAsyncRndr",
-				(GThreadFunc) evince_thumbnail_pngenc_get_async,
-				&data);
-		
-		gtk_main ();
-
-		g_object_unref (document);
-		ev_shutdown ();
-
-		return data.success ? 0 : -2;
-	}
-
-	if (!evince_thumbnail_pngenc_get (document, output, size)) {
+	if (!evince_thumbnailer_render (document, output)) {
 		g_object_unref (document);
 		ev_shutdown ();
 		return -2;